@@ -0,0 +1,1021 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Microbenchmarks for the SRTP and ZRTP building blocks.
+ *
+ * The program runs without any network and writes its results as JSON, one
+ * object per benchmark case, to stdout or to a file. Each case reports the
+ * time per operation, the operations (packets) per second, the heap
+ * allocations per operation and, on x86, the TSC cycles per processed byte.
+ * Compare the JSON of two builds to track regressions between releases.
+ *
+ * Usage: zrtpbench [-t <ms>] [-f <filter>] [-m <n>] [-o <file>] [-q]
+ *
+ *   -t   minimum run time per case in milliseconds, default 25
+ *   -f   run only cases whose name contains the filter string
+ *   -m   sample every n-th SRTP packet into the SRTP cycle histograms,
+ *        default 0 (off)
+ *   -o   write JSON to this file instead of stdout
+ *   -q   quick run: fewer payload sizes and algorithm combinations
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include <common/osSpecifics.h>
+
+#include <srtp/SrtpHandler.h>
+#include <srtp/CryptoContext.h>
+#include <srtp/CryptoContextCtrl.h>
+#include <srtp/SrtpMetrics.h>
+#include <srtp/crypto/SrtpSymCrypto.h>
+#include <srtp/crypto/hmac.h>
+#include <cryptcommon/macSkein.h>
+#include <cryptcommon/ZrtpRandom.h>
+#include <zrtp/crypto/hmac256.h>
+#include <zrtp/crypto/hmac384.h>
+#include <zrtp/crypto/skeinMac256.h>
+#include <zrtp/crypto/skeinMac384.h>
+#include <zrtp/crypto/sha2.h>
+#include <zrtp/crypto/zrtpDH.h>
+#include <libzrtpcpp/ZrtpTextData.h>
+#include <libzrtpcpp/ZrtpCrc32.h>
+#include <libzrtpcpp/ZrtpPacketClassifier.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZRtpPool.h>
+#include <libzrtpcpp/ZrtpNonceSet.h>
+
+using namespace std;
+using namespace GnuZrtpCodes;
+
+struct BenchResult {
+    string group;
+    string name;
+    const char* unit;
+    size_t bytesPerOp;
+    uint64_t ops;
+    double nsPerOp;
+    double opsPerSec;
+    double cyclesPerOp;     // negative if no cycle counter available
+    double allocsPerOp;
+};
+
+/*
+ * Count the heap allocations of the program to measure the allocator
+ * pressure of a benchmark case. The benchmarks run in one thread.
+ */
+static uint64_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    allocations++;
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    allocations++;
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+static vector<BenchResult> results;
+static uint64_t minTimeNs = 25 * 1000 * 1000;
+static const char* filter = NULL;
+static bool quick = false;
+
+static inline uint64_t nowNs()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint64_t cycles()
+{
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static bool selected(const string& name)
+{
+    return filter == NULL || name.find(filter) != string::npos;
+}
+
+/*
+ * Accumulates timing of a benchmark case. Benchmarks that need untimed
+ * setup between timed sections (for example to prepare fresh SRTP packets
+ * for unprotect) call start() and stop() around the timed part only.
+ */
+class Measure {
+public:
+    Measure(): ns(0), cyc(0), ops(0), allocs(0), t0(0), c0(0), a0(0) {}
+
+    void start()               { a0 = allocations; t0 = nowNs(); c0 = cycles(); }
+    void stop(uint64_t count)  { cyc += cycles() - c0; ns += nowNs() - t0; allocs += allocations - a0; ops += count; }
+    bool done() const          { return ns >= minTimeNs; }
+
+    void report(const char* group, const string& name, const char* unit, size_t bytesPerOp) {
+        BenchResult r;
+        r.group = group;
+        r.name = name;
+        r.unit = unit;
+        r.bytesPerOp = bytesPerOp;
+        r.ops = ops;
+        r.nsPerOp = ops ? (double)ns / ops : 0.0;
+        r.opsPerSec = ns ? ops * 1e9 / ns : 0.0;
+        r.allocsPerOp = ops ? (double)allocs / ops : 0.0;
+#ifdef HAVE_TSC
+        r.cyclesPerOp = ops ? (double)cyc / ops : 0.0;
+#else
+        r.cyclesPerOp = -1.0;
+#endif
+        results.push_back(r);
+        fprintf(stderr, "%-56s %12.1f ns/op %14.1f %s/s\n", name.c_str(), r.nsPerOp, r.opsPerSec, unit);
+    }
+
+    uint64_t ns;
+    uint64_t cyc;
+    uint64_t ops;
+    uint64_t allocs;
+
+private:
+    uint64_t t0;
+    uint64_t c0;
+    uint64_t a0;
+};
+
+/*
+ * Run a self contained operation in growing batches until the minimum run time
+ * is reached.
+ */
+template <typename Op>
+static void runSimple(const char* group, const string& name, const char* unit, size_t bytesPerOp, Op op)
+{
+    if (!selected(name))
+        return;
+
+    Measure m;
+    uint64_t batch = 1;
+    while (!m.done()) {
+        m.start();
+        for (uint64_t i = 0; i < batch; i++)
+            op();
+        m.stop(batch);
+        if (batch < 1024 && m.ns < minTimeNs / 16)
+            batch *= 2;
+    }
+    m.report(group, name, unit, bytesPerOp);
+}
+
+// **** SRTP / SRTCP ****
+
+struct CipherSpec {
+    const char* name;
+    int32_t ealg;
+    int32_t keyLength;
+};
+
+struct AuthSpec {
+    const char* name;
+    int32_t aalg;
+    int32_t keyLength;
+    int32_t tagLength;
+};
+
+// The crypto contexts derive session keys with the configured cipher, thus no NULL cipher here
+static const CipherSpec ciphers[] = {
+    {"AES-CM-128",  SrtpEncryptionAESCM, 16},
+    {"AES-CM-256",  SrtpEncryptionAESCM, 32},
+    {"AES-F8-128",  SrtpEncryptionAESF8, 16},
+    {"TWO-CM-128",  SrtpEncryptionTWOCM, 16},
+    {"TWO-CM-256",  SrtpEncryptionTWOCM, 32},
+    {"TWO-F8-128",  SrtpEncryptionTWOF8, 16},
+};
+
+static const AuthSpec auths[] = {
+    {"NULL",         SrtpAuthenticationNull,       0,  0},
+    {"HMAC-SHA1-32", SrtpAuthenticationSha1Hmac,   20, 4},
+    {"HMAC-SHA1-80", SrtpAuthenticationSha1Hmac,   20, 10},
+    {"SKEIN-32",     SrtpAuthenticationSkeinHmac,  32, 4},
+    {"SKEIN-64",     SrtpAuthenticationSkeinHmac,  32, 8},
+    {"HMAC-SHA256-32", SrtpAuthenticationSha256Hmac, 32, 4},
+    {"HMAC-SHA256-64", SrtpAuthenticationSha256Hmac, 32, 8},
+};
+
+static const size_t payloadSizes[] = {20, 64, 160, 320, 640, 1000, 1400};
+static const size_t quickSizes[] = {20, 160, 1400};
+
+static const int batchSize = 64;
+static const int rtpHeaderLength = 12;
+static const int rtcpHeaderLength = 8;
+static const int maxTrailer = 4 + 20;       // SRTCP index plus longest tag
+
+static uint8_t masterKey[32];
+static uint8_t masterSalt[14];
+
+static CryptoContext* newSrtpContext(const CipherSpec& c, const AuthSpec& a)
+{
+    CryptoContext* cc = new CryptoContext(0xfeedbacc, 0, 0L, c.ealg, a.aalg,
+                                          masterKey, c.keyLength, masterSalt, sizeof(masterSalt),
+                                          c.keyLength, a.keyLength, sizeof(masterSalt), a.tagLength);
+    cc->deriveSrtpKeys(0);
+    return cc;
+}
+
+static CryptoContextCtrl* newSrtcpContext(const CipherSpec& c, const AuthSpec& a)
+{
+    CryptoContextCtrl* cc = new CryptoContextCtrl(0xfeedbacc, c.ealg, a.aalg,
+                                                  masterKey, c.keyLength, masterSalt, sizeof(masterSalt),
+                                                  c.keyLength, a.keyLength, sizeof(masterSalt), a.tagLength);
+    cc->deriveSrtcpKeys();
+    return cc;
+}
+
+static void fillRtp(uint8_t* buffer, uint16_t seq, size_t payloadLength)
+{
+    buffer[0] = 0x80;
+    buffer[1] = 0x00;
+    *reinterpret_cast<uint16_t*>(buffer + 2) = zrtpHtons(seq);
+    *reinterpret_cast<uint32_t*>(buffer + 4) = zrtpHtonl(seq * 160U);
+    *reinterpret_cast<uint32_t*>(buffer + 8) = zrtpHtonl(0xfeedbacc);
+    memset(buffer + rtpHeaderLength, 0x5a, payloadLength);
+}
+
+static void fillRtcp(uint8_t* buffer, size_t payloadLength)
+{
+    size_t words = (rtcpHeaderLength + payloadLength) / 4 - 1;
+    buffer[0] = 0x80;
+    buffer[1] = 200;                                    // sender report
+    *reinterpret_cast<uint16_t*>(buffer + 2) = zrtpHtons(static_cast<uint16_t>(words));
+    *reinterpret_cast<uint32_t*>(buffer + 4) = zrtpHtonl(0xfeedbacc);
+    memset(buffer + rtcpHeaderLength, 0x5a, payloadLength);
+}
+
+static void benchSrtpCase(const CipherSpec& c, const AuthSpec& a, size_t payload, vector<uint8_t>& mem)
+{
+    const size_t stride = rtpHeaderLength + payload + maxTrailer;
+    const size_t length = rtpHeaderLength + payload;
+    size_t newLength;
+    string suffix = string(c.name) + "/" + a.name + "/" + to_string(payload);
+
+    string name = "srtp/protect/" + suffix;
+    if (selected(name)) {
+        CryptoContext* send = newSrtpContext(c, a);
+        uint16_t seq = 1;
+        Measure m;
+        while (!m.done()) {
+            for (int i = 0; i < batchSize; i++)
+                fillRtp(&mem[i * stride], seq++, payload);
+            m.start();
+            for (int i = 0; i < batchSize; i++)
+                SrtpHandler::protect(send, &mem[i * stride], length, &newLength);
+            m.stop(batchSize);
+        }
+        m.report("srtp", name, "packet", payload);
+        delete send;
+    }
+
+    name = "srtp/unprotect/" + suffix;
+    if (selected(name)) {
+        CryptoContext* send = newSrtpContext(c, a);
+        CryptoContext* recv = newSrtpContext(c, a);
+        const size_t protectedLength = length + a.tagLength;
+        uint16_t seq = 1;
+        Measure m;
+        int failed = 0;
+        while (!m.done()) {
+            for (int i = 0; i < batchSize; i++) {
+                fillRtp(&mem[i * stride], seq++, payload);
+                SrtpHandler::protect(send, &mem[i * stride], length, &newLength);
+            }
+            m.start();
+            for (int i = 0; i < batchSize; i++)
+                failed += SrtpHandler::unprotect(recv, &mem[i * stride], protectedLength, &newLength) != 1;
+            m.stop(batchSize);
+        }
+        if (failed)
+            fprintf(stderr, "%s: unprotect failed\n", name.c_str());
+        m.report("srtp", name, "packet", payload);
+        delete send;
+        delete recv;
+    }
+
+    name = "srtcp/protect/" + suffix;
+    if (selected(name)) {
+        CryptoContextCtrl* send = newSrtcpContext(c, a);
+        const size_t ctrlLength = rtcpHeaderLength + payload;
+        Measure m;
+        while (!m.done()) {
+            for (int i = 0; i < batchSize; i++)
+                fillRtcp(&mem[i * stride], payload);
+            m.start();
+            for (int i = 0; i < batchSize; i++)
+                SrtpHandler::protectCtrl(send, &mem[i * stride], ctrlLength, &newLength);
+            m.stop(batchSize);
+        }
+        m.report("srtcp", name, "packet", payload);
+        delete send;
+    }
+
+    name = "srtcp/unprotect/" + suffix;
+    if (selected(name)) {
+        CryptoContextCtrl* send = newSrtcpContext(c, a);
+        CryptoContextCtrl* recv = newSrtcpContext(c, a);
+        const size_t ctrlLength = rtcpHeaderLength + payload;
+        const size_t protectedLength = ctrlLength + 4 + a.tagLength;
+        Measure m;
+        int failed = 0;
+        while (!m.done()) {
+            for (int i = 0; i < batchSize; i++) {
+                fillRtcp(&mem[i * stride], payload);
+                SrtpHandler::protectCtrl(send, &mem[i * stride], ctrlLength, &newLength);
+            }
+            m.start();
+            for (int i = 0; i < batchSize; i++)
+                failed += SrtpHandler::unprotectCtrl(recv, &mem[i * stride], protectedLength, &newLength) != 1;
+            m.stop(batchSize);
+        }
+        if (failed)
+            fprintf(stderr, "%s: unprotect failed\n", name.c_str());
+        m.report("srtcp", name, "packet", payload);
+        delete send;
+        delete recv;
+    }
+}
+
+static void benchSrtp()
+{
+    vector<uint8_t> mem(batchSize * (rtpHeaderLength + 1400 + maxTrailer));
+
+    const size_t* sizes = quick ? quickSizes : payloadSizes;
+    size_t numSizes = quick ? sizeof(quickSizes) / sizeof(quickSizes[0]) : sizeof(payloadSizes) / sizeof(payloadSizes[0]);
+
+    for (size_t ci = 0; ci < sizeof(ciphers) / sizeof(ciphers[0]); ci++) {
+        for (size_t ai = 0; ai < sizeof(auths) / sizeof(auths[0]); ai++) {
+            // In quick mode run the full matrix of algorithms with the RFC 3711 default tag only
+            if (quick && auths[ai].aalg != SrtpAuthenticationNull && auths[ai].tagLength != 10 &&
+                auths[ai].tagLength != 8)
+                continue;
+            for (size_t si = 0; si < numSizes; si++)
+                benchSrtpCase(ciphers[ci], auths[ai], sizes[si], mem);
+        }
+    }
+}
+
+// **** Symmetric ciphers ****
+
+// CTR mode with single block encryption, as SrtpSymCrypto does it for AES
+static void ctrByBlocks(SrtpSymCrypto& cipher, const uint8_t* in, uint32_t length, uint8_t* out, uint8_t* iv)
+{
+    uint8_t stream[SRTP_BLOCK_SIZE];
+
+    for (uint32_t i = 0; i < length; i += SRTP_BLOCK_SIZE) {
+        uint16_t ctr = static_cast<uint16_t>(i / SRTP_BLOCK_SIZE);
+        iv[14] = static_cast<uint8_t>(ctr >> 8);
+        iv[15] = static_cast<uint8_t>(ctr);
+        cipher.encrypt(iv, stream);
+        for (uint32_t j = i; j < length && j < i + SRTP_BLOCK_SIZE; j++)
+            out[j] = in[j] ^ stream[j - i];
+    }
+}
+
+static void benchCiphers()
+{
+    uint8_t iv[16];
+    uint8_t data[1400];
+    uint8_t out[1400];
+
+    memset(iv, 0, sizeof(iv));
+    memset(data, 0x5a, sizeof(data));
+
+    const size_t* sizes = quick ? quickSizes : payloadSizes;
+    size_t numSizes = quick ? sizeof(quickSizes) / sizeof(quickSizes[0]) : sizeof(payloadSizes) / sizeof(payloadSizes[0]);
+
+    for (size_t ci = 0; ci < sizeof(ciphers) / sizeof(ciphers[0]); ci++) {
+        const CipherSpec& c = ciphers[ci];
+        bool f8 = c.ealg == SrtpEncryptionAESF8 || c.ealg == SrtpEncryptionTWOF8;
+        SrtpSymCrypto cipher(masterKey, c.keyLength, c.ealg);
+        SrtpSymCrypto f8Cipher(c.ealg);
+        if (f8)
+            cipher.f8_deriveForIV(&f8Cipher, masterKey, c.keyLength, masterSalt, sizeof(masterSalt));
+
+        for (size_t si = 0; si < numSizes; si++) {
+            uint32_t len = static_cast<uint32_t>(sizes[si]);
+            string name = string("cipher/") + c.name + "/" + to_string(len);
+            if (f8)
+                runSimple("cipher", name, "op", len, [&]() { cipher.f8_encrypt(data, len, out, iv, &f8Cipher); });
+            else
+                runSimple("cipher", name, "op", len, [&]() { cipher.ctr_encrypt(data, len, out, iv); });
+
+            // Twofish CTR has its own multi-block code, compare with one block at a time
+            if (c.ealg == SrtpEncryptionTWOCM)
+                runSimple("cipher", string("cipher/") + c.name + "/blocks/" + to_string(len), "op", len,
+                          [&]() { ctrByBlocks(cipher, data, len, out, iv); });
+        }
+    }
+}
+
+// **** MAC functions ****
+
+/*
+ * The pre-keyed contexts as SRTP uses them. The
+ * x4 cases compute four MACs of different packets per op, with the vector
+ * block function and with the portable code, for example
+ * mac/skein512_ctx_x4/avx2/160.
+ */
+static void benchMacContexts(const uint8_t* key, const uint8_t* data, const size_t* sizes, size_t numSizes)
+{
+    uint8_t mac[4][64];
+    uint8_t* macs[4] = {mac[0], mac[1], mac[2], mac[3]};
+    const uint8_t* packets[4];
+    uint64_t lengths[4];
+    uint32_t macLength;
+
+    void* sha1Ctx = createSha1HmacContext(key, 20);
+    void* skeinCtx = createSkeinMacContext(key, 32, 32 * 8, Skein512);
+
+    Skein_Use_Accel(1);
+    int passes = string(Skein_512_Impl()) != "c" ? 2 : 1;
+
+    for (size_t si = 0; si < numSizes; si++) {
+        size_t len = sizes[si];
+        string size = to_string(len);
+
+        for (int i = 0; i < 4; i++) {
+            packets[i] = data + i;
+            lengths[i] = len - i;
+        }
+        runSimple("mac", "mac/hmac_sha1_ctx/" + size, "op", len,
+                  [&]() { hmacSha1Ctx(sha1Ctx, DataChunks(data, len), mac[0], &macLength); });
+        runSimple("mac", "mac/skein512_ctx/" + size, "op", len,
+                  [&]() { macSkeinCtx(skeinCtx, data, len, mac[0]); });
+
+        for (int pass = 0; pass < passes; pass++) {
+            Skein_Use_Accel(pass == 0);
+            string impl = Skein_512_Impl();
+            runSimple("mac", "mac/skein512_ctx_x4/" + impl + "/" + size, "op", 4 * len,
+                      [&]() { macSkeinCtxMulti(skeinCtx, 4, packets, lengths, macs); });
+        }
+        Skein_Use_Accel(1);
+    }
+    freeSha1HmacContext(sha1Ctx);
+    freeSkeinMacContext(skeinCtx);
+}
+
+static void benchMacs()
+{
+    uint8_t key[32];
+    uint8_t data[1400];
+    uint8_t mac[64];
+
+    memset(key, 0x11, sizeof(key));
+    memset(data, 0x5a, sizeof(data));
+
+    const size_t* sizes = quick ? quickSizes : payloadSizes;
+    size_t numSizes = quick ? sizeof(quickSizes) / sizeof(quickSizes[0]) : sizeof(payloadSizes) / sizeof(payloadSizes[0]);
+
+    for (size_t si = 0; si < numSizes; si++) {
+        size_t len = sizes[si];
+        string size = to_string(len);
+        int32_t macLength;
+        uint32_t macLength32;
+
+        runSimple("mac", "mac/hmac_sha1/" + size, "op", len,
+                  [&]() { hmac_sha1(key, (int64_t)20, data, len, mac, &macLength); });
+        runSimple("mac", "mac/hmac_sha256/" + size, "op", len,
+                  [&]() { hmac_sha256(key, 32, data, len, mac, &macLength32); });
+        runSimple("mac", "mac/macSkein512-256/" + size, "op", len,
+                  [&]() { macSkein(key, 32, data, len, mac, 256, Skein512); });
+    }
+    benchMacContexts(key, data, sizes, numSizes);
+}
+
+// **** SHA2 hashes ****
+
+/*
+ * Runs the hashes and the pre-keyed HMAC-SHA256 with the block functions for
+ * the CPU extensions and with the portable code. The case names contain the
+ * name of the block function, for example hash/sha256/sha-ni/64.
+ */
+static void benchHashes()
+{
+    static const size_t hashSizes[] = {64, 1024};
+    uint8_t key[32];
+    uint8_t data[1024];
+    uint8_t digest[SHA512_DIGEST_SIZE];
+    uint32_t macLength;
+
+    memset(key, 0x11, sizeof(key));
+    memset(data, 0x5a, sizeof(data));
+    void* hmacCtx = createSha256HmacContext(key, sizeof(key));
+
+    // The portable code runs in the first pass if the CPU has no extensions
+    sha2_use_accel(1);
+    int passes = (string(sha256_impl()) != "c" || string(sha512_impl()) != "c") ? 2 : 1;
+
+    for (int pass = 0; pass < passes; pass++) {
+        sha2_use_accel(pass == 0);
+        string impl256 = sha256_impl();
+        string impl512 = sha512_impl();
+
+        for (size_t si = 0; si < sizeof(hashSizes) / sizeof(hashSizes[0]); si++) {
+            size_t len = hashSizes[si];
+            string size = to_string(len);
+
+            runSimple("hash", "hash/sha256/" + impl256 + "/" + size, "op", len,
+                      [&]() { sha256_zrtp(digest, data, len); });
+            runSimple("hash", "hash/hmac_sha256_ctx/" + impl256 + "/" + size, "op", len,
+                      [&]() { hmacSha256Ctx(hmacCtx, data, len, digest, &macLength); });
+            runSimple("hash", "hash/sha384/" + impl512 + "/" + size, "op", len,
+                      [&]() { sha384_zrtp(digest, data, len); });
+            runSimple("hash", "hash/sha512/" + impl512 + "/" + size, "op", len,
+                      [&]() { sha512_zrtp(digest, data, len); });
+        }
+    }
+    sha2_use_accel(1);
+    freeSha256HmacContext(hmacCtx);
+}
+
+// **** ZRTP packet checksum ****
+
+/*
+ * Runs the CRC32C check of received ZRTP packets with the crc32 instruction
+ * and with the portable code. The sizes are a HelloACK, a Commit, a DHPart
+ * for DH-3072 and a large junk packet, for example cksum/sse4.2/468.
+ */
+static void benchCksum()
+{
+    static const size_t cksumSizes[] = {24, 116, 468, 1400};
+    uint8_t data[1400];
+
+    memset(data, 0x5a, sizeof(data));
+
+    // The portable code runs in the first pass if the CPU has no SSE 4.2
+    zrtpCksumUseAccel(1);
+    int passes = string(zrtpCksumImpl()) != "slice8" ? 2 : 1;
+
+    for (int pass = 0; pass < passes; pass++) {
+        zrtpCksumUseAccel(pass == 0);
+        string impl = zrtpCksumImpl();
+
+        for (size_t si = 0; si < sizeof(cksumSizes) / sizeof(cksumSizes[0]); si++) {
+            size_t len = cksumSizes[si];
+            runSimple("cksum", "cksum/" + impl + "/" + to_string(len), "op", len,
+                      [&]() { zrtpCheckCksum(data, (uint16_t)len, 0x12345678); });
+        }
+    }
+    zrtpCksumUseAccel(1);
+}
+
+// **** Ingress classification ****
+
+/*
+ * Junk with the first byte of a ZRTP packet paid a full CRC before the
+ * classifier checked the magic cookie, length and message type first. The
+ * batch mixes junk, RTP and HelloACK packets as a flooded port sees them.
+ */
+static void benchClassifier()
+{
+    static const size_t junkSize = 200;
+    static const size_t batchSize = 32;
+    uint8_t junk[junkSize];
+    uint8_t rtp[junkSize];
+    uint8_t helloAck[12 + sizeof(HelloAckPacket_t)];
+    const uint8_t* packets[batchSize];
+    size_t lengths[batchSize];
+    ZrtpPacketClassifier::PacketClass classes[batchSize];
+    ZrtpPacketClassifier classifier;
+
+    randomZRTP(junk, sizeof(junk));
+    junk[0] = 0x10;
+    memset(rtp, 0x5a, sizeof(rtp));
+    rtp[0] = 0x80;
+
+    memset(helloAck, 0, sizeof(helloAck));
+    helloAck[0] = 0x10;
+    *reinterpret_cast<uint32_t*>(helloAck + 4) = zrtpHtonl(ZRTP_MAGIC);
+    *reinterpret_cast<uint16_t*>(helloAck + 12) = zrtpHtons(0x505a);
+    *reinterpret_cast<uint16_t*>(helloAck + 14) = zrtpHtons(3);
+    memcpy(helloAck + 16, HelloAckMsg, TYPE_SIZE);
+    uint16_t crcOffset = sizeof(helloAck) - CRC_SIZE;
+    *reinterpret_cast<uint32_t*>(helloAck + crcOffset) = zrtpHtonl(zrtpEndCksum(zrtpGenerateCksum(helloAck, crcOffset)));
+
+    for (size_t i = 0; i < batchSize; i++) {
+        packets[i] = (i % 8 == 0) ? rtp : (i % 8 == 1) ? helloAck : junk;
+        lengths[i] = (i % 8 == 1) ? sizeof(helloAck) : junkSize;
+    }
+
+    runSimple("ingress", "ingress/junk/crc_only/200", "op", junkSize,
+              [&]() { zrtpCheckCksum(junk, junkSize - CRC_SIZE, 0x12345678); });
+    runSimple("ingress", "ingress/junk/classify/200", "op", junkSize,
+              [&]() { classifier.check(junk, junkSize); });
+    runSimple("ingress", "ingress/zrtp/classify/28", "op", sizeof(helloAck),
+              [&]() { classifier.check(helloAck, sizeof(helloAck)); });
+    runSimple("ingress", "ingress/batch/32", "batch", 0,
+              [&]() { classifier.checkBatch(packets, lengths, batchSize, classes); });
+
+    ZrtpPacketCounters counters = classifier.getCounters();
+    if (counters.crcErrors != 0)
+        fprintf(stderr, "classifier: %llu CRC errors of a valid packet\n", (unsigned long long)counters.crcErrors);
+}
+
+// **** ZRTP key derivation ****
+
+struct KdfSpec {
+    const char* name;
+    void (*hmacList)(const uint8_t* key, uint64_t keyLength, const DataChunks& data, uint8_t* mac, uint32_t* macLength);
+    void (*hmacMulti)(const uint8_t* key, uint64_t keyLength, size_t count,
+                      const uint8_t* const* data, const uint64_t* dataLength, uint8_t* const* mac);
+    uint32_t hashLength;
+};
+
+static const KdfSpec kdfs[] = {
+    {"S256", hmacSha256, hmacSha256Multi, 32},
+    {"S384", hmacSha384, hmacSha384Multi, 48},
+    {"SKN2", macSkein256, macSkein256Multi, 32},
+    {"SKN3", macSkein384, macSkein384Multi, 48},
+};
+
+/*
+ * The twelve KDF outputs of ZRtp::computeSRTPKeys in a DH mode handshake.
+ * per_call keys the HMAC for each output as ZRtp::KDF did, multi prepares
+ * the key once as ZRtp::KDFMulti does. One op is one handshake.
+ */
+static void benchKdf()
+{
+    static const char* labels[] = {
+        iniMasterKey, iniMasterSalt, respMasterKey, respMasterSalt, iniHmacKey, respHmacKey,
+        iniZrtpKey, respZrtpKey, retainedSec, zrtpSessionKey, zrtpExportedKey, sasString
+    };
+    const size_t count = sizeof(labels) / sizeof(labels[0]);
+    uint8_t s0[48];
+    uint8_t context[12 + 12 + 48];
+    uint8_t messages[count][4 + 32 + sizeof(context) + 4];
+    const uint8_t* data[count];
+    uint64_t dataLength[count];
+    uint8_t outputs[count][64];
+    uint8_t* mac[count];
+
+    memset(s0, 0x33, sizeof(s0));
+    memset(context, 0x44, sizeof(context));
+
+    for (size_t k = 0; k < sizeof(kdfs) / sizeof(kdfs[0]); k++) {
+        const KdfSpec& spec = kdfs[k];
+        size_t contextLength = 12 + 12 + spec.hashLength;
+        uint32_t counter = zrtpHtonl(1);
+        uint32_t L = zrtpHtonl(256);
+
+        for (size_t i = 0; i < count; i++) {
+            size_t labelLength = strlen(labels[i]) + 1;
+            uint8_t* msg = messages[i];
+            memcpy(msg, &counter, 4);
+            memcpy(msg + 4, labels[i], labelLength);
+            memcpy(msg + 4 + labelLength, context, contextLength);
+            memcpy(msg + 4 + labelLength + contextLength, &L, 4);
+            data[i] = msg;
+            dataLength[i] = 4 + labelLength + contextLength + 4;
+            mac[i] = outputs[i];
+        }
+        string name = string("kdf/") + spec.name;
+
+        runSimple("kdf", name + "/per_call", "handshake", 0, [&]() {
+            for (size_t i = 0; i < count; i++) {
+                DataChunks chunks;
+                uint32_t macLength;
+                size_t labelLength = strlen(labels[i]) + 1;
+                chunks.add(reinterpret_cast<uint8_t*>(&counter), 4);
+                chunks.add(reinterpret_cast<const uint8_t*>(labels[i]), labelLength);
+                chunks.add(context, contextLength);
+                chunks.add(reinterpret_cast<uint8_t*>(&L), 4);
+                spec.hmacList(s0, spec.hashLength, chunks, outputs[i], &macLength);
+            }
+        });
+        runSimple("kdf", name + "/multi", "handshake", 0,
+                  [&]() { spec.hmacMulti(s0, spec.hashLength, count, data, dataLength, mac); });
+    }
+}
+
+// **** DH / ECDH ****
+
+static void benchDH()
+{
+    const char* types[] = {dh2k, dh3k, dh4k, ec25, ec38, e255, e414};
+
+    for (size_t ti = 0; ti < sizeof(types) / sizeof(types[0]); ti++) {
+        if (quick && types[ti] == dh4k)
+            continue;
+        string type(types[ti], 4);
+
+        runSimple("dh", "dh/construct/" + type, "op", 0, [&]() {
+            ZrtpDH dh(types[ti]);
+        });
+
+        runSimple("dh", "dh/keygen/" + type, "op", 0, [&]() {
+            ZrtpDH dh(types[ti]);
+            dh.generatePublicKey();
+        });
+
+        string name = "dh/agreement/" + type;
+        if (!selected(name))
+            continue;
+
+        ZrtpDH peer(types[ti]);
+        peer.generatePublicKey();
+        uint8_t peerPub[1200];
+        peer.getPubKeyBytes(peerPub);
+
+        ZrtpDH own(types[ti]);
+        own.generatePublicKey();
+        vector<uint8_t> secret(own.getDhSize());
+
+        runSimple("dh", name, "op", 0, [&]() {
+            own.checkPubKey(peerPub);
+            own.computeSecretKey(peerPub, secret.data());
+        });
+    }
+}
+
+// **** ZID cache ****
+
+static void benchZidCache()
+{
+    if (!selected("zidcache/"))
+        return;
+
+    char fileName[64];
+    snprintf(fileName, sizeof(fileName), "zrtpbench-%ld.zid", (long)nowNs());
+
+    ZIDCache* cache = getZidCacheInstance();
+    if (cache->open(fileName) <= 0) {
+        fprintf(stderr, "Cannot open ZID cache file %s\n", fileName);
+        return;
+    }
+    const int numRecords = quick ? 100 : 1000;
+    vector<uint8_t> zids(numRecords * IDENTIFIER_LEN);
+    ZrtpRandom::getRandomData(zids.data(), zids.size());
+
+    uint8_t rs[RS_LENGTH];
+    memset(rs, 0x33, sizeof(rs));
+    for (int i = 0; i < numRecords; i++) {
+        ZIDRecord* rec = cache->getRecord(&zids[i * IDENTIFIER_LEN]);
+        rec->setNewRs1(rs);
+        cache->saveRecord(rec);
+        delete rec;
+    }
+
+    int idx = 0;
+    runSimple("zidcache", "zidcache/lookup-hit/" + to_string(numRecords), "op", 0, [&]() {
+        ZIDRecord* rec = cache->getRecord(&zids[idx * IDENTIFIER_LEN]);
+        delete rec;
+        idx = (idx + 7) % numRecords;
+    });
+    cache->close();
+    remove(fileName);
+}
+
+// **** ZRTP engine ****
+
+/*
+ * A ZRTP callback that does nothing, sufficient to construct and delete
+ * ZRTP engines that never start.
+ */
+class NullCallback: public ZrtpCallback {
+protected:
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length)     { return 1; }
+    int32_t activateTimer(int32_t time)                             { return 1; }
+    int32_t cancelTimer()                                           { return 1; }
+    void sendInfo(MessageSeverity severity, int32_t subCode)        {}
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part) { return true; }
+    void srtpSecretsOff(EnableSecurity part)                        {}
+    void srtpSecretsOn(std::string c, std::string s, bool verified) {}
+    void handleGoClear()                                            {}
+    void zrtpNegotiationFailed(MessageSeverity severity, int32_t subCode) {}
+    void zrtpNotSuppOther()                                         {}
+    void synchEnter()                                               {}
+    void synchLeave()                                               {}
+    void zrtpAskEnrollment(InfoEnrollment info)                     {}
+    void zrtpInformEnrollment(InfoEnrollment info)                  {}
+    void signSAS(uint8_t* sasHash)                                  {}
+    bool checkSASSignature(uint8_t* sasHash)                        { return true; }
+};
+
+static void benchZrtpEngine()
+{
+    NullCallback callback;
+    uint8_t zid[IDENTIFIER_LEN];
+    ZrtpRandom::getRandomData(zid, sizeof(zid));
+
+    ZrtpConfigure config;
+    config.setStandardConfig();
+
+    runSimple("zrtp", "zrtp/construct/standard", "op", 0, [&]() {
+        ZRtp* engine = new ZRtp(zid, &callback, "zrtpbench", &config);
+        delete engine;
+    });
+
+    ZRtpPool pool(4);
+    pool.prefill(1, zid, &config);
+    runSimple("zrtp", "zrtp/pool-acquire-release/standard", "op", 0, [&]() {
+        ZRtp* engine = pool.acquire(zid, &callback, "zrtpbench", &config);
+        pool.release(engine);
+    });
+}
+
+/*
+ * Check and add multi-stream nonces of a master session that already holds
+ * a number of nonces, this is the work of each multi-stream Commit.
+ */
+static void benchNonceSet()
+{
+    if (!selected("zrtp/nonce"))
+        return;
+
+    const int sizes[] = {100, 10000};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        const int numNonces = sizes[s];
+        vector<uint8_t> nonces((numNonces + 1) * ZrtpNonceSet::nonceLength);
+        ZrtpRandom::getRandomData(nonces.data(), nonces.size());
+
+        ZrtpNonceSet set(numNonces);
+        for (int i = 0; i < numNonces; i++) {
+            if (set.checkAndAdd(&nonces[i * ZrtpNonceSet::nonceLength]) != ZrtpNonceSet::Added)
+                fprintf(stderr, "zrtp/nonce-set: nonce %d not added\n", i);
+        }
+        if (set.checkAndAdd(&nonces[numNonces * ZrtpNonceSet::nonceLength]) != ZrtpNonceSet::Full)
+            fprintf(stderr, "zrtp/nonce-set: maximum number of nonces not enforced\n");
+
+        int idx = 0;
+        int notSeen = 0;
+        runSimple("zrtp", "zrtp/nonce-check-seen/" + to_string(numNonces), "op", 0, [&]() {
+            notSeen += set.checkAndAdd(&nonces[idx * ZrtpNonceSet::nonceLength]) != ZrtpNonceSet::Seen;
+            idx = (idx + 7) % numNonces;
+        });
+        if (notSeen)
+            fprintf(stderr, "zrtp/nonce-set: %d stored nonces not found\n", notSeen);
+
+        // Fresh set per batch of adds, the set frees its table on clear()
+        set.setMaxNonces(numNonces + 1);
+        set.clear();
+        idx = 0;
+        runSimple("zrtp", "zrtp/nonce-add/" + to_string(numNonces), "op", 0, [&]() {
+            if (idx == numNonces) {
+                set.clear();
+                idx = 0;
+            }
+            set.checkAndAdd(&nonces[idx++ * ZrtpNonceSet::nonceLength]);
+        });
+    }
+}
+
+static void writeJson(FILE* out)
+{
+    fprintf(out, "{\n  \"benchmark\": \"zrtpbench\",\n");
+#ifdef HAVE_TSC
+    fprintf(out, "  \"cycle_counter\": \"tsc\",\n");
+#else
+    fprintf(out, "  \"cycle_counter\": null,\n");
+#endif
+    fprintf(out, "  \"min_time_ms\": %llu,\n", (unsigned long long)(minTimeNs / 1000000));
+    fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(out, "    {\"group\": \"%s\", \"name\": \"%s\", \"unit\": \"%s\", \"bytes\": %zu, \"ops\": %llu, "
+                     "\"ns_per_op\": %.2f, \"ops_per_sec\": %.1f, \"allocs_per_op\": %.2f, ",
+                r.group.c_str(), r.name.c_str(), r.unit, r.bytesPerOp, (unsigned long long)r.ops,
+                r.nsPerOp, r.opsPerSec, r.allocsPerOp);
+        if (r.cyclesPerOp < 0.0)
+            fprintf(out, "\"cycles_per_op\": null, \"cycles_per_byte\": null}");
+        else if (r.bytesPerOp == 0)
+            fprintf(out, "\"cycles_per_op\": %.1f, \"cycles_per_byte\": null}", r.cyclesPerOp);
+        else
+            fprintf(out, "\"cycles_per_op\": %.1f, \"cycles_per_byte\": %.3f}", r.cyclesPerOp,
+                    r.cyclesPerOp / r.bytesPerOp);
+        fprintf(out, "%s\n", (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(out, "  ],\n");
+
+    // Totals of all SRTP/SRTCP contexts the benchmarks used
+    SrtpMetricsData metrics;
+    SrtpMetrics::getAllData(&metrics);
+    fprintf(out, "  \"srtp_metrics\": {\"protected_packets\": %llu, \"protected_bytes\": %llu, "
+                 "\"unprotected_packets\": %llu, \"unprotected_bytes\": %llu, \"auth_failures\": %llu, "
+                 "\"replay_drops\": %llu, \"roc_rollovers\": %llu, \"index_guess_corrections\": %llu,\n",
+            (unsigned long long)metrics.protectedPackets, (unsigned long long)metrics.protectedBytes,
+            (unsigned long long)metrics.unprotectedPackets, (unsigned long long)metrics.unprotectedBytes,
+            (unsigned long long)metrics.authFailures, (unsigned long long)metrics.replayDrops,
+            (unsigned long long)metrics.rocRollovers, (unsigned long long)metrics.indexGuessCorrections);
+    const char* names[] = {"protect_cycles_log2", "unprotect_cycles_log2"};
+    const uint64_t* histograms[] = {metrics.protectCycles, metrics.unprotectCycles};
+    for (int h = 0; h < 2; h++) {
+        fprintf(out, "    \"%s\": [", names[h]);
+        for (int i = 0; i < SRTP_METRICS_BUCKETS; i++)
+            fprintf(out, "%llu%s", (unsigned long long)histograms[h][i], i + 1 < SRTP_METRICS_BUCKETS ? ", " : "");
+        fprintf(out, "]%s\n", h == 0 ? "," : "");
+    }
+    fprintf(out, "  }\n}\n");
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [-t <ms>] [-f <filter>] [-m <n>] [-o <file>] [-q]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const char* outName = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            minTimeNs = strtoull(argv[++i], NULL, 10) * 1000 * 1000;
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            SrtpMetrics::setSampleInterval(static_cast<uint32_t>(strtoul(argv[++i], NULL, 10)));
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outName = argv[++i];
+        }
+        else if (strcmp(argv[i], "-q") == 0) {
+            quick = true;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    ZrtpRandom::getRandomData(masterKey, sizeof(masterKey));
+    ZrtpRandom::getRandomData(masterSalt, sizeof(masterSalt));
+
+    benchSrtp();
+    benchCiphers();
+    benchMacs();
+    benchHashes();
+    benchKdf();
+    benchCksum();
+    benchClassifier();
+    benchDH();
+    benchZidCache();
+    benchZrtpEngine();
+    benchNonceSet();
+
+    FILE* out = stdout;
+    if (outName != NULL && (out = fopen(outName, "w")) == NULL) {
+        fprintf(stderr, "Cannot open output file %s\n", outName);
+        return 1;
+    }
+    writeJson(out);
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
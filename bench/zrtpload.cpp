@@ -0,0 +1,904 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * In-process ZRTP handshake load generator.
+ *
+ * The program runs pairs of ZRtp engines that talk to each other through an
+ * in-memory loopback transport. Each worker thread owns a set of pairs and a
+ * virtual clock: sent packets and timer requests become events in a time
+ * ordered queue, thus ZRTP timers and network delays do not cost any real
+ * time. The loopback transport can drop, delay and reorder packets to
+ * exercise the retransmission paths of the ZRTP state engine.
+ *
+ * Each pair runs a full DH handshake and then the configured number of
+ * multi-stream handshakes. For each key agreement and hash combination the
+ * program reports the handshakes per second (wall clock), the time to
+ * SecureState in virtual time and the CPU time per handshake as p50, p99
+ * and p999 values. It also checks that each engine released its handshake
+ * data when it entered SecureState and reports the largest per-engine memory
+ * footprint during the handshake and in SecureState, and the heap allocations
+ * of the engines and of the big number library per handshake. The results
+ * are written as JSON.
+ *
+ * Usage: zrtpload [-p <pairs>] [-t <threads>] [-r <rounds>] [-s <streams>]
+ *                 [-k <pk,...>] [-h <hash,...>] [-l <loss%>] [-d <ms>]
+ *                 [-j <ms>] [-x <reorder%>] [-z <zids>] [-T <0|1>] [-A <0|1>] [-o <file>]
+ *
+ *   -p   concurrent ZRTP pairs, default 64
+ *   -t   worker threads, default 4
+ *   -r   handshakes per pair, default 4
+ *   -s   multi-stream handshakes after each DH handshake, default 1
+ *   -k   key agreement types, default "EC25,DH3k"
+ *   -h   hash types, default "S256"
+ *   -l   packet loss in percent, default 0
+ *   -d   one way delay in milliseconds, default 20
+ *   -j   additional random delay (jitter) in milliseconds, default 0
+ *   -x   percentage of packets that get an extra delay of 3 x jitter, default 0
+ *   -z   number of distinct ZIDs, default 32
+ *   -T   if 1 enable the ZRTP handshake trace and report the crypto operation
+ *        histograms, default 0
+ *   -A   if 0 the DH operations allocate their big number temporaries on the
+ *        heap instead of the arena, default 1
+ *   -o   write JSON to this file instead of stdout
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/osSpecifics.h>
+
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZRtpPool.h>
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZrtpCrc32.h>
+#include <libzrtpcpp/ZrtpMultiStreamGroup.h>
+#include <libzrtpcpp/ZrtpPacketClassifier.h>
+#include <libzrtpcpp/ZrtpTrace.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/zrtpPacket.h>
+#include <cryptcommon/ZrtpRandom.h>
+#include <zrtp/crypto/zrtpDH.h>
+
+using namespace std;
+using namespace GnuZrtpCodes;
+
+static int numPairs = 64;
+static int numThreads = 4;
+static int numRounds = 4;
+static int numMulti = 1;
+static int numZids = 32;
+static double lossRate = 0.0;
+static double reorderRate = 0.0;
+static uint64_t delayUs = 20 * 1000;
+static uint64_t jitterUs = 0;
+static bool traceOn = false;
+static bool useArena = true;
+
+static vector<uint8_t> zidPool;
+
+/*
+ * Count the heap allocations the ZRTP engines perform while they process
+ * events. The transport callbacks of the load generator switch counting off.
+ */
+static thread_local bool countAllocations = false;
+static thread_local uint64_t engineAllocations = 0;
+
+void* operator new(size_t size)
+{
+    if (countAllocations)
+        engineAllocations++;
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    if (countAllocations)
+        engineAllocations++;
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+// Not inlined: GCC otherwise reports the free() of the unwind paths as mismatched
+#if defined(__GNUC__)
+#define ALLOC_NOINLINE __attribute__((noinline))
+#else
+#define ALLOC_NOINLINE
+#endif
+
+ALLOC_NOINLINE void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+ALLOC_NOINLINE void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+class PauseAllocationCount {
+public:
+    PauseAllocationCount(): saved(countAllocations) { countAllocations = false; }
+    ~PauseAllocationCount() { countAllocations = saved; }
+private:
+    bool saved;
+};
+
+static const uint64_t stallLimitUs = 60ULL * 1000 * 1000;   // give up a round after 60s virtual time
+
+static inline uint64_t nowNs()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class Worker;
+class PairSlot;
+
+/*
+ * One side of a ZRTP stream. Implements the ZRTP callback on top of the
+ * worker's event queue.
+ */
+class LoopEndpoint: public ZrtpCallback {
+public:
+    LoopEndpoint(): slot(NULL), peer(NULL), engine(NULL), ssrc(0), seq(0), timerGen(0), secure(false), failed(false),
+        startFootprint(0) {}
+
+    PairSlot* slot;
+    LoopEndpoint* peer;
+    ZRtp* engine;
+    uint32_t ssrc;
+    uint16_t seq;
+    uint32_t timerGen;
+    bool secure;
+    bool failed;
+    size_t startFootprint;
+
+protected:
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length);
+    int32_t activateTimer(int32_t time);
+    int32_t cancelTimer()                                   { timerGen++; return 1; }
+    void sendInfo(MessageSeverity severity, int32_t subCode);
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part) { return true; }
+    void srtpSecretsOff(EnableSecurity part)                {}
+    void srtpSecretsOn(std::string c, std::string s, bool verified) {}
+    void handleGoClear()                                    {}
+    void zrtpNegotiationFailed(MessageSeverity severity, int32_t subCode) { failed = true; }
+    void zrtpNotSuppOther()                                 { failed = true; }
+    void synchEnter()                                       {}
+    void synchLeave()                                       {}
+    void zrtpAskEnrollment(InfoEnrollment info)             {}
+    void zrtpInformEnrollment(InfoEnrollment info)          {}
+    void signSAS(uint8_t* sasHash)                          {}
+    bool checkSASSignature(uint8_t* sasHash)                { return true; }
+};
+
+struct StreamPair {
+    LoopEndpoint ep[2];
+};
+
+enum EventType {
+    StartEngine, Deliver, TimerFired
+};
+
+struct LoopEvent {
+    uint64_t time;
+    uint64_t order;
+    EventType type;
+    PairSlot* slot;
+    uint32_t epoch;
+    LoopEndpoint* target;
+    uint32_t timerGen;
+    vector<uint8_t>* packet;
+};
+
+struct LaterEvent {
+    bool operator()(const LoopEvent& a, const LoopEvent& b) const {
+        return a.time != b.time ? a.time > b.time : a.order > b.order;
+    }
+};
+
+struct RunStats {
+    vector<double> dhSetupMs;
+    vector<double> dhCpuMs;
+    vector<double> multiSetupMs;
+    vector<double> multiCpuMs;
+    vector<double> groupSetupMs;    // time until all multi-stream sessions of a round are secure
+    vector<double> dhAllocs;        // engine heap allocations per handshake, both sides
+    vector<double> dhBnAllocs;      // big number heap allocations per handshake, both sides
+    vector<double> multiAllocs;
+    uint64_t failures;
+    uint64_t retransmits;
+    uint64_t packets;
+    uint64_t dropped;
+    size_t handshakeFootprint;      // largest engine footprint before SecureState
+    size_t secureFootprint;         // largest engine footprint in SecureState
+    uint64_t footprintErrors;       // engines that kept handshake data in SecureState
+    uint64_t groupErrors;           // secure multi-stream rounds without a group result
+    string negotiated;
+
+    RunStats(): failures(0), retransmits(0), packets(0), dropped(0), handshakeFootprint(0), secureFootprint(0),
+        footprintErrors(0), groupErrors(0) {}
+
+    void merge(const RunStats& o) {
+        dhSetupMs.insert(dhSetupMs.end(), o.dhSetupMs.begin(), o.dhSetupMs.end());
+        dhCpuMs.insert(dhCpuMs.end(), o.dhCpuMs.begin(), o.dhCpuMs.end());
+        multiSetupMs.insert(multiSetupMs.end(), o.multiSetupMs.begin(), o.multiSetupMs.end());
+        multiCpuMs.insert(multiCpuMs.end(), o.multiCpuMs.begin(), o.multiCpuMs.end());
+        groupSetupMs.insert(groupSetupMs.end(), o.groupSetupMs.begin(), o.groupSetupMs.end());
+        dhAllocs.insert(dhAllocs.end(), o.dhAllocs.begin(), o.dhAllocs.end());
+        dhBnAllocs.insert(dhBnAllocs.end(), o.dhBnAllocs.begin(), o.dhBnAllocs.end());
+        multiAllocs.insert(multiAllocs.end(), o.multiAllocs.begin(), o.multiAllocs.end());
+        failures += o.failures;
+        retransmits += o.retransmits;
+        packets += o.packets;
+        dropped += o.dropped;
+        handshakeFootprint = max(handshakeFootprint, o.handshakeFootprint);
+        secureFootprint = max(secureFootprint, o.secureFootprint);
+        footprintErrors += o.footprintErrors;
+        groupErrors += o.groupErrors;
+        if (negotiated.empty())
+            negotiated = o.negotiated;
+    }
+};
+
+class Worker {
+public:
+    Worker(ZrtpConfigure* cfg, uint32_t seed): config(cfg), now(0), order(0), rng(seed) {}
+
+    void push(LoopEvent& ev) {
+        ev.order = order++;
+        queue.push(ev);
+    }
+    bool chance(double percent) {
+        return percent > 0.0 && uniform_real_distribution<double>(0.0, 100.0)(rng) < percent;
+    }
+    uint64_t networkDelay() {
+        uint64_t d = delayUs;
+        if (jitterUs > 0)
+            d += uniform_int_distribution<uint64_t>(0, jitterUs)(rng);
+        if (chance(reorderRate))
+            d += 3 * jitterUs + 1000;
+        return d;
+    }
+    void run(vector<PairSlot*>& slots);
+
+    ZrtpConfigure* config;
+    ZRtpPool pool;                  // engines are reused across rounds
+    uint64_t now;                   // virtual time in microseconds
+    uint64_t order;
+    mt19937 rng;
+    priority_queue<LoopEvent, vector<LoopEvent>, LaterEvent> queue;
+    ZrtpPacketClassifier classifier;
+    RunStats stats;
+};
+
+/*
+ * A pair slot runs a number of handshake rounds between two endpoints. A
+ * round consists of the DH stream and the multi-stream streams. Each side
+ * creates its multi-stream engines with a ZrtpMultiStreamGroup.
+ */
+class PairSlot: public ZrtpMultiStreamGroup::Listener {
+public:
+    PairSlot(Worker* w, int idx): worker(w), index(idx), epoch(0), pending(0), round(0),
+        phase(Idle), phaseStart(0), phaseCpuNs(0), phaseAllocs(0), phaseBnAllocs(0), groupsDone(0), streams(1 + numMulti) {
+        groups[0] = groups[1] = NULL;
+    }
+
+    ~PairSlot() { teardown(); }
+
+    enum Phase { Idle, DhPhase, MultiPhase, Done };
+
+    void startRound();
+    void advance();
+    void teardown();
+    void streamsDone(ZrtpMultiStreamGroup* group, size_t secure, size_t failed);
+
+    Worker* worker;
+    int index;
+    uint32_t epoch;
+    int pending;
+    int round;
+    Phase phase;
+    uint64_t phaseStart;
+    uint64_t phaseCpuNs;
+    uint64_t phaseAllocs;
+    uint64_t phaseBnAllocs;
+    int groupsDone;
+    ZrtpMultiStreamGroup* groups[2];
+    vector<StreamPair> streams;
+
+private:
+    void setupEndpoint(int s, int side);
+    void startMaster();
+    void startMultiStreams();
+    void schedule(EventType type, LoopEndpoint* target, uint64_t delay);
+    bool streamsSecure(int from, int to);
+    bool streamsFailed(int from, int to);
+};
+
+int32_t LoopEndpoint::sendDataZRTP(const uint8_t* data, int32_t length)
+{
+    PauseAllocationCount pause;
+    Worker* w = slot->worker;
+    w->stats.packets++;
+    if (w->chance(lossRate)) {
+        w->stats.dropped++;
+        return 1;
+    }
+    // Build the ZRTP packet as sent on the wire: fixed header, message, CRC
+    vector<uint8_t>* pkt = new vector<uint8_t>(12 + length);
+    uint8_t* buffer = pkt->data();
+    uint16_t* pus = reinterpret_cast<uint16_t*>(buffer);
+    uint32_t* pui = reinterpret_cast<uint32_t*>(buffer);
+
+    buffer[0] = 0x10;
+    buffer[1] = 0;
+    pus[1] = zrtpHtons(seq++);
+    pui[1] = zrtpHtonl(ZRTP_MAGIC);
+    pui[2] = zrtpHtonl(ssrc);
+    memcpy(buffer + 12, data, length - CRC_SIZE);
+
+    uint16_t crcOffset = static_cast<uint16_t>(pkt->size() - CRC_SIZE);
+    uint32_t crc = zrtpEndCksum(zrtpGenerateCksum(buffer, crcOffset));
+    *reinterpret_cast<uint32_t*>(buffer + crcOffset) = zrtpHtonl(crc);
+
+    LoopEvent ev;
+    ev.time = w->now + w->networkDelay();
+    ev.type = Deliver;
+    ev.slot = slot;
+    ev.epoch = slot->epoch;
+    ev.target = peer;
+    ev.timerGen = 0;
+    ev.packet = pkt;
+    slot->pending++;
+    w->push(ev);
+    return 1;
+}
+
+void LoopEndpoint::sendInfo(MessageSeverity severity, int32_t subCode)
+{
+    if (severity == Info && subCode == InfoSecureStateOn) {
+        secure = true;
+
+        // ZRtp released the handshake data before it reported SecureState
+        RunStats& stats = slot->worker->stats;
+        size_t footprint = engine->getMemoryFootprint();
+        stats.secureFootprint = max(stats.secureFootprint, footprint);
+        if (footprint >= startFootprint)
+            stats.footprintErrors++;
+    }
+}
+
+int32_t LoopEndpoint::activateTimer(int32_t time)
+{
+    PauseAllocationCount pause;
+    Worker* w = slot->worker;
+    LoopEvent ev;
+    ev.time = w->now + static_cast<uint64_t>(time) * 1000;
+    ev.type = TimerFired;
+    ev.slot = slot;
+    ev.epoch = slot->epoch;
+    ev.target = this;
+    ev.timerGen = ++timerGen;
+    ev.packet = NULL;
+    slot->pending++;
+    w->push(ev);
+    return 1;
+}
+
+void PairSlot::schedule(EventType type, LoopEndpoint* target, uint64_t delay)
+{
+    LoopEvent ev;
+    ev.time = worker->now + delay;
+    ev.type = type;
+    ev.slot = this;
+    ev.epoch = epoch;
+    ev.target = target;
+    ev.timerGen = 0;
+    ev.packet = NULL;
+    pending++;
+    worker->push(ev);
+}
+
+void PairSlot::setupEndpoint(int s, int side)
+{
+    LoopEndpoint& ep = streams[s].ep[side];
+    ep.slot = this;
+    ep.peer = &streams[s].ep[1 - side];
+    ep.ssrc = (index << 8) | (s << 1) | side;
+    ep.seq = 0;
+    ep.secure = false;
+    ep.failed = false;
+}
+
+// Pick different ZIDs for both sides from the pool
+static uint8_t* sideZid(int index, int side)
+{
+    int zidIdx = (2 * index + side) % numZids;
+    if (numZids > 1 && side == 1 && zidIdx == (2 * index) % numZids)
+        zidIdx = (zidIdx + 1) % numZids;
+    return &zidPool[zidIdx * IDENTIFIER_LEN];
+}
+
+void PairSlot::startMaster()
+{
+    for (int side = 0; side < 2; side++) {
+        setupEndpoint(0, side);
+        LoopEndpoint& ep = streams[0].ep[side];
+        ep.engine = worker->pool.acquire(sideZid(index, side), &ep, "zrtpload", worker->config);
+        ep.startFootprint = ep.engine->getMemoryFootprint();
+        worker->stats.handshakeFootprint = max(worker->stats.handshakeFootprint, ep.startFootprint);
+    }
+    schedule(StartEngine, &streams[0].ep[0], 0);
+    schedule(StartEngine, &streams[0].ep[1], 0);
+}
+
+void PairSlot::startMultiStreams()
+{
+    vector<ZrtpCallback*> callbacks(numMulti);
+    groupsDone = 0;
+
+    for (int side = 0; side < 2; side++) {
+        for (int s = 1; s <= numMulti; s++) {
+            setupEndpoint(s, side);
+            callbacks[s - 1] = &streams[s].ep[side];
+        }
+        groups[side] = new ZrtpMultiStreamGroup(streams[0].ep[side].engine, &worker->pool);
+        groups[side]->setListener(this);
+        if (groups[side]->createStreams(numMulti, callbacks.data(), sideZid(index, side), "zrtpload",
+                                        worker->config) != static_cast<size_t>(numMulti)) {
+            streams[1].ep[side].failed = true;
+            continue;
+        }
+        for (int s = 1; s <= numMulti; s++) {
+            LoopEndpoint& ep = streams[s].ep[side];
+            ep.engine = groups[side]->getStream(s - 1);
+            ep.startFootprint = ep.engine->getMemoryFootprint();
+            worker->stats.handshakeFootprint = max(worker->stats.handshakeFootprint, ep.startFootprint);
+        }
+    }
+    for (int s = 1; s <= numMulti; s++) {
+        schedule(StartEngine, &streams[s].ep[0], 0);
+        schedule(StartEngine, &streams[s].ep[1], 0);
+    }
+}
+
+void PairSlot::streamsDone(ZrtpMultiStreamGroup* group, size_t secure, size_t failed)
+{
+    if (failed != 0)
+        return;
+
+    // Time until the multi-stream sessions of both sides are secure
+    if (++groupsDone == 2)
+        worker->stats.groupSetupMs.push_back((worker->now - phaseStart) / 1000.0);
+}
+
+void PairSlot::startRound()
+{
+    teardown();
+    epoch++;
+    pending = 0;
+    phase = DhPhase;
+    phaseStart = worker->now;
+    phaseCpuNs = 0;
+    phaseAllocs = 0;
+    phaseBnAllocs = 0;
+    startMaster();
+}
+
+bool PairSlot::streamsSecure(int from, int to)
+{
+    for (int s = from; s < to; s++) {
+        if (!streams[s].ep[0].secure || !streams[s].ep[1].secure)
+            return false;
+    }
+    return true;
+}
+
+bool PairSlot::streamsFailed(int from, int to)
+{
+    for (int s = from; s < to; s++) {
+        if (streams[s].ep[0].failed || streams[s].ep[1].failed)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Called after each processed event. Checks the state of the current phase
+ * and moves to the next phase or round.
+ */
+void PairSlot::advance()
+{
+    if (phase == Idle || phase == Done)
+        return;
+
+    int from = phase == DhPhase ? 0 : 1;
+    int to = phase == DhPhase ? 1 : static_cast<int>(streams.size());
+
+    if (streamsSecure(from, to)) {
+        double setupMs = (worker->now - phaseStart) / 1000.0;
+        double cpuMs = phaseCpuNs / 1e6;
+        if (phase == DhPhase) {
+            worker->stats.dhSetupMs.push_back(setupMs);
+            worker->stats.dhCpuMs.push_back(cpuMs);
+            worker->stats.dhAllocs.push_back(static_cast<double>(phaseAllocs));
+            worker->stats.dhBnAllocs.push_back(static_cast<double>(phaseBnAllocs));
+            if (worker->stats.negotiated.empty()) {
+                const ZRtp::zrtpInfo* info = streams[0].ep[0].engine->getDetailInfo();
+                worker->stats.negotiated = string(info->pubKey) + "/" + info->hash + "/" + info->cipher +
+                                           "/" + info->authLength;
+            }
+        }
+        else {
+            // Multi-stream setup time is per stream, all streams run in parallel
+            for (int s = from; s < to; s++) {
+                worker->stats.multiSetupMs.push_back(setupMs);
+                worker->stats.multiCpuMs.push_back(cpuMs / (to - from));
+                worker->stats.multiAllocs.push_back(static_cast<double>(phaseAllocs) / (to - from));
+            }
+        }
+        if (phase == DhPhase && to < static_cast<int>(streams.size())) {
+            phase = MultiPhase;
+            phaseStart = worker->now;
+            phaseCpuNs = 0;
+            phaseAllocs = 0;
+            phaseBnAllocs = 0;
+            startMultiStreams();
+            return;
+        }
+        if (phase == MultiPhase && groupsDone != 2)
+            worker->stats.groupErrors++;
+    }
+    else if (streamsFailed(from, to) || pending == 0 || worker->now - phaseStart > stallLimitUs) {
+        worker->stats.failures++;
+    }
+    else {
+        return;
+    }
+    if (++round < numRounds) {
+        startRound();
+    }
+    else {
+        teardown();
+        epoch++;
+        phase = Done;
+    }
+}
+
+void PairSlot::teardown()
+{
+    // Release multi-stream engines first, they refer to the master stream
+    for (int side = 0; side < 2; side++) {
+        delete groups[side];
+        groups[side] = NULL;
+        for (size_t s = 1; s < streams.size(); s++)
+            streams[s].ep[side].engine = NULL;
+        if (streams[0].ep[side].engine != NULL) {
+            worker->pool.release(streams[0].ep[side].engine);
+            streams[0].ep[side].engine = NULL;
+        }
+    }
+}
+
+void Worker::run(vector<PairSlot*>& slots)
+{
+    for (size_t i = 0; i < slots.size(); i++)
+        slots[i]->startRound();
+
+    while (!queue.empty()) {
+        LoopEvent ev = queue.top();
+        queue.pop();
+        now = ev.time;
+
+        PairSlot* slot = ev.slot;
+        if (ev.epoch != slot->epoch) {
+            delete ev.packet;
+            continue;
+        }
+        slot->pending--;
+
+        uint64_t t0 = nowNs();
+        uint64_t a0 = engineAllocations;
+        uint64_t b0 = ZrtpDH::getHeapAllocations();
+        countAllocations = true;
+        switch (ev.type) {
+        case StartEngine:
+            ev.target->engine->startZrtpEngine();
+            break;
+
+        case Deliver: {
+            uint8_t* buffer = ev.packet->data();
+            if (classifier.check(buffer, ev.packet->size()) == ZrtpPacketClassifier::ZrtpPacket)
+                ev.target->engine->processZrtpMessage(buffer + 12, ev.target->peer->ssrc, ev.packet->size());
+            delete ev.packet;
+            break;
+        }
+        case TimerFired:
+            if (ev.timerGen == ev.target->timerGen) {
+                stats.retransmits++;
+                ev.target->engine->processTimeout();
+            }
+            break;
+        }
+        countAllocations = false;
+        slot->phaseCpuNs += nowNs() - t0;
+        slot->phaseAllocs += engineAllocations - a0;
+        slot->phaseBnAllocs += ZrtpDH::getHeapAllocations() - b0;
+        slot->advance();
+    }
+}
+
+static double percentile(vector<double>& v, double p)
+{
+    if (v.empty())
+        return 0.0;
+    size_t idx = static_cast<size_t>(p * v.size());
+    if (idx >= v.size())
+        idx = v.size() - 1;
+    return v[idx];
+}
+
+static void printDistribution(FILE* out, const char* name, vector<double>& v, bool last)
+{
+    sort(v.begin(), v.end());
+    fprintf(out, "\"%s\": {\"p50\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f}%s", name,
+            percentile(v, 0.5), percentile(v, 0.99), percentile(v, 0.999), v.empty() ? 0.0 : v.back(),
+            last ? "" : ", ");
+}
+
+/*
+ * Print the process-wide ZRTP trace histograms as count and the upper
+ * bucket limits of p50 and p99 in microseconds.
+ */
+static void printTrace(FILE* out)
+{
+    static const char* names[numberOfTraceHistograms] = {
+        "dh_keygen", "dh_compute", "cache_read", "cache_write", "kdf", "setup"
+    };
+    fprintf(out, ",\n      \"trace_us\": {");
+    for (int32_t h = 0; h < numberOfTraceHistograms; h++) {
+        uint64_t buckets[ZRTP_TRACE_BUCKETS];
+        int32_t number = ZrtpTrace::getHistogram(h, buckets, ZRTP_TRACE_BUCKETS);
+        uint64_t count = 0;
+        for (int32_t i = 0; i < number; i++)
+            count += buckets[i];
+
+        uint64_t p50 = 0, p99 = 0, sum = 0;
+        for (int32_t i = 0; i < number && count > 0; i++) {
+            sum += buckets[i];
+            if (p50 == 0 && sum * 2 >= count)
+                p50 = 1ULL << i;
+            if (p99 == 0 && sum * 100 >= count * 99)
+                p99 = 1ULL << i;
+        }
+        fprintf(out, "\"%s\": {\"count\": %llu, \"p50\": %llu, \"p99\": %llu}%s", names[h],
+                (unsigned long long)count, (unsigned long long)p50, (unsigned long long)p99,
+                h + 1 < numberOfTraceHistograms ? ", " : "");
+    }
+    fprintf(out, "}");
+}
+
+static vector<string> splitList(const char* list)
+{
+    vector<string> names;
+    string s(list);
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t end = s.find(',', start);
+        if (end == string::npos)
+            end = s.size();
+        if (end > start)
+            names.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+    return names;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [-p <pairs>] [-t <threads>] [-r <rounds>] [-s <streams>] [-k <pk,...>]\n"
+                    "          [-h <hash,...>] [-l <loss%%>] [-d <ms>] [-j <ms>] [-x <reorder%%>] [-z <zids>] [-T <0|1>]\n"
+                    "          [-A <0|1>] [-o <file>]\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const char* pkList = "EC25,DH3k";
+    const char* hashList = "S256";
+    const char* outName = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (arg[0] != '-' || arg[1] == 0 || arg[2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* val = argv[++i];
+        switch (arg[1]) {
+        case 'p': numPairs = atoi(val); break;
+        case 't': numThreads = atoi(val); break;
+        case 'r': numRounds = atoi(val); break;
+        case 's': numMulti = atoi(val); break;
+        case 'k': pkList = val; break;
+        case 'h': hashList = val; break;
+        case 'l': lossRate = atof(val); break;
+        case 'd': delayUs = static_cast<uint64_t>(atof(val) * 1000); break;
+        case 'j': jitterUs = static_cast<uint64_t>(atof(val) * 1000); break;
+        case 'x': reorderRate = atof(val); break;
+        case 'z': numZids = atoi(val); break;
+        case 'T': traceOn = atoi(val) != 0; break;
+        case 'A': useArena = atoi(val) != 0; break;
+        case 'o': outName = val; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (numPairs < 1 || numThreads < 1 || numRounds < 1 || numMulti < 0 || numZids < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (numThreads > numPairs)
+        numThreads = numPairs;
+    ZrtpTrace::setEnabled(traceOn);
+    ZrtpDH::setUseArena(useArena);
+
+    char cacheName[64];
+    snprintf(cacheName, sizeof(cacheName), "zrtpload-%ld.zid", (long)nowNs());
+    ZIDCache* cache = getZidCacheInstance();
+    if (cache->open(cacheName) <= 0) {
+        fprintf(stderr, "Cannot open ZID cache file %s\n", cacheName);
+        return 1;
+    }
+    zidPool.resize(numZids * IDENTIFIER_LEN);
+    ZrtpRandom::getRandomData(zidPool.data(), zidPool.size());
+
+    FILE* out = stdout;
+    if (outName != NULL && (out = fopen(outName, "w")) == NULL) {
+        fprintf(stderr, "Cannot open output file %s\n", outName);
+        return 1;
+    }
+    fprintf(out, "{\n  \"benchmark\": \"zrtpload\",\n");
+    fprintf(out, "  \"pairs\": %d, \"threads\": %d, \"rounds\": %d, \"multistreams\": %d,\n",
+            numPairs, numThreads, numRounds, numMulti);
+    fprintf(out, "  \"loss_percent\": %.2f, \"delay_ms\": %.3f, \"jitter_ms\": %.3f, \"reorder_percent\": %.2f,\n",
+            lossRate, delayUs / 1000.0, jitterUs / 1000.0, reorderRate);
+    fprintf(out, "  \"results\": [\n");
+
+    vector<string> pks = splitList(pkList);
+    vector<string> hashes = splitList(hashList);
+    bool first = true;
+    uint64_t footprintErrors = 0;
+    uint64_t groupErrors = 0;
+
+    for (size_t ki = 0; ki < pks.size(); ki++) {
+        for (size_t hi = 0; hi < hashes.size(); hi++) {
+            AlgorithmEnum& pk = zrtpPubKeys.getByName(pks[ki].c_str());
+            AlgorithmEnum& hash = zrtpHashes.getByName(hashes[hi].c_str());
+            if (!pk.isValid() || !hash.isValid()) {
+                fprintf(stderr, "Unknown algorithm %s/%s\n", pks[ki].c_str(), hashes[hi].c_str());
+                continue;
+            }
+            ZrtpConfigure config;
+            config.setStandardConfig();
+            config.addAlgoAt(PubKeyAlgorithm, pk, 0);
+            config.addAlgoAt(HashAlgorithm, hash, 0);
+
+            vector<Worker*> workers;
+            vector<vector<PairSlot*> > slots(numThreads);
+            for (int t = 0; t < numThreads; t++)
+                workers.push_back(new Worker(&config, 4711 + t));
+            for (int p = 0; p < numPairs; p++)
+                slots[p % numThreads].push_back(new PairSlot(workers[p % numThreads], p));
+
+            ZrtpTrace::resetHistograms();
+            uint64_t start = nowNs();
+            vector<thread> threads;
+            for (int t = 0; t < numThreads; t++)
+                threads.push_back(thread(&Worker::run, workers[t], ref(slots[t])));
+            for (size_t t = 0; t < threads.size(); t++)
+                threads[t].join();
+            double wallSec = (nowNs() - start) / 1e9;
+
+            RunStats total;
+            for (int t = 0; t < numThreads; t++) {
+                total.merge(workers[t]->stats);
+                for (size_t p = 0; p < slots[t].size(); p++)
+                    delete slots[t][p];
+                delete workers[t];
+            }
+            fprintf(stderr, "%s/%s (%s): %zu DH, %zu multi-stream handshakes, %llu failures, %.1f handshakes/s\n",
+                    pks[ki].c_str(), hashes[hi].c_str(), total.negotiated.c_str(), total.dhSetupMs.size(),
+                    total.multiSetupMs.size(), (unsigned long long)total.failures,
+                    (total.dhSetupMs.size() + total.multiSetupMs.size()) / wallSec);
+            fprintf(stderr, "  engine footprint: %zu bytes during handshake, %zu bytes secure, %llu errors\n",
+                    total.handshakeFootprint, total.secureFootprint, (unsigned long long)total.footprintErrors);
+            footprintErrors += total.footprintErrors;
+
+            double dhMax = 0.0, multiMax = 0.0;
+            for (size_t i = 0; i < total.dhAllocs.size(); i++)
+                dhMax = max(dhMax, total.dhAllocs[i]);
+            for (size_t i = 0; i < total.multiAllocs.size(); i++)
+                multiMax = max(multiMax, total.multiAllocs[i]);
+            fprintf(stderr, "  engine allocations: max %.1f per DH, %.1f per multi-stream handshake\n", dhMax, multiMax);
+            double bnSum = 0.0;
+            for (size_t i = 0; i < total.dhBnAllocs.size(); i++)
+                bnSum += total.dhBnAllocs[i];
+            fprintf(stderr, "  big number allocations: %.1f per DH handshake, arena %s\n",
+                    total.dhBnAllocs.empty() ? 0.0 : bnSum / total.dhBnAllocs.size(), useArena ? "on" : "off");
+            if (numMulti > 0) {
+                sort(total.groupSetupMs.begin(), total.groupSetupMs.end());
+                fprintf(stderr, "  %d multi-streams per group: all secure after p50 %.1f ms, p99 %.1f ms, %llu errors\n",
+                        numMulti, percentile(total.groupSetupMs, 0.5), percentile(total.groupSetupMs, 0.99),
+                        (unsigned long long)total.groupErrors);
+                groupErrors += total.groupErrors;
+            }
+
+            fprintf(out, "%s    {\"key_agreement\": \"%s\", \"hash\": \"%s\", \"negotiated\": \"%s\", ",
+                    first ? "" : ",\n", pks[ki].c_str(), hashes[hi].c_str(), total.negotiated.c_str());
+            fprintf(out, "\"dh_handshakes\": %zu, \"multistream_handshakes\": %zu, \"failures\": %llu, ",
+                    total.dhSetupMs.size(), total.multiSetupMs.size(), (unsigned long long)total.failures);
+            fprintf(out, "\"packets\": %llu, \"dropped\": %llu, \"timeouts\": %llu, \"wall_sec\": %.3f, ",
+                    (unsigned long long)total.packets, (unsigned long long)total.dropped,
+                    (unsigned long long)total.retransmits, wallSec);
+            fprintf(out, "\"handshake_footprint_bytes\": %zu, \"secure_footprint_bytes\": %zu, \"footprint_errors\": %llu, ",
+                    total.handshakeFootprint, total.secureFootprint, (unsigned long long)total.footprintErrors);
+            fprintf(out, "\"dh_per_sec\": %.1f, ", total.dhSetupMs.size() / wallSec);
+            fprintf(out, "\"handshakes_per_sec\": %.1f,\n      ",
+                    (total.dhSetupMs.size() + total.multiSetupMs.size()) / wallSec);
+            printDistribution(out, "dh_setup_ms", total.dhSetupMs, false);
+            printDistribution(out, "dh_cpu_ms", total.dhCpuMs, false);
+            fprintf(out, "\n      ");
+            printDistribution(out, "multistream_setup_ms", total.multiSetupMs, false);
+            printDistribution(out, "multistream_cpu_ms", total.multiCpuMs, false);
+            printDistribution(out, "multistream_group_ms", total.groupSetupMs, false);
+            fprintf(out, "\n      ");
+            printDistribution(out, "dh_allocs", total.dhAllocs, false);
+            printDistribution(out, "dh_bn_allocs", total.dhBnAllocs, false);
+            printDistribution(out, "multistream_allocs", total.multiAllocs, true);
+            if (traceOn)
+                printTrace(out);
+            fprintf(out, "}");
+            first = false;
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout)
+        fclose(out);
+
+    cache->close();
+    remove(cacheName);
+    return footprintErrors == 0 && groupErrors == 0 ? 0 : 1;
+}
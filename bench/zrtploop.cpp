@@ -0,0 +1,755 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Example driver for the event loop integration of ZRTP and throughput
+ * comparison with the classic callback integration.
+ *
+ * The program runs pairs of ZRtp engines that exchange their packets in
+ * memory, in real time and without network delay, in two modes:
+ *
+ * event_loop
+ *     One thread drives all sessions with a ZrtpEventLoop. It waits in
+ *     epoll_wait() on the loop's eventfd with the timeout of the next ZRTP
+ *     timer, sends the queued packets of the ready sessions to their peers
+ *     and processes expired timers. No locks.
+ *
+ * timeout_provider
+ *     The integration of the ccrtp and tivi clients: a timeout provider
+ *     thread with a sorted request list calls back into the engines, a
+ *     receive thread hands the packets to the engines, and synchEnter() and
+ *     synchLeave() lock a mutex per session.
+ *
+ * worker_pool
+ *     As timeout_provider, but the receive thread posts the ZRTP packets to
+ *     a ZrtpWorkerPool, as ZrtpQueue::setZrtpWorkerPool() does.
+ *
+ * Each pair runs a number of full DH handshakes. The program reports the
+ * handshakes per second, the process CPU time per handshake and the context
+ * switches of each mode as JSON. In the receive thread modes the application
+ * thread also sends an RTP probe to the receive thread every millisecond.
+ * The delay until the receive thread takes the probe is the jitter that
+ * the ZRTP processing adds to RTP reception.
+ *
+ * Usage: zrtploop [-p <pairs>] [-r <rounds>] [-k <pk>] [-m <mode>] [-w <threads>] [-o <file>]
+ *
+ *   -p   concurrent ZRTP pairs, default 32
+ *   -r   handshakes per pair, default 4
+ *   -k   key agreement type, default "EC25"
+ *   -m   "loop", "provider", "pool", "both" (loop and provider) or "all",
+ *        default "both"
+ *   -w   threads of the worker pool, default 2
+ *   -o   write JSON to this file instead of stdout
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <common/osSpecifics.h>
+
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZrtpCrc32.h>
+#include <libzrtpcpp/ZrtpEventLoop.h>
+#include <libzrtpcpp/ZrtpWorkerPool.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/zrtpPacket.h>
+#include <cryptcommon/ZrtpRandom.h>
+
+using namespace std;
+using namespace GnuZrtpCodes;
+
+static int numPairs = 32;
+static int numRounds = 4;
+static int poolThreads = 2;
+static const int numZids = 32;
+static const uint64_t roundLimitMs = 30000;
+
+static vector<uint8_t> zidPool;
+
+static uint64_t nowNs()
+{
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct Usage {
+    double cpuSec;
+    uint64_t contextSwitches;
+};
+
+static Usage getUsage()
+{
+    Usage u = {0.0, 0};
+#ifndef _WIN32
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        u.cpuSec = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+        u.contextSwitches = static_cast<uint64_t>(ru.ru_nvcsw + ru.ru_nivcsw);
+    }
+#endif
+    return u;
+}
+
+// Pick different ZIDs for both sides from the pool
+static uint8_t* sideZid(int index, int side)
+{
+    int zidIdx = (2 * index + side) % numZids;
+    if (side == 1 && zidIdx == (2 * index) % numZids)
+        zidIdx = (zidIdx + 1) % numZids;
+    return &zidPool[zidIdx * IDENTIFIER_LEN];
+}
+
+// Check the CRC of a complete ZRTP packet and hand it to the engine
+static bool deliver(ZRtp* engine, const uint8_t* packet, int32_t length, uint32_t peerSsrc)
+{
+    uint16_t crcOffset = static_cast<uint16_t>(length - CRC_SIZE);
+    uint32_t crc;
+    memcpy(&crc, packet + crcOffset, sizeof(crc));
+    if (!zrtpCheckCksum(const_cast<uint8_t*>(packet), crcOffset, zrtpNtohl(crc)))
+        return false;
+    engine->processZrtpMessage(const_cast<uint8_t*>(packet) + 12, peerSsrc, static_cast<size_t>(length));
+    return true;
+}
+
+struct ModeResult {
+    string mode;
+    uint64_t handshakes;
+    uint64_t failures;
+    uint64_t timeouts;
+    uint64_t wakeups;
+    double wallSec;
+    double cpuSec;
+    uint64_t contextSwitches;
+    vector<double> rtpDelayUs;      // receive thread modes: delay of the RTP probes
+
+    ModeResult(const char* name): mode(name), handshakes(0), failures(0), timeouts(0), wakeups(0), wallSec(0.0),
+        cpuSec(0.0), contextSwitches(0) {}
+
+    double rtpDelay(double p) const {
+        if (rtpDelayUs.empty())
+            return 0.0;
+        vector<double> sorted(rtpDelayUs);
+        sort(sorted.begin(), sorted.end());
+        size_t idx = static_cast<size_t>(p * sorted.size());
+        return sorted[idx < sorted.size() ? idx : sorted.size() - 1];
+    }
+};
+
+/*
+ * Callback functions that both modes implement in the same way.
+ */
+#define ZRTPLOOP_COMMON_CALLBACKS \
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part) { return true; } \
+    void srtpSecretsOff(EnableSecurity part)                {} \
+    void srtpSecretsOn(std::string c, std::string s, bool verified) {} \
+    void handleGoClear()                                    {} \
+    void zrtpNegotiationFailed(MessageSeverity severity, int32_t subCode) { failed = true; } \
+    void zrtpNotSuppOther()                                 { failed = true; } \
+    void zrtpAskEnrollment(InfoEnrollment info)             {} \
+    void zrtpInformEnrollment(InfoEnrollment info)          {} \
+    void signSAS(uint8_t* sasHash)                          {} \
+    bool checkSASSignature(uint8_t* sasHash)                { return true; } \
+    void sendInfo(MessageSeverity severity, int32_t subCode) { \
+        if (severity == Info && subCode == InfoSecureStateOn) \
+            secure = true; \
+    }
+
+/* ---------------------------------------------------------------------------
+ * Event loop mode
+ */
+
+class LoopSession: public ZrtpEventSession {
+public:
+    LoopSession(ZrtpEventLoop* loop, uint32_t ssrc): ZrtpEventSession(loop, ssrc), peer(NULL), ssrc(ssrc),
+        secure(false), failed(false) {}
+
+    LoopSession* peer;
+    uint32_t ssrc;
+    bool secure;
+    bool failed;
+
+protected:
+    ZRTPLOOP_COMMON_CALLBACKS
+};
+
+// Send the queued packets of all ready sessions to their peers
+static void drainReady(ZrtpEventLoop& loop)
+{
+    ZrtpEventSession* ready;
+    while ((ready = loop.nextReady()) != NULL) {
+        LoopSession* session = static_cast<LoopSession*>(ready);
+        const uint8_t* packet;
+        int32_t length;
+        while ((packet = session->frontPacket(&length)) != NULL) {
+            ZRtp* peerEngine = session->peer->getZrtpEngine();
+            if (peerEngine != NULL)
+                deliver(peerEngine, packet, length, session->ssrc);
+            session->popPacket();
+        }
+    }
+}
+
+static void runEventLoop(ZrtpConfigure* config, ModeResult& result)
+{
+    ZrtpEventLoop loop;
+    vector<LoopSession*> sessions;
+    for (int p = 0; p < numPairs; p++) {
+        LoopSession* a = new LoopSession(&loop, (p << 1));
+        LoopSession* b = new LoopSession(&loop, (p << 1) | 1);
+        a->peer = b;
+        b->peer = a;
+        sessions.push_back(a);
+        sessions.push_back(b);
+    }
+#ifdef __linux__
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = loop.getEventFd();
+    epoll_ctl(epfd, EPOLL_CTL_ADD, loop.getEventFd(), &ev);
+#endif
+
+    for (int r = 0; r < numRounds; r++) {
+        for (size_t i = 0; i < sessions.size(); i++) {
+            LoopSession* s = sessions[i];
+            s->secure = s->failed = false;
+            s->setZrtpEngine(new ZRtp(sideZid(static_cast<int>(i / 2), static_cast<int>(i % 2)), s, "zrtploop",
+                                      config));
+        }
+        for (size_t i = 0; i < sessions.size(); i++)
+            sessions[i]->getZrtpEngine()->startZrtpEngine();
+
+        uint64_t start = zrtpGetTickCount();
+        int done = 0;
+        while (done < numPairs && zrtpGetTickCount() - start < roundLimitMs) {
+            int32_t timeout = loop.getTimeout(zrtpGetTickCount());
+#ifdef __linux__
+            struct epoll_event events[4];
+            if (epoll_wait(epfd, events, 4, timeout < 0 ? 100 : timeout) > 0)
+                result.wakeups++;
+#else
+            if (!loop.nextReady() && timeout != 0)
+                this_thread::sleep_for(chrono::milliseconds(timeout < 0 ? 1 : timeout));
+#endif
+            drainReady(loop);
+            loop.clearEvent();
+            result.timeouts += loop.processTimers(zrtpGetTickCount());
+
+            done = 0;
+            for (int p = 0; p < numPairs; p++) {
+                LoopSession* a = sessions[2 * p];
+                if ((a->secure && a->peer->secure) || a->failed || a->peer->failed)
+                    done++;
+            }
+        }
+        for (int p = 0; p < numPairs; p++) {
+            LoopSession* a = sessions[2 * p];
+            if (a->secure && a->peer->secure)
+                result.handshakes++;
+            else
+                result.failures++;
+        }
+        for (size_t i = 0; i < sessions.size(); i++) {
+            ZRtp* engine = sessions[i]->getZrtpEngine();
+            engine->stopZrtp();
+            sessions[i]->setZrtpEngine(NULL);
+            delete engine;
+        }
+        drainReady(loop);
+        loop.clearEvent();
+    }
+#ifdef __linux__
+    close(epfd);
+#endif
+    for (size_t i = 0; i < sessions.size(); i++)
+        delete sessions[i];
+}
+
+/* ---------------------------------------------------------------------------
+ * Timeout provider mode
+ */
+
+class ThreadSession;
+
+/*
+ * Timeout provider as in the clients: sorted request list, a thread that
+ * waits for the first request and calls the subscriber without holding the
+ * list lock.
+ */
+class TimerThread {
+public:
+    TimerThread(): stop(false), worker(&TimerThread::run, this) {}
+    ~TimerThread() {
+        {
+            lock_guard<mutex> guard(lock);
+            stop = true;
+        }
+        wakeup.notify_one();
+        worker.join();
+    }
+
+    void requestTimeout(int32_t timeMs, ThreadSession* subscriber) {
+        Request req;
+        req.when = zrtpGetTickCount() + timeMs;
+        req.subscriber = subscriber;
+        lock_guard<mutex> guard(lock);
+        list<Request>::iterator it = requests.begin();
+        while (it != requests.end() && it->when <= req.when)
+            ++it;
+        requests.insert(it, req);
+        wakeup.notify_one();
+    }
+
+    void cancelRequest(ThreadSession* subscriber) {
+        lock_guard<mutex> guard(lock);
+        for (list<Request>::iterator it = requests.begin(); it != requests.end(); ) {
+            if (it->subscriber == subscriber)
+                it = requests.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    // Wait until a running callback returned
+    void quiesce() {
+        lock_guard<mutex> guard(dispatch);
+    }
+
+    uint64_t fired = 0;
+
+private:
+    struct Request {
+        uint64_t when;
+        ThreadSession* subscriber;
+    };
+
+    void run();
+
+    list<Request> requests;
+    mutex lock;
+    mutex dispatch;
+    condition_variable wakeup;
+    bool stop;
+    thread worker;
+};
+
+class ReceiveThread;
+
+class ThreadSession: public ZrtpCallback {
+public:
+    ThreadSession(uint32_t ssrc): engine(NULL), peer(NULL), timer(NULL), network(NULL), ssrc(ssrc), seq(0),
+        round(0), secure(false), failed(false) {}
+
+    void handleTimeout() {
+        lock_guard<recursive_mutex> guard(engineLock);
+        if (engine != NULL)
+            engine->processTimeout();
+    }
+
+    recursive_mutex engineLock;
+    ZRtp* engine;
+    ThreadSession* peer;
+    TimerThread* timer;
+    ReceiveThread* network;
+    uint32_t ssrc;
+    uint16_t seq;
+    int round;
+    volatile bool secure;
+    volatile bool failed;
+    ZrtpWorkerPool::Strand strand;
+
+protected:
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length);
+    int32_t activateTimer(int32_t time)   { timer->requestTimeout(time, this); return 1; }
+    int32_t cancelTimer()                 { timer->cancelRequest(this); return 1; }
+    void synchEnter()                     { engineLock.lock(); }
+    void synchLeave()                     { engineLock.unlock(); }
+
+    ZRTPLOOP_COMMON_CALLBACKS
+};
+
+void TimerThread::run()
+{
+    unique_lock<mutex> guard(lock);
+    while (!stop) {
+        if (requests.empty()) {
+            wakeup.wait(guard);
+            continue;
+        }
+        uint64_t now = zrtpGetTickCount();
+        if (requests.front().when > now) {
+            wakeup.wait_for(guard, chrono::milliseconds(requests.front().when - now));
+            continue;
+        }
+        ThreadSession* subscriber = requests.front().subscriber;
+        requests.pop_front();
+        fired++;
+
+        // Call the subscriber with free list lock
+        lock_guard<mutex> busy(dispatch);
+        guard.unlock();
+        subscriber->handleTimeout();
+        guard.lock();
+    }
+}
+
+/*
+ * Receive thread, plays the RTP stack's thread that reads the socket and
+ * hands ZRTP packets to the engine or to the worker pool. It also takes the
+ * RTP probes of the application thread and records their delay.
+ */
+class ReceiveThread {
+public:
+    ReceiveThread(ZrtpWorkerPool* pool): pool(pool), stop(false), worker(&ReceiveThread::run, this) {}
+    ~ReceiveThread() { shutdown(); }
+
+    // Process the remaining items and stop the thread
+    void shutdown() {
+        {
+            lock_guard<mutex> guard(lock);
+            stop = true;
+        }
+        wakeup.notify_one();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    void post(ThreadSession* target, vector<uint8_t>* packet, uint32_t fromSsrc, int round) {
+        Item item = {target, packet, fromSsrc, round, 0};
+        lock_guard<mutex> guard(lock);
+        items.push_back(item);
+        wakeup.notify_one();
+    }
+
+    void postRtp() {
+        Item item = {NULL, NULL, 0, 0, nowNs()};
+        lock_guard<mutex> guard(lock);
+        items.push_back(item);
+        wakeup.notify_one();
+    }
+
+    vector<double> rtpDelayUs;      // read after the thread stopped
+
+private:
+    struct Item {
+        ThreadSession* target;      // NULL for an RTP probe
+        vector<uint8_t>* packet;
+        uint32_t fromSsrc;
+        int round;
+        uint64_t postedNs;
+    };
+
+    static void deliverItem(Item& item) {
+        lock_guard<recursive_mutex> engine(item.target->engineLock);
+        if (item.target->engine != NULL && item.target->round == item.round)
+            deliver(item.target->engine, item.packet->data(), static_cast<int32_t>(item.packet->size()),
+                    item.fromSsrc);
+    }
+
+    static void deliverTask(void* context, void* data) {
+        Item* item = static_cast<Item*>(data);
+        deliverItem(*item);
+        delete item->packet;
+        delete item;
+    }
+
+    void run() {
+        unique_lock<mutex> guard(lock);
+        while (!stop || !items.empty()) {
+            if (items.empty()) {
+                wakeup.wait(guard);
+                continue;
+            }
+            Item item = items.front();
+            items.pop_front();
+            guard.unlock();
+            if (item.target == NULL) {
+                rtpDelayUs.push_back((nowNs() - item.postedNs) / 1000.0);
+            }
+            else if (pool != NULL) {
+                pool->post(&item.target->strand, deliverTask, item.target, new Item(item));
+            }
+            else {
+                deliverItem(item);
+                delete item.packet;
+            }
+            guard.lock();
+        }
+    }
+
+    ZrtpWorkerPool* pool;
+    deque<Item> items;
+    mutex lock;
+    condition_variable wakeup;
+    bool stop;
+    thread worker;
+};
+
+int32_t ThreadSession::sendDataZRTP(const uint8_t* data, int32_t length)
+{
+    // Build the packet as the RTP stack does: header, message, CRC
+    vector<uint8_t>* pkt = new vector<uint8_t>(12 + length);
+    uint8_t* buffer = pkt->data();
+    uint16_t s = zrtpHtons(seq++);
+    uint32_t magic = zrtpHtonl(ZRTP_MAGIC);
+    uint32_t ns = zrtpHtonl(ssrc);
+
+    buffer[0] = 0x10;
+    buffer[1] = 0;
+    memcpy(buffer + 2, &s, sizeof(s));
+    memcpy(buffer + 4, &magic, sizeof(magic));
+    memcpy(buffer + 8, &ns, sizeof(ns));
+    memcpy(buffer + 12, data, length - CRC_SIZE);
+
+    uint16_t crcOffset = static_cast<uint16_t>(pkt->size() - CRC_SIZE);
+    uint32_t crc = zrtpHtonl(zrtpEndCksum(zrtpGenerateCksum(buffer, crcOffset)));
+    memcpy(buffer + crcOffset, &crc, sizeof(crc));
+
+    network->post(peer, pkt, ssrc, round);
+    return 1;
+}
+
+static void runReceiveThread(ZrtpConfigure* config, ModeResult& result, ZrtpWorkerPool* pool)
+{
+    TimerThread* timer = new TimerThread;
+    ReceiveThread* network = new ReceiveThread(pool);
+
+    vector<ThreadSession*> sessions;
+    for (int p = 0; p < numPairs; p++) {
+        ThreadSession* a = new ThreadSession(p << 1);
+        ThreadSession* b = new ThreadSession((p << 1) | 1);
+        a->peer = b;
+        b->peer = a;
+        sessions.push_back(a);
+        sessions.push_back(b);
+    }
+    for (size_t i = 0; i < sessions.size(); i++) {
+        sessions[i]->timer = timer;
+        sessions[i]->network = network;
+    }
+
+    for (int r = 0; r < numRounds; r++) {
+        for (size_t i = 0; i < sessions.size(); i++) {
+            ThreadSession* s = sessions[i];
+            lock_guard<recursive_mutex> guard(s->engineLock);
+            s->secure = s->failed = false;
+            s->round = r;
+            s->engine = new ZRtp(sideZid(static_cast<int>(i / 2), static_cast<int>(i % 2)), s, "zrtploop", config);
+        }
+        for (size_t i = 0; i < sessions.size(); i++)
+            sessions[i]->engine->startZrtpEngine();
+
+        // The application thread sends RTP probes, the ZRTP work runs in the
+        // receive, timer and pool threads
+        uint64_t start = zrtpGetTickCount();
+        int done = 0;
+        while (done < numPairs && zrtpGetTickCount() - start < roundLimitMs) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+            network->postRtp();
+            done = 0;
+            for (int p = 0; p < numPairs; p++) {
+                ThreadSession* a = sessions[2 * p];
+                if ((a->secure && a->peer->secure) || a->failed || a->peer->failed)
+                    done++;
+            }
+        }
+        for (int p = 0; p < numPairs; p++) {
+            ThreadSession* a = sessions[2 * p];
+            if (a->secure && a->peer->secure)
+                result.handshakes++;
+            else
+                result.failures++;
+        }
+        for (size_t i = 0; i < sessions.size(); i++) {
+            ThreadSession* s = sessions[i];
+            lock_guard<recursive_mutex> guard(s->engineLock);
+            s->engine->stopZrtp();
+            delete s->engine;
+            s->engine = NULL;
+        }
+        timer->quiesce();
+    }
+    network->shutdown();
+    result.rtpDelayUs.swap(network->rtpDelayUs);
+    delete network;
+    result.timeouts = timer->fired;
+    delete timer;
+    for (size_t i = 0; i < sessions.size(); i++) {
+        if (pool != NULL)
+            pool->drain(&sessions[i]->strand);
+        delete sessions[i];
+    }
+}
+
+static void runTimeoutProvider(ZrtpConfigure* config, ModeResult& result)
+{
+    runReceiveThread(config, result, NULL);
+}
+
+static void runWorkerPool(ZrtpConfigure* config, ModeResult& result)
+{
+    ZrtpWorkerPool pool(poolThreads);
+    runReceiveThread(config, result, &pool);
+}
+
+/* ---------------------------------------------------------------------------
+ */
+
+static void runMode(ZrtpConfigure* config, ModeResult& result, void (*run)(ZrtpConfigure*, ModeResult&))
+{
+    Usage u0 = getUsage();
+    uint64_t t0 = nowNs();
+    run(config, result);
+    result.wallSec = (nowNs() - t0) / 1e9;
+    Usage u1 = getUsage();
+    result.cpuSec = u1.cpuSec - u0.cpuSec;
+    result.contextSwitches = u1.contextSwitches - u0.contextSwitches;
+
+    fprintf(stderr, "%-16s %llu handshakes, %llu failures, %.1f handshakes/s, %.3f ms CPU per handshake, "
+                    "%llu context switches\n",
+            result.mode.c_str(), (unsigned long long)result.handshakes, (unsigned long long)result.failures,
+            result.handshakes / result.wallSec, result.handshakes > 0 ? result.cpuSec * 1000.0 / result.handshakes : 0.0,
+            (unsigned long long)result.contextSwitches);
+    if (!result.rtpDelayUs.empty())
+        fprintf(stderr, "%-16s RTP probe delay p50 %.0f us, p99 %.0f us, max %.0f us\n", "",
+                result.rtpDelay(0.5), result.rtpDelay(0.99), result.rtpDelay(1.0));
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [-p <pairs>] [-r <rounds>] [-k <pk>] [-m <loop|provider|pool|both|all>] [-w <threads>] "
+                    "[-o <file>]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const char* pkName = "EC25";
+    const char* modeName = "both";
+    const char* outName = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (arg[0] != '-' || arg[1] == 0 || arg[2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* val = argv[++i];
+        switch (arg[1]) {
+        case 'p': numPairs = atoi(val); break;
+        case 'r': numRounds = atoi(val); break;
+        case 'k': pkName = val; break;
+        case 'm': modeName = val; break;
+        case 'w': poolThreads = atoi(val); break;
+        case 'o': outName = val; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    bool runAll = strcmp(modeName, "all") == 0;
+    bool runLoop = strcmp(modeName, "loop") == 0 || strcmp(modeName, "both") == 0 || runAll;
+    bool runProvider = strcmp(modeName, "provider") == 0 || strcmp(modeName, "both") == 0 || runAll;
+    bool runPool = strcmp(modeName, "pool") == 0 || runAll;
+    if (numPairs < 1 || numRounds < 1 || poolThreads < 1 || (!runLoop && !runProvider && !runPool)) {
+        usage(argv[0]);
+        return 1;
+    }
+    AlgorithmEnum& pk = zrtpPubKeys.getByName(pkName);
+    if (!pk.isValid()) {
+        fprintf(stderr, "Unknown key agreement %s\n", pkName);
+        return 1;
+    }
+
+    char cacheName[64];
+    snprintf(cacheName, sizeof(cacheName), "zrtploop-%ld.zid", (long)nowNs());
+    ZIDCache* cache = getZidCacheInstance();
+    if (cache->open(cacheName) <= 0) {
+        fprintf(stderr, "Cannot open ZID cache file %s\n", cacheName);
+        return 1;
+    }
+    zidPool.resize(numZids * IDENTIFIER_LEN);
+    ZrtpRandom::getRandomData(zidPool.data(), zidPool.size());
+
+    ZrtpConfigure config;
+    config.setStandardConfig();
+    config.addAlgoAt(PubKeyAlgorithm, pk, 0);
+
+    vector<ModeResult> results;
+    if (runLoop) {
+        results.push_back(ModeResult("event_loop"));
+        runMode(&config, results.back(), runEventLoop);
+    }
+    if (runProvider) {
+        results.push_back(ModeResult("timeout_provider"));
+        runMode(&config, results.back(), runTimeoutProvider);
+    }
+    if (runPool) {
+        results.push_back(ModeResult("worker_pool"));
+        runMode(&config, results.back(), runWorkerPool);
+    }
+
+    FILE* out = stdout;
+    if (outName != NULL && (out = fopen(outName, "w")) == NULL) {
+        fprintf(stderr, "Cannot open output file %s\n", outName);
+        return 1;
+    }
+    fprintf(out, "{\n  \"benchmark\": \"zrtploop\",\n  \"pairs\": %d, \"rounds\": %d, \"key_agreement\": \"%s\",\n",
+            numPairs, numRounds, pkName);
+    fprintf(out, "  \"results\": [\n");
+    uint64_t failures = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        ModeResult& r = results[i];
+        fprintf(out, "    {\"mode\": \"%s\", \"handshakes\": %llu, \"failures\": %llu, \"timeouts\": %llu, "
+                     "\"wakeups\": %llu, \"wall_sec\": %.3f, \"handshakes_per_sec\": %.1f, "
+                     "\"cpu_ms_per_handshake\": %.3f, \"context_switches\": %llu, \"rtp_probes\": %llu, "
+                     "\"rtp_delay_p50_us\": %.1f, \"rtp_delay_p99_us\": %.1f, \"rtp_delay_max_us\": %.1f}%s\n",
+                r.mode.c_str(), (unsigned long long)r.handshakes, (unsigned long long)r.failures,
+                (unsigned long long)r.timeouts, (unsigned long long)r.wakeups, r.wallSec, r.handshakes / r.wallSec,
+                r.handshakes > 0 ? r.cpuSec * 1000.0 / r.handshakes : 0.0, (unsigned long long)r.contextSwitches,
+                (unsigned long long)r.rtpDelayUs.size(), r.rtpDelay(0.5), r.rtpDelay(0.99), r.rtpDelay(1.0),
+                i + 1 < results.size() ? "," : "");
+        failures += r.failures;
+    }
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout)
+        fclose(out);
+
+    cache->close();
+    remove(cacheName);
+    return failures == 0 ? 0 : 1;
+}
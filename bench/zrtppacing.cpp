@@ -0,0 +1,432 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Simulation of a mass ZRTP restart, with and without retransmission pacing.
+ *
+ * The program restarts many ZRtp engines in the same millisecond, as after
+ * a network outage. Some engines have a peer and run a full handshake, the
+ * others have lost their peer and send Hello packets until they give up.
+ * All engines send through one simulated link: a socket buffer with a fixed
+ * size that drains with a fixed packet rate. The link drops packets if the
+ * buffer is full. The simulation runs on a virtual clock, thus the timers
+ * do not cost real time.
+ *
+ * The program runs the scenario twice, without pacing and with the
+ * ZrtpRetransmitPacer, and reports per mode:
+ *
+ * - sent and dropped packets, the packets of the restart and the peak of
+ *   sent packets per 10 ms after the restart,
+ * - completed handshakes and the p50, p99 and maximum time to SecureState,
+ * - the pacer counters for sent, delayed, suppressed and forced
+ *   retransmissions.
+ *
+ * Usage: zrtppacing [-n <sessions>] [-p <pairs>] [-R <packets/ms>] [-B <packets>]
+ *                   [-r <packets/s>] [-b <burst>] [-j <percent>] [-d <ms>]
+ *                   [-k <pk>] [-m <mode>] [-o <file>]
+ *
+ *   -n   restarted sessions, default 10000
+ *   -p   pairs among the sessions that have a peer, default 200
+ *   -R   link rate in packets per millisecond, default 20
+ *   -B   link buffer in packets, default 256
+ *   -r   pacer rate in packets per second, default 80% of the link rate
+ *   -b   pacer burst in packets, default 200
+ *   -j   pacer jitter in percent, default 25
+ *   -d   pacer maximum delay in milliseconds, default 1000
+ *   -k   key agreement type, default "EC25"
+ *   -m   "off", "on" or "both", default "both"
+ *   -o   write JSON to this file instead of stdout
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <common/osSpecifics.h>
+
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZrtpRetransmitPacer.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <cryptcommon/ZrtpRandom.h>
+
+using namespace std;
+using namespace GnuZrtpCodes;
+
+static int numSessions = 10000;
+static int numPairs = 200;
+static int linkRate = 20;                   // packets per ms
+static int linkBuffer = 256;
+static int pacerRate = 0;                   // 0: 80% of the link rate
+static int pacerBurst = 200;
+static int pacerJitter = 25;
+static int pacerMaxDelay = 1000;
+static const int numZids = 32;
+static const uint64_t delayUs = 20 * 1000;  // one way delay after the link
+static const uint64_t limitUs = 120ULL * 1000 * 1000;
+static const uint64_t windowUs = 10 * 1000;
+
+static vector<uint8_t> zidPool;
+static uint64_t virtualUs = 0;
+
+static uint64_t virtualMs()
+{
+    return virtualUs / 1000;
+}
+
+static uint64_t nowNs()
+{
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static uint8_t* sideZid(int index, int side)
+{
+    int zidIdx = (2 * index + side) % numZids;
+    if (side == 1 && zidIdx == (2 * index) % numZids)
+        zidIdx = (zidIdx + 1) % numZids;
+    return &zidPool[zidIdx * IDENTIFIER_LEN];
+}
+
+struct SimEvent {
+    uint64_t timeUs;
+    uint64_t order;             // keeps events of the same time in FIFO order
+    int32_t session;
+    uint64_t timerId;           // 0: packet event
+    vector<uint8_t>* packet;
+    uint32_t fromSsrc;
+
+    bool operator<(const SimEvent& other) const {
+        return timeUs != other.timeUs ? timeUs > other.timeUs : order > other.order;
+    }
+};
+
+struct ModeResult {
+    string mode;
+    uint64_t sent;
+    uint64_t dropped;
+    uint64_t restartBurst;
+    uint64_t peakPerWindow;
+    uint64_t handshakes;
+    double p50Ms;
+    double p99Ms;
+    double maxMs;
+    double wallSec;
+    ZrtpRetransmitPacer::Counters pacer;
+
+    ModeResult(const char* name): mode(name), sent(0), dropped(0), restartBurst(0), peakPerWindow(0), handshakes(0), p50Ms(0.0),
+        p99Ms(0.0), maxMs(0.0), wallSec(0.0) {
+        memset(&pacer, 0, sizeof(pacer));
+    }
+};
+
+class Simulation;
+
+class SimSession: public ZrtpCallback {
+public:
+    SimSession(Simulation* sim, int32_t index, int32_t peer): engine(NULL), sim(sim), index(index), peer(peer),
+        timerId(0), secure(false), secureUs(0) {}
+
+    ZRtp* engine;
+    Simulation* sim;
+    int32_t index;
+    int32_t peer;               // -1: peer lost
+    uint64_t timerId;
+    bool secure;
+    uint64_t secureUs;
+
+protected:
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length);
+    int32_t activateTimer(int32_t time);
+    int32_t cancelTimer()                                   { timerId = 0; return 1; }
+    void synchEnter()                                       {}
+    void synchLeave()                                       {}
+
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part) { return true; }
+    void srtpSecretsOff(EnableSecurity part)                {}
+    void srtpSecretsOn(std::string c, std::string s, bool verified) {}
+    void handleGoClear()                                    {}
+    void zrtpNegotiationFailed(MessageSeverity severity, int32_t subCode) {}
+    void zrtpNotSuppOther()                                 {}
+    void zrtpAskEnrollment(InfoEnrollment info)             {}
+    void zrtpInformEnrollment(InfoEnrollment info)          {}
+    void signSAS(uint8_t* sasHash)                          {}
+    bool checkSASSignature(uint8_t* sasHash)                { return true; }
+    void sendInfo(MessageSeverity severity, int32_t subCode) {
+        if (severity == Info && subCode == InfoSecureStateOn && !secure) {
+            secure = true;
+            secureUs = virtualUs;
+        }
+    }
+};
+
+class Simulation {
+public:
+    Simulation(ModeResult& result): result(result), order(0), lastTimerId(0), linkBusyUs(0),
+        windows(limitUs / windowUs + 1, 0) {}
+
+    void push(uint64_t timeUs, int32_t session, uint64_t timerId, vector<uint8_t>* packet, uint32_t fromSsrc) {
+        SimEvent ev = {timeUs, ++order, session, timerId, packet, fromSsrc};
+        events.push(ev);
+    }
+
+    // The socket buffer drains with linkRate packets per ms
+    bool transmit(uint64_t& arrivalUs) {
+        uint64_t now = virtualUs;
+        uint64_t backlog = linkBusyUs > now ? (linkBusyUs - now) * linkRate / 1000 : 0;
+
+        result.sent++;
+        windows[now / windowUs]++;
+        if (backlog >= static_cast<uint64_t>(linkBuffer)) {
+            result.dropped++;
+            return false;
+        }
+        linkBusyUs = max(linkBusyUs, now) + 1000 / linkRate;
+        arrivalUs = linkBusyUs + delayUs;
+        return true;
+    }
+
+    void run(vector<SimSession*>& sessions) {
+        while (!events.empty()) {
+            SimEvent ev = events.top();
+            events.pop();
+            if (ev.timeUs > limitUs) {
+                delete ev.packet;
+                continue;
+            }
+            virtualUs = ev.timeUs;
+            SimSession* s = sessions[ev.session];
+            if (ev.packet != NULL) {
+                if (s->engine != NULL)
+                    s->engine->processZrtpMessage(ev.packet->data() + 12, ev.fromSsrc, ev.packet->size());
+                delete ev.packet;
+            }
+            else if (ev.timerId == s->timerId) {
+                s->timerId = 0;
+                s->engine->processTimeout();
+            }
+        }
+        // The first window holds the restart itself, the first packets
+        // are not paced
+        result.restartBurst = windows[0];
+        for (size_t i = 1; i < windows.size(); i++)
+            result.peakPerWindow = max(result.peakPerWindow, windows[i]);
+    }
+
+    ModeResult& result;
+    priority_queue<SimEvent> events;
+    uint64_t order;
+    uint64_t lastTimerId;
+    uint64_t linkBusyUs;
+    vector<uint64_t> windows;
+};
+
+int32_t SimSession::sendDataZRTP(const uint8_t* data, int32_t length)
+{
+    uint64_t arrivalUs;
+    if (!sim->transmit(arrivalUs) || peer < 0)
+        return 1;
+
+    // The simulation skips the CRC, the link does not corrupt packets
+    vector<uint8_t>* packet = new vector<uint8_t>(12 + length);
+    memcpy(packet->data() + 12, data, length);
+    sim->push(arrivalUs, peer, 0, packet, static_cast<uint32_t>(index));
+    return 1;
+}
+
+int32_t SimSession::activateTimer(int32_t time)
+{
+    timerId = ++sim->lastTimerId;
+    sim->push(virtualUs + static_cast<uint64_t>(time) * 1000, index, timerId, NULL, 0);
+    return 1;
+}
+
+static void runMode(ZrtpConfigure* config, bool paced, ModeResult& result)
+{
+    ZrtpRetransmitPacer& pacer = ZrtpRetransmitPacer::getInstance();
+    virtualUs = 0;
+    pacer.setClock(virtualMs);
+    pacer.setRate(paced ? pacerRate : 0, pacerBurst);
+    pacer.setJitter(paced ? pacerJitter : 0);
+    pacer.setMaxDelay(pacerMaxDelay);
+    pacer.resetCounters();
+
+    Simulation sim(result);
+    vector<SimSession*> sessions;
+    for (int i = 0; i < numSessions; i++) {
+        int32_t peer = -1;
+        if (i < 2 * numPairs)
+            peer = (i % 2 == 0) ? i + 1 : i - 1;
+        SimSession* s = new SimSession(&sim, i, peer);
+        s->engine = new ZRtp(sideZid(i / 2, i % 2), s, "zrtppacing", config);
+        sessions.push_back(s);
+    }
+
+    // The restart: all engines send their first Hello at the same time
+    uint64_t t0 = nowNs();
+    for (size_t i = 0; i < sessions.size(); i++)
+        sessions[i]->engine->startZrtpEngine();
+    sim.run(sessions);
+    result.wallSec = (nowNs() - t0) / 1e9;
+    result.pacer = pacer.getCounters();
+
+    vector<double> times;
+    for (int i = 0; i < 2 * numPairs; i += 2) {
+        if (sessions[i]->secure && sessions[i + 1]->secure)
+            times.push_back(max(sessions[i]->secureUs, sessions[i + 1]->secureUs) / 1000.0);
+    }
+    sort(times.begin(), times.end());
+    result.handshakes = times.size();
+    if (!times.empty()) {
+        result.p50Ms = times[times.size() / 2];
+        result.p99Ms = times[min(times.size() - 1, times.size() * 99 / 100)];
+        result.maxMs = times.back();
+    }
+
+    for (size_t i = 0; i < sessions.size(); i++) {
+        sessions[i]->engine->stopZrtp();
+        delete sessions[i]->engine;
+        delete sessions[i];
+    }
+    while (!sim.events.empty()) {
+        delete sim.events.top().packet;
+        sim.events.pop();
+    }
+    pacer.setRate(0, pacerBurst);
+    pacer.setJitter(0);
+    pacer.setClock(NULL);
+
+    fprintf(stderr, "%-4s sent %llu, dropped %llu, peak %llu/10ms, %llu/%d handshakes, p50 %.0f ms, p99 %.0f ms, "
+                    "delayed %llu, suppressed %llu\n",
+            result.mode.c_str(), (unsigned long long)result.sent, (unsigned long long)result.dropped,
+            (unsigned long long)result.peakPerWindow, (unsigned long long)result.handshakes, numPairs, result.p50Ms,
+            result.p99Ms, (unsigned long long)result.pacer.delayed, (unsigned long long)result.pacer.suppressed);
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [-n <sessions>] [-p <pairs>] [-R <packets/ms>] [-B <packets>] [-r <packets/s>] "
+                    "[-b <burst>] [-j <percent>] [-d <ms>] [-k <pk>] [-m <off|on|both>] [-o <file>]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const char* pkName = "EC25";
+    const char* modeName = "both";
+    const char* outName = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (arg[0] != '-' || arg[1] == 0 || arg[2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* val = argv[++i];
+        switch (arg[1]) {
+        case 'n': numSessions = atoi(val); break;
+        case 'p': numPairs = atoi(val); break;
+        case 'R': linkRate = atoi(val); break;
+        case 'B': linkBuffer = atoi(val); break;
+        case 'r': pacerRate = atoi(val); break;
+        case 'b': pacerBurst = atoi(val); break;
+        case 'j': pacerJitter = atoi(val); break;
+        case 'd': pacerMaxDelay = atoi(val); break;
+        case 'k': pkName = val; break;
+        case 'm': modeName = val; break;
+        case 'o': outName = val; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    bool runOff = strcmp(modeName, "off") == 0 || strcmp(modeName, "both") == 0;
+    bool runOn = strcmp(modeName, "on") == 0 || strcmp(modeName, "both") == 0;
+    if (numSessions < 2 || numPairs < 1 || 2 * numPairs > numSessions || linkRate < 1 || linkRate > 1000 ||
+        linkBuffer < 1 || (!runOff && !runOn)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (pacerRate <= 0)
+        pacerRate = linkRate * 1000 * 8 / 10;
+    AlgorithmEnum& pk = zrtpPubKeys.getByName(pkName);
+    if (!pk.isValid()) {
+        fprintf(stderr, "Unknown key agreement %s\n", pkName);
+        return 1;
+    }
+
+    char cacheName[64];
+    snprintf(cacheName, sizeof(cacheName), "zrtppacing-%ld.zid", (long)nowNs());
+    ZIDCache* cache = getZidCacheInstance();
+    if (cache->open(cacheName) <= 0) {
+        fprintf(stderr, "Cannot open ZID cache file %s\n", cacheName);
+        return 1;
+    }
+    zidPool.resize(numZids * IDENTIFIER_LEN);
+    ZrtpRandom::getRandomData(zidPool.data(), zidPool.size());
+
+    ZrtpConfigure config;
+    config.setStandardConfig();
+    config.addAlgoAt(PubKeyAlgorithm, pk, 0);
+
+    vector<ModeResult> results;
+    if (runOff) {
+        results.push_back(ModeResult("off"));
+        runMode(&config, false, results.back());
+    }
+    if (runOn) {
+        results.push_back(ModeResult("on"));
+        runMode(&config, true, results.back());
+    }
+
+    FILE* out = stdout;
+    if (outName != NULL && (out = fopen(outName, "w")) == NULL) {
+        fprintf(stderr, "Cannot open output file %s\n", outName);
+        return 1;
+    }
+    fprintf(out, "{\n  \"benchmark\": \"zrtppacing\",\n  \"sessions\": %d, \"pairs\": %d, \"link_rate_per_ms\": %d, "
+                 "\"link_buffer\": %d,\n  \"pacer_rate\": %d, \"pacer_burst\": %d, \"pacer_jitter\": %d, "
+                 "\"pacer_max_delay_ms\": %d, \"key_agreement\": \"%s\",\n",
+            numSessions, numPairs, linkRate, linkBuffer, pacerRate, pacerBurst, pacerJitter, pacerMaxDelay, pkName);
+    fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        ModeResult& r = results[i];
+        fprintf(out, "    {\"pacing\": \"%s\", \"sent\": %llu, \"dropped\": %llu, \"restart_burst\": %llu, \"peak_per_10ms\": %llu, "
+                     "\"handshakes\": %llu, \"p50_ms\": %.1f, \"p99_ms\": %.1f, \"max_ms\": %.1f, "
+                     "\"paced_sent\": %llu, \"delayed\": %llu, \"suppressed\": %llu, \"forced\": %llu, "
+                     "\"wall_sec\": %.3f}%s\n",
+                r.mode.c_str(), (unsigned long long)r.sent, (unsigned long long)r.dropped,
+                (unsigned long long)r.restartBurst, (unsigned long long)r.peakPerWindow, (unsigned long long)r.handshakes, r.p50Ms, r.p99Ms, r.maxMs,
+                (unsigned long long)r.pacer.sent, (unsigned long long)r.pacer.delayed,
+                (unsigned long long)r.pacer.suppressed, (unsigned long long)r.pacer.forced, r.wallSec,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout)
+        fclose(out);
+
+    cache->close();
+    remove(cacheName);
+    return 0;
+}
@@ -0,0 +1,529 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Scaling benchmark of the sharded session reactor.
+ *
+ * For each shard count the program creates a ZrtpShardReactor and measures
+ * two workloads:
+ *
+ * handshakes
+ *     Pairs of ZRtp engines on each shard run full DH handshakes. Both
+ *     engines of a pair live in the same shard, the shard's ready handler
+ *     hands the packets of one engine to the other one.
+ *
+ * srtp
+ *     Producer threads, one per shard, play the RTP threads of an
+ *     application. They post RTP packets through the lock-free rings to the
+ *     shards, the shard thread protects and unprotects each packet with the
+ *     SRTP contexts of a session and returns the packet through another ring.
+ *
+ * The program writes handshakes/s and SRTP packets/s per shard count as
+ * JSON. The numbers scale only up to the number of cores of the machine.
+ *
+ * Usage: zrtpshards [-c <shards,...>] [-p <pairs>] [-r <rounds>] [-n <packets>]
+ *                   [-b <bytes>] [-k <pk>] [-a <0|1>] [-o <file>]
+ *
+ *   -c   shard counts, default "1,2,4,8,16,32"
+ *   -p   ZRTP pairs per shard, default 2
+ *   -r   handshakes per pair, default 1
+ *   -n   SRTP packets per shard count, default 200000
+ *   -b   RTP payload size, default 160
+ *   -k   key agreement type, default "EC25"
+ *   -a   if 1 pin the shard threads to cores, default 1
+ *   -o   write JSON to this file instead of stdout
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/osSpecifics.h>
+
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZrtpCrc32.h>
+#include <libzrtpcpp/ZrtpEventLoop.h>
+#include <libzrtpcpp/ZrtpShardReactor.h>
+#include <libzrtpcpp/ZrtpSpscRing.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/zrtpPacket.h>
+#include <cryptcommon/ZrtpRandom.h>
+#include <srtp/ZsrtpCWrapper.h>
+
+using namespace std;
+using namespace GnuZrtpCodes;
+
+static int numPairs = 2;
+static int numRounds = 1;
+static int numPackets = 200000;
+static int payload = 160;
+static const int numZids = 32;
+static const uint64_t roundLimitMs = 60000;
+static const int packetsPerProducer = 256;
+static const int rtpHeader = 12;
+
+static vector<uint8_t> zidPool;
+
+static uint64_t nowNs()
+{
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static uint8_t* sideZid(int index, int side)
+{
+    int zidIdx = (2 * index + side) % numZids;
+    if (side == 1 && zidIdx == (2 * index) % numZids)
+        zidIdx = (zidIdx + 1) % numZids;
+    return &zidPool[zidIdx * IDENTIFIER_LEN];
+}
+
+struct ShardResult {
+    int shards;
+    uint64_t handshakes;
+    uint64_t failures;
+    double handshakeSec;
+    uint64_t packets;
+    uint64_t srtpFailures;
+    uint64_t ringFull;
+    double srtpSec;
+
+    ShardResult(int shards): shards(shards), handshakes(0), failures(0), handshakeSec(0.0), packets(0),
+        srtpFailures(0), ringFull(0), srtpSec(0.0) {}
+};
+
+/* ---------------------------------------------------------------------------
+ * Handshakes
+ */
+
+class ShardSession: public ZrtpEventSession {
+public:
+    ShardSession(ZrtpEventLoop* loop, uint32_t ssrc, atomic<int>* done): ZrtpEventSession(loop, ssrc), peer(NULL),
+        ssrc(ssrc), secure(false), failed(false), done(done) {}
+
+    ShardSession* peer;
+    uint32_t ssrc;
+    bool secure;
+    bool failed;
+
+protected:
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part) { return true; }
+    void srtpSecretsOff(EnableSecurity part)                {}
+    void srtpSecretsOn(std::string c, std::string s, bool verified) {}
+    void handleGoClear()                                    {}
+    void zrtpNegotiationFailed(MessageSeverity severity, int32_t subCode) { setDone(failed); }
+    void zrtpNotSuppOther()                                 { setDone(failed); }
+    void zrtpAskEnrollment(InfoEnrollment info)             {}
+    void zrtpInformEnrollment(InfoEnrollment info)          {}
+    void signSAS(uint8_t* sasHash)                          {}
+    bool checkSASSignature(uint8_t* sasHash)                { return true; }
+    void sendInfo(MessageSeverity severity, int32_t subCode) {
+        if (severity == Info && subCode == InfoSecureStateOn)
+            setDone(secure);
+    }
+
+private:
+    // Both engines of a pair run in the same shard thread. Count a pair
+    // once, when the second engine reached its final state.
+    void setDone(bool& flag) {
+        bool wasDone = secure || failed;
+        flag = true;
+        if (!wasDone && (peer->secure || peer->failed))
+            done->fetch_add(1);
+    }
+
+    atomic<int>* done;
+};
+
+static void deliverReady(ZrtpEventSession* ready, void* userData)
+{
+    ShardSession* session = static_cast<ShardSession*>(ready);
+    const uint8_t* packet;
+    int32_t length;
+
+    while ((packet = session->frontPacket(&length)) != NULL) {
+        ZRtp* peerEngine = session->peer->getZrtpEngine();
+        uint16_t crcOffset = static_cast<uint16_t>(length - CRC_SIZE);
+        uint32_t crc;
+        memcpy(&crc, packet + crcOffset, sizeof(crc));
+        if (peerEngine != NULL && zrtpCheckCksum(const_cast<uint8_t*>(packet), crcOffset, zrtpNtohl(crc)))
+            peerEngine->processZrtpMessage(const_cast<uint8_t*>(packet) + 12, session->ssrc, length);
+        session->popPacket();
+    }
+}
+
+static void startEngine(void* context, void* data)
+{
+    static_cast<ShardSession*>(context)->getZrtpEngine()->startZrtpEngine();
+}
+
+static void runHandshakes(ZrtpShardReactor& reactor, ZrtpConfigure* config, ShardResult& result)
+{
+    int shards = reactor.getNumberOfShards();
+    atomic<int> done(0);
+    vector<ShardSession*> sessions;
+
+    for (int s = 0; s < shards; s++) {
+        for (int p = 0; p < numPairs; p++) {
+            uint32_t ssrc = static_cast<uint32_t>((s * numPairs + p) << 1);
+            ShardSession* a = new ShardSession(reactor.getEventLoop(s), ssrc, &done);
+            ShardSession* b = new ShardSession(reactor.getEventLoop(s), ssrc | 1, &done);
+            a->peer = b;
+            b->peer = a;
+            sessions.push_back(a);
+            sessions.push_back(b);
+        }
+    }
+    reactor.setReadyHandler(deliverReady, NULL);
+    ZrtpShardProducer* control = reactor.createProducer();
+    int total = shards * numPairs;
+
+    for (int r = 0; r < numRounds; r++) {
+        // The shard threads are stopped, the sessions and engines may be
+        // set up from this thread
+        done.store(0);
+        for (size_t i = 0; i < sessions.size(); i++) {
+            ShardSession* s = sessions[i];
+            s->secure = s->failed = false;
+            s->setZrtpEngine(new ZRtp(sideZid(static_cast<int>(i / 2), static_cast<int>(i % 2)), s, "zrtpshards",
+                                      config));
+        }
+        uint64_t t0 = nowNs();
+        reactor.start();
+        for (size_t i = 0; i < sessions.size(); i++) {
+            int32_t shard = static_cast<int32_t>(i / (2 * numPairs));
+            while (!reactor.post(control, shard, startEngine, sessions[i], NULL))
+                this_thread::yield();
+        }
+        uint64_t start = zrtpGetTickCount();
+        while (done.load() < total && zrtpGetTickCount() - start < roundLimitMs)
+            this_thread::sleep_for(chrono::milliseconds(1));
+        result.handshakeSec += (nowNs() - t0) / 1e9;
+        reactor.stop();
+
+        for (size_t i = 0; i < sessions.size(); i += 2) {
+            if (sessions[i]->secure && sessions[i + 1]->secure)
+                result.handshakes++;
+            else
+                result.failures++;
+        }
+        for (size_t i = 0; i < sessions.size(); i++) {
+            ZRtp* engine = sessions[i]->getZrtpEngine();
+            engine->stopZrtp();
+            sessions[i]->setZrtpEngine(NULL);
+            delete engine;
+            while (sessions[i]->hasOutput())
+                sessions[i]->popPacket();
+        }
+    }
+    reactor.setReadyHandler(NULL, NULL);
+    for (size_t i = 0; i < sessions.size(); i++)
+        delete sessions[i];
+}
+
+/* ---------------------------------------------------------------------------
+ * SRTP
+ */
+
+struct SrtpPair {
+    ZsrtpContext* sender;
+    ZsrtpContext* receiver;
+    uint16_t sequence;
+    uint64_t failures;
+};
+
+struct BenchProducer;
+
+struct BenchPacket {
+    uint8_t buffer[rtpHeader + 1500 + 64];
+    int32_t length;
+    int32_t shard;
+    BenchProducer* owner;
+};
+
+struct BenchProducer {
+    ZrtpShardProducer* producer;
+    vector<ZrtpSpscRing<BenchPacket*>*> returns;    // one per shard, the shard is the producer
+    vector<BenchPacket> packets;
+    uint64_t ringFull;
+};
+
+static void fillSecrets(C_SrtpSecret_t* secrets, uint8_t* keys, int32_t role)
+{
+    for (int i = 0; i < 4 * 32; i++)
+        keys[i] = static_cast<uint8_t>(i * 7 + 1);
+
+    memset(secrets, 0, sizeof(*secrets));
+    secrets->symEncAlgorithm = zrtp_Aes;
+    secrets->keyInitiator = keys;
+    secrets->initKeyLen = 128;
+    secrets->saltInitiator = keys + 32;
+    secrets->initSaltLen = 112;
+    secrets->keyResponder = keys + 64;
+    secrets->respKeyLen = 128;
+    secrets->saltResponder = keys + 96;
+    secrets->respSaltLen = 112;
+    secrets->authAlgorithm = zrtp_Sha1;
+    secrets->srtpAuthTagLen = 80;
+    secrets->role = role;
+}
+
+// Runs in the shard thread that owns the pair
+static void protectUnprotect(void* context, void* data)
+{
+    SrtpPair* pair = static_cast<SrtpPair*>(context);
+    BenchPacket* packet = static_cast<BenchPacket*>(data);
+    uint8_t* buffer = packet->buffer;
+    int32_t length = rtpHeader + payload;
+
+    buffer[2] = static_cast<uint8_t>(pair->sequence >> 8);
+    buffer[3] = static_cast<uint8_t>(pair->sequence);
+    pair->sequence++;
+
+    if (zsrtp_protect(pair->sender, buffer, length, &length) != 1 ||
+        zsrtp_unprotect(pair->receiver, buffer, length, &length) != 1 ||
+        length != rtpHeader + payload || buffer[rtpHeader] != static_cast<uint8_t>(payload))
+        pair->failures++;
+
+    packet->length = length;
+    packet->owner->returns[packet->shard]->push(packet);
+}
+
+static void runProducer(ZrtpShardReactor* reactor, BenchProducer* bp, vector<SrtpPair>* pairs, int index, int count)
+{
+    int shards = reactor->getNumberOfShards();
+    vector<BenchPacket*> freeList;
+    for (size_t i = 0; i < bp->packets.size(); i++)
+        freeList.push_back(&bp->packets[i]);
+
+    int sent = 0;
+    int returned = 0;
+    int next = index;
+    while (returned < count) {
+        BenchPacket* packet;
+        for (int s = 0; s < shards; s++) {
+            while (bp->returns[s]->pop(packet)) {
+                freeList.push_back(packet);
+                returned++;
+            }
+        }
+        if (sent == count || freeList.empty()) {
+            this_thread::yield();
+            continue;
+        }
+        while (sent < count && !freeList.empty()) {
+            packet = freeList.back();
+            int pairIndex = next++ % static_cast<int>(pairs->size());
+            packet->shard = pairIndex / numPairs;
+
+            uint8_t* buffer = packet->buffer;
+            buffer[0] = 0x80;
+            buffer[1] = 0x00;
+            memset(buffer + 4, 0, 4);
+            buffer[8] = 0xfe; buffer[9] = 0xed; buffer[10] = 0xba; buffer[11] = 0xcc;
+            memset(buffer + rtpHeader, payload, payload);
+            packet->length = rtpHeader + payload;
+
+            if (!reactor->post(bp->producer, packet->shard, protectUnprotect, &(*pairs)[pairIndex], packet)) {
+                bp->ringFull++;
+                break;
+            }
+            freeList.pop_back();
+            sent++;
+        }
+    }
+}
+
+static void runSrtp(ZrtpShardReactor& reactor, ShardResult& result)
+{
+    int shards = reactor.getNumberOfShards();
+    uint8_t keys[4 * 32];
+    C_SrtpSecret_t initiator;
+    C_SrtpSecret_t responder;
+    fillSecrets(&initiator, keys, Initiator);
+    fillSecrets(&responder, keys, Responder);
+
+    vector<SrtpPair> pairs(shards * numPairs);
+    for (size_t i = 0; i < pairs.size(); i++) {
+        pairs[i].sender = zsrtp_CreateWrapperFromSecrets(&initiator, ForSender);
+        pairs[i].receiver = zsrtp_CreateWrapperFromSecrets(&responder, ForReceiver);
+        pairs[i].sequence = 1;
+        pairs[i].failures = 0;
+    }
+
+    vector<BenchProducer> producers(shards);
+    for (int p = 0; p < shards; p++) {
+        producers[p].producer = reactor.createProducer();
+        producers[p].packets.resize(packetsPerProducer);
+        for (int s = 0; s < shards; s++)
+            producers[p].returns.push_back(new ZrtpSpscRing<BenchPacket*>(packetsPerProducer));
+        for (size_t i = 0; i < producers[p].packets.size(); i++)
+            producers[p].packets[i].owner = &producers[p];
+        producers[p].ringFull = 0;
+    }
+
+    reactor.start();
+    uint64_t t0 = nowNs();
+    vector<thread> threads;
+    int perProducer = numPackets / shards;
+    for (int p = 0; p < shards; p++)
+        threads.push_back(thread(runProducer, &reactor, &producers[p], &pairs, p, perProducer));
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    result.srtpSec = (nowNs() - t0) / 1e9;
+    reactor.stop();
+
+    result.packets = static_cast<uint64_t>(perProducer) * shards;
+    for (size_t i = 0; i < pairs.size(); i++) {
+        result.srtpFailures += pairs[i].failures;
+        zsrtp_DestroyWrapper(pairs[i].sender);
+        zsrtp_DestroyWrapper(pairs[i].receiver);
+    }
+    for (int p = 0; p < shards; p++) {
+        result.ringFull += producers[p].ringFull;
+        for (int s = 0; s < shards; s++)
+            delete producers[p].returns[s];
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ */
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [-c <shards,...>] [-p <pairs>] [-r <rounds>] [-n <packets>] [-b <bytes>] [-k <pk>] "
+                    "[-a <0|1>] [-o <file>]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const char* shardList = "1,2,4,8,16,32";
+    const char* pkName = "EC25";
+    const char* outName = NULL;
+    bool pin = true;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (arg[0] != '-' || arg[1] == 0 || arg[2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* val = argv[++i];
+        switch (arg[1]) {
+        case 'c': shardList = val; break;
+        case 'p': numPairs = atoi(val); break;
+        case 'r': numRounds = atoi(val); break;
+        case 'n': numPackets = atoi(val); break;
+        case 'b': payload = atoi(val); break;
+        case 'k': pkName = val; break;
+        case 'a': pin = atoi(val) != 0; break;
+        case 'o': outName = val; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    vector<int> shardCounts;
+    for (const char* p = shardList; *p != 0; ) {
+        int n = atoi(p);
+        if (n < 1 || n > ZrtpShardReactor::maxProducers - 1) {
+            usage(argv[0]);
+            return 1;
+        }
+        shardCounts.push_back(n);
+        while (*p != 0 && *p != ',')
+            p++;
+        if (*p == ',')
+            p++;
+    }
+    if (numPairs < 1 || numRounds < 1 || numPackets < 1 || payload < 1 || payload > 1400) {
+        usage(argv[0]);
+        return 1;
+    }
+    AlgorithmEnum& pk = zrtpPubKeys.getByName(pkName);
+    if (!pk.isValid()) {
+        fprintf(stderr, "Unknown key agreement %s\n", pkName);
+        return 1;
+    }
+
+    char cacheName[64];
+    snprintf(cacheName, sizeof(cacheName), "zrtpshards-%ld.zid", (long)nowNs());
+    ZIDCache* cache = getZidCacheInstance();
+    if (cache->open(cacheName) <= 0) {
+        fprintf(stderr, "Cannot open ZID cache file %s\n", cacheName);
+        return 1;
+    }
+    zidPool.resize(numZids * IDENTIFIER_LEN);
+    ZrtpRandom::getRandomData(zidPool.data(), zidPool.size());
+
+    ZrtpConfigure config;
+    config.setStandardConfig();
+    config.addAlgoAt(PubKeyAlgorithm, pk, 0);
+
+    vector<ShardResult> results;
+    for (size_t i = 0; i < shardCounts.size(); i++) {
+        results.push_back(ShardResult(shardCounts[i]));
+        ShardResult& r = results.back();
+        {
+            ZrtpShardReactor reactor(shardCounts[i], 4096, pin);
+            runHandshakes(reactor, &config, r);
+        }
+        {
+            ZrtpShardReactor reactor(shardCounts[i], 4096, pin);
+            runSrtp(reactor, r);
+        }
+        fprintf(stderr, "%3d shards: %8.1f handshakes/s (%llu failures), %10.0f SRTP packets/s (%llu failures)\n",
+                r.shards, r.handshakes / r.handshakeSec, (unsigned long long)r.failures, r.packets / r.srtpSec,
+                (unsigned long long)r.srtpFailures);
+    }
+
+    FILE* out = stdout;
+    if (outName != NULL && (out = fopen(outName, "w")) == NULL) {
+        fprintf(stderr, "Cannot open output file %s\n", outName);
+        return 1;
+    }
+    fprintf(out, "{\n  \"benchmark\": \"zrtpshards\",\n  \"hardware_threads\": %u, \"pairs_per_shard\": %d, "
+                 "\"rounds\": %d, \"key_agreement\": \"%s\", \"payload\": %d, \"pinned\": %s,\n",
+            thread::hardware_concurrency(), numPairs, numRounds, pkName, payload, pin ? "true" : "false");
+    fprintf(out, "  \"results\": [\n");
+    uint64_t failures = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        ShardResult& r = results[i];
+        fprintf(out, "    {\"shards\": %d, \"handshakes\": %llu, \"failures\": %llu, \"handshakes_per_sec\": %.1f, "
+                     "\"srtp_packets\": %llu, \"srtp_failures\": %llu, \"ring_full\": %llu, "
+                     "\"srtp_packets_per_sec\": %.0f}%s\n",
+                r.shards, (unsigned long long)r.handshakes, (unsigned long long)r.failures,
+                r.handshakes / r.handshakeSec, (unsigned long long)r.packets, (unsigned long long)r.srtpFailures,
+                (unsigned long long)r.ringFull, r.packets / r.srtpSec, i + 1 < results.size() ? "," : "");
+        failures += r.failures + r.srtpFailures;
+    }
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout)
+        fclose(out);
+
+    cache->close();
+    remove(cacheName);
+    return failures == 0 ? 0 : 1;
+}
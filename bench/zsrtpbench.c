@@ -0,0 +1,250 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark of the SRTP C wrapper, written in plain C.
+ *
+ * The program creates a sender and a receiver context from ZRTP secrets, the
+ * same way a C application does in its zrtp_srtpSecretsReady callback. It
+ * measures protect and unprotect of single packets and of batches, checks
+ * that each packet round trips and writes its results as JSON to stdout.
+ *
+ * Usage: zsrtpbench [-t <ms>] [-b <batch>]
+ *
+ *   -t   minimum run time per case in milliseconds, default 25
+ *   -b   number of packets per batch call, default 64
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <srtp/ZsrtpCWrapper.h>
+
+#define MAX_BATCH 1024
+#define MAX_PAYLOAD 1400
+#define RTP_HEADER 12
+#define BUFFER_SIZE (RTP_HEADER + MAX_PAYLOAD + 64)
+
+typedef struct {
+    const char* name;
+    int32_t payload;
+    double nsPerOp;
+    uint64_t ops;
+} Result;
+
+static uint8_t buffers[MAX_BATCH][BUFFER_SIZE];
+static uint8_t* bufferPtrs[MAX_BATCH];
+static int32_t lengths[MAX_BATCH];
+static int32_t results[MAX_BATCH];
+static uint16_t sequence = 0;
+static int failures = 0;
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void makeRtp(uint8_t* buffer, int32_t payload)
+{
+    int32_t i;
+
+    buffer[0] = 0x80;
+    buffer[1] = 0x00;
+    buffer[2] = (uint8_t)(sequence >> 8);
+    buffer[3] = (uint8_t)sequence;
+    memset(buffer + 4, 0, 4);
+    buffer[8] = 0xfe; buffer[9] = 0xed; buffer[10] = 0xba; buffer[11] = 0xcc;
+    for (i = 0; i < payload; i++)
+        buffer[RTP_HEADER + i] = (uint8_t)(i + sequence);
+    sequence++;
+}
+
+static int checkPayload(const uint8_t* buffer, int32_t length, int32_t payload)
+{
+    uint16_t seq = (uint16_t)((buffer[2] << 8) | buffer[3]);
+    int32_t i;
+
+    if (length != RTP_HEADER + payload)
+        return 0;
+    for (i = 0; i < payload; i++) {
+        if (buffer[RTP_HEADER + i] != (uint8_t)(i + seq))
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * Protect and unprotect batch packets per round, either with single calls or
+ * with one batch call per direction. Returns ns per packet and direction.
+ */
+static double runCase(ZsrtpContext* sender, ZsrtpContext* receiver, int32_t payload, int32_t batch, int useBatch,
+                      uint64_t minTimeNs, uint64_t* ops)
+{
+    uint64_t elapsed = 0;
+    uint64_t count = 0;
+    int32_t i;
+
+    while (elapsed < minTimeNs) {
+        uint64_t start;
+
+        for (i = 0; i < batch; i++) {
+            makeRtp(bufferPtrs[i], payload);
+            lengths[i] = RTP_HEADER + payload;
+        }
+        start = nowNs();
+        if (useBatch) {
+            if (zsrtp_protectBatch(sender, bufferPtrs, lengths, NULL, batch) != batch)
+                failures++;
+            if (zsrtp_unprotectBatch(receiver, bufferPtrs, lengths, results, batch) != batch)
+                failures++;
+        }
+        else {
+            for (i = 0; i < batch; i++) {
+                if (zsrtp_protect(sender, bufferPtrs[i], lengths[i], &lengths[i]) != 1)
+                    failures++;
+            }
+            for (i = 0; i < batch; i++) {
+                results[i] = zsrtp_unprotect(receiver, bufferPtrs[i], lengths[i], &lengths[i]);
+            }
+        }
+        elapsed += nowNs() - start;
+
+        for (i = 0; i < batch; i++) {
+            if (results[i] != 1 || !checkPayload(bufferPtrs[i], lengths[i], payload))
+                failures++;
+        }
+        count += batch;
+    }
+    *ops = count;
+    return (double)elapsed / (double)count / 2.0;
+}
+
+static void fillSecrets(C_SrtpSecret_t* secrets, uint8_t* keys, int32_t role)
+{
+    int32_t i;
+
+    for (i = 0; i < 4 * 32; i++)
+        keys[i] = (uint8_t)(i * 7 + 1);
+
+    memset(secrets, 0, sizeof(*secrets));
+    secrets->symEncAlgorithm = zrtp_Aes;
+    secrets->keyInitiator = keys;
+    secrets->initKeyLen = 128;
+    secrets->saltInitiator = keys + 32;
+    secrets->initSaltLen = 112;
+    secrets->keyResponder = keys + 64;
+    secrets->respKeyLen = 128;
+    secrets->saltResponder = keys + 96;
+    secrets->respSaltLen = 112;
+    secrets->authAlgorithm = zrtp_Sha1;
+    secrets->srtpAuthTagLen = 80;
+    secrets->role = role;
+}
+
+int main(int argc, char* argv[])
+{
+    static const int32_t payloads[] = {20, 160, 1400};
+    Result res[6];
+    int32_t numResults = 0;
+    uint64_t minTimeNs = 25ULL * 1000000ULL;
+    int32_t batch = 64;
+    uint8_t keys[4 * 32];
+    C_SrtpSecret_t initiator;
+    C_SrtpSecret_t responder;
+    ZsrtpContext* sender;
+    ZsrtpContext* receiver;
+    size_t p;
+    int32_t i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            minTimeNs = (uint64_t)strtoul(argv[++i], NULL, 10) * 1000000ULL;
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            batch = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-t <ms>] [-b <batch>]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (batch < 1 || batch > MAX_BATCH) {
+        fprintf(stderr, "Batch size must be between 1 and %d\n", MAX_BATCH);
+        return 1;
+    }
+    for (i = 0; i < MAX_BATCH; i++)
+        bufferPtrs[i] = buffers[i];
+
+    /* The Initiator sends, the Responder receives */
+    fillSecrets(&initiator, keys, Initiator);
+    fillSecrets(&responder, keys, Responder);
+    sender = zsrtp_CreateWrapperFromSecrets(&initiator, ForSender);
+    receiver = zsrtp_CreateWrapperFromSecrets(&responder, ForReceiver);
+    if (sender == NULL || receiver == NULL) {
+        fprintf(stderr, "Cannot create SRTP wrapper contexts\n");
+        return 1;
+    }
+    if (zsrtp_getTrailerLength(sender, 0) != 10 || zsrtp_getTrailerLength(sender, 1) != 14) {
+        fprintf(stderr, "Unexpected trailer length\n");
+        failures++;
+    }
+
+    for (p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++) {
+        res[numResults].name = "srtp/c-wrapper/single";
+        res[numResults].payload = payloads[p];
+        res[numResults].nsPerOp = runCase(sender, receiver, payloads[p], batch, 0, minTimeNs, &res[numResults].ops);
+        numResults++;
+        res[numResults].name = "srtp/c-wrapper/batch";
+        res[numResults].payload = payloads[p];
+        res[numResults].nsPerOp = runCase(sender, receiver, payloads[p], batch, 1, minTimeNs, &res[numResults].ops);
+        numResults++;
+    }
+
+    /* A tampered packet must fail and must not change the receiver state */
+    makeRtp(bufferPtrs[0], 160);
+    lengths[0] = RTP_HEADER + 160;
+    zsrtp_protect(sender, bufferPtrs[0], lengths[0], &lengths[0]);
+    bufferPtrs[0][RTP_HEADER] ^= 1;
+    if (zsrtp_unprotect(receiver, bufferPtrs[0], lengths[0], &lengths[0]) != -1) {
+        fprintf(stderr, "Tampered packet not detected\n");
+        failures++;
+    }
+
+    zsrtp_DestroyWrapper(sender);
+    zsrtp_DestroyWrapper(receiver);
+
+    for (i = 0; i < numResults; i++)
+        fprintf(stderr, "%-24s %5d bytes %10.1f ns/op\n", res[i].name, res[i].payload, res[i].nsPerOp);
+
+    printf("{\n  \"benchmark\": \"zsrtpbench\",\n  \"batch\": %d,\n  \"failures\": %d,\n  \"results\": [\n",
+           batch, failures);
+    for (i = 0; i < numResults; i++) {
+        printf("    {\"name\": \"%s\", \"bytes\": %d, \"ops\": %llu, \"ns_per_op\": %.1f}%s\n", res[i].name,
+               res[i].payload, (unsigned long long)res[i].ops, res[i].nsPerOp, i + 1 < numResults ? "," : "");
+    }
+    printf("  ]\n}\n");
+
+    if (failures != 0) {
+        fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    return 0;
+}
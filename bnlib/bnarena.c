@@ -0,0 +1,105 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include <bnarena.h>
+
+/* Wipe through a volatile pointer, the compiler must not drop it */
+static void *(*volatile arenaWipe)(void *, int, size_t) = memset;
+
+/* Block sizes are multiples of this value, keeps the blocks aligned */
+#define ARENA_ALIGN 16
+
+static unsigned blockSize(unsigned bytes)
+{
+    return (bytes + ARENA_ALIGN - 1) & ~(unsigned)(ARENA_ALIGN - 1);
+}
+
+static void *arenaAlloc(void *context, unsigned bytes)
+{
+    struct BnArena *arena = (struct BnArena *)context;
+    unsigned size = blockSize(bytes);
+    void *ptr;
+
+    if (size < bytes || size > arena->size - arena->top) {
+        arena->fallbacks++;
+        return NULL;
+    }
+    ptr = arena->buffer + arena->top;
+    arena->top += size;
+    if (arena->top > arena->high)
+        arena->high = arena->top;
+    arena->allocs++;
+    return ptr;
+}
+
+static void arenaFree(void *context, void *ptr, unsigned bytes)
+{
+    struct BnArena *arena = (struct BnArena *)context;
+    unsigned char *block = (unsigned char *)ptr;
+    unsigned size = blockSize(bytes);
+
+    arenaWipe(ptr, 0, bytes);
+
+    /* The most recent block returns to the arena */
+    if (block + size == arena->buffer + arena->top)
+        arena->top -= size;
+}
+
+static int arenaOwns(void *context, void const *ptr)
+{
+    struct BnArena *arena = (struct BnArena *)context;
+    unsigned char const *p = (unsigned char const *)ptr;
+
+    return p >= arena->buffer && p < arena->buffer + arena->size;
+}
+
+void bnArenaInit(struct BnArena *arena, void *buffer, unsigned size)
+{
+    arena->buffer = (unsigned char *)buffer;
+    arena->size = size & ~(unsigned)(ARENA_ALIGN - 1);
+    arena->top = 0;
+    arena->high = 0;
+    arena->allocs = 0;
+    arena->fallbacks = 0;
+    arena->allocator.alloc = arenaAlloc;
+    arena->allocator.free = arenaFree;
+    arena->allocator.owns = arenaOwns;
+    arena->allocator.context = arena;
+    arena->previous = NULL;
+}
+
+void bnArenaEnter(struct BnArena *arena)
+{
+    arena->previous = lbnMemSetAllocator(&arena->allocator);
+}
+
+void bnArenaLeave(struct BnArena *arena)
+{
+    lbnMemSetAllocator(arena->previous);
+    arena->previous = NULL;
+    bnArenaReset(arena);
+}
+
+void bnArenaReset(struct BnArena *arena)
+{
+    if (arena->high > 0)
+        arenaWipe(arena->buffer, 0, arena->high);
+    arena->top = 0;
+    arena->high = 0;
+}
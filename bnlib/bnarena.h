@@ -0,0 +1,85 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _BNARENA_H_
+#define _BNARENA_H_
+
+/**
+ * @file bnarena.h
+ * @brief Bump arena for the temporary numbers of bnlib
+ *
+ * An arena serves the bnlib allocations of one thread between
+ * bnArenaEnter() and bnArenaLeave(). It hands out the memory of a fixed
+ * buffer in allocation order. Freeing the most recent block returns it
+ * to the arena, other blocks stay in use until bnArenaLeave() resets
+ * the arena. If the buffer is full the allocations use the heap.
+ *
+ * All numbers that bnlib allocates inside the scope must be freed
+ * before bnArenaLeave(). Numbers that exist before the scope may grow,
+ * bnlib keeps their memory on the heap.
+ *
+ * Free and reset wipe the memory.
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <lbnmem.h>
+
+struct BnArena {
+    unsigned char *buffer;
+    unsigned size;
+    unsigned top;                   /* first free byte */
+    unsigned high;                  /* highest top since the last reset */
+    unsigned long allocs;           /* allocations served by the arena */
+    unsigned long fallbacks;        /* allocations that did not fit */
+    struct LbnAllocator allocator;
+    struct LbnAllocator const *previous;
+};
+
+/**
+ * Initialize an arena with a buffer.
+ *
+ * @param arena the arena.
+ *
+ * @param buffer the memory of the arena, 16 byte aligned.
+ *
+ * @param size the size of the buffer in bytes.
+ */
+void bnArenaInit(struct BnArena *arena, void *buffer, unsigned size);
+
+/**
+ * Install the arena as allocator of the calling thread.
+ */
+void bnArenaEnter(struct BnArena *arena);
+
+/**
+ * Restore the previous allocator of the calling thread and reset the arena.
+ */
+void bnArenaLeave(struct BnArena *arena);
+
+/**
+ * Wipe the used memory and make all memory available again.
+ */
+void bnArenaReset(struct BnArena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,6 +22,7 @@
 #include <bnprint.h>
 
 #include <ec/ec.h>
+#include <ec/ecfield.h>
 
 static BigNum _mpiZero;
 static BigNum _mpiOne;
@@ -297,7 +298,7 @@ static void curveCommonPrealloc(EcCurve *curve)
     bnPrealloc(curve->U1, maxBits);
     bnPrealloc(curve->H, maxBits);
     bnPrealloc(curve->R, maxBits);
-    bnPrealloc(curve->S1, maxBits);
+    bnPrealloc(curve->t0, maxBits);
     bnPrealloc(curve->t1, maxBits);
     bnPrealloc(curve->t2, maxBits);
     bnPrealloc(curve->t3, maxBits);
@@ -365,6 +366,18 @@ int ecGetCurveNistECp(Curves curveId, EcCurve *curve)
     curve->randomOp = ecGenerateRandomNumberNist;
     curve->mulScalar = ecMulPointScalarNormal;
 
+    /* P-256 and P-384 use the fixed-size field arithmetic of ecfield.c */
+    if (curveId == NIST256P) {
+        curve->doubleOp = ecDoublePointP256;
+        curve->addOp = ecAddPointP256;
+        curve->mulScalar = ecMulPointScalarP256;
+    }
+    else if (curveId == NIST384P) {
+        curve->doubleOp = ecDoublePointP384;
+        curve->addOp = ecAddPointP384;
+        curve->mulScalar = ecMulPointScalarP384;
+    }
+
     bnReadAscii(curve->p, cd->p, 10);
     bnReadAscii(curve->n, cd->n, 10);
     bnReadAscii(curve->SEED, cd->SEED, 16);
@@ -472,6 +485,34 @@ void ecFreeCurveNistECp(EcCurve *curve)
  * EC point helper functions
  */
 
+int ecInitCurveWorkspace(const EcCurve *shared, EcCurve *curve)
+{
+    if (shared == NULL || curve == NULL)
+        return -2;
+
+    /* Copy the pointers to the parameters and the functions, the workspace
+       owns the scratch pad variables only */
+    *curve = *shared;
+    curveCommonInit(curve);
+    curveCommonPrealloc(curve);
+    return 0;
+}
+
+void ecFreeCurveWorkspace(EcCurve *curve)
+{
+    if (curve == NULL)
+        return;
+
+    bnEnd(curve->S1);
+    bnEnd(curve->U1);
+    bnEnd(curve->H);
+    bnEnd(curve->R);
+    bnEnd(curve->t0);
+    bnEnd(curve->t1);
+    bnEnd(curve->t2);
+    bnEnd(curve->t3);
+}
+
 void ecInitPoint(EcPoint *P)
 {
     INIT_EC_POINT(P);
@@ -158,6 +158,33 @@ int ecGetCurveNistECp(Curves curveId, NistECpCurve *curve);
  */
 void ecFreeCurveNistECp(EcCurve *curve);
 
+/**
+ * \brief          Initialize a workspace for a shared EC curve.
+ *
+ *                 The workspace uses the parameters of the shared curve and owns
+ *                 only the scratch pad variables. Threads that use the same shared
+ *                 curve need own workspaces because the EC functions modify the
+ *                 scratch pad variables. The shared curve must not be freed while
+ *                 a workspace uses it.
+ *
+ * \param shared   Pointer to a curve initialized with ecGetCurveNistECp or
+ *                 ecGetCurvesCurve
+ *
+ * \param curve    Pointer to the EcCurve structure of the workspace
+ *
+ * \return         0 if successful
+ *
+ * \note           Call ecFreeCurveWorkspace to return allocated memory.
+ */
+int ecInitCurveWorkspace(const EcCurve *shared, EcCurve *curve);
+
+/**
+ * \brief          Free the scratch pad variables of a workspace.
+ *
+ * \param curve    Pointer to an EcCurve structure initialized with ecInitCurveWorkspace
+ */
+void ecFreeCurveWorkspace(EcCurve *curve);
+
 /**
  * \brief          Double an EC point.
  *
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <bn.h>
+
+#include <ec/ec.h>
+#include <ec/ecfield.h>
+
+/*
+ * Returns the high word of a * b + c + d, the low word goes to *lo. The
+ * sum cannot overflow 128 bits.
+ */
+#if defined(__SIZEOF_INT128__)
+static inline uint64_t mulAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t *lo)
+{
+    unsigned __int128 t = (unsigned __int128)a * b + c + d;
+    *lo = (uint64_t)t;
+    return (uint64_t)(t >> 64);
+}
+#else
+static inline uint64_t mulAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t *lo)
+{
+    uint64_t aLo = a & 0xffffffff, aHi = a >> 32;
+    uint64_t bLo = b & 0xffffffff, bHi = b >> 32;
+    uint64_t ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+    uint64_t mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+    uint64_t low = (ll & 0xffffffff) | (mid << 32);
+    uint64_t high = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+
+    low += c;
+    high += low < c;
+    low += d;
+    high += low < d;
+    *lo = low;
+    return high;
+}
+#endif
+
+/*
+ * P-256, p = 2^256 - 2^224 + 2^192 + 2^96 - 1. The limbs are little endian.
+ */
+static const uint64_t p256P[4] = {
+    0xffffffffffffffffULL, 0x00000000ffffffffULL, 0x0000000000000000ULL, 0xffffffff00000001ULL
+};
+static const uint64_t p256R2[4] = {
+    0x0000000000000003ULL, 0xfffffffbffffffffULL, 0xfffffffffffffffeULL, 0x00000004fffffffdULL
+};
+static const uint64_t p256One[4] = {
+    0x0000000000000001ULL, 0xffffffff00000000ULL, 0xffffffffffffffffULL, 0x00000000fffffffeULL
+};
+static const uint64_t p256PInv = 0x0000000000000001ULL;
+
+#define FE_LIMBS 4
+#define FE(name) p256##name
+#define EC_FE(name) ec##name##P256
+#include "ecfieldimpl.h"
+#undef FE_LIMBS
+#undef FE
+#undef EC_FE
+
+/*
+ * P-384, p = 2^384 - 2^128 - 2^96 + 2^32 - 1
+ */
+static const uint64_t p384P[6] = {
+    0x00000000ffffffffULL, 0xffffffff00000000ULL, 0xfffffffffffffffeULL,
+    0xffffffffffffffffULL, 0xffffffffffffffffULL, 0xffffffffffffffffULL
+};
+static const uint64_t p384R2[6] = {
+    0xfffffffe00000001ULL, 0x0000000200000000ULL, 0xfffffffe00000000ULL,
+    0x0000000200000000ULL, 0x0000000000000001ULL, 0x0000000000000000ULL
+};
+static const uint64_t p384One[6] = {
+    0xffffffff00000001ULL, 0x00000000ffffffffULL, 0x0000000000000001ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL
+};
+static const uint64_t p384PInv = 0x0000000100000001ULL;
+
+#define FE_LIMBS 6
+#define FE(name) p384##name
+#define EC_FE(name) ec##name##P384
+#include "ecfieldimpl.h"
+#undef FE_LIMBS
+#undef FE
+#undef EC_FE
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ECFIELD_H_
+#define _ECFIELD_H_
+
+#include <ec/ec.h>
+
+/**
+ * @file ecfield.h
+ * @brief Fixed-size field arithmetic for the NIST P-256 and P-384 curves
+ * @ingroup BNLIB_EC
+ * @{
+ *
+ * The functions implement the point operations of the NIST curves with
+ * field elements of 4 (P-256) and 6 (P-384) 64 bit limbs in Montgomery
+ * representation. They have the same interface as the BigNum functions
+ * in ec.c and convert the points only at entry and exit. The curve
+ * initialization in ec.c sets them as the curve's point functions.
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ecDoublePointP256(const EcCurve *curve, EcPoint *R, const EcPoint *P);
+
+int ecAddPointP256(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q);
+
+int ecMulPointScalarP256(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar);
+
+int ecDoublePointP384(const EcCurve *curve, EcPoint *R, const EcPoint *P);
+
+int ecAddPointP384(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q);
+
+int ecMulPointScalarP384(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,372 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Field and point arithmetic for one field size. ecfield.c includes this
+ * file once per curve. Before the include it defines:
+ *
+ * FE_LIMBS      number of 64 bit limbs of a field element
+ * FE(name)      prefix for the local names, for example p256##name
+ * EC_FE(name)   name of an exported point function, for example ec##name##P256
+ *
+ * and the constants FE(P) (the prime), FE(R2) (R^2 mod p), FE(One) (R mod p)
+ * and FE(PInv) (-p^-1 mod 2^64), with R = 2^(64 * FE_LIMBS).
+ *
+ * All loops have the constant bound FE_LIMBS, the compiler unrolls them. The
+ * field functions do not branch on the values of the field elements.
+ */
+
+typedef struct { uint64_t v[FE_LIMBS]; } FE(Elem);
+typedef struct { FE(Elem) x, y, z; } FE(Point);
+
+/* r = a + b mod p */
+static void FE(Add)(FE(Elem) *r, const FE(Elem) *a, const FE(Elem) *b)
+{
+    uint64_t sum[FE_LIMBS], diff[FE_LIMBS];
+    uint64_t carry = 0, borrow = 0, mask;
+    int i;
+
+    for (i = 0; i < FE_LIMBS; i++) {
+        uint64_t s = a->v[i] + carry;
+        carry = s < carry;
+        s += b->v[i];
+        carry += s < b->v[i];
+        sum[i] = s;
+    }
+    for (i = 0; i < FE_LIMBS; i++) {
+        diff[i] = sum[i] - FE(P)[i] - borrow;
+        borrow = (sum[i] < FE(P)[i]) | ((sum[i] == FE(P)[i]) & borrow);
+    }
+    /* Use the difference if the sum overflowed or is not less than p */
+    mask = 0 - (carry | (borrow ^ 1));
+    for (i = 0; i < FE_LIMBS; i++)
+        r->v[i] = (diff[i] & mask) | (sum[i] & ~mask);
+}
+
+/* r = a - b mod p */
+static void FE(Sub)(FE(Elem) *r, const FE(Elem) *a, const FE(Elem) *b)
+{
+    uint64_t diff[FE_LIMBS];
+    uint64_t carry = 0, borrow = 0, mask;
+    int i;
+
+    for (i = 0; i < FE_LIMBS; i++) {
+        diff[i] = a->v[i] - b->v[i] - borrow;
+        borrow = (a->v[i] < b->v[i]) | ((a->v[i] == b->v[i]) & borrow);
+    }
+    /* Add p if the difference is negative */
+    mask = 0 - borrow;
+    for (i = 0; i < FE_LIMBS; i++) {
+        uint64_t s = diff[i] + carry;
+        carry = s < carry;
+        s += FE(P)[i] & mask;
+        carry += s < (FE(P)[i] & mask);
+        r->v[i] = s;
+    }
+}
+
+/* r = a * b / R mod p, Montgomery multiplication (CIOS) */
+static void FE(MulRaw)(uint64_t *r, const uint64_t *a, const uint64_t *b)
+{
+    uint64_t t[FE_LIMBS + 2];
+    uint64_t diff[FE_LIMBS];
+    uint64_t carry, m, borrow = 0, mask;
+    int i, j;
+
+    for (j = 0; j < FE_LIMBS + 2; j++)
+        t[j] = 0;
+
+    for (i = 0; i < FE_LIMBS; i++) {
+        /* t = t + a * b[i] */
+        carry = 0;
+        for (j = 0; j < FE_LIMBS; j++)
+            carry = mulAdd(a[j], b[i], t[j], carry, &t[j]);
+        t[FE_LIMBS] += carry;
+        t[FE_LIMBS + 1] = t[FE_LIMBS] < carry;
+
+        /* t = (t + m * p) / 2^64 */
+        m = t[0] * FE(PInv);
+        carry = mulAdd(m, FE(P)[0], t[0], 0, &t[0]);
+        for (j = 1; j < FE_LIMBS; j++)
+            carry = mulAdd(m, FE(P)[j], t[j], carry, &t[j - 1]);
+        t[FE_LIMBS - 1] = t[FE_LIMBS] + carry;
+        t[FE_LIMBS] = t[FE_LIMBS + 1] + (t[FE_LIMBS - 1] < carry);
+    }
+
+    /* t < 2p, subtract p once if t >= p */
+    for (i = 0; i < FE_LIMBS; i++) {
+        diff[i] = t[i] - FE(P)[i] - borrow;
+        borrow = (t[i] < FE(P)[i]) | ((t[i] == FE(P)[i]) & borrow);
+    }
+    mask = 0 - (t[FE_LIMBS] | (borrow ^ 1));
+    for (i = 0; i < FE_LIMBS; i++)
+        r[i] = (diff[i] & mask) | (t[i] & ~mask);
+}
+
+static void FE(Mul)(FE(Elem) *r, const FE(Elem) *a, const FE(Elem) *b)
+{
+    FE(MulRaw)(r->v, a->v, b->v);
+}
+
+static int FE(IsZero)(const FE(Elem) *a)
+{
+    uint64_t bits = 0;
+    int i;
+
+    for (i = 0; i < FE_LIMBS; i++)
+        bits |= a->v[i];
+    return bits == 0;
+}
+
+static int FE(Equal)(const FE(Elem) *a, const FE(Elem) *b)
+{
+    uint64_t bits = 0;
+    int i;
+
+    for (i = 0; i < FE_LIMBS; i++)
+        bits |= a->v[i] ^ b->v[i];
+    return bits == 0;
+}
+
+static void FE(SetOne)(FE(Elem) *r)
+{
+    int i;
+
+    for (i = 0; i < FE_LIMBS; i++)
+        r->v[i] = FE(One)[i];
+}
+
+static void FE(SetZero)(FE(Elem) *r)
+{
+    int i;
+
+    for (i = 0; i < FE_LIMBS; i++)
+        r->v[i] = 0;
+}
+
+/* Convert a BigNum into Montgomery representation */
+static void FE(FromBn)(FE(Elem) *r, const BigNum *a)
+{
+    uint8_t buf[FE_LIMBS * 8];
+    uint64_t n[FE_LIMBS];
+    int i, j;
+
+    bnExtractBigBytes(a, buf, 0, sizeof(buf));
+    for (i = 0; i < FE_LIMBS; i++) {
+        const uint8_t *src = &buf[(FE_LIMBS - 1 - i) * 8];
+        n[i] = 0;
+        for (j = 0; j < 8; j++)
+            n[i] = (n[i] << 8) | src[j];
+    }
+    FE(MulRaw)(r->v, n, FE(R2));
+}
+
+/* Convert from Montgomery representation into a BigNum */
+static void FE(ToBn)(BigNum *r, const FE(Elem) *a)
+{
+    uint8_t buf[FE_LIMBS * 8];
+    uint64_t one[FE_LIMBS];
+    uint64_t n[FE_LIMBS];
+    int i, j;
+
+    for (i = 0; i < FE_LIMBS; i++)
+        one[i] = 0;
+    one[0] = 1;
+    FE(MulRaw)(n, a->v, one);
+    for (i = 0; i < FE_LIMBS; i++) {
+        uint8_t *dst = &buf[(FE_LIMBS - 1 - i) * 8];
+        for (j = 0; j < 8; j++)
+            dst[j] = (uint8_t)(n[i] >> (56 - 8 * j));
+    }
+    bnSetQ(r, 0);
+    bnInsertBigBytes(r, buf, 0, sizeof(buf));
+}
+
+static void FE(PointFromBn)(FE(Point) *r, const EcPoint *P)
+{
+    FE(FromBn)(&r->x, P->x);
+    FE(FromBn)(&r->y, P->y);
+    FE(FromBn)(&r->z, P->z);
+}
+
+static void FE(PointToBn)(EcPoint *R, const FE(Point) *p)
+{
+    FE(ToBn)(R->x, &p->x);
+    FE(ToBn)(R->y, &p->y);
+    FE(ToBn)(R->z, &p->z);
+}
+
+/*
+ * Double a point in Jacobian coordinates, a = -3. Same formulas as
+ * ecDoublePointNist. r may be the same as p.
+ */
+static void FE(Double)(FE(Point) *r, const FE(Point) *p)
+{
+    FE(Elem) t0, t1, t2, t3, s, m, z;
+
+    if (FE(IsZero)(&p->y) || FE(IsZero)(&p->z)) {
+        FE(SetOne)(&r->x);
+        FE(SetOne)(&r->y);
+        FE(SetZero)(&r->z);
+        return;
+    }
+
+    /* S = 4*X*Y^2, keep Y^2 in t1 */
+    FE(Mul)(&t1, &p->y, &p->y);
+    FE(Add)(&t0, &p->x, &p->x);
+    FE(Add)(&t0, &t0, &t0);
+    FE(Mul)(&s, &t0, &t1);
+
+    /* M = 3*(X + Z^2)*(X - Z^2) */
+    FE(Mul)(&t2, &p->z, &p->z);
+    FE(Add)(&t0, &p->x, &t2);
+    FE(Add)(&t3, &t0, &t0);
+    FE(Add)(&t3, &t3, &t0);
+    FE(Sub)(&t0, &p->x, &t2);
+    FE(Mul)(&m, &t3, &t0);
+
+    /* Z' = 2*Y*Z, before r overwrites p */
+    FE(Add)(&t0, &p->y, &p->y);
+    FE(Mul)(&z, &t0, &p->z);
+
+    /* X' = M^2 - 2*S */
+    FE(Mul)(&t2, &m, &m);
+    FE(Add)(&t0, &s, &s);
+    FE(Sub)(&r->x, &t2, &t0);
+
+    /* Y' = M*(S - X') - 8*Y^4 */
+    FE(Mul)(&t3, &t1, &t1);
+    FE(Add)(&t3, &t3, &t3);
+    FE(Add)(&t3, &t3, &t3);
+    FE(Add)(&t2, &t3, &t3);
+    FE(Sub)(&t3, &s, &r->x);
+    FE(Mul)(&t0, &m, &t3);
+    FE(Sub)(&r->y, &t0, &t2);
+
+    r->z = z;
+}
+
+/*
+ * Add two points in Jacobian coordinates. Same formulas as ecAddPointNist.
+ * r may be the same as p or q.
+ */
+static void FE(AddPoints)(FE(Point) *r, const FE(Point) *p, const FE(Point) *q)
+{
+    FE(Elem) u1, s1, h, rr, t0, t1, t2, x3, y3, z3;
+
+    if (FE(Equal)(&p->x, &q->x) && FE(Equal)(&p->y, &q->y) && FE(Equal)(&p->z, &q->z)) {
+        FE(Double)(r, p);
+        return;
+    }
+    if (FE(IsZero)(&p->z)) {
+        *r = *q;
+        return;
+    }
+    if (FE(IsZero)(&q->z)) {
+        *r = *p;
+        return;
+    }
+
+    /* U1 = X1*Z2^2, S1 = Y1*Z2^3 */
+    FE(Mul)(&t1, &q->z, &q->z);
+    FE(Mul)(&u1, &p->x, &t1);
+    FE(Mul)(&t1, &t1, &q->z);
+    FE(Mul)(&s1, &p->y, &t1);
+
+    /* H = X2*Z1^2 - U1, R = Y2*Z1^3 - S1 */
+    FE(Mul)(&t1, &p->z, &p->z);
+    FE(Mul)(&h, &q->x, &t1);
+    FE(Sub)(&h, &h, &u1);
+    FE(Mul)(&t1, &t1, &p->z);
+    FE(Mul)(&rr, &q->y, &t1);
+    FE(Sub)(&rr, &rr, &s1);
+
+    if (FE(IsZero)(&h)) {
+        if (!FE(IsZero)(&rr)) {
+            FE(SetOne)(&r->x);
+            FE(SetOne)(&r->y);
+            FE(SetZero)(&r->z);
+            return;
+        }
+        FE(Double)(r, p);
+        return;
+    }
+
+    /* X3 = R^2 - H^3 - 2*U1*H^2 */
+    FE(Mul)(&t0, &h, &h);
+    FE(Mul)(&t1, &u1, &t0);
+    FE(Mul)(&t0, &t0, &h);
+    FE(Mul)(&t2, &rr, &rr);
+    FE(Sub)(&x3, &t2, &t0);
+    FE(Add)(&t2, &t1, &t1);
+    FE(Sub)(&x3, &x3, &t2);
+
+    /* Y3 = R*(U1*H^2 - X3) - S1*H^3 */
+    FE(Sub)(&t1, &t1, &x3);
+    FE(Mul)(&t2, &rr, &t1);
+    FE(Mul)(&t0, &s1, &t0);
+    FE(Sub)(&y3, &t2, &t0);
+
+    /* Z3 = H*Z1*Z2 */
+    FE(Mul)(&t2, &h, &p->z);
+    FE(Mul)(&z3, &t2, &q->z);
+
+    r->x = x3;
+    r->y = y3;
+    r->z = z3;
+}
+
+int EC_FE(DoublePoint)(const EcCurve *curve, EcPoint *R, const EcPoint *P)
+{
+    FE(Point) p;
+
+    FE(PointFromBn)(&p, P);
+    FE(Double)(&p, &p);
+    FE(PointToBn)(R, &p);
+    return 0;
+}
+
+int EC_FE(AddPoint)(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q)
+{
+    FE(Point) p, q;
+
+    FE(PointFromBn)(&p, P);
+    FE(PointFromBn)(&q, Q);
+    FE(AddPoints)(&p, &p, &q);
+    FE(PointToBn)(R, &p);
+    return 0;
+}
+
+/* Same algorithm as ecMulPointScalarNormal, the points stay in field representation */
+int EC_FE(MulPointScalar)(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar)
+{
+    FE(Point) n, r;
+    int bits = bnBits(scalar);
+    int i;
+
+    FE(PointFromBn)(&n, P);
+    FE(SetZero)(&r.x);
+    FE(SetZero)(&r.y);
+    FE(SetZero)(&r.z);
+
+    for (i = 0; i < bits; i++) {
+        if (bnReadBit(scalar, i))
+            FE(AddPoints)(&r, &r, &n);
+        FE(Double)(&n, &n);
+    }
+    FE(PointToBn)(R, &r);
+    return 0;
+}
@@ -75,6 +75,46 @@ void free();
  */
 static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
 
+#if defined(_MSC_VER)
+#define LBN_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define LBN_THREAD_LOCAL __thread
+#else
+#define LBN_THREAD_LOCAL _Thread_local
+#endif
+
+static LBN_THREAD_LOCAL struct LbnAllocator const *threadAllocator = 0;
+static LBN_THREAD_LOCAL unsigned long heapAllocs = 0;
+
+struct LbnAllocator const *
+lbnMemSetAllocator(struct LbnAllocator const *allocator)
+{
+	struct LbnAllocator const *previous = threadAllocator;
+
+	threadAllocator = allocator;
+	return previous;
+}
+
+unsigned long
+lbnMemHeapAllocs(void)
+{
+	return heapAllocs;
+}
+
+static void *
+lbnHeapAlloc(unsigned bytes)
+{
+	heapAllocs++;
+	return malloc(bytes);
+}
+
+static int
+lbnAllocatorOwns(void const *ptr)
+{
+	return threadAllocator &&
+	       threadAllocator->owns(threadAllocator->context, ptr);
+}
+
 #ifndef lbnMemWipe
 void
 lbnMemWipe(void *ptr, unsigned bytes)
@@ -88,25 +128,78 @@ lbnMemWipe(void *ptr, unsigned bytes)
 void *
 lbnMemAlloc(unsigned bytes)
 {
-	return malloc(bytes);
+	if (threadAllocator) {
+		void *ptr = threadAllocator->alloc(threadAllocator->context,
+		                                   bytes);
+		if (ptr)
+			return ptr;
+	}
+	return lbnHeapAlloc(bytes);
 }
-#define lbnMemAlloc(bytes) malloc(bytes)
 #endif
 
 #ifndef lbnMemFree
 void
 lbnMemFree(void *ptr, unsigned bytes)
 {
+	if (lbnAllocatorOwns(ptr)) {
+		threadAllocator->free(threadAllocator->context, ptr, bytes);
+		return;
+	}
 	lbnMemWipe(ptr, bytes);
 	free(ptr);
 }
 #endif
 
 #ifndef lbnRealloc
+/*
+ * Allocate new memory, copy and free the old memory.  A heap block stays
+ * on the heap, see lbnMemSetAllocator.
+ */
+static void *
+lbnReallocCopy(void *oldptr, unsigned oldbytes, unsigned newbytes)
+{
+	void *newptr;
+
+	if (oldptr && !lbnAllocatorOwns(BIGLITTLE((char *)oldptr-oldbytes, oldptr)))
+		newptr = lbnHeapAlloc(newbytes);
+	else
+		newptr = lbnMemAlloc(newbytes);
+
+	if (!newptr)
+		return newptr;
+	if (!oldptr)
+		return BIGLITTLE((char *)newptr+newbytes, newptr);
+
+	/*
+	 * The following copies are a bit non-obvious in the big-endian case
+	 * because one of the pointers points to the *end* of allocated memory.
+	 */
+	if (newbytes > oldbytes) {	/* Copy all of old into part of new */
+		BIG(newptr = (char *)newptr + newbytes;)
+		BIG(oldptr = (char *)oldptr - oldbytes;)
+		memcpy(BIGLITTLE((char *)newptr-oldbytes, newptr), oldptr,
+		       oldbytes);
+	} else {	/* Copy part of old into all of new */
+		memcpy(newptr, BIGLITTLE((char *)oldptr-newbytes, oldptr),
+		       newbytes);
+		BIG(newptr = (char *)newptr + newbytes;)
+		BIG(oldptr = (char *)oldptr - oldbytes;)
+	}
+
+	lbnMemFree(oldptr, oldbytes);
+
+	return newptr;
+}
+
 #if defined(lbnMemRealloc) || !BNSECURE
 void *
 lbnRealloc(void *ptr, unsigned oldbytes, unsigned newbytes)
 {
+	/* Memory of an allocator cannot go through realloc() */
+	if (threadAllocator)
+		return lbnReallocCopy(ptr, oldbytes, newbytes);
+
 	if (ptr) {
 		BIG(ptr = (char *)ptr - oldbytes;)
 		if (newbytes < oldbytes)
@@ -131,32 +224,7 @@ lbnRealloc(void *ptr, unsigned oldbytes, unsigned newbytes)
 void *
 lbnRealloc(void *oldptr, unsigned oldbytes, unsigned newbytes)
 {
-	void *newptr = lbnMemAlloc(newbytes);
-
-	if (!newptr)
-		return newptr;
-	if (!oldptr)
-		return BIGLITTLE((char *)newptr+newbytes, newptr);
-
-	/*
-	 * The following copies are a bit non-obvious in the big-endian case
-	 * because one of the pointers points to the *end* of allocated memory.
-	 */
-	if (newbytes > oldbytes) {	/* Copy all of old into part of new */
-		BIG(newptr = (char *)newptr + newbytes;)
-		BIG(oldptr = (char *)oldptr - oldbytes;)
-		memcpy(BIGLITTLE((char *)newptr-oldbytes, newptr), oldptr,
-		       oldbytes);
-	} else {	/* Copy part of old into all of new */
-		memcpy(newptr, BIGLITTLE((char *)oldptr-newbytes, oldptr),
-		       newbytes);
-		BIG(newptr = (char *)newptr + newbytes;)
-		BIG(oldptr = (char *)oldptr - oldbytes;)
-	}
-
-	lbnMemFree(oldptr, oldbytes);
-
-	return newptr;
+	return lbnReallocCopy(oldptr, oldbytes, newbytes);
 }
 #endif /* BNSECURE */
 #endif /* !lbnRealloc */
@@ -18,6 +18,30 @@ void *lbnMemAlloc(unsigned bytes);
 void lbnMemFree(void *ptr, unsigned bytes);
 #endif
 
+/*
+ * Allocator hook.  A thread may install an allocator for the memory
+ * that lbnMemAlloc and lbnRealloc hand out on this thread, for example
+ * an arena for the temporaries of one DH operation.  lbnMemAlloc uses
+ * the heap if the hook has no allocator or alloc() returns NULL.  A
+ * reallocation of a heap block stays on the heap, thus numbers that
+ * were allocated before the hook was installed survive its removal.
+ *
+ * Memory of the allocator must be freed while it is installed; free()
+ * must wipe the memory.  lbnMemSetAllocator returns the previous
+ * allocator, NULL restores the heap.
+ */
+struct LbnAllocator {
+	void *(*alloc)(void *context, unsigned bytes);
+	void (*free)(void *context, void *ptr, unsigned bytes);
+	int (*owns)(void *context, void const *ptr);
+	void *context;
+};
+
+struct LbnAllocator const *lbnMemSetAllocator(struct LbnAllocator const *allocator);
+
+/* Number of heap allocations of the calling thread */
+unsigned long lbnMemHeapAllocs(void);
+
 /* This wipes out a buffer of bytes if necessary needed. */
 
 #ifndef lbnMemWipe
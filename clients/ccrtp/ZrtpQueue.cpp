@@ -57,6 +57,12 @@ void ZrtpQueue::init()
 
     clientIdString = clientId;
     peerSSRC = 0;
+
+    workerPool = NULL;
+    zrtpStopping = false;
+    stopInTask = false;
+    memset(pendingContexts, 0, sizeof(pendingContexts));
+    contextsPending = false;
 }
 
 ZrtpQueue::~ZrtpQueue() {
@@ -108,6 +114,8 @@ ZrtpQueue::initialize(const char *zidFilename, bool autoEnable, ZrtpConfigure* c
     if (ret > 0) {
         const uint8_t* ownZid = zf->getZid();
         zrtpEngine = new ZRtp((uint8_t*)ownZid, (ZrtpCallback*)this, clientIdString, config, mitmMode, signSas);
+        std::lock_guard<std::mutex> guard(poolLock);
+        zrtpStopping = false;
     }
     if (configOwn != NULL) {
         delete configOwn;
@@ -125,6 +133,27 @@ void ZrtpQueue::startZrtp() {
 }
 
 void ZrtpQueue::stopZrtp() {
+    // Pool tasks use the engine and the queue. After the flag is set the
+    // receive thread posts no more tasks, thus the drain waits for the last one.
+    ZrtpWorkerPool* pool;
+    {
+        std::lock_guard<std::mutex> guard(poolLock);
+        zrtpStopping = true;
+        pool = workerPool;
+    }
+    // A callback in our own task cannot wait for the task, the engine is on
+    // its stack. processZrtpTask() deletes the engine when it returns.
+    if (ZrtpWorkerPool::runsStrand(&zrtpStrand)) {
+        stopInTask = true;
+        return;
+    }
+    if (pool != NULL)
+        pool->drain(&zrtpStrand);
+    deleteZrtpEngine();
+    discardCryptoContexts();
+}
+
+void ZrtpQueue::deleteZrtpEngine() {
     if (zrtpEngine != NULL) {
         if (zrtpUnprotect < 50 && !zrtpEngine->isMultiStream())
             zrtpEngine->setRs2Valid();
@@ -134,6 +163,105 @@ void ZrtpQueue::stopZrtp() {
     }
 }
 
+void ZrtpQueue::setZrtpWorkerPool(ZrtpWorkerPool* pool) {
+    // Tasks do not take the lock, thus the drain cannot deadlock
+    if (ZrtpWorkerPool::runsStrand(&zrtpStrand))
+        return;
+    std::lock_guard<std::mutex> guard(poolLock);
+    if (workerPool != NULL)
+        workerPool->drain(&zrtpStrand);
+    workerPool = pool;
+}
+
+void ZrtpQueue::processZrtpTask(void* context, void* data) {
+    ZrtpQueue* queue = static_cast<ZrtpQueue*>(context);
+    unsigned char* buffer = static_cast<unsigned char*>(data);
+
+    // The classifier checked that the length field matches the packet length
+    int32 length = 12 + ntohs(*(uint16*)(buffer + 14)) * ZRTP_WORD_SIZE + CRC_SIZE;
+    if (queue->zrtpEngine != NULL)
+        queue->zrtpEngine->processZrtpMessage(buffer + 12, ntohl(*(uint32*)(buffer + 8)), length);
+    delete[] buffer;
+
+    // A callback called stopZrtp(), no other task follows on this strand
+    if (queue->stopInTask) {
+        queue->stopInTask = false;
+        queue->deleteZrtpEngine();
+    }
+}
+
+void ZrtpQueue::changeCryptoContexts(EnableSecurity part, CryptoContext* context, CryptoContextCtrl* contextCtrl)
+{
+    bool sender = (part == ForSender);
+
+    if (ZrtpWorkerPool::runsStrand(&zrtpStrand)) {
+        std::lock_guard<std::mutex> guard(contextLock);
+        PendingContexts& pending = pendingContexts[sender ? 0 : 1];
+
+        // A newer change replaces contexts that are not yet installed
+        delete pending.context;
+        delete pending.contextCtrl;
+        if (context == NULL)
+            pending.remove = true;
+        pending.context = context;
+        pending.contextCtrl = contextCtrl;
+        contextsPending = true;
+        return;
+    }
+    if (sender) {
+        if (context == NULL) {
+            removeOutQueueCryptoContext(NULL);
+            removeOutQueueCryptoContextCtrl(NULL);
+        }
+        else {
+            setOutQueueCryptoContext(context);
+            setOutQueueCryptoContextCtrl(contextCtrl);
+        }
+    }
+    else {
+        if (context == NULL) {
+            removeInQueueCryptoContext(NULL);
+            removeInQueueCryptoContextCtrl(NULL);
+        }
+        else {
+            setInQueueCryptoContext(context);
+            setInQueueCryptoContextCtrl(contextCtrl);
+        }
+    }
+}
+
+void ZrtpQueue::applyCryptoContexts()
+{
+    PendingContexts pending[2];
+
+    if (!contextsPending)
+        return;
+    {
+        std::lock_guard<std::mutex> guard(contextLock);
+        memcpy(pending, pendingContexts, sizeof(pending));
+        memset(pendingContexts, 0, sizeof(pendingContexts));
+        contextsPending = false;
+    }
+    for (int i = 0; i < 2; i++) {
+        EnableSecurity part = (i == 0) ? ForSender : ForReceiver;
+        if (pending[i].remove)
+            changeCryptoContexts(part, NULL, NULL);
+        if (pending[i].context != NULL)
+            changeCryptoContexts(part, pending[i].context, pending[i].contextCtrl);
+    }
+}
+
+void ZrtpQueue::discardCryptoContexts()
+{
+    std::lock_guard<std::mutex> guard(contextLock);
+    for (int i = 0; i < 2; i++) {
+        delete pendingContexts[i].context;
+        delete pendingContexts[i].contextCtrl;
+        pendingContexts[i].context = NULL;
+        pendingContexts[i].contextCtrl = NULL;
+    }
+}
+
 /*
  * The takeInDataPacket implementation for ZRTPQueue.
  */
@@ -143,6 +271,9 @@ ZrtpQueue::takeInDataPacket(void)
     InetHostAddress network_address;
     tpport_t transport_port;
 
+    // Install the crypto contexts of a handshake that ran in the pool
+    applyCryptoContexts();
+
     uint32 nextSize = (uint32)getNextDataPacketSize();
     unsigned char* buffer = new unsigned char[nextSize];
     int32 rtn = (int32)recvData(buffer, nextSize, network_address, transport_port);
@@ -151,57 +282,53 @@ ZrtpQueue::takeInDataPacket(void)
         return 0;
     }
 
-    IncomingZRTPPkt* packet = NULL;
-    // check if this could be a real RTP/SRTP packet.
-    if ((*buffer & 0xf0) != 0x10) {
+    // check if this could be a real RTP/SRTP packet. Drop junk before any CRC work.
+    ZrtpPacketClassifier::PacketClass packetClass = packetClassifier.check(buffer, rtn);
+    if (packetClass == ZrtpPacketClassifier::RtpPacket) {
         return (rtpDataPacket(buffer, rtn, network_address, transport_port));
     }
 
-    // We assume all other packets are ZRTP packets here. Process
-    // if ZRTP processing is enabled. Because valid RTP packets are
-    // already handled we delete any packets here after processing.
+    // Process ZRTP packets with a valid CRC if ZRTP processing is enabled.
+    // Because valid RTP packets are already handled we delete any packets
+    // here after processing.
     if (enableZrtp && zrtpEngine != NULL) {
-        // Fixed header length + smallest ZRTP packet (includes CRC)
-        if (rtn < (int32)(12 + sizeof(HelloAckPacket_t))) // data too small, dismiss
-            return 0;
-
-        // Get CRC value into crc (see above how to compute the offset)
-        uint16_t temp = rtn - CRC_SIZE;
-        uint32_t crc = *(uint32_t*)(buffer + temp);
-        crc = ntohl(crc);
-
-        if (!zrtpCheckCksum(buffer, temp, crc)) {
+        if (packetClass == ZrtpPacketClassifier::CrcErrorPacket) {
             delete[] buffer;
             if (zrtpUserCallback != NULL)
                 zrtpUserCallback->showMessage(Warning, WarningCRCmismatch);
             return 0;
         }
-
-        packet = new IncomingZRTPPkt(buffer,rtn);
-
-        uint32 magic = packet->getZrtpMagic();
-
-        // Check if it is really a ZRTP packet, if not delete it and return 0
-        if (magic != ZRTP_MAGIC || zrtpEngine == NULL) {
-            delete packet;
+        if (packetClass != ZrtpPacketClassifier::ZrtpPacket) {
+            delete[] buffer;
             return 0;
         }
+
         // cover the case if the other party sends _only_ ZRTP packets at the
         // beginning of a session. Start ZRTP in this case as well.
         if (!started) {
             startZrtp();
          }
-        // this now points beyond the undefined and length field.
-        // We need them, thus adjust
-        unsigned char* extHeader =
-                const_cast<unsigned char*>(packet->getHdrExtContent());
-        extHeader -= 4;
-
         // store peer's SSRC, used when creating the CryptoContext
-        peerSSRC = packet->getSSRC();
-        zrtpEngine->processZrtpMessage(extHeader, peerSSRC, rtn);
+        peerSSRC = ntohl(*(uint32*)(buffer + 8));
+
+        // The task owns and deletes the buffer. stopZrtp() sets the flag under
+        // the same lock, thus no task can follow its drain.
+        std::unique_lock<std::mutex> guard(poolLock);
+        if (zrtpStopping) {
+            delete[] buffer;
+            return 0;
+        }
+        if (workerPool != NULL) {
+            workerPool->post(&zrtpStrand, processZrtpTask, this, buffer);
+            return 0;
+        }
+        guard.unlock();
+
+        // The ZRTP message starts with the undefined and length field of the
+        // header extension, just after the fixed 12 bytes header.
+        zrtpEngine->processZrtpMessage(buffer + 12, peerSSRC, rtn);
     }
-    delete packet;
+    delete[] buffer;
     return 0;
 }
 
@@ -353,6 +480,8 @@ ZrtpQueue::sendImmediate(uint32 stamp, const unsigned char* data, size_t len)
  */
 int32_t ZrtpQueue::sendDataZRTP(const unsigned char *data, int32_t length) {
 
+    std::lock_guard<std::mutex> guard(sendLock);
+
     OutgoingZRTPPkt* packet = new OutgoingZRTPPkt(data, length);
 
     packet->setSSRC(getLocalSSRC());
@@ -473,8 +602,7 @@ bool ZrtpQueue::srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part)
         // Refer to putData(), sendImmediate() in ccrtp's outqueue.cpp and
         // takeinControlPacket() in ccrtp's control.cpp.
         //
-         setOutQueueCryptoContext(senderCryptoContext);
-         setOutQueueCryptoContextCtrl(senderCryptoContextCtrl);
+        changeCryptoContexts(ForSender, senderCryptoContext, senderCryptoContextCtrl);
     }
     if (part == ForReceiver) {
         // To decrypt packets: intiator uses responder keys,
@@ -542,8 +670,7 @@ bool ZrtpQueue::srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part)
         // the first RTP or RTCP packet the real crypto context will be created.
         // Refer to rtpDataPacket() above and takeinControlPacket in ccrtp's control.cpp.
         //
-        setInQueueCryptoContext(recvCryptoContext);
-        setInQueueCryptoContextCtrl(recvCryptoContextCtrl);
+        changeCryptoContexts(ForReceiver, recvCryptoContext, recvCryptoContextCtrl);
     }
     return true;
 }
@@ -560,14 +687,7 @@ void ZrtpQueue::srtpSecretsOn(std::string c, std::string s, bool verified)
 }
 
 void ZrtpQueue::srtpSecretsOff(EnableSecurity part) {
-    if (part == ForSender) {
-        removeOutQueueCryptoContext(NULL);
-        removeOutQueueCryptoContextCtrl(NULL);
-    }
-    if (part == ForReceiver) {
-        removeInQueueCryptoContext(NULL);
-        removeInQueueCryptoContextCtrl(NULL);
-    }
+    changeCryptoContexts(part, NULL, NULL);
     if (zrtpUserCallback != NULL) {
         zrtpUserCallback->secureOff();
     }
@@ -18,10 +18,14 @@
 #ifndef _ZRTPQUEUE_H_
 #define _ZRTPQUEUE_H_
 
+#include <atomic>
+
 #include <ccrtp/cqueue.h>
 #include <ccrtp/rtppkt.h>
 #include <libzrtpcpp/ZrtpCallback.h>
 #include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZrtpPacketClassifier.h>
+#include <libzrtpcpp/ZrtpWorkerPool.h>
 #include "CcrtpTimeoutProvider.h"
 
 class __EXPORT ZrtpUserCallback;
@@ -562,6 +566,16 @@ public:
      */
     bool sendSASRelayPacket(uint8_t* sh, std::string render);
 
+    /**
+     * Get the counters of the received packets.
+     *
+     * The queue classifies each received packet as RTP, ZRTP, junk or ZRTP
+     * with a wrong CRC before it spends work on it.
+     *
+     * @return a copy of the counters
+     */
+    ZrtpPacketCounters getPacketCounters() const { return packetClassifier.getCounters(); }
+
     /**
      * Check the state of the MitM mode flag.
      *
@@ -771,11 +785,46 @@ public:
      * Stops the ZRTP protocol engine.
      *
      * Applications call this method to stop the ZRTP protocol
-     * engine.
+     * engine. If the queue uses a worker pool the method waits until
+     * the pool processed the received ZRTP messages. The queue drops
+     * ZRTP messages that arrive after this call.
+     *
+     * If a callback calls this method in a pool thread the method cannot
+     * wait for its own task. It only marks the engine as stopped, the task
+     * deletes the engine after the engine processed the message.
      *
      */
     void stopZrtp();
 
+    /**
+     * Process received ZRTP messages in a worker pool.
+     *
+     * By default the queue processes a ZRTP message in the receive thread.
+     * The DH computations of a handshake then stop the reception of RTP
+     * packets for milliseconds. With a pool the receive thread posts the
+     * message and continues with the next packet. The engine then sends
+     * its ZRTP packets and calls the callbacks, for example
+     * srtpSecretsReady(), from the pool threads.
+     *
+     * The RTP receive and send paths use the SRTP crypto contexts without
+     * a lock. Thus srtpSecretsReady() and srtpSecretsOff() do not change
+     * the contexts in a pool thread, the receive thread installs or
+     * removes them before it processes the next received packet.
+     *
+     * The pool is off by default. ccRTP was not available to build this
+     * client when the pool was added, the pool mode is not tested with a
+     * real ccRTP session yet.
+     *
+     * An application usually shares one pool between all queues. Set the
+     * pool before the queue receives packets, the pool must exist until
+     * the queue stopped ZRTP. A call in a pool task of this queue is
+     * ignored, the task cannot wait for itself.
+     *
+     * @param pool the worker pool, @c NULL processes the messages in the
+     *        receive thread
+     */
+    void setZrtpWorkerPool(ZrtpWorkerPool* pool);
+
     /**
      * Get other party's ZID (ZRTP Identifier) data
      *
@@ -906,6 +955,45 @@ private:
                          InetHostAddress network_address,
                          tpport_t transport_port);
 
+    /**
+     * Worker pool task, processes a received ZRTP packet and frees it.
+     */
+    static void processZrtpTask(void* context, void* data);
+
+    /**
+     * Delete the engine, the part of stopZrtp() that must not run in a
+     * pool task of this queue.
+     */
+    void deleteZrtpEngine();
+
+    /**
+     * Install or remove the crypto contexts of one direction.
+     *
+     * In a pool task only records the change, see applyCryptoContexts().
+     * A @c NULL context removes the contexts of the direction.
+     */
+    void changeCryptoContexts(EnableSecurity part, CryptoContext* context, CryptoContextCtrl* contextCtrl);
+
+    /**
+     * Apply the crypto context changes of the pool tasks, called by the
+     * receive thread.
+     */
+    void applyCryptoContexts();
+
+    /**
+     * Delete the recorded crypto contexts that are not yet installed.
+     */
+    void discardCryptoContexts();
+
+    /**
+     * A crypto context change of a pool task for one direction.
+     */
+    struct PendingContexts {
+        bool remove;                    // remove the installed contexts first
+        CryptoContext* context;         // then install these, if not NULL
+        CryptoContextCtrl* contextCtrl;
+    };
+
     ZRtp *zrtpEngine;
     ZrtpUserCallback* zrtpUserCallback;
 
@@ -923,6 +1011,18 @@ private:
     bool mitmMode;
     bool signSas;
     bool enableParanoidMode;
+
+    ZrtpPacketClassifier packetClassifier;
+    ZrtpWorkerPool* workerPool;
+    ZrtpWorkerPool::Strand zrtpStrand;
+    std::mutex poolLock;            // guards workerPool and zrtpStopping against the receive thread
+    bool zrtpStopping;              // stopZrtp() called, post no more pool tasks
+    bool stopInTask;                // stopZrtp() called in a pool task, the task deletes the engine
+    std::mutex sendLock;            // the timer, receive and pool threads send ZRTP packets
+
+    std::mutex contextLock;         // guards pendingContexts, pool tasks never take poolLock
+    PendingContexts pendingContexts[2];         // index 0: sender, 1: receiver
+    std::atomic<bool> contextsPending;          // receive thread checks it without the lock
 };
 
 class IncomingZRTPPkt : public IncomingRTPPkt {
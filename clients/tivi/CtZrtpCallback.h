@@ -70,4 +70,39 @@ public:
     virtual void sendRtp(CtZrtpSession const *session, uint8_t* packet, size_t length, CtZrtpSession::streamName streamNm) =0;
 };
 
+/**
+ * @brief An RTP packet that the application hands over to a shard.
+ *
+ * The application owns the packet and must not touch it until the session
+ * returns it with @c CtZrtpRtpCb::onRtpDone.
+ */
+struct CtZrtpPacket {
+    uint8_t *buffer;                    //!< RTP packet, must have room for the SRTP tag
+    size_t length;                      //!< length of the packet data
+    size_t newLength;                   //!< new length after protect or unprotect
+    int32_t result;                     //!< return value of processOutoingRtp or processIncomingRtp
+    CtZrtpSession::streamName streamNm; //!< the stream of the packet
+    void *userData;                     //!< not used by the session
+};
+
+/**
+ * @brief Tivi callback function for RTP packets processed in a shard.
+ *
+ * If a session runs in a @c ZrtpShardReactor the shard thread calls this
+ * callback after it processed a packet that the application posted with
+ * @c CtZrtpSession::postIncomingRtp or @c CtZrtpSession::postOutgoingRtp.
+ * The callback runs in the shard thread, it usually sends the packet or
+ * queues it for the media engine.
+ */
+class __EXPORT CtZrtpRtpCb {
+public:
+    /**
+     * @brief Destructor.
+     * Define a virtual destructor to enable cleanup in derived classes.
+     */
+    virtual ~CtZrtpRtpCb() {};
+
+    virtual void onRtpDone(CtZrtpSession *session, CtZrtpPacket *packet, bool incoming) =0;
+};
+
 #endif
\ No newline at end of file
@@ -24,6 +24,8 @@
 
 #include <libzrtpcpp/ZIDCache.h>
 #include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZRtpPool.h>
+#include <libzrtpcpp/ZrtpShardReactor.h>
 
 #include <CtZrtpStream.h>
 #include <CtZrtpCallback.h>
@@ -37,7 +39,7 @@ const char *getZrtpBuildInfo()
 {
     return zrtpBuildInfo;
 }
-CtZrtpSession::CtZrtpSession() : zrtpMaster(NULL), mitmMode(false), signSas(false), enableParanoidMode(false), isReady(false),
+CtZrtpSession::CtZrtpSession() : reactor(NULL), enginePool(NULL), rtpCallback(NULL), shard(0), zrtpMaster(NULL), mitmMode(false), signSas(false), enableParanoidMode(false), isReady(false),
     zrtpEnabled(true), sdesEnabled(true), discriminatorMode(false) {
 
     clientIdString = clientId;
@@ -69,9 +71,10 @@ int CtZrtpSession::init(bool audio, bool video, int32_t callId, ZrtpConfigure* c
 
     synchEnter();
 
-    ZrtpConfigure* configOwn = NULL;
+    // The audio and video engines share the Hello template of this configuration
+    ZrtpConfigure configOwn;
     if (config == NULL) {
-        config = configOwn = new ZrtpConfigure();
+        config = &configOwn;
         setupConfiguration(config);
         config->setTrustedMitM(false);
 #if defined AXO_SUPPORT
@@ -95,27 +98,34 @@ int CtZrtpSession::init(bool audio, bool video, int32_t callId, ZrtpConfigure* c
             if (streams[AudioStream] == NULL)
                 streams[AudioStream] = new CtZrtpStream();
             stream = streams[AudioStream];
-            stream->zrtpEngine = new ZRtp((uint8_t*)ownZid, stream, clientIdString, config, mitmMode, signSas);
+            if (enginePool != NULL)
+                stream->zrtpEngine = enginePool->acquire((uint8_t*)ownZid, stream, clientIdString, config, mitmMode, signSas);
+            else
+                stream->zrtpEngine = new ZRtp((uint8_t*)ownZid, stream, clientIdString, config, mitmMode, signSas);
+            stream->enginePool = enginePool;
             stream->type = Master;
             stream->index = AudioStream;
             stream->session = this;
             stream->discriminatorMode = discriminatorMode;
+            stream->shardLoop = (reactor != NULL) ? reactor->getEventLoop(shard) : NULL;
         }
         if (video) {
             if (streams[VideoStream] == NULL)
                 streams[VideoStream] = new CtZrtpStream();
             stream = streams[VideoStream];
-            stream->zrtpEngine = new ZRtp((uint8_t*)ownZid, stream, clientIdString, config);
+            if (enginePool != NULL)
+                stream->zrtpEngine = enginePool->acquire((uint8_t*)ownZid, stream, clientIdString, config);
+            else
+                stream->zrtpEngine = new ZRtp((uint8_t*)ownZid, stream, clientIdString, config);
+            stream->enginePool = enginePool;
             stream->type = Slave;
             stream->index = VideoStream;
             stream->session = this;
             stream->discriminatorMode = discriminatorMode;
+            stream->shardLoop = (reactor != NULL) ? reactor->getEventLoop(shard) : NULL;
         }
         isReady = true;
     }
-    if (configOwn != NULL) {
-        delete configOwn;
-    }
     synchLeave();
     return ret;
 }
@@ -430,6 +440,59 @@ bool CtZrtpSession::processOutoingRtp(uint8_t *buffer, size_t length, size_t *ne
     return stream->processOutgoingRtp(buffer, length, newLength);
 }
 
+bool CtZrtpSession::setReactor(ZrtpShardReactor* rtor, int32_t shardNm) {
+    if (isReady)
+        return false;
+
+    reactor = rtor;
+    if (reactor != NULL) {
+        if (shardNm < 0 || shardNm >= reactor->getNumberOfShards())
+            shardNm = reactor->selectShard(reinterpret_cast<uintptr_t>(this));
+        shard = shardNm;
+    }
+    return true;
+}
+
+bool CtZrtpSession::setEnginePool(ZRtpPool* pool) {
+    if (isReady)
+        return false;
+
+    enginePool = pool;
+    return true;
+}
+
+void CtZrtpSession::runOutgoingRtp(void* context, void* data) {
+    CtZrtpSession *session = static_cast<CtZrtpSession*>(context);
+    CtZrtpPacket *packet = static_cast<CtZrtpPacket*>(data);
+
+    packet->newLength = packet->length;
+    packet->result = session->processOutoingRtp(packet->buffer, packet->length, &packet->newLength, packet->streamNm) ? 1 : 0;
+    if (session->rtpCallback != NULL)
+        session->rtpCallback->onRtpDone(session, packet, false);
+}
+
+void CtZrtpSession::runIncomingRtp(void* context, void* data) {
+    CtZrtpSession *session = static_cast<CtZrtpSession*>(context);
+    CtZrtpPacket *packet = static_cast<CtZrtpPacket*>(data);
+
+    packet->newLength = packet->length;
+    packet->result = session->processIncomingRtp(packet->buffer, packet->length, &packet->newLength, packet->streamNm);
+    if (session->rtpCallback != NULL)
+        session->rtpCallback->onRtpDone(session, packet, true);
+}
+
+bool CtZrtpSession::postOutgoingRtp(ZrtpShardProducer* producer, CtZrtpPacket* packet) {
+    if (reactor == NULL)
+        return false;
+    return reactor->post(producer, shard, runOutgoingRtp, this, packet);
+}
+
+bool CtZrtpSession::postIncomingRtp(ZrtpShardProducer* producer, CtZrtpPacket* packet) {
+    if (reactor == NULL)
+        return false;
+    return reactor->post(producer, shard, runIncomingRtp, this, packet);
+}
+
 int32_t CtZrtpSession::processIncomingRtp(uint8_t *buffer, size_t length, size_t *newLength, streamName streamNm) {
     if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
         return fail;
@@ -559,6 +622,22 @@ int CtZrtpSession::getCountersZrtp(int32_t* counters, streamName streamNm) {
     return stream->getCountersZrtp(counters);
 }
 
+int CtZrtpSession::getSrtpMetrics(SrtpMetricsData* data, streamName streamNm) {
+    if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
+        return -1;
+
+    CtZrtpStream *stream = streams[streamNm];
+    return stream->getSrtpMetrics(data);
+}
+
+int CtZrtpSession::getPacketCounters(ZrtpPacketCounters* data, streamName streamNm) {
+    if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
+        return -1;
+
+    CtZrtpStream *stream = streams[streamNm];
+    return stream->getPacketCounters(data);
+}
+
 
 int CtZrtpSession::enrollAccepted(char *p) {
     if (!isReady || !(streams[AudioStream] != NULL))
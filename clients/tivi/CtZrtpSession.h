@@ -43,10 +43,17 @@
 class CtZrtpStream;
 class CtZrtpCb;
 class CtZrtpSendCb;
+class CtZrtpRtpCb;
 class ZrtpConfigure;
+class ZrtpShardReactor;
+class ZrtpShardProducer;
+class ZRtpPool;
+struct CtZrtpPacket;
 class ZRtp;
 class CMutexClass;
 typedef struct _SrtpErrorData SrtpErrorData;
+typedef struct _SrtpMetricsData SrtpMetricsData;
+typedef struct _ZrtpPacketCounters ZrtpPacketCounters;
 
 extern "C" __EXPORT const char *getZrtpBuildInfo();
 
@@ -177,6 +184,91 @@ public:
      */
     void setSendCallback(CtZrtpSendCb* scb, streamName streamNm);
 
+    /**
+     * @brief Run this session in a shard of a reactor.
+     *
+     * The application calls this function before @c init. Then the shard
+     * thread runs the ZRTP timers of the session instead of the global
+     * timeout thread and the streams do not lock their mutex. Thus the
+     * application must call all functions of the session in the shard
+     * thread: it posts received and outgoing RTP packets with
+     * @c postIncomingRtp and @c postOutgoingRtp, and other calls, for
+     * example @c start or @c stop, with @c ZrtpShardReactor::post.
+     *
+     * @param reactor
+     *     The reactor, @c NULL switches back to the classic mode.
+     *
+     * @param shard
+     *     The shard of the session, -1 lets the reactor select a shard.
+     *
+     * @return
+     *     @c false if @c init was called already.
+     */
+    bool setReactor(ZrtpShardReactor* reactor, int32_t shard = -1);
+
+    /**
+     * @brief Get the shard of this session.
+     *
+     * @return the shard number or -1 if the session does not use a reactor.
+     */
+    int32_t getShard() { return reactor != NULL ? shard : -1; }
+
+    /**
+     * @brief Take the ZRTP engines of this session from a pool.
+     *
+     * The application calls this function before @c init. By default a
+     * session creates its engines with @c new and deletes them when a
+     * stream stops. With a pool the session acquires the engines from the
+     * pool and releases them back to it. This saves the allocations of an
+     * engine but not the setup time of a call, see ZRtpPool.
+     *
+     * @param pool
+     *     The pool, for example @c ZRtpPool::getInstance(). @c NULL switches
+     *     back to @c new and @c delete. The pool must exist until the
+     *     session is deleted.
+     *
+     * @return
+     *     @c false if @c init was called already.
+     */
+    bool setEnginePool(ZRtpPool* pool);
+
+    /**
+     * @brief Set the callback for packets processed in the shard.
+     *
+     * @param rcb
+     *     Implementation of the application's RTP callback class
+     */
+    void setRtpCallback(CtZrtpRtpCb* rcb) { rtpCallback = rcb; }
+
+    /**
+     * @brief Process an outgoing RTP packet in the shard of this session.
+     *
+     * The shard thread calls @c processOutoingRtp and then the @c onRtpDone
+     * callback. The packet's @c result is 1 if the application shall send
+     * the packet, 0 otherwise.
+     *
+     * @param producer
+     *     The producer of the calling thread, see @c ZrtpShardReactor::createProducer
+     *
+     * @param packet
+     *     The packet, the function uses its @c streamNm.
+     *
+     * @return
+     *     @c false if the ring to the shard is full, the application still
+     *     owns the packet.
+     */
+    bool postOutgoingRtp(ZrtpShardProducer* producer, CtZrtpPacket* packet);
+
+    /**
+     * @brief Process an incoming RTP or ZRTP packet in the shard of this session.
+     *
+     * The shard thread calls @c processIncomingRtp, stores its return value
+     * in the packet's @c result and calls the @c onRtpDone callback.
+     *
+     * @see postOutgoingRtp
+     */
+    bool postIncomingRtp(ZrtpShardProducer* producer, CtZrtpPacket* packet);
+
     /**
      * @brief Start a stream if it is not already started.
      *
@@ -442,6 +534,32 @@ public:
      */
     int getCountersZrtp(int32_t* counters, streamName streamNm =AudioStream);
 
+    /**
+     * @brief Read the SRTP metrics of a stream
+     *
+     * Adds the counters and cycle histograms of the stream's current send and
+     * receive SRTP contexts.
+     *
+     * @param data Pointer to the structure that gets the metrics
+     * @param streamNm stream, if not specified the default is @c AudioStream
+     *
+     * @return 1 if data is valid, < 0 on error
+     */
+    int getSrtpMetrics(SrtpMetricsData* data, streamName streamNm =AudioStream);
+
+    /**
+     * @brief Read the counters of the received ZRTP packets of a stream
+     *
+     * Counts the ZRTP packets the stream received outside an SRTP tunnel,
+     * the junk and the packets with a wrong CRC among them.
+     *
+     * @param data Pointer to the structure that gets the counters
+     * @param streamNm stream, if not specified the default is @c AudioStream
+     *
+     * @return 1 if data is valid, < 0 on error
+     */
+    int getPacketCounters(ZrtpPacketCounters* data, streamName streamNm =AudioStream);
+
     /**
      * @brief Accept enrollment for the active peer.
      *
@@ -751,7 +869,14 @@ private:
     void synchEnter();
     void synchLeave();
 
+    static void runOutgoingRtp(void* context, void* data);
+    static void runIncomingRtp(void* context, void* data);
+
     CtZrtpStream *streams[AllStreams];
+    ZrtpShardReactor *reactor;
+    ZRtpPool *enginePool;
+    CtZrtpRtpCb *rtpCallback;
+    int32_t shard;
     std::string  clientIdString;
     std::string  multiStreamParameter;
     const uint8_t* ownZid;
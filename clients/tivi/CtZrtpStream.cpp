@@ -24,6 +24,7 @@
 #include <common/osSpecifics.h>
 
 #include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZRtpPool.h>
 #include <libzrtpcpp/ZrtpStateClass.h>
 #include <libzrtpcpp/ZrtpCrc32.h>
 #include <srtp/CryptoContext.h>
@@ -91,14 +92,14 @@ void set_zrtp_log_cb(void *pRet, void (*cb)(void *ret, const char *tag, const ch
 }
 
 CtZrtpStream::CtZrtpStream():
-    index(CtZrtpSession::AudioStream), type(CtZrtpSession::NoStream), zrtpEngine(NULL),
+    index(CtZrtpSession::AudioStream), type(CtZrtpSession::NoStream), zrtpEngine(NULL), enginePool(NULL),
     ownSSRC(0), zrtpProtect(0), sdesProtect(0), zrtpUnprotect(0), sdesUnprotect(0), unprotectFailed(0),
     enableZrtp(0), started(false), isStopped(false), discriminatorMode(false), session(NULL), tiviState(CtZrtpSession::eLookingPeer),
     prevTiviState(CtZrtpSession::eLookingPeer), recvSrtp(NULL), recvSrtcp(NULL), sendSrtp(NULL), sendSrtcp(NULL),
     zrtpUserCallback(NULL), zrtpSendCallback(NULL), senderZrtpSeqNo(0), peerSSRC(0), zrtpHashMatch(false),
     sasVerified(false), helloReceived(false), useSdesForMedia(false), useZrtpTunnel(false), zrtpEncapSignaled(false), 
     sdes(NULL), supressCounter(0), srtpAuthErrorBurst(0), srtpReplayErrorBurst(0), srtpDecodeErrorBurst(0), 
-    zrtpCrcErrors(0), role(NoRole), errorInfoIndex(0), numErrorArrayWrap(0)
+    zrtpCrcErrors(0), shardLoop(NULL), shardTimer(this), role(NoRole), errorInfoIndex(0), numErrorArrayWrap(0)
 {
     synchLock = new CMutexClass();
 
@@ -122,6 +123,8 @@ void CtZrtpStream::setSendCallback(CtZrtpSendCb* scb) {
 
 CtZrtpStream::~CtZrtpStream() {
     stopStream();
+    if (shardLoop != NULL)
+        shardLoop->detachTimer(&shardTimer);
     delete synchLock;
     synchLock = NULL;
 }
@@ -169,7 +172,10 @@ void CtZrtpStream::stopStream() {
 
     peerHelloHashes.clear();
 
-    delete zrtpEngine;
+    if (enginePool != NULL)
+        enginePool->release(zrtpEngine);    // wipes the engine, next init reuses it
+    else
+        delete zrtpEngine;
     zrtpEngine = NULL;
 
     delete recvSrtp;
@@ -365,14 +371,15 @@ int32_t CtZrtpStream::processIncomingRtp(uint8_t *buffer, const size_t length, s
             }
             DEBUG(char tmpBuffer[500];)
             useZrtpTunnel = false;
-            // Get CRC value into crc (see above how to compute the offset)
-            uint16_t temp = length - CRC_SIZE;
-            uint32_t crc = *(uint32_t*)(buffer + temp);
-            crc = zrtpNtohl(crc);
-            if (!zrtpCheckCksum(buffer, temp, crc)) {
+            // Drop junk before the CRC, then check the CRC
+            ZrtpPacketClassifier::PacketClass packetClass = packetClassifier.check(buffer, length);
+            if (packetClass == ZrtpPacketClassifier::JunkPacket) {
+                return 0;
+            }
+            if (packetClass == ZrtpPacketClassifier::CrcErrorPacket) {
                 zrtpCrcErrors++;
                 if (zrtpCrcErrors > 15) {
-                    DEBUG(snprintf(debBuf, 499, "len: %d, sdes: %p, sdesMedia: %d, zrtpEncap: %d", temp, (void*)sdes, useSdesForMedia, zrtpEncapSignaled); zrtp_log("CtZrtpStream", debBuf);)
+                    DEBUG(snprintf(debBuf, 499, "len: %d, sdes: %p, sdesMedia: %d, zrtpEncap: %d", (int)(length - CRC_SIZE), (void*)sdes, useSdesForMedia, zrtpEncapSignaled); zrtp_log("CtZrtpStream", debBuf);)
 
                     sendInfo(Warning, WarningCRCmismatch);
                     zrtpCrcErrors = 0;
@@ -595,6 +602,26 @@ int CtZrtpStream::getCountersZrtp(int32_t* counters) {
     return zrtpEngine->getCountersZrtp(counters);
 }
 
+int CtZrtpStream::getSrtpMetrics(SrtpMetricsData* data) {
+    if (data == NULL)
+        return -1;
+
+    memset(data, 0, sizeof(SrtpMetricsData));
+    if (sendSrtp != NULL)
+        sendSrtp->getMetrics().addData(data);
+    if (recvSrtp != NULL)
+        recvSrtp->getMetrics().addData(data);
+    return 1;
+}
+
+int CtZrtpStream::getPacketCounters(ZrtpPacketCounters* data) {
+    if (data == NULL)
+        return -1;
+
+    *data = packetClassifier.getCounters();
+    return 1;
+}
+
 int CtZrtpStream::enrollAccepted(char *p) {
     zrtpEngine->acceptEnrollment(true);
 
@@ -1045,6 +1072,10 @@ void CtZrtpStream::srtpSecretsOff(EnableSecurity part) {
 }
 
 int32_t CtZrtpStream::activateTimer(int32_t time) {
+    if (shardLoop != NULL) {
+        shardLoop->startTimer(&shardTimer, time);
+        return 1;
+    }
     std::string s("ZRTP");
     if (staticTimeoutProvider != NULL) {
         staticTimeoutProvider->requestTimeout(time, this, s);
@@ -1053,6 +1084,10 @@ int32_t CtZrtpStream::activateTimer(int32_t time) {
 }
 
 int32_t CtZrtpStream::cancelTimer() {
+    if (shardLoop != NULL) {
+        shardLoop->stopTimer(&shardTimer);
+        return 1;
+    }
     std::string s("ZRTP");
     if (staticTimeoutProvider != NULL) {
         staticTimeoutProvider->cancelRequest(this, s);
@@ -1215,11 +1250,13 @@ void CtZrtpStream::zrtpNotSuppOther() {
 }
 
 void CtZrtpStream::synchEnter() {
-    synchLock->Lock();
+    if (shardLoop == NULL)
+        synchLock->Lock();
 }
 
 void CtZrtpStream::synchLeave() {
-    synchLock->Unlock();
+    if (shardLoop == NULL)
+        synchLock->Unlock();
 }
 
 void CtZrtpStream::zrtpAskEnrollment(GnuZrtpCodes::InfoEnrollment  info) {
@@ -26,6 +26,8 @@
 #include <vector>
 
 #include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZrtpEventLoop.h>
+#include <libzrtpcpp/ZrtpPacketClassifier.h>
 #include <libzrtpcpp/ZrtpSdesStream.h>
 #include <srtp/SrtpHandler.h>
 
@@ -45,6 +47,7 @@ static const int32_t NumSrtpErrorData = 200;
 class CryptoContext;
 class CryptoContextCtrl;
 class ZRtp;
+class ZRtpPool;
 class CtZrtpCb;
 class CtZrtpSendCb;
 class CtZrtpSession;
@@ -64,6 +67,7 @@ protected:
     CtZrtpSession::streamName  index;      //!< either audio or video. Index in stream array
     CtZrtpSession::streamType  type;       //!< Master or slave stream. Necessary to handle multi-stream
     ZRtp              *zrtpEngine;         //!< The ZRTP core class of this stream
+    ZRtpPool          *enginePool;         //!< Pool of the engine, NULL if created with new
     uint32_t          ownSSRC;             //!< Our own SSRC, in host order
 
     uint64_t          zrtpProtect;
@@ -229,6 +233,27 @@ protected:
      */
     int getCountersZrtp(int32_t* counters);
 
+    /**
+     * @brief Read the SRTP metrics of the current send and receive contexts
+     *
+     * @param data Pointer to the structure that gets the sum of both contexts' metrics
+     *
+     * @return 1 if data is valid, < 0 on error
+     */
+    int getSrtpMetrics(SrtpMetricsData* data);
+
+    /**
+     * @brief Read the counters of the received ZRTP packets
+     *
+     * The stream classifies the ZRTP packets that it receives outside an
+     * SRTP tunnel. RTP packets are not counted.
+     *
+     * @param data Pointer to the structure that gets the counters
+     *
+     * @return 1 if data is valid, < 0 on error
+     */
+    int getPacketCounters(ZrtpPacketCounters* data);
+
     bool isStarted() {return started;}
 
     bool isEnabled() {return enableZrtp;}
@@ -517,9 +542,25 @@ private:
     uint32_t srtpReplayErrorBurst;
     uint32_t srtpDecodeErrorBurst;
     uint32_t zrtpCrcErrors;
+    ZrtpPacketClassifier packetClassifier;
 
     CMutexClass *synchLock;
 
+    /*
+     * Timer of the stream if its session runs in a shard, see
+     * CtZrtpSession::setReactor. The shard thread runs all calls of the
+     * stream, thus synchEnter() and synchLeave() don't lock.
+     */
+    class StreamTimer: public ZrtpEventLoop::Timer {
+    public:
+        StreamTimer(CtZrtpStream *stream): stream(stream) {}
+        void timerExpired() { stream->handleTimeout(std::string()); }
+    private:
+        CtZrtpStream *stream;
+    };
+    ZrtpEventLoop *shardLoop;
+    StreamTimer shardTimer;
+
     char mixAlgoName[20];                   //!< stores name in during getInfo() call
 
     int role;                               //!< Initiator or Responder role
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2019 Silent Circle.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Test program for tivi sessions that run in a ZrtpShardReactor.
+ *
+ * The program forks, each process owns its own ZID cache and one session
+ * in a reactor. The processes talk through a datagram socket pair. Each
+ * side runs the ZRTP handshake in its shard, then sends SRTP packets with
+ * postOutgoingRtp and checks the packets of its peer that it decrypts with
+ * postIncomingRtp. At the end each side releases its stream in the shard,
+ * stops the reactor and deletes the session. The program returns 0 if both
+ * sides reached secure state and received all packets. With option -p the
+ * sessions take their ZRTP engines from the process-wide engine pool.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <CtZrtpSession.h>
+#include <CtZrtpCallback.h>
+
+#include <libzrtpcpp/ZrtpShardReactor.h>
+#include <libzrtpcpp/ZRtpPool.h>
+
+static const int numberOfPackets = 10;
+static const int timeoutMs = 15000;
+static const size_t rtpHeaderLength = 12;
+static const size_t srtpTagRoom = 32;
+static const char payloadText[] = "reactor test packet ";
+
+static int sock;
+static const char *sideName;
+static bool usePool = false;
+
+static std::atomic<bool> secure(false);
+static std::atomic<bool> failed(false);
+static std::atomic<int> received(0);
+static std::atomic<int> sent(0);
+static std::atomic<int> badPackets(0);
+static std::atomic<bool> released(false);
+
+class TestCallbackAudio: public CtZrtpCb {
+    void onNewZrtpStatus(CtZrtpSession *session, char *p, CtZrtpSession::streamName streamNm) {
+        CtZrtpSession::tiviStatus state = session->getCurrentState(streamNm);
+        if (state == CtZrtpSession::eSecure)
+            secure = true;
+        else if (state == CtZrtpSession::eError || state == CtZrtpSession::eNoPeer)
+            failed = true;
+    }
+
+    void onNeedEnroll(CtZrtpSession *session, CtZrtpSession::streamName streamNm, int32_t info) {}
+
+    void onPeer(CtZrtpSession *session, char *name, int iIsVerified, CtZrtpSession::streamName streamNm) {}
+
+    void onZrtpWarning(CtZrtpSession *session, char *p, CtZrtpSession::streamName streamNm) {
+        fprintf(stderr, "%s: warning: %s\n", sideName, p == NULL ? "NULL" : p);
+    }
+
+    void onDiscriminatorException(CtZrtpSession *session, char *p, CtZrtpSession::streamName streamNm) {}
+};
+
+// Runs in the shard thread
+class TestSendCallbackAudio: public CtZrtpSendCb {
+    void sendRtp(CtZrtpSession const *session, uint8_t* packet, size_t length, CtZrtpSession::streamName streamNm) {
+        if (send(sock, packet, length, 0) < 0)
+            perror("send ZRTP");
+    }
+};
+
+// Runs in the shard thread
+class TestRtpCallback: public CtZrtpRtpCb {
+    void onRtpDone(CtZrtpSession *session, CtZrtpPacket *packet, bool incoming) {
+        if (!incoming) {
+            if (packet->result == 1 && send(sock, packet->buffer, packet->newLength, 0) >= 0)
+                sent++;
+        }
+        else if (packet->result == 1) {
+            const size_t textLength = sizeof(payloadText) - 1;
+            if (packet->newLength >= rtpHeaderLength + textLength &&
+                memcmp(packet->buffer + rtpHeaderLength, payloadText, textLength) == 0)
+                received++;
+            else
+                badPackets++;
+        }
+        else if (packet->result < 0) {
+            badPackets++;
+        }
+        delete[] packet->buffer;
+        delete packet;
+    }
+};
+
+static void startStream(void* context, void* data) {
+    CtZrtpSession *session = static_cast<CtZrtpSession*>(context);
+    session->start(*static_cast<uint32_t*>(data), CtZrtpSession::AudioStream);
+}
+
+static void releaseStream(void* context, void* data) {
+    CtZrtpSession *session = static_cast<CtZrtpSession*>(context);
+    session->stop(CtZrtpSession::AudioStream);
+    session->release();
+    released = true;
+}
+
+static void postWait(ZrtpShardReactor* reactor, ZrtpShardProducer* producer, int32_t shard,
+                     ZrtpShardTask function, void* context, void* data) {
+    while (!reactor->post(producer, shard, function, context, data))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+static CtZrtpPacket* newPacket(size_t length) {
+    CtZrtpPacket *packet = new CtZrtpPacket();
+    packet->buffer = new uint8_t[length + srtpTagRoom];
+    packet->length = length;
+    packet->newLength = 0;
+    packet->result = 0;
+    packet->streamNm = CtZrtpSession::AudioStream;
+    packet->userData = NULL;
+    return packet;
+}
+
+static CtZrtpPacket* newRtpPacket(uint32_t ssrc, uint16_t seq) {
+    char text[64];
+    int textLength = snprintf(text, sizeof(text), "%s%d", payloadText, seq);
+    CtZrtpPacket *packet = newPacket(rtpHeaderLength + textLength);
+    uint8_t *p = packet->buffer;
+    uint32_t ts = seq * 160;
+
+    p[0] = 0x80; p[1] = 0;                              // version 2, PCMU
+    p[2] = seq >> 8; p[3] = seq & 0xff;
+    p[4] = ts >> 24; p[5] = ts >> 16; p[6] = ts >> 8; p[7] = ts;
+    p[8] = ssrc >> 24; p[9] = ssrc >> 16; p[10] = ssrc >> 8; p[11] = ssrc;
+    memcpy(p + rtpHeaderLength, text, textLength);
+    return packet;
+}
+
+static int runSide(const char *name, const char *zidFile, uint32_t ssrc) {
+    sideName = name;
+    unlink(zidFile);
+    if (CtZrtpSession::initCache(zidFile) < 0) {
+        fprintf(stderr, "%s: cannot open ZID cache %s\n", name, zidFile);
+        return 1;
+    }
+
+    ZrtpShardReactor reactor(1);
+    CtZrtpSession *session = new CtZrtpSession();
+    TestCallbackAudio callback;
+    TestSendCallbackAudio sendCallback;
+    TestRtpCallback rtpCallback;
+
+    session->setReactor(&reactor, 0);
+    if (usePool)
+        session->setEnginePool(&ZRtpPool::getInstance());
+    session->init(true, true);                  // audio and video, video stays idle
+    session->setUserCallback(&callback, CtZrtpSession::AudioStream);
+    session->setSendCallback(&sendCallback, CtZrtpSession::AudioStream);
+    session->setRtpCallback(&rtpCallback);
+
+    reactor.start();
+    ZrtpShardProducer *producer = reactor.createProducer();
+    postWait(&reactor, producer, session->getShard(), startStream, session, &ssrc);
+
+    uint16_t seq = 1;
+    auto start = std::chrono::steady_clock::now();
+    auto nextSend = start;
+    uint8_t buffer[1500];
+
+    // The peer sends its SRTP packets only after it is secure, thus this
+    // side keeps its stream until it received all of them
+    while (received < numberOfPackets || sent < numberOfPackets) {
+        auto now = std::chrono::steady_clock::now();
+        if (failed || badPackets > 0 ||
+            std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() > timeoutMs)
+            break;
+
+        if (secure && seq <= numberOfPackets && now >= nextSend) {
+            CtZrtpPacket *packet = newRtpPacket(ssrc, seq++);
+            while (!session->postOutgoingRtp(producer, packet))
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            nextSend = now + std::chrono::milliseconds(20);
+        }
+
+        struct pollfd pfd = {sock, POLLIN, 0};
+        if (poll(&pfd, 1, 10) <= 0)
+            continue;
+        ssize_t length = recv(sock, buffer, sizeof(buffer), 0);
+        if (length <= 0)
+            continue;
+        CtZrtpPacket *packet = newPacket(length);
+        memcpy(packet->buffer, buffer, length);
+        while (!session->postIncomingRtp(producer, packet))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Release the stream in the shard: the engine goes back to the pool and
+    // cancels its timer in the shard loop
+    postWait(&reactor, producer, session->getShard(), releaseStream, session, NULL);
+    while (!released)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    reactor.stop();
+    delete session;                         // detaches the stream timers from the stopped loop
+    unlink(zidFile);
+
+    bool ok = secure && !failed && badPackets == 0 && received == numberOfPackets && sent == numberOfPackets;
+    fprintf(stderr, "%s: secure: %s, sent: %d, received: %d, bad: %d -> %s\n", name, secure ? "yes" : "no",
+            sent.load(), received.load(), badPackets.load(), ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc,char **argv) {
+    int fds[2];
+
+    usePool = argc > 1 && strcmp(argv[1], "-p") == 0;
+    fprintf(stderr, "Config info: %s\n", getZrtpBuildInfo());
+
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) < 0) {
+        perror("socketpair");
+        return 1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        sock = fds[1];
+        _exit(runSide("side B", "reactorTestB.zid", 0xbeefcafe));
+    }
+    close(fds[1]);
+    sock = fds[0];
+    int rc = runSide("side A", "reactorTestA.zid", 0xfeedbacc);
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        rc = 1;
+    close(sock);
+    fprintf(stderr, "reactor call: %s\n", rc == 0 ? "OK" : "FAILED");
+    return rc;
+}
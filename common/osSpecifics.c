@@ -74,3 +74,71 @@ uint16_t zrtpHtons (uint16_t host)
     return htons(host);
 }
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# include <cpuid.h>
+
+static void cpuid(uint32_t leaf, uint32_t regs[4])
+{
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+}
+
+static uint64_t xgetbv0()
+{
+    uint32_t eax, edx;
+    __asm__ volatile ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return ((uint64_t)edx << 32) | eax;
+}
+# define HAVE_CPUID
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+# include <intrin.h>
+
+static void cpuid(uint32_t leaf, uint32_t regs[4])
+{
+    __cpuidex((int*)regs, (int)leaf, 0);
+}
+
+static uint64_t xgetbv0()
+{
+    return _xgetbv(0);
+}
+# define HAVE_CPUID
+#endif
+
+uint32_t zrtpCpuFeatures()
+{
+    static volatile int32_t features = -1;
+
+    if (features >= 0)
+        return (uint32_t)features;
+
+    int32_t found = 0;
+#ifdef HAVE_CPUID
+    uint32_t regs[4];
+
+    cpuid(0, regs);
+    uint32_t maxLeaf = regs[0];
+
+    cpuid(1, regs);
+    if (regs[2] & (1u << 9))
+        found |= ZRTP_CPU_SSSE3;
+    if (regs[2] & (1u << 19))
+        found |= ZRTP_CPU_SSE41;
+    if (regs[2] & (1u << 20))
+        found |= ZRTP_CPU_SSE42;
+
+    // AVX needs the OS to save the YMM state (OSXSAVE and XCR0 bits 1 and 2)
+    int avxState = (regs[2] & (1u << 27)) && (regs[2] & (1u << 28)) && (xgetbv0() & 6) == 6;
+
+    if (maxLeaf >= 7) {
+        cpuid(7, regs);
+        if (regs[1] & (1u << 29))
+            found |= ZRTP_CPU_SHA;
+        if ((regs[1] & (1u << 5)) && avxState)
+            found |= ZRTP_CPU_AVX2;
+        if (regs[1] & (1u << 8))
+            found |= ZRTP_CPU_BMI2;
+    }
+#endif
+    features = found;
+    return (uint32_t)found;
+}
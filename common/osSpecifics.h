@@ -117,6 +117,24 @@ extern uint32_t zrtpHtonl (uint32_t host);
  */
 extern uint16_t zrtpHtons (uint16_t host);
 
+#define ZRTP_CPU_SSSE3      0x0001  /*!< SSSE3 */
+#define ZRTP_CPU_SSE41      0x0002  /*!< SSE 4.1 */
+#define ZRTP_CPU_SHA        0x0004  /*!< SHA extensions (SHA-NI) */
+#define ZRTP_CPU_AVX2       0x0008  /*!< AVX2, includes the check for OS support of the AVX state */
+#define ZRTP_CPU_BMI2       0x0010  /*!< BMI2 */
+#define ZRTP_CPU_SSE42      0x0020  /*!< SSE 4.2, provides the CRC32C instruction */
+
+/**
+ * Get the CPU features the crypto functions may use.
+ *
+ * The function checks the features once and returns the cached result on
+ * later calls. It returns 0 on other CPUs than x86 and x86_64 and for
+ * compilers that do not support the detection.
+ *
+ * @return a bit mask of the @c ZRTP_CPU_* flags.
+ */
+extern uint32_t zrtpCpuFeatures();
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DATA_CHUNKS_H
+#define DATA_CHUNKS_H
+
+/**
+ * @file DataChunks.h
+ * @brief Fixed size list of data chunks for the multi-chunk hash and MAC functions
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ * Maximum number of data chunks in one list.
+ *
+ * The largest list in ZRTP is the input of the S0 computation with 12 chunks.
+ * Adding more chunks to a list is a programming error, refer to
+ * DataChunks::add().
+ */
+#define MAX_DATA_CHUNKS 16
+
+/**
+ * @brief A list of data chunks that lives on the stack.
+ *
+ * The hash and MAC functions that process several data chunks take this list.
+ * Unlike a pair of @c std::vector it does not use the heap, thus computing a
+ * MAC over an SRTP packet and its ROC or a ZRTP key derivation does not
+ * allocate memory.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class DataChunks {
+public:
+    DataChunks(): count(0) {}
+
+    /**
+     * Initialize the list with one data chunk.
+     */
+    DataChunks(const uint8_t* data, uint64_t length): count(0) { add(data, length); }
+
+    /**
+     * Append a data chunk.
+     *
+     * The function aborts the program if the list is full. Dropping the
+     * chunk would silently hash or MAC a truncated message, and an assert
+     * does not catch this in builds with @c NDEBUG.
+     *
+     * @param data
+     *    Points to the data chunk. The functions skip @c nullptr chunks.
+     * @param length
+     *    Length of the data chunk in bytes
+     */
+    void add(const uint8_t* data, uint64_t length) {
+        if (count >= MAX_DATA_CHUNKS)
+            abort();
+        chunks[count] = data;
+        lengths[count] = length;
+        count++;
+    }
+
+    /// Remove all data chunks
+    void clear() { count = 0; }
+
+    /// Number of data chunks in the list
+    size_t size() const { return count; }
+
+    /// Pointer to data chunk @c i
+    const uint8_t* data(size_t i) const { return chunks[i]; }
+
+    /// Length of data chunk @c i in bytes
+    uint64_t length(size_t i) const { return lengths[i]; }
+
+private:
+    const uint8_t* chunks[MAX_DATA_CHUNKS];
+    uint64_t lengths[MAX_DATA_CHUNKS];
+    size_t count;
+};
+
+/**
+ * @}
+ */
+#endif
@@ -32,8 +32,7 @@ void macSkein(const uint8_t* key, uint64_t key_length,
 }
 
 void macSkein(const uint8_t* key, uint64_t key_length,
-              std::vector<const uint8_t*> data,
-              std::vector<uint64_t> dataLength,
+              const DataChunks& data,
               uint8_t* mac, size_t mac_length, SkeinSize_t skeinSize)
 {
     SkeinCtx_t ctx = {};
@@ -42,7 +41,7 @@ void macSkein(const uint8_t* key, uint64_t key_length,
 
     skeinMacInit(&ctx, key, key_length, mac_length);
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        skeinUpdate(&ctx, data[i], dataLength[i]);
+        skeinUpdate(&ctx, data.data(i), data.length(i));
     }
     skeinFinal(&ctx, mac);
 }
@@ -78,19 +77,42 @@ void macSkeinCtx(void* ctx, const uint8_t* data, uint64_t data_length, uint8_t*
 }
 
 void macSkeinCtx(void* ctx,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength,
+                 const DataChunks& data,
                  uint8_t* mac)
 {
     auto* pctx = (SkeinCtx_t*)ctx;
 
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        skeinUpdate(pctx, data[i], dataLength[i]);
+        skeinUpdate(pctx, data.data(i), data.length(i));
     }
     skeinFinal(pctx, mac);
     skeinReset(pctx);
 }
 
+void macSkeinCtxMulti(void* ctx, size_t count, const uint8_t* const* data,
+                      const uint64_t* dataLength, uint8_t* const* mac)
+{
+    auto* pctx = (SkeinCtx_t*)ctx;
+    const size_t batch = 16;
+
+    if (pctx->skeinSize != Skein512) {
+        for (size_t i = 0; i < count; i++) {
+            macSkeinCtx(ctx, data[i], dataLength[i], mac[i]);
+        }
+        return;
+    }
+    // Skein_512_Multi uses copies of the context, it stays in reset state
+    for (size_t i = 0; i < count; i += batch) {
+        size_t n = (count - i < batch) ? count - i : batch;
+        size_t length[batch];
+
+        for (size_t j = 0; j < n; j++) {
+            length[j] = (size_t)dataLength[i + j];
+        }
+        Skein_512_Multi(&pctx->m.s512, n, data + i, length, mac + i);
+    }
+}
+
 void freeSkeinMacContext(void* ctx)
 {
     if (ctx)
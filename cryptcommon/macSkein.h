@@ -19,7 +19,7 @@
 #define MAC_SKEIN_H
 
 #include <cryptcommon/skeinApi.h>
-#include <vector>
+#include <cryptcommon/DataChunks.h>
 /**
  * @file macSkein.h
  * @brief Function that provide Skein MAC support
@@ -65,10 +65,7 @@ void macSkein(const uint8_t* key, uint64_t keyLength,
  * @param keyLength
  *    Lneght of the MAC key in bytes
  * @param data
- *    A Vector of pointers that point to the data chunks. A NULL
- *    pointer in an array element terminates the data chunks.
- * @param dataLength
- *    A vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  * @param mac
  *    Points to a buffer that receives the computed digest.
  * @param macLength
@@ -77,8 +74,7 @@ void macSkein(const uint8_t* key, uint64_t keyLength,
  *    The Skein size to use.
  */
 void macSkein(const uint8_t* key, uint64_t keyLength,
-              std::vector<const uint8_t*> data,
-              std::vector<uint64_t> dataLength,
+              const DataChunks& data,
               uint8_t* mac, size_t macLength, SkeinSize_t skeinSize);
 
 /**
@@ -151,10 +147,30 @@ void macSkeinCtx(void* ctx, const uint8_t* data, uint64_t dataLength, uint8_t* m
  * @param mac
  *    Points to a buffer that receives the computed digest.
  */
-void macSkeinCtx(void* ctx, const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength,
+void macSkeinCtx(void* ctx, const DataChunks& data,
                  uint8_t* mac);
 
+/**
+ * Compute Skein MACs of several independent data buffers.
+ *
+ * Computes the same MACs as calling macSkeinCtx() for each buffer. For
+ * Skein 512 contexts the function processes four buffers in parallel if
+ * the CPU supports AVX2, this is useful for batches of short packets.
+ *
+ * @param ctx
+ *     Pointer to initialized Skein MAC context
+ * @param count
+ *    Number of data buffers.
+ * @param data
+ *    Array of @c count pointers to the data buffers.
+ * @param dataLength
+ *    Array of @c count integers that hold the length of each data buffer.
+ * @param mac
+ *    Array of @c count pointers to buffers that receive the computed digests.
+ */
+void macSkeinCtxMulti(void* ctx, size_t count, const uint8_t* const* data,
+                      const uint64_t* dataLength, uint8_t* const* mac);
+
 /**
  * Free Skein MAC context.
  *
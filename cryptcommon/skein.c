@@ -409,6 +409,103 @@ int Skein_512_Final(Skein_512_Ctxt_t *ctx, u08b_t *hashVal)
     return SKEIN_SUCCESS;
 }
 
+/*++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++*/
+/* hash several messages with copies of one context, four at a time */
+int Skein_512_Multi(const Skein_512_Ctxt_t *ctx, size_t count, const u08b_t *const msg[],
+                    const size_t msgByteCnt[], u08b_t *const hashVal[])
+{
+    enum { IDLE, BLOCK, LAST, OUTPUT };
+    Skein_512_Ctxt_t  lane[4];
+    Skein_512_Ctxt_t *lanePtr[4];
+    const u08b_t     *blkPtr[4];
+    const u08b_t     *data[4];
+    size_t byteCntAdd[4],left[4];
+    size_t i,j,n,byteCnt;
+    u08b_t last[4][SKEIN_512_BLOCK_BYTES];
+    int    step[4],active;
+
+    Skein_Assert(ctx->h.bCnt <= SKEIN_512_BLOCK_BYTES,SKEIN_FAIL);    /* catch uninitialized context */
+
+    byteCnt = (ctx->h.hashBitLen + 7) >> 3;
+    if (ctx->h.bCnt != 0 || byteCnt > SKEIN_512_BLOCK_BYTES)
+    {   /* buffered data or more than one output block: one by one */
+        for (i=0;i < count;i++)
+        {
+            lane[0] = *ctx;
+            Skein_512_Update(&lane[0],msg[i],msgByteCnt[i]);
+            Skein_512_Final(&lane[0],hashVal[i]);
+        }
+        return SKEIN_SUCCESS;
+    }
+
+    for (i=0;i < count;i+=4)
+    {
+        n = (count - i < 4) ? count - i : 4;
+        for (j=0;j < 4;j++)
+        {
+            lane[j]    = *ctx;
+            lanePtr[j] = &lane[j];
+            data[j]    = (j < n) ? msg[i+j] : NULL;
+            left[j]    = (j < n) ? msgByteCnt[i+j] : 0;
+            step[j]    = (j < n) ? BLOCK : IDLE;
+            memset(last[j],0,sizeof(last[j]));
+        }
+        /* Same order as Update/Final: keep the last (maybe full) block  */
+        /* for the final one, then run one output block in counter mode. */
+        /* Idle lanes run along on their own context, results are unused. */
+        do
+        {
+            active = 0;
+            for (j=0;j < 4;j++)
+            {
+                blkPtr[j] = last[j];
+                byteCntAdd[j] = 0;
+                if (step[j] == BLOCK && left[j] > SKEIN_512_BLOCK_BYTES)
+                {
+                    blkPtr[j] = data[j];
+                    byteCntAdd[j] = SKEIN_512_BLOCK_BYTES;
+                }
+                else if (step[j] == BLOCK)
+                {
+                    if (left[j])
+                        memcpy(last[j],data[j],left[j]);
+                    lane[j].h.T[1] |= SKEIN_T1_FLAG_FINAL;
+                    byteCntAdd[j] = left[j];
+                    step[j] = LAST;
+                }
+                else if (step[j] == LAST)
+                {
+                    memset(last[j],0,sizeof(last[j]));   /* counter block 0 */
+                    Skein_Start_New_Type(&lane[j],OUT_FINAL);
+                    byteCntAdd[j] = sizeof(u64b_t);
+                    step[j] = OUTPUT;
+                }
+                active |= step[j] != IDLE;
+            }
+            if (!active)
+                break;
+
+            Skein_512_Process_Block_x4(lanePtr,blkPtr,byteCntAdd);
+
+            for (j=0;j < 4;j++)
+            {
+                if (step[j] == BLOCK)
+                {
+                    data[j] += SKEIN_512_BLOCK_BYTES;
+                    left[j] -= SKEIN_512_BLOCK_BYTES;
+                }
+                else if (step[j] == OUTPUT)
+                {
+                    Skein_Put64_LSB_First(hashVal[i+j],lane[j].X,byteCnt);
+                    Skein_Show_Final(512,&lane[j].h,byteCnt,hashVal[i+j]);
+                    step[j] = IDLE;
+                }
+            }
+        } while (active);
+    }
+    return SKEIN_SUCCESS;
+}
+
 /*****************************************************************/
 /*    1024-bit Skein                                             */
 /*****************************************************************/
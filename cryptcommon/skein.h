@@ -102,6 +102,23 @@ int  Skein_256_Final (Skein_256_Ctxt_t *ctx, u08b_t * hashVal);
 int  Skein_512_Final (Skein_512_Ctxt_t *ctx, u08b_t * hashVal);
 int  Skein1024_Final (Skein1024_Ctxt_t *ctx, u08b_t * hashVal);
 
+/*
+**   Skein-512 API for many short messages, for example SRTP packets:
+**      Multi:  hash msg[i] with a copy of ctx into hashVal[i], leaves ctx
+**              unchanged. Four messages run in parallel if the CPU
+**              supports it, the results are identical to Update/Final.
+**      Use_Accel: select the vector block function (default) or the
+**              portable code if enable is 0, returns the previous setting.
+**      Impl:   name of the active block function, "avx2" or "c".
+*/
+int  Skein_512_Multi(const Skein_512_Ctxt_t *ctx, size_t count, const u08b_t *const msg[],
+                     const size_t msgByteCnt[], u08b_t *const hashVal[]);
+int  Skein_Use_Accel(int enable);
+const char *Skein_512_Impl(void);
+
+/* Process one block for each of four contexts */
+void Skein_512_Process_Block_x4(Skein_512_Ctxt_t *ctx[4], const u08b_t *blkPtr[4], const size_t byteCntAdd[4]);
+
 /*
 **   Skein APIs for "extended" initialization: MAC keys, tree hashing.
 **   After an InitExt() call, just use Update/Final calls as with Init().
@@ -16,6 +16,12 @@
 
 #include <string.h>
 #include <cryptcommon/skein.h>
+#include <cryptcommon/skein_block_x86.h>
+
+#if defined(SKEIN_X86)
+#include <stdint.h>
+#include <common/osSpecifics.h>
+#endif
 
 #ifndef SKEIN_USE_ASM
 #define SKEIN_USE_ASM   (0)                     /* default is all C code (no ASM) */
@@ -430,6 +436,56 @@ uint_t Skein_512_Unroll_Cnt(void)
 #endif
 #endif
 
+/*****************************  Skein_512 x4 ***************************/
+#if defined(SKEIN_X86)
+static void (*process_512_x4)(Skein_512_Ctxt_t *ctx[4], const u08b_t *blkPtr[4], const size_t byteCntAdd[4]) = 0;
+
+__attribute__((constructor))
+static void Skein_Select(void)
+    {
+    Skein_Use_Accel(1);
+    }
+#endif
+
+int Skein_Use_Accel(int enable)
+    {
+#if defined(SKEIN_X86)
+    int previous = process_512_x4 != 0;
+
+    process_512_x4 = 0;
+    if (enable && (zrtpCpuFeatures() & ZRTP_CPU_AVX2))
+        process_512_x4 = Skein_512_Process_Block_AVX2_x4;
+    return previous;
+#else
+    (void)enable;
+    return 0;
+#endif
+    }
+
+const char *Skein_512_Impl(void)
+    {
+#if defined(SKEIN_X86)
+    if (process_512_x4)
+        return "avx2";
+#endif
+    return "c";
+    }
+
+void Skein_512_Process_Block_x4(Skein_512_Ctxt_t *ctx[4],const u08b_t *blkPtr[4],const size_t byteCntAdd[4])
+    {
+    size_t i;
+
+#if defined(SKEIN_X86)
+    if (process_512_x4)
+        {
+        process_512_x4(ctx,blkPtr,byteCntAdd);
+        return;
+        }
+#endif
+    for (i=0;i<4;i++)
+        Skein_512_Process_Block(ctx[i],blkPtr[i],1,byteCntAdd[i]);
+    }
+
 /*****************************  Skein1024 ******************************/
 #if !(SKEIN_USE_ASM & 1024)
 void Skein1024_Process_Block(Skein1024_Ctxt_t *ctx,const u08b_t *blkPtr,size_t blkCnt,size_t byteCntAdd)
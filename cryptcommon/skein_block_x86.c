@@ -0,0 +1,137 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Threefish-512 block function for AVX2 that processes four blocks at once.
+ *
+ * The function uses a target attribute, thus the file compiles without
+ * special compiler flags. skein_block.c calls it only if
+ * zrtpCpuFeatures() reports AVX2.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include "skein_block_x86.h"
+
+#if defined(SKEIN_X86)
+
+#include <immintrin.h>
+
+/*
+ * Four contexts: vector Xn holds the state word n of all four contexts.
+ * The rounds have the same structure as the portable code, each MIX
+ * function processes four blocks. A single block does not gain from
+ * AVX2: the four MIX functions of a round fit into one vector, but the
+ * lane permutations between the rounds make it slower than the portable
+ * code.
+ */
+#define ROTL_IMM(x, n)  _mm256_or_si256(_mm256_slli_epi64((x), (n)), _mm256_srli_epi64((x), 64 - (n)))
+
+#define MIX4(p0, p1, ROT)                                                               \
+    X##p0 = _mm256_add_epi64(X##p0, X##p1);                                             \
+    X##p1 = _mm256_xor_si256(ROTL_IMM(X##p1, ROT), X##p0)
+
+#define ROUND4(p0, p1, p2, p3, p4, p5, p6, p7, R)                                       \
+    MIX4(p0, p1, R##_0); MIX4(p2, p3, R##_1); MIX4(p4, p5, R##_2); MIX4(p6, p7, R##_3)
+
+#define INJECT4(s)                                                                      \
+    X0 = _mm256_add_epi64(X0, k[((s) + 0) % 9]);                                        \
+    X1 = _mm256_add_epi64(X1, k[((s) + 1) % 9]);                                        \
+    X2 = _mm256_add_epi64(X2, k[((s) + 2) % 9]);                                        \
+    X3 = _mm256_add_epi64(X3, k[((s) + 3) % 9]);                                        \
+    X4 = _mm256_add_epi64(X4, k[((s) + 4) % 9]);                                        \
+    X5 = _mm256_add_epi64(X5, _mm256_add_epi64(k[((s) + 5) % 9], t[(s) % 3]));          \
+    X6 = _mm256_add_epi64(X6, _mm256_add_epi64(k[((s) + 6) % 9], t[((s) + 1) % 3]));    \
+    X7 = _mm256_add_epi64(X7, _mm256_add_epi64(k[((s) + 7) % 9], _mm256_set1_epi64x(s)))
+
+#define EIGHT_ROUNDS4(s)                                                                \
+    ROUND4(0, 1, 2, 3, 4, 5, 6, 7, R_512_0);                                            \
+    ROUND4(2, 1, 4, 7, 6, 5, 0, 3, R_512_1);                                            \
+    ROUND4(4, 1, 6, 3, 0, 5, 2, 7, R_512_2);                                            \
+    ROUND4(6, 1, 0, 7, 2, 5, 4, 3, R_512_3);                                            \
+    INJECT4(s);                                                                         \
+    ROUND4(0, 1, 2, 3, 4, 5, 6, 7, R_512_4);                                            \
+    ROUND4(2, 1, 4, 7, 6, 5, 0, 3, R_512_5);                                            \
+    ROUND4(4, 1, 6, 3, 0, 5, 2, 7, R_512_6);                                            \
+    ROUND4(6, 1, 0, 7, 2, 5, 4, 3, R_512_7);                                            \
+    INJECT4((s) + 1)
+
+/* Transpose four rows of four words, row i becomes lane i of the results */
+#define TRANSPOSE4(r0, r1, r2, r3, c0, c1, c2, c3) {                                    \
+    __m256i t0 = _mm256_unpacklo_epi64(r0, r1), t1 = _mm256_unpackhi_epi64(r0, r1);     \
+    __m256i t2 = _mm256_unpacklo_epi64(r2, r3), t3 = _mm256_unpackhi_epi64(r2, r3);     \
+    c0 = _mm256_permute2x128_si256(t0, t2, 0x20);                                       \
+    c1 = _mm256_permute2x128_si256(t1, t3, 0x20);                                       \
+    c2 = _mm256_permute2x128_si256(t0, t2, 0x31);                                       \
+    c3 = _mm256_permute2x128_si256(t1, t3, 0x31); }
+
+#define LOAD4(p, off, c0, c1, c2, c3)                                                   \
+    TRANSPOSE4(_mm256_loadu_si256((const __m256i *)((p)[0] + (off))),                   \
+               _mm256_loadu_si256((const __m256i *)((p)[1] + (off))),                   \
+               _mm256_loadu_si256((const __m256i *)((p)[2] + (off))),                   \
+               _mm256_loadu_si256((const __m256i *)((p)[3] + (off))), c0, c1, c2, c3)
+
+__attribute__((target("avx2")))
+void Skein_512_Process_Block_AVX2_x4(Skein_512_Ctxt_t *ctx[4], const u08b_t *blkPtr[4], const size_t byteCntAdd[4])
+{
+    __m256i X0, X1, X2, X3, X4, X5, X6, X7;
+    __m256i W0, W1, W2, W3, W4, W5, W6, W7;
+    __m256i k[9], t[3];
+    const u08b_t *state[4];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        ctx[i]->h.T[0] += byteCntAdd[i];
+        state[i] = (const u08b_t *)ctx[i]->X;
+    }
+    t[0] = _mm256_set_epi64x(ctx[3]->h.T[0], ctx[2]->h.T[0], ctx[1]->h.T[0], ctx[0]->h.T[0]);
+    t[1] = _mm256_set_epi64x(ctx[3]->h.T[1], ctx[2]->h.T[1], ctx[1]->h.T[1], ctx[0]->h.T[1]);
+    t[2] = _mm256_xor_si256(t[0], t[1]);
+
+    LOAD4(state, 0, k[0], k[1], k[2], k[3]);
+    LOAD4(state, 32, k[4], k[5], k[6], k[7]);
+    k[8] = _mm256_set1_epi64x(SKEIN_KS_PARITY);
+    for (i = 0; i < 8; i++)
+        k[8] = _mm256_xor_si256(k[8], k[i]);
+
+    LOAD4(blkPtr, 0, W0, W1, W2, W3);
+    LOAD4(blkPtr, 32, W4, W5, W6, W7);
+    X0 = W0; X1 = W1; X2 = W2; X3 = W3;
+    X4 = W4; X5 = W5; X6 = W6; X7 = W7;
+    INJECT4(0);
+
+    EIGHT_ROUNDS4(1);  EIGHT_ROUNDS4(3);  EIGHT_ROUNDS4(5);
+    EIGHT_ROUNDS4(7);  EIGHT_ROUNDS4(9);  EIGHT_ROUNDS4(11);
+    EIGHT_ROUNDS4(13); EIGHT_ROUNDS4(15); EIGHT_ROUNDS4(17);
+
+    X0 = _mm256_xor_si256(X0, W0); X1 = _mm256_xor_si256(X1, W1);
+    X2 = _mm256_xor_si256(X2, W2); X3 = _mm256_xor_si256(X3, W3);
+    X4 = _mm256_xor_si256(X4, W4); X5 = _mm256_xor_si256(X5, W5);
+    X6 = _mm256_xor_si256(X6, W6); X7 = _mm256_xor_si256(X7, W7);
+
+    /* transposing is its own inverse: lane i of the words becomes row i */
+    TRANSPOSE4(X0, X1, X2, X3, W0, W1, W2, W3);
+    TRANSPOSE4(X4, X5, X6, X7, W4, W5, W6, W7);
+    _mm256_storeu_si256((__m256i *)&ctx[0]->X[0], W0); _mm256_storeu_si256((__m256i *)&ctx[0]->X[4], W4);
+    _mm256_storeu_si256((__m256i *)&ctx[1]->X[0], W1); _mm256_storeu_si256((__m256i *)&ctx[1]->X[4], W5);
+    _mm256_storeu_si256((__m256i *)&ctx[2]->X[0], W2); _mm256_storeu_si256((__m256i *)&ctx[2]->X[4], W6);
+    _mm256_storeu_si256((__m256i *)&ctx[3]->X[0], W3); _mm256_storeu_si256((__m256i *)&ctx[3]->X[4], W7);
+
+    for (i = 0; i < 4; i++)
+        ctx[i]->h.T[1] &= ~SKEIN_T1_FLAG_FIRST;
+}
+
+#endif
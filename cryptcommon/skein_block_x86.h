@@ -0,0 +1,53 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SKEIN_BLOCK_X86_H_
+#define _SKEIN_BLOCK_X86_H_
+
+/**
+ * @file skein_block_x86.h
+ * @brief Threefish-512 block function for AVX2
+ *
+ * The function is internal to skein_block.c which selects it at runtime
+ * if the CPU supports AVX2. It has the semantics of four calls of the
+ * portable Skein_512_Process_Block with one block each.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cryptcommon/skein.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SKEIN_X86
+#endif
+
+#if defined(SKEIN_X86)
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/** One block for each of four contexts, one context per vector lane */
+void Skein_512_Process_Block_AVX2_x4(Skein_512_Ctxt_t *ctx[4], const u08b_t *blkPtr[4], const size_t byteCntAdd[4]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
+
+#endif
@@ -909,6 +909,80 @@ static int test_odd_sized_keys()
     } 
  
  
+/* 
+ * Check one CTR mode result against the block encryption. 
+ */ 
+static int check_ctr( Twofish_key * xkey, Twofish_Byte iv[16], 
+                      Twofish_Byte in[], Twofish_Byte out[], int len ) 
+    { 
+    Twofish_Byte ctr_iv[16], tmp[16]; 
+    int i; 
+ 
+    memcpy( ctr_iv, iv, 16 ); 
+    for( i=0; i<len; i++ ) 
+        { 
+        if( (i & 15) == 0 ) 
+            { 
+            ctr_iv[14] = (Twofish_Byte)((i/16) >> 8); 
+            ctr_iv[15] = (Twofish_Byte)(i/16); 
+            Twofish_encrypt( xkey, ctr_iv, tmp ); 
+            } 
+        if( out[i] != (in[i] ^ tmp[i & 15]) ) 
+            { 
+	      Twofish_fatal( "Twofish CTR failure", ERR_TEST_CTR ); 
+            } 
+        } 
+    return SUCCESS; 
+    } 
+ 
+ 
+/* 
+ * Test the CTR mode. 
+ * 
+ * There are no published Twofish CTR test vectors. The single block 
+ * encryption passed the test vectors above, so we check the CTR mode 
+ * against it: all lengths up to five blocks with separate and with 
+ * in-place buffers, and a long run where the counter uses both bytes. 
+ */ 
+static int test_ctr() 
+    { 
+    Twofish_Byte key[32]; 
+    Twofish_Byte iv[16]; 
+    Twofish_Byte in[260*16], out[260*16]; 
+    Twofish_key xkey; 
+    int i, len, ret; 
+ 
+    for( i=0; i<32; i++ ) 
+        key[i] = (Twofish_Byte)(3*i + 1); 
+    for( i=0; i<16; i++ ) 
+        iv[i] = (Twofish_Byte)(0xa5 ^ (7*i)); 
+    for( i=0; i<(int)sizeof( in ); i++ ) 
+        in[i] = (Twofish_Byte)(5*i + 11); 
+ 
+    if ((ret = Twofish_prepare_key( key, 32, &xkey)) < 0)
+      return ret; 
+ 
+    for( len=0; len<=5*16; len++ ) 
+        { 
+        Twofish_ctr_encrypt( &xkey, iv, in, out, len ); 
+        if ((ret = check_ctr( &xkey, iv, in, out, len )) < 0)
+          return ret; 
+ 
+        memcpy( out, in, len ); 
+        Twofish_ctr_encrypt( &xkey, iv, out, out, len ); 
+        if ((ret = check_ctr( &xkey, iv, in, out, len )) < 0)
+          return ret; 
+        } 
+ 
+    Twofish_ctr_encrypt( &xkey, iv, in, out, sizeof( in ) - 5 ); 
+    if ((ret = check_ctr( &xkey, iv, in, out, sizeof( in ) - 5 )) < 0)
+      return ret; 
+ 
+    /* The test key is not secret, so we don't need to wipe xkey. */
+    return SUCCESS;
+    } 
+ 
+ 
 /* 
  * Test the Twofish implementation. 
  * 
@@ -939,6 +1013,10 @@ static int self_test()
     /* Test the odd-sized keys. */ 
       if ((ret = test_odd_sized_keys()) < 0)
 	return ret;
+
+    /* Test the CTR mode against the block encryption. */ 
+      if ((ret = test_ctr()) < 0)
+	return ret;
       return SUCCESS;
     } 
  
@@ -1747,4 +1825,120 @@ void Twofish_decrypt( Twofish_key * xkey, Twofish_Byte c[16], Twofish_Byte p[16]
  * with Twofish. 
  */ 
 
+/* 
+ * CTR mode as SRTP (RFC 3711) uses it: block i of the key stream is the 
+ * encrypted iv with the 16 bit counter i, most significant byte first, in 
+ * the last two bytes. 
+ * 
+ * Only the last word of the input depends on the counter. Thus the first 
+ * round's g() functions and the new C are the same for all blocks and we 
+ * compute them once. The remaining 15 rounds run on two blocks at a time, 
+ * the two independent table lookup chains keep more execution units busy 
+ * than a single one. 
+ */ 
+ 
+/* The last input word with the counter in the last two bytes */ 
+#define CTR_WORD( D, ctr ) \
+    ((D) | ((Twofish_UInt32)((ctr) >> 8) & 0xff) << 16 | ((Twofish_UInt32)(ctr) & 0xff) << 24) 
+ 
+/* The last word after the first round, X is the shared part of the round */ 
+#define CTR_FIRST_RND( D, ctr, xkey ) \
+    D = CTR_WORD( D0, ctr ) ^ xkey->K[3]; D = ROL32(D,1); D ^= X 
+ 
+/* 
+ * Like PUT_OUTPUT, but xors the output with the four words at src. Reads 
+ * all of src before it writes dst, thus src and dst may be the same. 
+ */ 
+#define XOR_PUT_OUTPUT( A,B,C,D, src, dst, xkey, koff ) \
+    A ^= xkey->K[  koff] ^ GET32(src   ); B ^= xkey->K[1+koff] ^ GET32(src+ 4); \
+    C ^= xkey->K[2+koff] ^ GET32(src+ 8); D ^= xkey->K[3+koff] ^ GET32(src+12); \
+    PUT32( A, dst   ); PUT32( B, dst+ 4 ); \
+    PUT32( C, dst+8 ); PUT32( D, dst+12 ) 
+ 
+/* Rounds of two blocks, each has its own state and temporaries */ 
+#define ENCRYPT_RND2( A,B,C,D, E,F,G,H, xkey, r ) \
+    ENCRYPT_RND( A,B,C,D,T0,T1,xkey,r ); \
+    ENCRYPT_RND( E,F,G,H,T2,T3,xkey,r ) 
+ 
+#define ENCRYPT_CYCLE2( A,B,C,D, E,F,G,H, xkey, r ) \
+    ENCRYPT_RND2( A,B,C,D,E,F,G,H,xkey,2*(r)   ); \
+    ENCRYPT_RND2( C,D,A,B,G,H,E,F,xkey,2*(r)+1 ) 
+ 
+/* Rounds 1 to 15, round 0 is done by CTR_FIRST_RND */ 
+#define ENCRYPT_CTR( A,B,C,D,T0,T1,xkey ) \
+    ENCRYPT_RND( C,D,A,B,T0,T1,xkey,1 ); \
+    ENCRYPT_CYCLE( A,B,C,D,T0,T1,xkey, 1 ); \
+    ENCRYPT_CYCLE( A,B,C,D,T0,T1,xkey, 2 ); \
+    ENCRYPT_CYCLE( A,B,C,D,T0,T1,xkey, 3 ); \
+    ENCRYPT_CYCLE( A,B,C,D,T0,T1,xkey, 4 ); \
+    ENCRYPT_CYCLE( A,B,C,D,T0,T1,xkey, 5 ); \
+    ENCRYPT_CYCLE( A,B,C,D,T0,T1,xkey, 6 ); \
+    ENCRYPT_CYCLE( A,B,C,D,T0,T1,xkey, 7 ) 
+ 
+#define ENCRYPT_CTR2( A,B,C,D, E,F,G,H, xkey ) \
+    ENCRYPT_RND2( C,D,A,B,G,H,E,F,xkey,1 ); \
+    ENCRYPT_CYCLE2( A,B,C,D,E,F,G,H,xkey, 1 ); \
+    ENCRYPT_CYCLE2( A,B,C,D,E,F,G,H,xkey, 2 ); \
+    ENCRYPT_CYCLE2( A,B,C,D,E,F,G,H,xkey, 3 ); \
+    ENCRYPT_CYCLE2( A,B,C,D,E,F,G,H,xkey, 4 ); \
+    ENCRYPT_CYCLE2( A,B,C,D,E,F,G,H,xkey, 5 ); \
+    ENCRYPT_CYCLE2( A,B,C,D,E,F,G,H,xkey, 6 ); \
+    ENCRYPT_CYCLE2( A,B,C,D,E,F,G,H,xkey, 7 ) 
+ 
+/* 
+ * Twofish CTR mode encryption and decryption 
+ * 
+ * Arguments: 
+ * xkey         expanded key array 
+ * iv           16 bytes initial counter block, the function ignores the 
+ *              last two bytes and does not modify it 
+ * in           len bytes of input 
+ * out          len bytes of output, may be the same as in 
+ * len          number of bytes 
+ */ 
+void Twofish_ctr_encrypt( Twofish_key * xkey, const Twofish_Byte iv[16], 
+                          const Twofish_Byte * in, Twofish_Byte * out, size_t len ) 
+    { 
+    Twofish_UInt32 A,B,C,D,T0,T1;       /* Working variables, first block */ 
+    Twofish_UInt32 E,F,G,H,T2,T3;       /* Working variables, second block */ 
+    Twofish_UInt32 A0,B0,C0,D0,X;       /* State shared by all blocks */ 
+    Twofish_Byte tmp[16]; 
+    unsigned int ctr = 0; 
+    size_t i; 
+ 
+    /* The first round up to the counter dependent last word */ 
+    A0 = GET32(iv   )^xkey->K[0]; B0 = GET32(iv+ 4)^xkey->K[1]; 
+    C0 = GET32(iv+ 8)^xkey->K[2]; D0 = GET32(iv+12) & 0xffff; 
+    T0 = g0(A0,xkey); T1 = g1(B0,xkey); 
+    C0 ^= T0+T1+xkey->K[8]; C0 = ROR32(C0,1); 
+    X = T0+2*T1+xkey->K[9]; 
+ 
+    for( ; len >= 32; len -= 32, in += 32, out += 32, ctr += 2 ) 
+        { 
+        A = E = A0; B = F = B0; C = G = C0; 
+        CTR_FIRST_RND( D, ctr, xkey ); 
+        CTR_FIRST_RND( H, ctr+1, xkey ); 
+        ENCRYPT_CTR2( A,B,C,D,E,F,G,H,xkey ); 
+        XOR_PUT_OUTPUT( C,D,A,B, in, out, xkey, 4 ); 
+        XOR_PUT_OUTPUT( G,H,E,F, in+16, out+16, xkey, 4 ); 
+        } 
+ 
+    for( ; len > 0; ctr++ ) 
+        { 
+        A = A0; B = B0; C = C0; 
+        CTR_FIRST_RND( D, ctr, xkey ); 
+        ENCRYPT_CTR( A,B,C,D,T0,T1,xkey ); 
+        if( len >= 16 ) 
+            { 
+            XOR_PUT_OUTPUT( C,D,A,B, in, out, xkey, 4 ); 
+            len -= 16; in += 16; out += 16; 
+            continue; 
+            } 
+        PUT_OUTPUT( C,D,A,B, tmp, xkey, 4 ); 
+        for( i=0; i<len; i++ ) 
+            out[i] = in[i] ^ tmp[i]; 
+        len = 0; 
+        } 
+    } 
+
 
@@ -26,6 +26,8 @@
 #ifndef TWOFISH_H
 #define TWOFISH_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -84,6 +86,7 @@ typedef unsigned int    Twofish_UInt32;
 #define ERR_INIT       -14
 #define ERR_KEY_LEN    -15
 #define ERR_ILL_ARG    -16
+#define ERR_TEST_CTR   -17
 
 
 /**
@@ -213,7 +216,30 @@ extern void Twofish_decrypt(
                             Twofish_key * xkey,
                             Twofish_Byte c[16],
                             Twofish_Byte p[16]
-                            ); 
+                            );
+
+
+/**
+ * Encrypt or decrypt data in counter (CTR) mode.
+ * The key stream block i is the encrypted @c iv with the 16 bit counter i
+ * in the last two bytes, most significant byte first, as SRTP (RFC 3711)
+ * defines it. The function processes two blocks at a time and xors the
+ * key stream word by word.
+ * @param xkey     pointer to Twofish_key, internal form of the key
+ *                 produces by Twofish_prepare_key()
+ * @param iv       The initial counter block, the function ignores its last two
+ *                 bytes and does not modify it
+ * @param in       Data to encrypt or decrypt
+ * @param out      Place to store the result, may be the same as @c in
+ * @param len      Number of bytes to process, at most 65536 * 16
+ */
+extern void Twofish_ctr_encrypt(
+                                Twofish_key * xkey,
+                                const Twofish_Byte iv[16],
+                                const Twofish_Byte * in,
+                                Twofish_Byte * out,
+                                size_t len
+                                ); 
 
 
 /**
@@ -226,23 +226,18 @@ void CryptoContext::srtpAuthenticate(uint8_t* pkt, uint32_t pktlen, uint32_t roc
     }
     uint32_t macL;
 
-    unsigned char temp[20];
+    unsigned char temp[SHA256_DIGEST_SIZE];
 
-    std::vector<const uint8_t*>chunks;
-    std::vector<uint64_t> chunkLength;
+    DataChunks chunks;
     uint32_t beRoc = zrtpHtonl(roc);
 
-    chunks.push_back(pkt);
-    chunkLength.push_back(pktlen);
-
-    chunks.push_back((unsigned char *)&beRoc);
-    chunkLength.push_back(4);
+    chunks.add(pkt, pktlen);
+    chunks.add((unsigned char *)&beRoc, 4);
 
     switch (aalg) {
     case SrtpAuthenticationSha1Hmac:
         hmacSha1Ctx(macCtx,
                     chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
                     temp, &macL);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
@@ -250,7 +245,6 @@ void CryptoContext::srtpAuthenticate(uint8_t* pkt, uint32_t pktlen, uint32_t roc
     case SrtpAuthenticationSkeinHmac:
         macSkeinCtx(macCtx,
                     chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
                     temp);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
@@ -258,7 +252,6 @@ void CryptoContext::srtpAuthenticate(uint8_t* pkt, uint32_t pktlen, uint32_t roc
     case SrtpAuthenticationSha256Hmac:
         hmacSha256Ctx(macCtx,
                       chunks,           // data chunks to hash
-                      chunkLength,      // length of the data to hash
                       temp, &macL);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
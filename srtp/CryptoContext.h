@@ -47,6 +47,7 @@ const int SrtpEncryptionTWOF8 = 4;
 #include "crypto/hmac.h"
 #include "cryptcommon/macSkein.h"
 #include "zrtp/crypto/hmac256.h"
+#include "srtp/SrtpMetrics.h"
 
 class SrtpSymCrypto;
 
@@ -419,6 +420,13 @@ public:
      */
     CryptoContext* newCryptoContextForSSRC(uint32_t ssrc, int roc, int64_t keyDerivRate);
 
+    /**
+     * @brief Get the packet counters and cycle histograms of this context.
+     *
+     * @see SrtpMetrics
+     */
+    SrtpMetrics& getMetrics() { return metrics; }
+
 private:
     typedef union _hmacCtx {
         SkeinCtx_t       hmacSkeinCtx;
@@ -470,6 +478,8 @@ private:
 
     SrtpSymCrypto* cipher;
     SrtpSymCrypto* f8Cipher;
+
+    SrtpMetrics metrics;
 };
 
 #endif
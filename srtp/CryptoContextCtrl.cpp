@@ -29,6 +29,8 @@
 
 #include "srtp/crypto/SrtpSymCrypto.h"
 
+/* The SRTCP replay bitmask has 64 bits, REPLAY_WINDOW_SIZE sizes the SRTP one */
+#define SRTCP_REPLAY_WINDOW_SIZE 64
 
 CryptoContextCtrl::CryptoContextCtrl(uint32_t ssrc,
                                 const int32_t ealg,
@@ -41,7 +43,7 @@ CryptoContextCtrl::CryptoContextCtrl(uint32_t ssrc,
                                 int32_t akeyl,
                                 int32_t skeyl,
                                 int32_t tagLength):
-ssrcCtx(ssrc), mkiLength(0),mki(NULL), replay_window(0), srtcpIndex(0),
+ssrcCtx(ssrc), mkiLength(0),mki(NULL), s_l(0), replay_window(0), srtcpIndex(0),
 labelBase(3), macCtx(NULL), cipher(NULL), f8Cipher(NULL)        // SRTCP labels start at 3
 
 {
@@ -99,6 +101,7 @@ labelBase(3), macCtx(NULL), cipher(NULL), f8Cipher(NULL)        // SRTCP labels
 
         case SrtpAuthenticationSha1Hmac:
         case SrtpAuthenticationSkeinHmac:
+        case SrtpAuthenticationSha256Hmac:
             n_a = akeyl;
             k_a = new uint8_t[n_a];
             this->tagLength = tagLength;
@@ -238,22 +241,17 @@ void CryptoContextCtrl::srtcpAuthenticate(uint8_t* rtp, int32_t len, uint32_t in
     }
     uint32_t macL;
 
-    unsigned char temp[20];
-    std::vector<const uint8_t*>chunks;
-    std::vector<uint64_t> chunkLength;
+    unsigned char temp[SHA256_DIGEST_SIZE];
+    DataChunks chunks;
     uint32_t beIndex = zrtpHtonl(index);
 
-    chunks.push_back(rtp);
-    chunkLength.push_back(len);
-
-    chunks.push_back((unsigned char *)&beIndex);
-    chunkLength.push_back(4);
+    chunks.add(rtp, len);
+    chunks.add((unsigned char *)&beIndex, 4);
 
     switch (aalg) {
     case SrtpAuthenticationSha1Hmac:
         hmacSha1Ctx(macCtx,
                     chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
                     temp, &macL);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
@@ -261,7 +259,6 @@ void CryptoContextCtrl::srtcpAuthenticate(uint8_t* rtp, int32_t len, uint32_t in
     case SrtpAuthenticationSkeinHmac:
         macSkeinCtx(macCtx,
                     chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
                     temp);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
@@ -269,7 +266,6 @@ void CryptoContextCtrl::srtcpAuthenticate(uint8_t* rtp, int32_t len, uint32_t in
     case SrtpAuthenticationSha256Hmac:
         hmacSha256Ctx(macCtx,
                       chunks,           // data chunks to hash
-                      chunkLength,      // length of the data to hash
                       temp, &macL);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
@@ -353,13 +349,13 @@ bool CryptoContextCtrl::checkReplay( uint32_t index )
         return true;
     }
 
-    int64_t delta = index - s_l;
+    int64_t delta = static_cast<int64_t>(index) - s_l;
     if (delta > 0) {
         /* Packet not yet received*/
         return true;
     }
     else {
-        if( -delta >= REPLAY_WINDOW_SIZE ) {
+        if( -delta >= SRTCP_REPLAY_WINDOW_SIZE ) {
             return false;       /* Packet too old */
         }
         else {
@@ -375,11 +371,11 @@ bool CryptoContextCtrl::checkReplay( uint32_t index )
 
 void CryptoContextCtrl::update(uint32_t index)
 {
-    int64_t delta = index - s_l;
+    int64_t delta = static_cast<int64_t>(index) - s_l;
 
     /* update the replay bitmask */
     if( delta > 0 ){
-        replay_window = replay_window << delta;
+        replay_window = (delta < SRTCP_REPLAY_WINDOW_SIZE) ? replay_window << delta : 0;
         replay_window |= 1;
     }
     else {
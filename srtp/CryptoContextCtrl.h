@@ -28,6 +28,7 @@
 #include "crypto/hmac.h"
 #include "cryptcommon/macSkein.h"
 #include "zrtp/crypto/hmac256.h"
+#include "srtp/SrtpMetrics.h"
 
 class SrtpSymCrypto;
 
@@ -296,6 +297,13 @@ class CryptoContextCtrl {
      */
     CryptoContextCtrl* newCryptoContextForSSRC(uint32_t ssrc);
 
+    /**
+     * @brief Get the packet counters and cycle histograms of this context.
+     *
+     * @see SrtpMetrics
+     */
+    SrtpMetrics& getMetrics() { return metrics; }
+
     private:
 
         typedef union _hmacCtx {
@@ -340,6 +348,8 @@ class CryptoContextCtrl {
 
         SrtpSymCrypto* cipher;
         SrtpSymCrypto* f8Cipher;
+
+        SrtpMetrics metrics;
     };
 
 /**
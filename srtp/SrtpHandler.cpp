@@ -98,8 +98,13 @@ bool SrtpHandler::protect(CryptoContext* pcc, uint8_t* buffer, size_t length, si
     if (pcc == NULL) {
         return false;
     }
-    if (!decodeRtp(buffer, length, &ssrc, &seqnum, &payload, &payloadlen))
+    SrtpMetrics& metrics = pcc->getMetrics();
+    uint64_t sample = metrics.startSample();
+
+    if (!decodeRtp(buffer, length, &ssrc, &seqnum, &payload, &payloadlen)) {
+        metrics.add(SrtpMetrics::DecodeErrors, 1);
         return false;
+    }
 
     /* Encrypt the packet */
     uint64_t index = ((uint64_t)pcc->getRoc() << 16) | (uint64_t)seqnum;
@@ -118,7 +123,11 @@ bool SrtpHandler::protect(CryptoContext* pcc, uint8_t* buffer, size_t length, si
     /* Update the ROC if necessary */
     if (seqnum == 0xFFFF ) {
         pcc->setRoc(pcc->getRoc() + 1);
+        metrics.add(SrtpMetrics::RocRollovers, 1);
     }
+    metrics.add(SrtpMetrics::ProtectedPackets, 1);
+    metrics.add(SrtpMetrics::ProtectedBytes, length);
+    metrics.endSample(SrtpMetrics::ProtectCycles, sample);
     return true;
 }
 
@@ -132,10 +141,14 @@ int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t lengt
     if (pcc == NULL) {
         return 0;
     }
+    SrtpMetrics& metrics = pcc->getMetrics();
+    uint64_t sample = metrics.startSample();
+    size_t srtpLength = length;
 
     if (!decodeRtp(buffer, length, &ssrc, &seqnum, &payload, &payloadlen)) {
         if (errorData != NULL)
             fillErrorData(errorData, DecodeError, buffer, length, 0);
+        metrics.add(SrtpMetrics::DecodeErrors, 1);
         return 0;
     }
     /*
@@ -169,6 +182,7 @@ int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t lengt
     if (!pcc->checkReplay(seqnum)) {
         if (errorData != NULL)
             fillErrorData(errorData, ReplayError, buffer, length, guessedIndex);
+        metrics.add(SrtpMetrics::ReplayDrops, 1);
         return -2;
     }
 
@@ -180,6 +194,7 @@ int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t lengt
         if (memcmp(tag, mac, pcc->getTagLength()) != 0) {
             if (errorData != NULL)
                 fillErrorData(errorData, AuthError, buffer, length, guessedIndex);
+            metrics.add(SrtpMetrics::AuthFailures, 1);
             return -1;
         }
     }
@@ -187,8 +202,16 @@ int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t lengt
     pcc->srtpEncrypt(buffer, payload, payloadlen, guessedIndex, ssrc);
 
     /* Update the Crypto-context */
+    uint32_t roc = pcc->getRoc();
+    if ((guessedIndex >> 16) != roc)
+        metrics.add(SrtpMetrics::IndexGuessCorrections, 1);
     pcc->update(seqnum);
+    if (pcc->getRoc() != roc)
+        metrics.add(SrtpMetrics::RocRollovers, 1);
 
+    metrics.add(SrtpMetrics::UnprotectedPackets, 1);
+    metrics.add(SrtpMetrics::UnprotectedBytes, srtpLength);
+    metrics.endSample(SrtpMetrics::UnprotectCycles, sample);
     return 1;
 }
 
@@ -199,6 +222,9 @@ bool SrtpHandler::protectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size_t le
     if (pcc == NULL) {
         return false;
     }
+    SrtpMetrics& metrics = pcc->getMetrics();
+    uint64_t sample = metrics.startSample();
+
     /* Encrypt the packet */
     uint32_t ssrc = *(reinterpret_cast<uint32_t*>(buffer + 4)); // always SSRC of sender
     ssrc = zrtpNtohl(ssrc);
@@ -223,6 +249,9 @@ bool SrtpHandler::protectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size_t le
     pcc->setSrtcpIndex(encIndex);
     *newLength = length + pcc->getTagLength() + sizeof(uint32_t);
 
+    metrics.add(SrtpMetrics::ProtectedPackets, 1);
+    metrics.add(SrtpMetrics::ProtectedBytes, length);
+    metrics.endSample(SrtpMetrics::ProtectCycles, sample);
     return true;
 }
 
@@ -232,6 +261,8 @@ int32_t SrtpHandler::unprotectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size
     if (pcc == NULL) {
         return 0;
     }
+    SrtpMetrics& metrics = pcc->getMetrics();
+    uint64_t sample = metrics.startSample();
 
     // Compute the total length of the payload
     int32_t payloadLen = length - (pcc->getTagLength() + pcc->getMkiLength() + 4);
@@ -244,7 +275,8 @@ int32_t SrtpHandler::unprotectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size
     uint32_t remoteIndex = encIndex & ~0x80000000;    // get index without Encryption flag
 
     if (!pcc->checkReplay(remoteIndex)) {
-       return -2;
+        metrics.add(SrtpMetrics::ReplayDrops, 1);
+        return -2;
     }
 
     uint8_t mac[20];
@@ -255,6 +287,7 @@ int32_t SrtpHandler::unprotectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size
     // Authenticate includes the index, but not MKI and not (obviously) the tag itself
     pcc->srtcpAuthenticate(buffer, payloadLen, encIndex, mac);
     if (memcmp(tag, mac, pcc->getTagLength()) != 0) {
+        metrics.add(SrtpMetrics::AuthFailures, 1);
         return -1;
     }
 
@@ -268,6 +301,9 @@ int32_t SrtpHandler::unprotectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size
     // Update the Crypto-context
     pcc->update(remoteIndex);
 
+    metrics.add(SrtpMetrics::UnprotectedPackets, 1);
+    metrics.add(SrtpMetrics::UnprotectedBytes, length);
+    metrics.endSample(SrtpMetrics::UnprotectCycles, sample);
     return 1;
 }
 
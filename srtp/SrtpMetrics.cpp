@@ -0,0 +1,127 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cstring>
+#include <chrono>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "srtp/SrtpMetrics.h"
+
+std::atomic<uint32_t> SrtpMetrics::sampleInterval(0);
+
+// The list of all instances and the sum of the deleted instances. Function
+// local statics because crypto contexts may exist during static initialization.
+static std::mutex& registryLock() {
+    static std::mutex lock;
+    return lock;
+}
+
+static SrtpMetrics*& registryHead() {
+    static SrtpMetrics* head = NULL;
+    return head;
+}
+
+static SrtpMetricsData& retiredData() {
+    static SrtpMetricsData data;
+    return data;
+}
+
+SrtpMetrics::SrtpMetrics(): sampleCount(0), prev(NULL) {
+    for (int i = 0; i < numberOfCounters; i++)
+        counters[i].store(0, std::memory_order_relaxed);
+    for (int h = 0; h < numberOfHistograms; h++) {
+        for (int i = 0; i < SRTP_METRICS_BUCKETS; i++)
+            histograms[h][i].store(0, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock(registryLock());
+    next = registryHead();
+    if (next != NULL)
+        next->prev = this;
+    registryHead() = this;
+}
+
+SrtpMetrics::~SrtpMetrics() {
+    std::lock_guard<std::mutex> lock(registryLock());
+    addData(&retiredData());
+
+    if (prev != NULL)
+        prev->next = next;
+    else
+        registryHead() = next;
+    if (next != NULL)
+        next->prev = prev;
+}
+
+uint64_t SrtpMetrics::timestamp() {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void SrtpMetrics::addSample(Histogram histogram, uint64_t ticks) {
+    int bucket = 0;
+    while ((ticks >>= 1) != 0 && bucket < SRTP_METRICS_BUCKETS - 1)
+        bucket++;
+
+    std::atomic<uint64_t>& slot = histograms[histogram][bucket];
+    slot.store(slot.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void SrtpMetrics::addData(SrtpMetricsData* data) const {
+    data->protectedPackets += counters[ProtectedPackets].load(std::memory_order_relaxed);
+    data->protectedBytes += counters[ProtectedBytes].load(std::memory_order_relaxed);
+    data->unprotectedPackets += counters[UnprotectedPackets].load(std::memory_order_relaxed);
+    data->unprotectedBytes += counters[UnprotectedBytes].load(std::memory_order_relaxed);
+    data->authFailures += counters[AuthFailures].load(std::memory_order_relaxed);
+    data->replayDrops += counters[ReplayDrops].load(std::memory_order_relaxed);
+    data->decodeErrors += counters[DecodeErrors].load(std::memory_order_relaxed);
+    data->rocRollovers += counters[RocRollovers].load(std::memory_order_relaxed);
+    data->indexGuessCorrections += counters[IndexGuessCorrections].load(std::memory_order_relaxed);
+
+    for (int i = 0; i < SRTP_METRICS_BUCKETS; i++) {
+        data->protectCycles[i] += histograms[ProtectCycles][i].load(std::memory_order_relaxed);
+        data->unprotectCycles[i] += histograms[UnprotectCycles][i].load(std::memory_order_relaxed);
+    }
+}
+
+void SrtpMetrics::getData(SrtpMetricsData* data) const {
+    memset(data, 0, sizeof(SrtpMetricsData));
+    addData(data);
+}
+
+void SrtpMetrics::getAllData(SrtpMetricsData* data) {
+    std::lock_guard<std::mutex> lock(registryLock());
+
+    memcpy(data, &retiredData(), sizeof(SrtpMetricsData));
+    for (SrtpMetrics* metrics = registryHead(); metrics != NULL; metrics = metrics->next)
+        metrics->addData(data);
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SRTPMETRICS_H_
+#define _SRTPMETRICS_H_
+
+/**
+ * @file SrtpMetrics.h
+ * @brief Counters and sampled cycle histograms of SRTP crypto contexts
+ * @ingroup Z_SRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Number of buckets of a cycle histogram.
+ *
+ * Bucket 0 counts samples below 2 cycles, bucket @c n counts samples between
+ * 2^n and 2^(n+1) cycles. The last bucket counts all longer samples.
+ */
+#define SRTP_METRICS_BUCKETS 32
+
+/**
+ * @brief A copy of the SRTP metrics.
+ *
+ * Byte counts are the packet lengths as handed to the protect and unprotect
+ * functions.
+ */
+typedef struct _SrtpMetricsData {
+    uint64_t protectedPackets;          ///< Packets protected
+    uint64_t protectedBytes;            ///< Bytes protected
+    uint64_t unprotectedPackets;        ///< Packets successfully unprotected
+    uint64_t unprotectedBytes;          ///< Bytes successfully unprotected
+    uint64_t authFailures;              ///< Packets that failed authentication
+    uint64_t replayDrops;               ///< Packets dropped by the replay check
+    uint64_t decodeErrors;              ///< Packets with an invalid RTP header
+    uint64_t rocRollovers;              ///< Increments of the roll-over counter, SRTP only
+    uint64_t indexGuessCorrections;     ///< Received packets with a guessed ROC different to the local ROC, SRTP only
+    uint64_t protectCycles[SRTP_METRICS_BUCKETS];   ///< Histogram of sampled protect cycles
+    uint64_t unprotectCycles[SRTP_METRICS_BUCKETS]; ///< Histogram of sampled unprotect cycles
+} SrtpMetricsData;
+
+/**
+ * @brief Metrics of one SRTP or SRTCP crypto context.
+ *
+ * Each CryptoContext and CryptoContextCtrl owns one instance. Like the crypto
+ * context itself the metrics have one writer at a time, thus the counters use
+ * relaxed atomic loads and stores instead of locked read-modify-write
+ * operations. Other threads may read the counters at any time.
+ *
+ * Per-packet cycle samples are off by default. If an application sets a
+ * sample interval @c n then each context measures every n-th protect and
+ * unprotect call. On x86 the samples are TSC cycles, on other systems they
+ * are nanoseconds.
+ *
+ * All instances register themselves in a process-wide list, getAllData()
+ * aggregates the metrics of all live and already deleted contexts.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class SrtpMetrics {
+public:
+    enum Counter {
+        ProtectedPackets = 0,
+        ProtectedBytes,
+        UnprotectedPackets,
+        UnprotectedBytes,
+        AuthFailures,
+        ReplayDrops,
+        DecodeErrors,
+        RocRollovers,
+        IndexGuessCorrections,
+        numberOfCounters
+    };
+
+    enum Histogram {
+        ProtectCycles = 0,
+        UnprotectCycles,
+        numberOfHistograms
+    };
+
+    SrtpMetrics();
+
+    ~SrtpMetrics();
+
+    /**
+     * @brief Add a value to a counter.
+     *
+     * Only the thread that currently uses the crypto context may call this.
+     */
+    void add(Counter counter, uint64_t value) {
+        counters[counter].store(counters[counter].load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Start a sample if this call is selected by the sample interval.
+     *
+     * @return the start timestamp or 0 if this call is not sampled.
+     */
+    uint64_t startSample() {
+        uint32_t interval = sampleInterval.load(std::memory_order_relaxed);
+        if (interval == 0 || ++sampleCount < interval)
+            return 0;
+        sampleCount = 0;
+        return timestamp();
+    }
+
+    /**
+     * @brief End a sample and add it to a histogram.
+     *
+     * @param histogram the histogram that gets the sample
+     * @param start the value returned by startSample(), does nothing if 0
+     */
+    void endSample(Histogram histogram, uint64_t start) {
+        if (start != 0)
+            addSample(histogram, timestamp() - start);
+    }
+
+    /**
+     * @brief Copy the metrics of this context.
+     */
+    void getData(SrtpMetricsData* data) const;
+
+    /**
+     * @brief Add the metrics of this context to the values in @c data.
+     */
+    void addData(SrtpMetricsData* data) const;
+
+    /**
+     * @brief Aggregate the metrics of all contexts, including deleted ones.
+     */
+    static void getAllData(SrtpMetricsData* data);
+
+    /**
+     * @brief Set the process-wide sample interval, 0 switches sampling off.
+     */
+    static void setSampleInterval(uint32_t interval) { sampleInterval.store(interval, std::memory_order_relaxed); }
+
+    /**
+     * @brief Return the current TSC value on x86, monotonic nanoseconds otherwise.
+     */
+    static uint64_t timestamp();
+
+private:
+    SrtpMetrics(const SrtpMetrics& other) = delete;
+    SrtpMetrics& operator=(const SrtpMetrics& other) = delete;
+
+    void addSample(Histogram histogram, uint64_t ticks);
+
+    std::atomic<uint64_t> counters[numberOfCounters];
+    std::atomic<uint64_t> histograms[numberOfHistograms][SRTP_METRICS_BUCKETS];
+    uint32_t sampleCount;
+
+    SrtpMetrics* next;          // process-wide list of all instances
+    SrtpMetrics* prev;
+
+    static std::atomic<uint32_t> sampleInterval;
+};
+
+/**
+ * @}
+ */
+#endif
@@ -0,0 +1,368 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include <common/osSpecifics.h>
+#include <srtp/CryptoContext.h>
+#include <srtp/CryptoContextCtrl.h>
+#include <srtp/SrtpHandler.h>
+#include <srtp/ZsrtpCWrapper.h>
+
+/*
+ * Holds the SRTP and SRTCP crypto contexts of one direction.
+ *
+ * The two templates keep the master key and salt. The wrapper creates the
+ * crypto context of an SSRC from the template when it sees the first packet
+ * of this SSRC. Usually a direction has only one or very few SSRCs, thus a
+ * short list and a cache of the last used context is fast enough.
+ */
+class ZsrtpWrapper {
+public:
+    ZsrtpWrapper(CryptoContext* srtp, CryptoContextCtrl* srtcp):
+        srtpTemplate(srtp), srtcpTemplate(srtcp), lastSrtp(nullptr), lastSrtcp(nullptr) {
+        srtpContexts.reserve(4);
+        srtcpContexts.reserve(4);
+    }
+
+    ~ZsrtpWrapper() {
+        for (size_t i = 0; i < srtpContexts.size(); i++)
+            delete srtpContexts[i];
+        for (size_t i = 0; i < srtcpContexts.size(); i++)
+            delete srtcpContexts[i];
+        delete srtpTemplate;
+        delete srtcpTemplate;
+    }
+
+    CryptoContext* findSrtp(uint32_t ssrc) {
+        if (lastSrtp != nullptr && lastSrtp->getSsrc() == ssrc)
+            return lastSrtp;
+        for (size_t i = 0; i < srtpContexts.size(); i++) {
+            if (srtpContexts[i]->getSsrc() == ssrc) {
+                lastSrtp = srtpContexts[i];
+                return lastSrtp;
+            }
+        }
+        return nullptr;
+    }
+
+    CryptoContextCtrl* findSrtcp(uint32_t ssrc) {
+        if (lastSrtcp != nullptr && lastSrtcp->getSsrc() == ssrc)
+            return lastSrtcp;
+        for (size_t i = 0; i < srtcpContexts.size(); i++) {
+            if (srtcpContexts[i]->getSsrc() == ssrc) {
+                lastSrtcp = srtcpContexts[i];
+                return lastSrtcp;
+            }
+        }
+        return nullptr;
+    }
+
+    CryptoContext* newSrtp(uint32_t ssrc) {
+        if (srtpContexts.size() >= zsrtp_MaxSsrcs)
+            return nullptr;
+        CryptoContext* pcc = srtpTemplate->newCryptoContextForSSRC(ssrc, 0, 0L);
+        pcc->deriveSrtpKeys(0);
+        return pcc;
+    }
+
+    CryptoContextCtrl* newSrtcp(uint32_t ssrc) {
+        if (srtcpContexts.size() >= zsrtp_MaxSsrcs)
+            return nullptr;
+        CryptoContextCtrl* pcc = srtcpTemplate->newCryptoContextForSSRC(ssrc);
+        pcc->deriveSrtcpKeys();
+        return pcc;
+    }
+
+    void addSrtp(CryptoContext* pcc) {
+        srtpContexts.push_back(pcc);
+        lastSrtp = pcc;
+    }
+
+    void addSrtcp(CryptoContextCtrl* pcc) {
+        srtcpContexts.push_back(pcc);
+        lastSrtcp = pcc;
+    }
+
+    CryptoContext* srtpTemplate;
+    CryptoContextCtrl* srtcpTemplate;
+
+private:
+    std::vector<CryptoContext*> srtpContexts;
+    std::vector<CryptoContextCtrl*> srtcpContexts;
+    CryptoContext* lastSrtp;
+    CryptoContextCtrl* lastSrtcp;
+};
+
+static const int32_t rtpHeaderLength = 12;
+static const int32_t rtcpHeaderLength = 8;
+static const int32_t srtcpIndexLength = 4;
+
+static inline uint32_t getSsrc(const uint8_t* buffer, int32_t offset) {
+    return (static_cast<uint32_t>(buffer[offset]) << 24) | (static_cast<uint32_t>(buffer[offset + 1]) << 16) |
+           (static_cast<uint32_t>(buffer[offset + 2]) << 8) | buffer[offset + 3];
+}
+
+static int32_t protectRtp(ZsrtpWrapper* wrapper, uint8_t* buffer, int32_t length, int32_t* newLength) {
+    if (length < rtpHeaderLength)
+        return 0;
+
+    uint32_t ssrc = getSsrc(buffer, 8);
+    CryptoContext* pcc = wrapper->findSrtp(ssrc);
+    if (pcc == nullptr) {
+        if ((pcc = wrapper->newSrtp(ssrc)) == nullptr)
+            return 0;
+        wrapper->addSrtp(pcc);
+    }
+    size_t len = 0;
+    if (!SrtpHandler::protect(pcc, buffer, static_cast<size_t>(length), &len))
+        return 0;
+    *newLength = static_cast<int32_t>(len);
+    return 1;
+}
+
+static int32_t unprotectRtp(ZsrtpWrapper* wrapper, uint8_t* buffer, int32_t length, int32_t* newLength) {
+    if (length < rtpHeaderLength)
+        return 0;
+
+    uint32_t ssrc = getSsrc(buffer, 8);
+    CryptoContext* pcc = wrapper->findSrtp(ssrc);
+    bool created = false;
+    if (pcc == nullptr) {
+        if ((pcc = wrapper->newSrtp(ssrc)) == nullptr)
+            return 0;
+        created = true;
+    }
+    size_t len = 0;
+    int32_t rc = SrtpHandler::unprotect(pcc, buffer, static_cast<size_t>(length), &len);
+
+    // Keep a new context only if the packet was authentic, otherwise forged
+    // packets with random SSRCs would fill the list
+    if (created) {
+        if (rc != 1) {
+            delete pcc;
+            return rc;
+        }
+        wrapper->addSrtp(pcc);
+    }
+    if (rc == 1)
+        *newLength = static_cast<int32_t>(len);
+    return rc;
+}
+
+static int32_t protectRtcp(ZsrtpWrapper* wrapper, uint8_t* buffer, int32_t length, int32_t* newLength) {
+    if (length < rtcpHeaderLength)
+        return 0;
+
+    uint32_t ssrc = getSsrc(buffer, 4);
+    CryptoContextCtrl* pcc = wrapper->findSrtcp(ssrc);
+    if (pcc == nullptr) {
+        if ((pcc = wrapper->newSrtcp(ssrc)) == nullptr)
+            return 0;
+        wrapper->addSrtcp(pcc);
+    }
+    size_t len = 0;
+    if (!SrtpHandler::protectCtrl(pcc, buffer, static_cast<size_t>(length), &len))
+        return 0;
+    *newLength = static_cast<int32_t>(len);
+    return 1;
+}
+
+static int32_t unprotectRtcp(ZsrtpWrapper* wrapper, uint8_t* buffer, int32_t length, int32_t* newLength) {
+    CryptoContextCtrl* tmpl = wrapper->srtcpTemplate;
+
+    // SrtpHandler::unprotectCtrl() does not check the length
+    if (length < rtcpHeaderLength + srtcpIndexLength + tmpl->getTagLength() + tmpl->getMkiLength())
+        return 0;
+
+    uint32_t ssrc = getSsrc(buffer, 4);
+    CryptoContextCtrl* pcc = wrapper->findSrtcp(ssrc);
+    bool created = false;
+    if (pcc == nullptr) {
+        if ((pcc = wrapper->newSrtcp(ssrc)) == nullptr)
+            return 0;
+        created = true;
+    }
+    size_t len = 0;
+    int32_t rc = SrtpHandler::unprotectCtrl(pcc, buffer, static_cast<size_t>(length), &len);
+
+    if (created) {
+        if (rc != 1) {
+            delete pcc;
+            return rc;
+        }
+        wrapper->addSrtcp(pcc);
+    }
+    if (rc == 1)
+        *newLength = static_cast<int32_t>(len);
+    return rc;
+}
+
+typedef int32_t (*PacketFunction)(ZsrtpWrapper*, uint8_t*, int32_t, int32_t*);
+
+static int32_t processBatch(ZsrtpContext* ctx, PacketFunction function, uint8_t* const* buffers, int32_t* lengths,
+                            int32_t* results, int32_t count) {
+    if (ctx == NULL || buffers == NULL || lengths == NULL)
+        return 0;
+
+    ZsrtpWrapper* wrapper = ctx->srtp;
+    int32_t success = 0;
+    for (int32_t i = 0; i < count; i++) {
+        int32_t rc = function(wrapper, buffers[i], lengths[i], &lengths[i]);
+        if (results != NULL)
+            results[i] = rc;
+        if (rc == 1)
+            success++;
+    }
+    return success;
+}
+
+ZsrtpContext* zsrtp_CreateWrapperFromSecrets(const C_SrtpSecret_t* secrets, int32_t part)
+{
+    int32_t cipher;
+    int32_t authn;
+    int32_t authKeyLen;
+
+    if (secrets == NULL)
+        return NULL;
+
+    if (secrets->authAlgorithm == zrtp_Sha1) {
+        authn = zsrtp_AuthenticationSha1Hmac;
+        authKeyLen = 20;
+    }
+    else if (secrets->authAlgorithm == zrtp_Skein) {
+        authn = zsrtp_AuthenticationSkeinHmac;
+        authKeyLen = 32;
+    }
+    else
+        return NULL;
+
+    if (secrets->symEncAlgorithm == zrtp_Aes)
+        cipher = zsrtp_EncryptionAESCM;
+    else if (secrets->symEncAlgorithm == zrtp_TwoFish)
+        cipher = zsrtp_EncryptionTWOCM;
+    else
+        return NULL;
+
+    // To encrypt packets: intiator uses initiator keys, responder uses
+    // responder keys. To decrypt it's the other way round.
+    bool initiatorKeys = (part == ForSender) == (secrets->role == Initiator);
+    if (initiatorKeys)
+        return zsrtp_CreateWrapper(cipher, authn, secrets->keyInitiator, secrets->initKeyLen / 8,
+                                   secrets->saltInitiator, secrets->initSaltLen / 8, authKeyLen,
+                                   secrets->srtpAuthTagLen / 8);
+    return zsrtp_CreateWrapper(cipher, authn, secrets->keyResponder, secrets->respKeyLen / 8,
+                               secrets->saltResponder, secrets->respSaltLen / 8, authKeyLen,
+                               secrets->srtpAuthTagLen / 8);
+}
+
+ZsrtpContext* zsrtp_CreateWrapper(int32_t ealg, int32_t aalg, const uint8_t* masterKey, int32_t masterKeyLength,
+                                  const uint8_t* masterSalt, int32_t masterSaltLength, int32_t authKeyLength,
+                                  int32_t tagLength)
+{
+    uint8_t* key = const_cast<uint8_t*>(masterKey);
+    uint8_t* salt = const_cast<uint8_t*>(masterSalt);
+
+    CryptoContext* srtp = new CryptoContext(0, 0, 0L, ealg, aalg, key, masterKeyLength, salt, masterSaltLength,
+                                            masterKeyLength, authKeyLength, masterSaltLength, tagLength);
+    CryptoContextCtrl* srtcp = new CryptoContextCtrl(0, ealg, aalg, key, masterKeyLength, salt, masterSaltLength,
+                                                     masterKeyLength, authKeyLength, masterSaltLength, tagLength);
+
+    ZsrtpContext* ctx = new ZsrtpContext;
+    ctx->srtp = new ZsrtpWrapper(srtp, srtcp);
+    ctx->userData = NULL;
+    return ctx;
+}
+
+void zsrtp_DestroyWrapper(ZsrtpContext* ctx)
+{
+    if (ctx == NULL)
+        return;
+
+    delete ctx->srtp;
+    ctx->srtp = NULL;
+    delete ctx;
+}
+
+int32_t zsrtp_getTrailerLength(ZsrtpContext* ctx, int32_t rtcp)
+{
+    if (ctx == NULL)
+        return 0;
+
+    if (rtcp) {
+        CryptoContextCtrl* tmpl = ctx->srtp->srtcpTemplate;
+        return srtcpIndexLength + tmpl->getTagLength() + tmpl->getMkiLength();
+    }
+    CryptoContext* tmpl = ctx->srtp->srtpTemplate;
+    return tmpl->getTagLength() + tmpl->getMkiLength();
+}
+
+int32_t zsrtp_protect(ZsrtpContext* ctx, uint8_t* buffer, int32_t length, int32_t* newLength)
+{
+    if (ctx == NULL || buffer == NULL)
+        return 0;
+    return protectRtp(ctx->srtp, buffer, length, newLength);
+}
+
+int32_t zsrtp_unprotect(ZsrtpContext* ctx, uint8_t* buffer, int32_t length, int32_t* newLength)
+{
+    if (ctx == NULL || buffer == NULL)
+        return 0;
+    return unprotectRtp(ctx->srtp, buffer, length, newLength);
+}
+
+int32_t zsrtp_protectCtrl(ZsrtpContext* ctx, uint8_t* buffer, int32_t length, int32_t* newLength)
+{
+    if (ctx == NULL || buffer == NULL)
+        return 0;
+    return protectRtcp(ctx->srtp, buffer, length, newLength);
+}
+
+int32_t zsrtp_unprotectCtrl(ZsrtpContext* ctx, uint8_t* buffer, int32_t length, int32_t* newLength)
+{
+    if (ctx == NULL || buffer == NULL)
+        return 0;
+    return unprotectRtcp(ctx->srtp, buffer, length, newLength);
+}
+
+int32_t zsrtp_protectBatch(ZsrtpContext* ctx, uint8_t* const* buffers, int32_t* lengths, int32_t* results,
+                           int32_t count)
+{
+    return processBatch(ctx, protectRtp, buffers, lengths, results, count);
+}
+
+int32_t zsrtp_unprotectBatch(ZsrtpContext* ctx, uint8_t* const* buffers, int32_t* lengths, int32_t* results,
+                             int32_t count)
+{
+    return processBatch(ctx, unprotectRtp, buffers, lengths, results, count);
+}
+
+int32_t zsrtp_protectCtrlBatch(ZsrtpContext* ctx, uint8_t* const* buffers, int32_t* lengths, int32_t* results,
+                               int32_t count)
+{
+    return processBatch(ctx, protectRtcp, buffers, lengths, results, count);
+}
+
+int32_t zsrtp_unprotectCtrlBatch(ZsrtpContext* ctx, uint8_t* const* buffers, int32_t* lengths, int32_t* results,
+                                 int32_t count)
+{
+    return processBatch(ctx, unprotectRtcp, buffers, lengths, results, count);
+}
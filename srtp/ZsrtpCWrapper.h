@@ -0,0 +1,268 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ZSRTPCWRAPPER_H
+#define ZSRTPCWRAPPER_H
+
+/**
+ *
+ * @file ZsrtpCWrapper.h
+ * @brief The GNU ZRTP SRTP C-to-C++ wrapper.
+ *
+ * C applications that use the ZRTP C wrapper (ZrtpCWrapper.h) use these
+ * functions to protect and unprotect their RTP and RTCP packets with the
+ * SRTP implementation of this library. The applications create the SRTP
+ * contexts directly from the secrets that ZRTP hands over in the
+ * @c zrtp_srtpSecretsReady callback.
+ *
+ * An SRTP wrapper context handles one direction, either sending or
+ * receiving, of one RTP session and its RTCP packets. It creates the crypto
+ * context of an SSRC when it sees the first valid packet of this SSRC.
+ *
+ * All functions work in place: protect appends the SRTP/SRTCP trailer to the
+ * packet data, thus the buffer must have room for at least
+ * zsrtp_getTrailerLength() additional bytes. Unprotect decrypts in place and
+ * returns the length without the trailer.
+ *
+ * A wrapper context is not thread safe, only one thread at a time may use
+ * it. Different contexts may run in different threads.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+
+#include <libzrtpcpp/ZrtpCWrapper.h>
+
+/*
+ * Keep the following defines in sync with the SrtpEncryption* and
+ * SrtpAuthentication* constants in CryptoContext.h
+ */
+#define zsrtp_EncryptionNull     0      /*!< No encryption */
+#define zsrtp_EncryptionAESCM    1      /*!< AES counter mode */
+#define zsrtp_EncryptionAESF8    2      /*!< AES F8 mode */
+#define zsrtp_EncryptionTWOCM    3      /*!< Twofish counter mode */
+#define zsrtp_EncryptionTWOF8    4      /*!< Twofish F8 mode */
+
+#define zsrtp_AuthenticationNull       0    /*!< No authentication */
+#define zsrtp_AuthenticationSha1Hmac   1    /*!< HMAC SHA1 */
+#define zsrtp_AuthenticationSkeinHmac  2    /*!< Skein MAC */
+
+#define zsrtp_MaxSsrcs 32       /*!< Maximum number of SSRCs per wrapper context */
+
+#ifdef __cplusplus
+#ifdef __GNUC__
+#pragma GCC visibility push(default)
+#endif
+extern "C"
+{
+    typedef class ZsrtpWrapper ZsrtpWrapper;
+#else
+    typedef struct ZsrtpWrapper ZsrtpWrapper;
+#endif
+
+    /**
+     * The opaque SRTP wrapper context.
+     */
+    typedef struct zsrtpContext
+    {
+        ZsrtpWrapper* srtp;                 /*!< Holds the SRTP and SRTCP crypto contexts */
+        void* userData;                     /*!< User data, set by application */
+    } ZsrtpContext;
+
+    /**
+     * Create an SRTP wrapper context from ZRTP secrets.
+     *
+     * Selects the keys according to the ZRTP role: the Initiator sends with
+     * the Initiator keys and receives with the Responder keys, the Responder
+     * the other way round. The function copies the keys, the application may
+     * release the secrets afterwards.
+     *
+     * @param secrets
+     *    The secrets of the @c zrtp_srtpSecretsReady callback.
+     * @param part
+     *    Either @c ForSender or @c ForReceiver, the @c part parameter of
+     *    the callback.
+     * @return
+     *    Pointer to the wrapper context or @c NULL if the secrets use
+     *    unknown algorithms.
+     */
+    ZsrtpContext* zsrtp_CreateWrapperFromSecrets(const C_SrtpSecret_t* secrets, int32_t part);
+
+    /**
+     * Create an SRTP wrapper context from master key and salt.
+     *
+     * @param ealg
+     *    The encryption algorithm, one of the @c zsrtp_Encryption* values.
+     * @param aalg
+     *    The authentication algorithm, one of the @c zsrtp_Authentication* values.
+     * @param masterKey
+     *    The master key.
+     * @param masterKeyLength
+     *    Length of the master key in bytes, also the length of the session
+     *    encryption key.
+     * @param masterSalt
+     *    The master salt.
+     * @param masterSaltLength
+     *    Length of the master salt in bytes, also the length of the session salt.
+     * @param authKeyLength
+     *    Length of the session authentication key in bytes.
+     * @param tagLength
+     *    Length of the authentication tag in bytes.
+     * @return
+     *    Pointer to the wrapper context.
+     */
+    ZsrtpContext* zsrtp_CreateWrapper(int32_t ealg, int32_t aalg, const uint8_t* masterKey, int32_t masterKeyLength,
+                                      const uint8_t* masterSalt, int32_t masterSaltLength, int32_t authKeyLength,
+                                      int32_t tagLength);
+
+    /**
+     * Destroy an SRTP wrapper context.
+     *
+     * Wipes all keys and frees the crypto contexts of all SSRCs.
+     *
+     * @param ctx
+     *    Pointer to the wrapper context, @c NULL is ignored.
+     */
+    void zsrtp_DestroyWrapper(ZsrtpContext* ctx);
+
+    /**
+     * Get the number of bytes that protect appends to an RTP packet.
+     *
+     * @param ctx
+     *    Pointer to the wrapper context.
+     * @param rtcp
+     *    If not zero return the length for RTCP packets.
+     * @return
+     *    Number of bytes.
+     */
+    int32_t zsrtp_getTrailerLength(ZsrtpContext* ctx, int32_t rtcp);
+
+    /**
+     * Protect an RTP packet in place.
+     *
+     * @param ctx
+     *    Pointer to the wrapper context.
+     * @param buffer
+     *    The RTP packet, the buffer must have room for the SRTP trailer.
+     * @param length
+     *    Length of the RTP packet in bytes.
+     * @param newLength
+     *    Gets the length of the SRTP packet in bytes.
+     * @return
+     *    1 on success, 0 if the packet is not a valid RTP packet or the
+     *    context already handles @c zsrtp_MaxSsrcs SSRCs.
+     */
+    int32_t zsrtp_protect(ZsrtpContext* ctx, uint8_t* buffer, int32_t length, int32_t* newLength);
+
+    /**
+     * Unprotect an SRTP packet in place.
+     *
+     * @param ctx
+     *    Pointer to the wrapper context.
+     * @param buffer
+     *    The SRTP packet.
+     * @param length
+     *    Length of the SRTP packet in bytes.
+     * @param newLength
+     *    Gets the length of the RTP packet in bytes.
+     * @return
+     *    - 1 - success
+     *    - 0 - SRTP/RTP packet decode error
+     *    - -1 - SRTP authentication failed
+     *    - -2 - SRTP replay check failed
+     */
+    int32_t zsrtp_unprotect(ZsrtpContext* ctx, uint8_t* buffer, int32_t length, int32_t* newLength);
+
+    /**
+     * Protect an RTCP packet in place.
+     *
+     * Parameters and return value as zsrtp_protect().
+     */
+    int32_t zsrtp_protectCtrl(ZsrtpContext* ctx, uint8_t* buffer, int32_t length, int32_t* newLength);
+
+    /**
+     * Unprotect an SRTCP packet in place.
+     *
+     * Parameters and return value as zsrtp_unprotect().
+     */
+    int32_t zsrtp_unprotectCtrl(ZsrtpContext* ctx, uint8_t* buffer, int32_t length, int32_t* newLength);
+
+    /**
+     * Protect a batch of RTP packets in place.
+     *
+     * Same as calling zsrtp_protect() for each packet, but with one call
+     * into the library.
+     *
+     * @param ctx
+     *    Pointer to the wrapper context.
+     * @param buffers
+     *    Array of @c count packet buffers.
+     * @param lengths
+     *    Array of @c count packet lengths. On return each element holds the
+     *    new length of a successfully protected packet, otherwise it is
+     *    unchanged.
+     * @param results
+     *    Array of @c count results, each the return value of zsrtp_protect()
+     *    for this packet. May be @c NULL.
+     * @param count
+     *    Number of packets.
+     * @return
+     *    Number of successfully protected packets.
+     */
+    int32_t zsrtp_protectBatch(ZsrtpContext* ctx, uint8_t* const* buffers, int32_t* lengths, int32_t* results,
+                               int32_t count);
+
+    /**
+     * Unprotect a batch of SRTP packets in place.
+     *
+     * Parameters as zsrtp_protectBatch(), the results are the return values
+     * of zsrtp_unprotect().
+     *
+     * @return
+     *    Number of successfully unprotected packets.
+     */
+    int32_t zsrtp_unprotectBatch(ZsrtpContext* ctx, uint8_t* const* buffers, int32_t* lengths, int32_t* results,
+                                 int32_t count);
+
+    /**
+     * Protect a batch of RTCP packets in place.
+     *
+     * Parameters as zsrtp_protectBatch().
+     */
+    int32_t zsrtp_protectCtrlBatch(ZsrtpContext* ctx, uint8_t* const* buffers, int32_t* lengths, int32_t* results,
+                                   int32_t count);
+
+    /**
+     * Unprotect a batch of SRTCP packets in place.
+     *
+     * Parameters as zsrtp_unprotectBatch().
+     */
+    int32_t zsrtp_unprotectCtrlBatch(ZsrtpContext* ctx, uint8_t* const* buffers, int32_t* lengths, int32_t* results,
+                                     int32_t count);
+
+#ifdef __cplusplus
+}
+#ifdef __GNUC__
+#pragma GCC visibility pop
+#endif
+#endif
+
+/**
+ * @}
+ */
+#endif
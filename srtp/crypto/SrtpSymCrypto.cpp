@@ -132,6 +132,12 @@ void SrtpSymCrypto::ctr_encrypt(const uint8_t* input, uint32_t input_length, uin
     if (key == NULL)
         return;
 
+    // Twofish has its own CTR mode that runs two blocks at a time
+    if (algorithm == SrtpEncryptionTWOCM) {
+        Twofish_ctr_encrypt((Twofish_key*)key, iv, input, output, input_length);
+        return;
+    }
+
     uint16_t ctr = 0;
     unsigned char temp[SRTP_BLOCK_SIZE];
 
@@ -164,6 +170,11 @@ void SrtpSymCrypto::ctr_encrypt( uint8_t* data, uint32_t data_length, uint8_t* i
     if (key == NULL)
         return;
 
+    if (algorithm == SrtpEncryptionTWOCM) {
+        Twofish_ctr_encrypt((Twofish_key*)key, iv, data, data, data_length);
+        return;
+    }
+
     uint16_t ctr = 0;
     unsigned char temp[SRTP_BLOCK_SIZE];
 
@@ -94,7 +94,7 @@ static void hmacSha1Final(hmacSha1Context *ctx, uint8_t *mac)
 }
 
 
-void hmac_sha1(const uint8_t *key, uint64_t keyLength, const uint8_t* data, uint32_t dataLength, uint8_t* mac, int32_t* macLength)
+void hmac_sha1(const uint8_t *key, int64_t keyLength, const uint8_t* data, uint64_t dataLength, uint8_t* mac, int32_t* macLength)
 {
     if (key == nullptr || data == nullptr || mac == nullptr || macLength == nullptr) {
         return;
@@ -112,9 +112,8 @@ void hmac_sha1(const uint8_t *key, uint64_t keyLength, const uint8_t* data, uint
 }
 
 void hmac_sha1(const uint8_t* key, uint64_t keyLength,
-               const std::vector<const uint8_t*>& data,
-               const std::vector<uint64_t>& dataLength,
-               uint8_t* mac, uint32_t* macLength )
+               const DataChunks& data,
+               uint8_t* mac, int32_t* macLength )
 {
     if (key == nullptr || mac == nullptr || macLength == nullptr) {
         return;
@@ -127,10 +126,10 @@ void hmac_sha1(const uint8_t* key, uint64_t keyLength,
     }
 
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        if (data[i] == nullptr || dataLength[i] == 0) {
+        if (data.data(i) == nullptr || data.length(i) == 0) {
             continue;
         }
-        hmacSha1Update(&ctx, data[i], dataLength[i]);
+        hmacSha1Update(&ctx, data.data(i), data.length(i));
     }
     hmacSha1Final(&ctx, mac);
     *macLength = SHA1_DIGEST_SIZE;
@@ -183,8 +182,7 @@ void hmacSha1Ctx(void* ctx, const uint8_t* data, uint64_t dataLength,
 }
 
 void hmacSha1Ctx(void* ctx,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength,
+                 const DataChunks& data,
                  uint8_t* mac, uint32_t* macLength )
 {
     if (ctx == nullptr || mac == nullptr || macLength == nullptr) {
@@ -195,10 +193,10 @@ void hmacSha1Ctx(void* ctx,
 
     hmacSha1Reset(pctx);
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        if (data[i] == nullptr || dataLength[i] == 0) {
+        if (data.data(i) == nullptr || data.length(i) == 0) {
             continue;
         }
-        hmacSha1Update(pctx, data[i], dataLength[i]);
+        hmacSha1Update(pctx, data.data(i), data.length(i));
     }
     hmacSha1Final(pctx, mac);
     *macLength = SHA1_DIGEST_SIZE;
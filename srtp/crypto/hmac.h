@@ -32,7 +32,7 @@
  */
 
 #include <cstdint>
-#include <vector>
+#include <cryptcommon/DataChunks.h>
 #include "srtp/crypto/sha1.h"
 
 #ifndef SHA1_DIGEST_LENGTH
@@ -80,10 +80,7 @@ void hmac_sha1(const uint8_t* key, int64_t keyLength,
  * @param keyLength
  *    Length of the MAC key in bytes
  * @param data
- *    Vector of pointers that point to the data chunks. A NULL
- *    pointer in an array element terminates the data chunks.
- * @param dataLength
- *    Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  * @param mac
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 20 bytes (SHA1_DIGEST_LENGTH).
@@ -91,8 +88,7 @@ void hmac_sha1(const uint8_t* key, int64_t keyLength,
  *    Point to an integer that receives the length of the computed HMAC.
  */
 void hmac_sha1(const uint8_t* key, uint64_t keyLength,
-               const std::vector<const uint8_t*>& data,
-               const std::vector<uint64_t>& dataLength,
+               const DataChunks& data,
                uint8_t* mac, int32_t* macLength);
 
 /**
@@ -153,10 +149,7 @@ void hmacSha1Ctx(void* ctx, const uint8_t* data, uint64_t data_length,
  * @param ctx 
  *     Pointer to initialized SHA1 HMAC context
  * @param data
- *    Vector of pointers that point to the data chunks. A NULL
- *    pointer in an array element terminates the data chunks.
- * @param data_length
- *    Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  * @param mac
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 20 bytes (SHA1_DIGEST_LENGTH).
@@ -164,8 +157,7 @@ void hmacSha1Ctx(void* ctx, const uint8_t* data, uint64_t data_length,
  *    Point to an integer that receives the length of the computed HMAC.
  */
 void hmacSha1Ctx(void* ctx,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength,
+                 const DataChunks& data,
                  uint8_t* mac, uint32_t* macLength);
 
 /**
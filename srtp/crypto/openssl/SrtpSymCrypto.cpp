@@ -116,6 +116,12 @@ void SrtpSymCrypto::ctr_encrypt(const uint8_t* input, uint32_t input_length,
     if (key == nullptr)
         return;
 
+    // Twofish has its own CTR mode that runs two blocks at a time
+    if (algorithm == SrtpEncryptionTWOCM) {
+        Twofish_ctr_encrypt((Twofish_key*)key, iv, input, output, input_length);
+        return;
+    }
+
     uint16_t ctr = 0;
     unsigned char temp[SRTP_BLOCK_SIZE];
 
@@ -148,6 +154,11 @@ void SrtpSymCrypto::ctr_encrypt( uint8_t* data, uint32_t data_length, uint8_t* i
     if (key == nullptr)
         return;
 
+    if (algorithm == SrtpEncryptionTWOCM) {
+        Twofish_ctr_encrypt((Twofish_key*)key, iv, data, data, data_length);
+        return;
+    }
+
     uint16_t ctr = 0;
     unsigned char temp[SRTP_BLOCK_SIZE];
 
@@ -21,7 +21,7 @@
 #include <cstdint>
 #include <openssl/hmac.h>
 #include <srtp/crypto/hmac.h>
-#include <vector>
+#include <cryptcommon/DataChunks.h>
 #include "../../../zrtp/crypto/openssl/openssl_compat.h"
 
 void hmac_sha1(const uint8_t* key, int64_t keyLength,
@@ -39,8 +39,7 @@ void hmac_sha1(const uint8_t* key, int64_t keyLength,
 }
 
 void hmac_sha1(const uint8_t* key, uint64_t keyLength,
-                const std::vector<const uint8_t*>& data,
-                const std::vector<uint64_t>& dataLength,
+                const DataChunks& data,
                 uint8_t* mac, int32_t* macLength) {
     if (key == nullptr || mac == nullptr || macLength == nullptr) {
         return;
@@ -59,10 +58,10 @@ void hmac_sha1(const uint8_t* key, uint64_t keyLength,
     }
     
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        if (data[i] == nullptr || dataLength[i] == 0) {
+        if (data.data(i) == nullptr || data.length(i) == 0) {
             continue;
         }
-        if (!hmac_update(ctx, data[i], dataLength[i])) {
+        if (!hmac_update(ctx, data.data(i), data.length(i))) {
             hmac_ctx_free(ctx);
             *macLength = 0;
             return;
@@ -147,8 +146,7 @@ void hmacSha1Ctx(void* ctx, const uint8_t* data, uint64_t data_length,
 }
 
 void hmacSha1Ctx(void* ctx,
-                  const std::vector<const uint8_t*>& data,
-                  const std::vector<uint64_t>& dataLength,
+                  const DataChunks& data,
                   uint8_t* mac, uint32_t* macLength)
 {
     if (ctx == nullptr || mac == nullptr || macLength == nullptr) {
@@ -163,10 +161,10 @@ void hmacSha1Ctx(void* ctx,
     }
     
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        if (data[i] == nullptr || dataLength[i] == 0) {
+        if (data.data(i) == nullptr || data.length(i) == 0) {
             continue;
         }
-        if (!hmac_update(pctx, data[i], dataLength[i])) {
+        if (!hmac_update(pctx, data.data(i), data.length(i))) {
             *macLength = 0;
             return;
         }
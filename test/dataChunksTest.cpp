@@ -0,0 +1,97 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Tests of the DataChunks list.
+ *
+ * A full list hashes the same digest as the concatenated data. Adding one
+ * chunk more than MAX_DATA_CHUNKS must abort the program, the test runs
+ * this case in a child process.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cryptcommon/DataChunks.h>
+#include <zrtp/crypto/sha256.h>
+
+static const size_t chunkLength = 7;
+
+static int fullList() {
+    uint8_t data[MAX_DATA_CHUNKS * chunkLength];
+    uint8_t digestChunks[SHA256_DIGEST_LENGTH];
+    uint8_t digestData[SHA256_DIGEST_LENGTH];
+    DataChunks chunks;
+
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = static_cast<uint8_t>(i);
+    for (size_t i = 0; i < MAX_DATA_CHUNKS; i++)
+        chunks.add(data + i * chunkLength, chunkLength);
+
+    if (chunks.size() != MAX_DATA_CHUNKS) {
+        fprintf(stderr, "full list: %zu chunks, expected %d\n", chunks.size(), MAX_DATA_CHUNKS);
+        return 1;
+    }
+    sha256(chunks, digestChunks);
+    sha256(data, sizeof(data), digestData);
+    if (memcmp(digestChunks, digestData, SHA256_DIGEST_LENGTH) != 0) {
+        fprintf(stderr, "full list: digest differs from digest of the concatenated data\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int overflow() {
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        uint8_t data[1] = {0};
+        DataChunks chunks;
+
+        for (size_t i = 0; i <= MAX_DATA_CHUNKS; i++)
+            chunks.add(data, sizeof(data));
+        _exit(0);                       // not reached if add() aborts
+    }
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid) {
+        perror("waitpid");
+        return 1;
+    }
+    if (!WIFSIGNALED(status) || WTERMSIG(status) != SIGABRT) {
+        fprintf(stderr, "overflow: adding chunk %d did not abort\n", MAX_DATA_CHUNKS + 1);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int failures = 0;
+
+    failures += fullList();
+    failures += overflow();
+
+    printf("dataChunksTest: %d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,387 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Tests of a ZRTP DH handshake between two engines.
+ *
+ * Two ZRtp engines exchange their packets through an in-memory queue until
+ * both reach SecureState. Both sides must compute the same SRTP keys and
+ * SAS. When an engine reports SecureState it must have released its
+ * handshake data: the memory footprint must shrink at least by the size of
+ * the public key and message buffers of the handshake data.
+ *
+ * The test counts the heap allocations of the engines during a handshake,
+ * the C++ allocations through operator new and the allocations of the big
+ * number library. The first handshake of a thread sets up the DH arena and
+ * the curve parameters, the test counts the second handshake. The limits
+ * are the allocations that remain per pair of engines:
+ * - DH handshake: the ZID cache record, the DH context and up to two
+ *   blocks of the cipher string for srtpSecretsOn() of each engine, and
+ *   the numbers of the two DH contexts, 4 for DH, 8 for ECDH
+ * - multi-stream handshake: the two blocks of the nonce set of the
+ *   responder's master if the set grows, on its first nonce and whenever
+ *   it doubles
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZrtpStateClass.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <zrtp/crypto/zrtpDH.h>
+#include <common/osSpecifics.h>
+
+using namespace GnuZrtpCodes;
+
+static char cacheName[] = "handshakeTest.zid";
+static const int maxSteps = 1000;
+static const size_t handshakeBuffers = 2 * 1000;    // public key and peer message buffers, at least
+static const uint64_t maxDhAllocs = 8;
+static const uint64_t maxDhBnAllocs = 8;
+static const uint64_t maxMultiAllocs = 2;
+
+class Endpoint;
+
+struct Packet {
+    Endpoint* target;
+    std::vector<uint8_t> data;
+};
+
+static std::deque<Packet> packets;
+
+/*
+ * Count the heap allocations of the engines. The callbacks of the test
+ * switch counting off.
+ */
+static bool countAllocations = false;
+static uint64_t engineAllocations = 0;
+
+void* operator new(size_t size)
+{
+    if (countAllocations)
+        engineAllocations++;
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    if (countAllocations)
+        engineAllocations++;
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+// The nothrow versions must use the same heap as the delete operators below
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    if (countAllocations)
+        engineAllocations++;
+    return malloc(size != 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    if (countAllocations)
+        engineAllocations++;
+    return malloc(size != 0 ? size : 1);
+}
+
+// Not inlined: GCC otherwise reports the free() of the unwind paths as mismatched
+#if defined(__GNUC__)
+#define ALLOC_NOINLINE __attribute__((noinline))
+#else
+#define ALLOC_NOINLINE
+#endif
+
+ALLOC_NOINLINE void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+ALLOC_NOINLINE void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+class PauseAllocationCount {
+public:
+    PauseAllocationCount(): saved(countAllocations) { countAllocations = false; }
+    ~PauseAllocationCount() { countAllocations = saved; }
+private:
+    bool saved;
+};
+
+/*
+ * One side of the handshake, sends its packets to the peer through the
+ * packet queue. Timers are fired by the test if no packets are queued.
+ */
+class Endpoint: public ZrtpCallback {
+public:
+    Endpoint(uint32_t ssrc): peer(NULL), engine(NULL), ssrc(ssrc), timerActive(false), secure(false), failed(false),
+        startFootprint(0), secureFootprint(0) {}
+
+    Endpoint* peer;
+    ZRtp* engine;
+    uint32_t ssrc;
+    bool timerActive;
+    bool secure;
+    bool failed;
+    size_t startFootprint;
+    size_t secureFootprint;
+    std::string sas;
+    std::vector<uint8_t> keyInitiator;
+    std::vector<uint8_t> keyResponder;
+
+protected:
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length);
+    int32_t activateTimer(int32_t time)                     { timerActive = true; return 1; }
+    int32_t cancelTimer()                                   { timerActive = false; return 1; }
+    void sendInfo(MessageSeverity severity, int32_t subCode);
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part);
+    void srtpSecretsOff(EnableSecurity part)                {}
+    void srtpSecretsOn(std::string c, std::string s, bool verified);
+    void handleGoClear()                                    {}
+    void zrtpNegotiationFailed(MessageSeverity severity, int32_t subCode) { failed = true; }
+    void zrtpNotSuppOther()                                 { failed = true; }
+    void synchEnter()                                       {}
+    void synchLeave()                                       {}
+    void zrtpAskEnrollment(InfoEnrollment info)             {}
+    void zrtpInformEnrollment(InfoEnrollment info)          {}
+    void signSAS(uint8_t* sasHash)                          {}
+    bool checkSASSignature(uint8_t* sasHash)                { return true; }
+};
+
+int32_t Endpoint::sendDataZRTP(const uint8_t* data, int32_t length)
+{
+    // Fixed ZRTP header, message and room for the CRC as on the wire
+    PauseAllocationCount pause;
+    Packet pkt;
+    pkt.target = peer;
+    pkt.data.resize(12 + length);
+    uint8_t* buffer = pkt.data.data();
+
+    buffer[0] = 0x10;
+    *reinterpret_cast<uint32_t*>(buffer + 4) = zrtpHtonl(ZRTP_MAGIC);
+    *reinterpret_cast<uint32_t*>(buffer + 8) = zrtpHtonl(ssrc);
+    memcpy(buffer + 12, data, length - CRC_SIZE);
+    packets.push_back(pkt);
+    return 1;
+}
+
+void Endpoint::sendInfo(MessageSeverity severity, int32_t subCode)
+{
+    if (severity == Info && subCode == InfoSecureStateOn) {
+        secure = true;
+        secureFootprint = engine->getMemoryFootprint();
+    }
+}
+
+bool Endpoint::srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part)
+{
+    PauseAllocationCount pause;
+    if (part == ForSender) {
+        keyInitiator.assign(secrets->keyInitiator, secrets->keyInitiator + secrets->initKeyLen / 8);
+        keyResponder.assign(secrets->keyResponder, secrets->keyResponder + secrets->respKeyLen / 8);
+    }
+    return true;
+}
+
+void Endpoint::srtpSecretsOn(std::string c, std::string s, bool verified)
+{
+    PauseAllocationCount pause;
+    sas = s;
+}
+
+/*
+ * Deliver the queued packets, fire a timer only if no packet is pending.
+ * Count the allocations of the engines while they process the events.
+ */
+static bool runHandshake(Endpoint& a, Endpoint& b, uint64_t* allocs, uint64_t* bnAllocs)
+{
+    uint64_t allocsStart = engineAllocations;
+    uint64_t bnAllocsStart = ZrtpDH::getHeapAllocations();
+    bool done = false;
+
+    countAllocations = true;
+    a.engine->startZrtpEngine();
+    b.engine->startZrtpEngine();
+
+    for (int step = 0; step < maxSteps && !done; step++) {
+        if ((a.secure && b.secure) || a.failed || b.failed)
+            done = true;
+        else if (!packets.empty()) {
+            Packet& pkt = packets.front();
+            pkt.target->engine->processZrtpMessage(pkt.data.data() + 12, pkt.target->peer->ssrc, pkt.data.size());
+            packets.pop_front();
+        }
+        else if (a.timerActive) {
+            a.timerActive = false;
+            a.engine->processTimeout();
+        }
+        else if (b.timerActive) {
+            b.timerActive = false;
+            b.engine->processTimeout();
+        }
+        else
+            done = true;
+    }
+    countAllocations = false;
+    *allocs = engineAllocations - allocsStart;
+    *bnAllocs = ZrtpDH::getHeapAllocations() - bnAllocsStart;
+    return a.secure && b.secure;
+}
+
+/*
+ * A pair of engines and their endpoints. A multi-stream pair uses the
+ * engines of a master pair.
+ */
+class Engines {
+public:
+    Engines(const char* pkName, Engines* master = NULL);
+    ~Engines();
+
+    Endpoint a;
+    Endpoint b;
+    ZrtpConfigure config;
+    uint64_t allocs;
+    uint64_t bnAllocs;
+    bool secure;
+};
+
+Engines::Engines(const char* pkName, Engines* master): a(0x1111), b(0x2222), allocs(0), bnAllocs(0), secure(false)
+{
+    uint8_t zidA[IDENTIFIER_LEN];
+    uint8_t zidB[IDENTIFIER_LEN];
+    memset(zidA, 0xa1, sizeof(zidA));
+    memset(zidB, 0xb2, sizeof(zidB));
+
+    config.setStandardConfig();
+    config.addAlgoAt(PubKeyAlgorithm, zrtpPubKeys.getByName(pkName), 0);
+
+    a.peer = &b;
+    b.peer = &a;
+    a.engine = new ZRtp(zidA, &a, "handshakeTest", &config);
+    b.engine = new ZRtp(zidB, &b, "handshakeTest", &config);
+    if (master != NULL) {
+        a.engine->setMultiStrMaster(master->a.engine);
+        b.engine->setMultiStrMaster(master->b.engine);
+    }
+    a.startFootprint = a.engine->getMemoryFootprint();
+    b.startFootprint = b.engine->getMemoryFootprint();
+    secure = runHandshake(a, b, &allocs, &bnAllocs);
+}
+
+Engines::~Engines()
+{
+    packets.clear();
+    delete a.engine;
+    delete b.engine;
+}
+
+static int dhHandshake(const char* pkName) {
+    Engines pair(pkName);
+    Endpoint& a = pair.a;
+    Endpoint& b = pair.b;
+
+    int failures = 0;
+    if (!pair.secure) {
+        fprintf(stderr, "%s: handshake did not reach SecureState\n", pkName);
+        failures++;
+    }
+    else {
+        if (!a.engine->inState(SecureState) || !b.engine->inState(SecureState)) {
+            fprintf(stderr, "%s: engine reported SecureState but is not in SecureState\n", pkName);
+            failures++;
+        }
+        if (a.keyInitiator.empty() || a.keyInitiator != b.keyInitiator || a.keyResponder != b.keyResponder) {
+            fprintf(stderr, "%s: SRTP keys differ\n", pkName);
+            failures++;
+        }
+        if (a.sas.empty() || a.sas != b.sas) {
+            fprintf(stderr, "%s: SAS differs: '%s' '%s'\n", pkName, a.sas.c_str(), b.sas.c_str());
+            failures++;
+        }
+        Endpoint* ep[2] = {&a, &b};
+        for (int i = 0; i < 2; i++) {
+            if (ep[i]->secureFootprint + handshakeBuffers > ep[i]->startFootprint) {
+                fprintf(stderr, "%s: handshake data not released, footprint %zu bytes, %zu bytes at start\n",
+                        pkName, ep[i]->secureFootprint, ep[i]->startFootprint);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+static int handshakeAllocations(const char* pkName) {
+    Engines first(pkName);
+    Engines master(pkName);
+    Engines multi(pkName, &master);
+    int failures = 0;
+
+    if (!first.secure || !master.secure || !multi.secure) {
+        fprintf(stderr, "%s allocations: handshake did not reach SecureState\n", pkName);
+        return 1;
+    }
+    if (master.allocs > maxDhAllocs || master.bnAllocs > maxDhBnAllocs) {
+        fprintf(stderr, "%s allocations: DH handshake %llu allocations, %llu big number allocations\n", pkName,
+                (unsigned long long)master.allocs, (unsigned long long)master.bnAllocs);
+        failures++;
+    }
+    if (multi.allocs > maxMultiAllocs || multi.bnAllocs > 0) {
+        fprintf(stderr, "%s allocations: multi-stream handshake %llu allocations, %llu big number allocations\n",
+                pkName, (unsigned long long)multi.allocs, (unsigned long long)multi.bnAllocs);
+        failures++;
+    }
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    int failures = 0;
+
+    remove(cacheName);
+    if (getZidCacheInstance()->open(cacheName) <= 0) {
+        fprintf(stderr, "Cannot open ZID cache file %s\n", cacheName);
+        return 1;
+    }
+    failures += dhHandshake("EC25");
+    failures += dhHandshake("DH3k");
+
+    const char* pkNames[] = {"DH2k", "DH3k", "EC25", "EC38", "E255"};
+    for (size_t i = 0; i < sizeof(pkNames) / sizeof(pkNames[0]); i++)
+        failures += handshakeAllocations(pkNames[i]);
+
+    getZidCacheInstance()->close();
+    remove(cacheName);
+
+    printf("handshakeTest: %d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Tests of the SRTP and SRTCP crypto contexts.
+ *
+ * Protects and unprotects RTP and RTCP packets with HMAC-SHA256
+ * authentication. The SHA256 digest is longer than the SHA1 digest, a too
+ * short digest buffer shows up as stack-buffer-overflow if the library is
+ * built with -fsanitize=address. The SRTCP context needs the key length
+ * of this algorithm to derive its authentication key.
+ *
+ * A fresh SRTCP context must detect a replayed first packet. The replay
+ * test constructs the receiver context in memory filled with a pattern,
+ * thus an uninitialized replay state does not happen to be zero.
+ *
+ * The standalone hmac_sha1() functions must link with the prototypes of
+ * hmac.h and compute the RFC 2202 test vectors.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#include <srtp/SrtpHandler.h>
+#include <srtp/CryptoContext.h>
+#include <srtp/CryptoContextCtrl.h>
+#include <srtp/crypto/hmac.h>
+#include <common/osSpecifics.h>
+
+static const int32_t rtpHeaderLength = 12;
+static const int32_t rtcpHeaderLength = 8;
+static const int32_t payloadLength = 160;
+static const int32_t sha256KeyLength = 32;
+static const int32_t trailerRoom = 64;           // SRTCP index and tag
+
+static uint8_t masterKey[16];
+static uint8_t masterSalt[14];
+
+static CryptoContext* newSrtpContext(int32_t tagLength) {
+    CryptoContext* cc = new CryptoContext(0xfeedbacc, 0, 0L, SrtpEncryptionAESCM, SrtpAuthenticationSha256Hmac,
+                                          masterKey, sizeof(masterKey), masterSalt, sizeof(masterSalt),
+                                          sizeof(masterKey), sha256KeyLength, sizeof(masterSalt), tagLength);
+    cc->deriveSrtpKeys(0);
+    return cc;
+}
+
+static CryptoContextCtrl* newSrtcpContext(int32_t tagLength) {
+    CryptoContextCtrl* cc = new CryptoContextCtrl(0xfeedbacc, SrtpEncryptionAESCM, SrtpAuthenticationSha256Hmac,
+                                                  masterKey, sizeof(masterKey), masterSalt, sizeof(masterSalt),
+                                                  sizeof(masterKey), sha256KeyLength, sizeof(masterSalt), tagLength);
+    cc->deriveSrtcpKeys();
+    return cc;
+}
+
+static void fillRtp(uint8_t* buffer, uint16_t seq) {
+    buffer[0] = 0x80;
+    buffer[1] = 0x00;
+    *reinterpret_cast<uint16_t*>(buffer + 2) = zrtpHtons(seq);
+    *reinterpret_cast<uint32_t*>(buffer + 4) = zrtpHtonl(seq * 160U);
+    *reinterpret_cast<uint32_t*>(buffer + 8) = zrtpHtonl(0xfeedbacc);
+    for (int32_t i = 0; i < payloadLength; i++)
+        buffer[rtpHeaderLength + i] = static_cast<uint8_t>(seq + i);
+}
+
+static void fillRtcp(uint8_t* buffer, uint8_t fill) {
+    buffer[0] = 0x80;
+    buffer[1] = 200;                                    // sender report
+    *reinterpret_cast<uint16_t*>(buffer + 2) = zrtpHtons((rtcpHeaderLength + payloadLength) / 4 - 1);
+    *reinterpret_cast<uint32_t*>(buffer + 4) = zrtpHtonl(0xfeedbacc);
+    memset(buffer + rtcpHeaderLength, fill, payloadLength);
+}
+
+static int srtpRoundTrip(int32_t tagLength) {
+    uint8_t packet[rtpHeaderLength + payloadLength + trailerRoom];
+    uint8_t plain[rtpHeaderLength + payloadLength];
+    CryptoContext* send = newSrtpContext(tagLength);
+    CryptoContext* recv = newSrtpContext(tagLength);
+    int failures = 0;
+
+    for (uint16_t seq = 1; seq <= 3; seq++) {
+        size_t newLength = 0;
+        fillRtp(packet, seq);
+        memcpy(plain, packet, sizeof(plain));
+
+        SrtpHandler::protect(send, packet, sizeof(plain), &newLength);
+        if (newLength != sizeof(plain) + tagLength) {
+            fprintf(stderr, "SRTP SHA256-%d: protected length %zu\n", tagLength * 8, newLength);
+            failures++;
+            break;
+        }
+        int32_t rc = SrtpHandler::unprotect(recv, packet, newLength, &newLength);
+        if (rc != 1 || newLength != sizeof(plain) || memcmp(packet, plain, sizeof(plain)) != 0) {
+            fprintf(stderr, "SRTP SHA256-%d: unprotect of packet %d failed: %d\n", tagLength * 8, seq, rc);
+            failures++;
+            break;
+        }
+    }
+    delete send;
+    delete recv;
+    return failures;
+}
+
+static int srtcpRoundTrip(int32_t tagLength) {
+    uint8_t packet[rtcpHeaderLength + payloadLength + trailerRoom];
+    uint8_t plain[rtcpHeaderLength + payloadLength];
+    CryptoContextCtrl* send = newSrtcpContext(tagLength);
+    CryptoContextCtrl* recv = newSrtcpContext(tagLength);
+    int failures = 0;
+
+    for (uint8_t i = 1; i <= 3; i++) {
+        size_t newLength = 0;
+        fillRtcp(packet, i);
+        memcpy(plain, packet, sizeof(plain));
+
+        SrtpHandler::protectCtrl(send, packet, sizeof(plain), &newLength);
+        if (newLength != sizeof(plain) + sizeof(uint32_t) + tagLength) {
+            fprintf(stderr, "SRTCP SHA256-%d: protected length %zu\n", tagLength * 8, newLength);
+            failures++;
+            break;
+        }
+        int32_t rc = SrtpHandler::unprotectCtrl(recv, packet, newLength, &newLength);
+        if (rc != 1 || newLength != sizeof(plain) || memcmp(packet, plain, sizeof(plain)) != 0) {
+            fprintf(stderr, "SRTCP SHA256-%d: unprotect of packet %d failed: %d\n", tagLength * 8, i, rc);
+            failures++;
+            break;
+        }
+    }
+    delete send;
+    delete recv;
+    return failures;
+}
+
+static int srtcpReplay() {
+    uint8_t packets[3][rtcpHeaderLength + payloadLength + trailerRoom];
+    size_t lengths[3];
+    CryptoContextCtrl* send = newSrtcpContext(8);
+    int failures = 0;
+
+    alignas(CryptoContextCtrl) uint8_t memory[sizeof(CryptoContextCtrl)];
+    memset(memory, 0xa5, sizeof(memory));
+    CryptoContextCtrl* recv = new (memory) CryptoContextCtrl(0xfeedbacc, SrtpEncryptionAESCM, SrtpAuthenticationSha256Hmac,
+                                                             masterKey, sizeof(masterKey), masterSalt, sizeof(masterSalt),
+                                                             sizeof(masterKey), sha256KeyLength, sizeof(masterSalt), 8);
+    recv->deriveSrtcpKeys();
+
+    for (int i = 0; i < 3; i++) {
+        fillRtcp(packets[i], static_cast<uint8_t>(i));
+        SrtpHandler::protectCtrl(send, packets[i], rtcpHeaderLength + payloadLength, &lengths[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        uint8_t copy[sizeof(packets[i])];
+        size_t newLength;
+        memcpy(copy, packets[i], lengths[i]);
+        int32_t rc = SrtpHandler::unprotectCtrl(recv, copy, lengths[i], &newLength);
+        if (rc != 1) {
+            fprintf(stderr, "SRTCP replay: packet %d rejected: %d\n", i, rc);
+            failures++;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        size_t newLength;
+        int32_t rc = SrtpHandler::unprotectCtrl(recv, packets[i], lengths[i], &newLength);
+        if (rc != -2) {
+            fprintf(stderr, "SRTCP replay: replayed packet %d not rejected: %d\n", i, rc);
+            failures++;
+        }
+    }
+    delete send;
+    recv->~CryptoContextCtrl();
+    return failures;
+}
+
+static int hmacSha1Vectors() {
+    // RFC 2202, test cases 1 and 2
+    static const uint8_t key1[20] = {
+        0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+        0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b
+    };
+    static const uint8_t mac1[SHA1_DIGEST_SIZE] = {
+        0xb6, 0x17, 0x31, 0x86, 0x55, 0x05, 0x72, 0x64, 0xe2, 0x8b,
+        0xc0, 0xb6, 0xfb, 0x37, 0x8c, 0x8e, 0xf1, 0x46, 0xbe, 0x00
+    };
+    static const uint8_t mac2[SHA1_DIGEST_SIZE] = {
+        0xef, 0xfc, 0xdf, 0x6a, 0xe5, 0xeb, 0x2f, 0xa2, 0xd2, 0x74,
+        0x16, 0xd5, 0xf1, 0x84, 0xdf, 0x9c, 0x25, 0x9a, 0x7c, 0x79
+    };
+    const uint8_t* data1 = reinterpret_cast<const uint8_t*>("Hi There");
+    const uint8_t* key2 = reinterpret_cast<const uint8_t*>("Jefe");
+    const uint8_t* data2 = reinterpret_cast<const uint8_t*>("what do ya want for nothing?");
+    uint8_t mac[SHA1_DIGEST_SIZE];
+    int32_t macLength = 0;
+    int failures = 0;
+
+    hmac_sha1(key1, static_cast<int64_t>(sizeof(key1)), data1, 8, mac, &macLength);
+    if (macLength != SHA1_DIGEST_SIZE || memcmp(mac, mac1, SHA1_DIGEST_SIZE) != 0) {
+        fprintf(stderr, "HMAC-SHA1: RFC 2202 test case 1 failed\n");
+        failures++;
+    }
+
+    DataChunks chunks;
+    chunks.add(data2, 13);
+    chunks.add(data2 + 13, 15);
+    macLength = 0;
+    hmac_sha1(key2, static_cast<uint64_t>(4), chunks, mac, &macLength);
+    if (macLength != SHA1_DIGEST_SIZE || memcmp(mac, mac2, SHA1_DIGEST_SIZE) != 0) {
+        fprintf(stderr, "HMAC-SHA1: RFC 2202 test case 2 failed\n");
+        failures++;
+    }
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    int failures = 0;
+
+    failures += srtpRoundTrip(4);
+    failures += srtpRoundTrip(8);
+    failures += srtcpRoundTrip(4);
+    failures += srtcpRoundTrip(8);
+    failures += srtcpReplay();
+    failures += hmacSha1Vectors();
+
+    printf("srtpTest: %d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -161,6 +161,7 @@ ZIDCacheFile::~ZIDCacheFile() {
 }
 
 int ZIDCacheFile::open(char* name) {
+    std::lock_guard<std::mutex> lock(fileLock);
 
     // check for an already active ZID file
     if (zidFile != NULL) {
@@ -190,6 +191,7 @@ int ZIDCacheFile::open(char* name) {
 }
 
 void ZIDCacheFile::close() {
+    std::lock_guard<std::mutex> lock(fileLock);
 
     if (zidFile != NULL) {
         fclose(zidFile);
@@ -200,6 +202,7 @@ void ZIDCacheFile::close() {
 ZIDRecord *ZIDCacheFile::getRecord(unsigned char *zid) {
     unsigned long pos;
     int numRead;
+    std::lock_guard<std::mutex> lock(fileLock);
     //    ZIDRecordFile rec;
     ZIDRecordFile *zidRecord = new ZIDRecordFile();
 
@@ -239,6 +242,7 @@ ZIDRecord *ZIDCacheFile::getRecord(unsigned char *zid) {
 
 unsigned int ZIDCacheFile::saveRecord(ZIDRecord *zidRec) {
     ZIDRecordFile *zidRecord = reinterpret_cast<ZIDRecordFile *>(zidRec);
+    std::lock_guard<std::mutex> lock(fileLock);
 
     fseek(zidFile, zidRecord->getPosition(), SEEK_SET);
     if (fwrite(zidRecord->getRecordData(), zidRecord->getRecordLength(), 1, zidFile) < 1)
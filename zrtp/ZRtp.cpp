@@ -17,6 +17,7 @@
 /*
  * Authors: Werner Dittmann <Werner.Dittmann@t-online.de>
  */
+#include <new>
 #include <sstream>
 
 #include <crypto/zrtpDH.h>
@@ -32,11 +33,21 @@
 
 #include <libzrtpcpp/ZRtp.h>
 #include <libzrtpcpp/ZrtpStateClass.h>
+#include <libzrtpcpp/ZrtpMultiStreamGroup.h>
 #include <libzrtpcpp/Base32.h>
 #include <libzrtpcpp/EmojiBase32.h>
 
 using namespace GnuZrtpCodes;
 
+/*
+ * memset_volatile is a volatile pointer to the memset function.
+ * You can call (*memset_volatile)(buf, val, len) or even
+ * memset_volatile(buf, val, len) just as you would call
+ * memset(buf, val, len), but the use of a volatile pointer
+ * guarantees that the compiler will not optimise the call away.
+ */
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+
 /*
  * This method simplifies detection of libzrtpcpp inside Automake, configure
  * and friends
@@ -53,11 +64,38 @@ extern "C" {
 #endif
 
 ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* config, bool mitm, bool sasSignSupport):
-        callback(cb), dhContext(nullptr), DHss(nullptr), auxSecret(nullptr), auxSecretLength(0), rs1Valid(false),
-        rs2Valid(false), msgShaContext(nullptr), hash(nullptr), cipher(nullptr), pubKey(nullptr), sasType(nullptr), authLength(nullptr),
-        multiStream(false), multiStreamAvailable(false), peerIsEnrolled(false), mitmSeen(false), pbxSecretTmp(nullptr),
-        enrollmentMode(false), configureAlgos(*config), zidRec(nullptr), saveZidRecord(true), signSasSeen(false),
-        masterStream(nullptr), peerDisclosureFlagSeen(false) {
+        stateEngine(nullptr), callback(cb), dhContext(nullptr), DHss(nullptr), auxSecret(nullptr), auxSecretLength(0),
+        msgShaContext(nullptr), zidRec(nullptr), handshake(nullptr) {
+
+    initialize(myZid, id, config, mitm, sasSignSupport);
+    stateEngine = new ZrtpStateClass(this);
+}
+
+void ZRtp::initialize(uint8_t *myZid, std::string id, ZrtpConfigure* config, bool mitm, bool sasSignSupport) {
+
+    allocateHandshakeData();
+
+    rs1Valid = false;
+    rs2Valid = false;
+    hash = nullptr;
+    cipher = nullptr;
+    pubKey = nullptr;
+    sasType = nullptr;
+    authLength = nullptr;
+    multiStream = false;
+    multiStreamAvailable = false;
+    peerIsEnrolled = false;
+    mitmSeen = false;
+    pbxSecretTmp = nullptr;
+    enrollmentMode = false;
+    configureAlgos = *config;
+    saveZidRecord = true;
+    signSasSeen = false;
+    masterStream = nullptr;
+    streamGroup = nullptr;
+    streamGroupIndex = 0;
+    peerDisclosureFlagSeen = false;
+    memset(&multiStrParams, 0, sizeof(multiStrParams));
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
     enableMitmEnrollment = config->isTrustedMitM();
@@ -67,7 +105,10 @@ ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* conf
 #endif
 
     signatureData = nullptr;
+    signatureLength = 0;
+    memset(&detailInfo, 0, sizeof(detailInfo));
     paranoidMode = config->isParanoidMode();
+    peerNonces.setMaxNonces(config->getMaxMultiStreams());
     sasSignSupport = config->isSasSignature();
 
     // setup the implicit hash function pointers and length. The casts show that we use different
@@ -88,14 +129,17 @@ ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* conf
     sha256(H1, HASH_IMAGE_SIZE, H2);        // H2
     sha256(H2, HASH_IMAGE_SIZE, H3);        // H3
 
-    // configure all supported Hello packet versions
-    zrtpHello_11.configureHello(&configureAlgos);
+    // configure all supported Hello packet versions, copy the algorithm data
+    // from the template that all engines with the same configuration share
+    std::shared_ptr<const ZrtpPacketHello> helloTemplate = config->getHelloTemplate();
+
+    zrtpHello_11.configureHello(*helloTemplate);
     zrtpHello_11.setH3(H3);                    // set H3 in Hello, included in helloHash
     zrtpHello_11.setZid(ownZid);
     zrtpHello_11.setVersion((uint8_t*)zrtpVersion_11);
 
 
-    zrtpHello_12.configureHello(&configureAlgos);
+    zrtpHello_12.configureHello(*helloTemplate);
     zrtpHello_12.setH3(H3);                 // set H3 in Hello, included in helloHash
     zrtpHello_12.setZid(ownZid);
     zrtpHello_12.setVersion((uint8_t*)zrtpVersion_12);
@@ -112,33 +156,119 @@ ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* conf
     // Keep array in ascending order (greater index -> greater version)
     helloPackets[0].packet = &zrtpHello_11;
     helloPackets[0].version = zrtpHello_11.getVersionInt();
-    setClientId(id, &helloPackets[0]);      // set id, compute HMAC and final helloHash
+    setClientId(id, &helloPackets[0]);      // set id, HMAC and final helloHash on first use
 
     helloPackets[1].packet = &zrtpHello_12;
     helloPackets[1].version = zrtpHello_12.getVersionInt();
-    setClientId(id, &helloPackets[1]);      // set id, compute HMAC and final helloHash
+    setClientId(id, &helloPackets[1]);      // set id, HMAC and final helloHash on first use
  
     currentHelloPacket = helloPackets[SUPPORTED_ZRTP_VERSIONS-1].packet;  // start with highest supported version
+    computeHelloHmac(&helloPackets[SUPPORTED_ZRTP_VERSIONS-1]);
     helloPackets[SUPPORTED_ZRTP_VERSIONS].packet = nullptr;
     peerHelloVersion[0] = 0;
+    peerClientId[0] = 0;
+    memset(&traceInfo, 0, sizeof(traceInfo));
 
-    stateEngine = new ZrtpStateClass(this);
 }
 
 ZRtp::~ZRtp() {
-    stopZrtp();
-    if (DHss != nullptr) {
-        delete DHss;
-        DHss = nullptr;
-    }
+    clearSession();
+    releaseHandshakeData();
     if (stateEngine != nullptr) {
         delete stateEngine;
         stateEngine = nullptr;
     }
+}
+
+/*
+ * Some packet setters modify the packet length or set flags, thus construct
+ * the packets again in place before the engine starts a new session.
+ */
+template <class T> static void reinitPacket(T& packet) {
+    packet.~T();
+    new (&packet) T();
+}
+
+void ZRtp::reset(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* config, bool mitm, bool sasSignSupport) {
+    clearSession();
+
+    reinitPacket(zrtpHelloAck);
+    reinitPacket(zrtpConf2Ack);
+    reinitPacket(zrtpGoClear);
+    reinitPacket(zrtpError);
+    reinitPacket(zrtpErrorAck);
+    reinitPacket(zrtpPingAck);
+    reinitPacket(zrtpSasRelay);
+    reinitPacket(zrtpRelayAck);
+
+    callback = cb;
+    initialize(myZid, id, config, mitm, sasSignSupport);
+}
+
+void ZRtp::freeDhData() {
     if (dhContext != nullptr) {
-        delete dhContext;
+        dhContext->~ZrtpDH();
         dhContext = nullptr;
     }
+    DHss = nullptr;
+
+    // The DH context and the DH result are the only users of the arena
+    memset_volatile(handshake->arena, 0, handshake->arenaUsed);
+    handshake->arenaUsed = 0;
+}
+
+ZrtpDH* ZRtp::createDhContext(const char* type) {
+    freeDhData();
+    void* memory = handshake->allocate(sizeof(ZrtpDH));
+    if (memory == nullptr)
+        return nullptr;
+    return new (memory) ZrtpDH(type);
+}
+
+void ZRtp::allocateHandshakeData() {
+    if (handshake != nullptr) {
+        handshake->~HandshakeData();
+        new (handshake) HandshakeData();
+    }
+    else {
+        handshake = new HandshakeData();
+    }
+}
+
+void ZRtp::releaseHandshakeData() {
+    if (handshake != nullptr) {
+        // The key generation already freed the DH data, do it here in case
+        // the handshake took an unusual path
+        freeDhData();
+        memset_volatile(handshake->pubKeyBytes, 0, sizeof(handshake->pubKeyBytes));
+        memset_volatile(handshake->tempMsgBuffer, 0, sizeof(handshake->tempMsgBuffer));
+        delete handshake;
+        handshake = nullptr;
+    }
+    if (msgShaContext != nullptr) {
+        closeHashCtx(msgShaContext, nullptr);
+        msgShaContext = nullptr;
+    }
+    // Keep the H chain: a restarted engine sends the same Hello and must
+    // reveal the matching H0 - H2
+    memset_volatile(s0, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(newRs1, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(messageHash, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(&hashCtx, 0, sizeof(hashCtx));
+}
+
+void ZRtp::clearSession() {
+    // Stopping the engine may cancel a timer, skip it if the engine is
+    // already cleared and has no callback
+    if (callback != nullptr) {
+        stopZrtp();
+        if (stateEngine != nullptr) {
+            stateEngine->reset();
+        }
+    }
+    callback = nullptr;
+    if (handshake != nullptr)
+        freeDhData();
     if (msgShaContext != nullptr) {
         closeHashCtx(msgShaContext, nullptr);
         msgShaContext = nullptr;
@@ -152,24 +282,47 @@ ZRtp::~ZRtp() {
         delete zidRec;
         zidRec = nullptr;
     }
-    memset(hmacKeyI, 0, MAX_DIGEST_LENGTH);
-    memset(hmacKeyR, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(hmacKeyI, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(hmacKeyR, 0, MAX_DIGEST_LENGTH);
 
-    memset(zrtpKeyI, 0, MAX_DIGEST_LENGTH);
-    memset(zrtpKeyR, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(zrtpKeyI, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(zrtpKeyR, 0, MAX_DIGEST_LENGTH);
     /*
      * Clear the Initiator's srtp key and salt
      */
-    memset(srtpKeyI, 0, MAX_DIGEST_LENGTH);
-    memset(srtpSaltI, 0,  MAX_DIGEST_LENGTH);
+    memset_volatile(srtpKeyI, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(srtpSaltI, 0,  MAX_DIGEST_LENGTH);
     /*
      * Clear he Responder's srtp key and salt
      */
-    memset(srtpKeyR, 0, MAX_DIGEST_LENGTH);
-    memset(srtpSaltR, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(srtpKeyR, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(srtpSaltR, 0, MAX_DIGEST_LENGTH);
 
-    memset(zrtpSession, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(zrtpSession, 0, MAX_DIGEST_LENGTH);
+    publishMultiStrParams(false);
 
+    /*
+     * Clear the other secrets and the handshake data, an engine may be
+     * reused for another session, refer to reset()
+     */
+    memset_volatile(zrtpExport, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(s0, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(newRs1, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(pbxSecretTmpBuffer, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(H0, 0, IMPL_MAX_DIGEST_LENGTH);
+    memset_volatile(H1, 0, IMPL_MAX_DIGEST_LENGTH);
+    memset_volatile(H2, 0, IMPL_MAX_DIGEST_LENGTH);
+    memset_volatile(messageHash, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(sasHash, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(&hashCtx, 0, sizeof(hashCtx));
+    if (handshake != nullptr) {
+        memset_volatile(handshake->pubKeyBytes, 0, sizeof(handshake->pubKeyBytes));
+        memset_volatile(handshake->tempMsgBuffer, 0, sizeof(handshake->tempMsgBuffer));
+        handshake->lengthOfMsgData = 0;
+    }
+
+    SAS.clear();
+    peerClientId[0] = 0;
     peerNonces.clear();
 }
 
@@ -224,6 +377,13 @@ void ZRtp::startZrtpEngine() {
     Event ev;
 
     if (stateEngine != nullptr && stateEngine->inState(Initial)) {
+        // The engine released the handshake data when it entered SecureState
+        // of a previous run
+        if (handshake == nullptr)
+            allocateHandshakeData();
+        else
+            freeDhData();           // a previous run may have stopped during the DH exchange
+        ZrtpTrace::start(&traceInfo);
         ev.type = ZrtpInitial;
         stateEngine->processEvent(&ev);
     }
@@ -270,7 +430,7 @@ ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg)
         return nullptr;
     }
     // Save data before detailed checks - may aid in analysing problems
-    peerClientId.assign((char*)hello->getClientId(), ZRTP_WORD_SIZE * 4);
+    memcpy(peerClientId, hello->getClientId(), ZRTP_WORD_SIZE * 4);
     memcpy(peerHelloVersion, hello->getVersion(), ZRTP_WORD_SIZE);
     peerHelloVersion[ZRTP_WORD_SIZE] = 0;
 
@@ -332,10 +492,17 @@ ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg)
 
     // Modify here when introducing new DH key agreement, for example
     // elliptic curves.
-    dhContext = new ZrtpDH(pubKey->getName());
-    dhContext->generatePublicKey();
+    {
+        ZrtpTraceTimer traceTimer(traceInfo, TraceDhKeyGen);
+        dhContext = createDhContext(pubKey->getName());
+        if (dhContext == nullptr) {
+            *errMsg = CriticalSWError;
+            return nullptr;
+        }
+        dhContext->generatePublicKey();
+    }
 
-    dhContext->getPubKeyBytes(pubKeyBytes);
+    dhContext->getPubKeyBytes(handshake->pubKeyBytes);
     sendInfo(Info, InfoCommitDHGenerated);
 
     // Prepare IV data that we will use during confirm packet encryption.
@@ -347,7 +514,10 @@ ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg)
      * To create this DH packet we have to compute the retained secret ids,
      * thus get our peer's retained secret data first.
      */
-    zidRec = getZidCacheInstance()->getRecord(peerZid);
+    {
+        ZrtpTraceTimer traceTimer(traceInfo, TraceCacheRead);
+        zidRec = getZidCacheInstance()->getRecord(peerZid);
+    }
 
     //Compute the Initiator's and Responder's retained secret ids.
     computeSharedSecretSet(zidRec);
@@ -364,81 +534,81 @@ ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg)
     // chapter 5.4.1.1.
 
     // Fill the values in the DHPart2 packet
-    zrtpDH2.setPubKeyType(pubKey->getName());
-    zrtpDH2.setMessageType((uint8_t*)DHPart2Msg);
-    zrtpDH2.setRs1Id(rs1IDi);
-    zrtpDH2.setRs2Id(rs2IDi);
-    zrtpDH2.setAuxSecretId(auxSecretIDi);
-    zrtpDH2.setPbxSecretId(pbxSecretIDi);
-    zrtpDH2.setPv(pubKeyBytes);
-    zrtpDH2.setH1(H1);
+    handshake->zrtpDH2.setPubKeyType(pubKey->getName());
+    handshake->zrtpDH2.setMessageType((uint8_t*)DHPart2Msg);
+    handshake->zrtpDH2.setRs1Id(rs1IDi);
+    handshake->zrtpDH2.setRs2Id(rs2IDi);
+    handshake->zrtpDH2.setAuxSecretId(auxSecretIDi);
+    handshake->zrtpDH2.setPbxSecretId(pbxSecretIDi);
+    handshake->zrtpDH2.setPv(handshake->pubKeyBytes);
+    handshake->zrtpDH2.setH1(H1);
 
-    uint32_t len = zrtpDH2.getLength() * ZRTP_WORD_SIZE;
+    uint32_t len = handshake->zrtpDH2.getLength() * ZRTP_WORD_SIZE;
 
     // Compute HMAC over DH2, excluding the HMAC field (HMAC_SIZE)
     // and store in DH2. Key to HMAC is H0, use HASH_IMAGE_SIZE bytes only.
     // Must use implicit HMAC functions.
     uint8_t hmac[IMPL_MAX_DIGEST_LENGTH];
     uint32_t macLen;
-    hmacFunctionImpl(H0, HASH_IMAGE_SIZE, (uint8_t*)zrtpDH2.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
-    zrtpDH2.setHMAC(hmac);
+    hmacFunctionImpl(H0, HASH_IMAGE_SIZE, (uint8_t*)handshake->zrtpDH2.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
+    handshake->zrtpDH2.setHMAC(hmac);
 
     // Compute the HVI, refer to chapter 5.4.1.1 of the specification
-    computeHvi(&zrtpDH2, hello);
+    computeHvi(&handshake->zrtpDH2, hello);
 
-    zrtpCommit.setZid(ownZid);
-    zrtpCommit.setHashType((uint8_t*)hash->getName());
-    zrtpCommit.setCipherType((uint8_t*)cipher->getName());
-    zrtpCommit.setAuthLen((uint8_t*)authLength->getName());
-    zrtpCommit.setPubKeyType((uint8_t*)pubKey->getName());
-    zrtpCommit.setSasType((uint8_t*)sasType->getName());
-    zrtpCommit.setHvi(hvi);
-    zrtpCommit.setH2(H2);
+    handshake->zrtpCommit.setZid(ownZid);
+    handshake->zrtpCommit.setHashType((uint8_t*)hash->getName());
+    handshake->zrtpCommit.setCipherType((uint8_t*)cipher->getName());
+    handshake->zrtpCommit.setAuthLen((uint8_t*)authLength->getName());
+    handshake->zrtpCommit.setPubKeyType((uint8_t*)pubKey->getName());
+    handshake->zrtpCommit.setSasType((uint8_t*)sasType->getName());
+    handshake->zrtpCommit.setHvi(hvi);
+    handshake->zrtpCommit.setH2(H2);
 
-    len = zrtpCommit.getLength() * ZRTP_WORD_SIZE;
+    len = handshake->zrtpCommit.getLength() * ZRTP_WORD_SIZE;
 
     // Compute HMAC over Commit, excluding the HMAC field (HMAC_SIZE)
     // and store in Hello. Key to HMAC is H1, use HASH_IMAGE_SIZE bytes only.
     // Must use implicit HMAC functions.
-    hmacFunctionImpl(H1, HASH_IMAGE_SIZE, (uint8_t*)zrtpCommit.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
-    zrtpCommit.setHMAC(hmac);
+    hmacFunctionImpl(H1, HASH_IMAGE_SIZE, (uint8_t*)handshake->zrtpCommit.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
+    handshake->zrtpCommit.setHMAC(hmac);
 
     // hash first messages to produce overall message hash
     // First the Responder's Hello message, second the Commit (always Initator's).
     // Must use negotiated hash.
     msgShaContext = createHashCtx(msgShaContext);
     hashCtxFunction(msgShaContext, (unsigned char*)hello->getHeaderBase(), helloLen);
-    hashCtxFunction(msgShaContext, (unsigned char*)zrtpCommit.getHeaderBase(), len);
+    hashCtxFunction(msgShaContext, (unsigned char*)handshake->zrtpCommit.getHeaderBase(), len);
 
     // store Hello data temporarily until we can check HMAC after receiving Commit as
     // Responder or DHPart1 as Initiator
     storeMsgTemp(hello);
 
-    return &zrtpCommit;
+    return &handshake->zrtpCommit;
 }
 
 ZrtpPacketCommit* ZRtp::prepareCommitMultiStream(ZrtpPacketHello *hello) {
 
     randomZRTP(hvi, ZRTP_WORD_SIZE*4);  // This is the Multi-Stream NONCE size
 
-    zrtpCommit.setZid(ownZid);
-    zrtpCommit.setHashType((uint8_t*)hash->getName());
-    zrtpCommit.setCipherType((uint8_t*)cipher->getName());
-    zrtpCommit.setAuthLen((uint8_t*)authLength->getName());
-    zrtpCommit.setPubKeyType((uint8_t*)mult);  // this is fixed because of Multi Stream mode
-    zrtpCommit.setSasType((uint8_t*)sasType->getName());
-    zrtpCommit.setNonce(hvi);
-    zrtpCommit.setH2(H2);
+    handshake->zrtpCommit.setZid(ownZid);
+    handshake->zrtpCommit.setHashType((uint8_t*)hash->getName());
+    handshake->zrtpCommit.setCipherType((uint8_t*)cipher->getName());
+    handshake->zrtpCommit.setAuthLen((uint8_t*)authLength->getName());
+    handshake->zrtpCommit.setPubKeyType((uint8_t*)mult);  // this is fixed because of Multi Stream mode
+    handshake->zrtpCommit.setSasType((uint8_t*)sasType->getName());
+    handshake->zrtpCommit.setNonce(hvi);
+    handshake->zrtpCommit.setH2(H2);
 
-    uint32_t len = zrtpCommit.getLength() * ZRTP_WORD_SIZE;
+    uint32_t len = handshake->zrtpCommit.getLength() * ZRTP_WORD_SIZE;
 
     // Compute HMAC over Commit, excluding the HMAC field (HMAC_SIZE)
     // and store in Hello. Key to HMAC is H1, use HASH_IMAGE_SIZE bytes only.
     // Must use the implicit HMAC function.
     uint8_t hmac[IMPL_MAX_DIGEST_LENGTH];
     uint32_t macLen;
-    hmacFunctionImpl(H1, HASH_IMAGE_SIZE, (uint8_t*)zrtpCommit.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
-    zrtpCommit.setHMACMulti(hmac);
+    hmacFunctionImpl(H1, HASH_IMAGE_SIZE, (uint8_t*)handshake->zrtpCommit.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
+    handshake->zrtpCommit.setHMACMulti(hmac);
 
 
     // hash first messages to produce overall message hash
@@ -449,13 +619,13 @@ ZrtpPacketCommit* ZRtp::prepareCommitMultiStream(ZrtpPacketHello *hello) {
 
     uint32_t helloLen = hello->getLength() * ZRTP_WORD_SIZE;
     hashCtxFunction(msgShaContext, (unsigned char*)hello->getHeaderBase(), helloLen);
-    hashCtxFunction(msgShaContext, (unsigned char*)zrtpCommit.getHeaderBase(), len);
+    hashCtxFunction(msgShaContext, (unsigned char*)handshake->zrtpCommit.getHeaderBase(), len);
 
     // store Hello data temporarily until we can check HMAC after receiving Commit as
     // Responder or DHPart1 as Initiator
     storeMsgTemp(hello);
 
-    return &zrtpCommit;
+    return &handshake->zrtpCommit;
 }
 
 /*
@@ -564,37 +734,41 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart1(ZrtpPacketCommit *commit, uint32_t* errMs
     // if not delete old DH context and generate new one
     // The algorithm names are 4 chars only, thus we can cast to int32_t
     if (*(int32_t*)(dhContext->getDHtype()) != *(int32_t*)(pubKey->getName())) {
-        delete dhContext;
-        dhContext = new ZrtpDH(pubKey->getName());
+        ZrtpTraceTimer traceTimer(traceInfo, TraceDhKeyGen);
+        dhContext = createDhContext(pubKey->getName());
+        if (dhContext == nullptr) {
+            *errMsg = CriticalSWError;
+            return nullptr;
+        }
         dhContext->generatePublicKey();
     }
     sendInfo(Info, InfoDH1DHGenerated);
 
-    dhContext->getPubKeyBytes(pubKeyBytes);
+    dhContext->getPubKeyBytes(handshake->pubKeyBytes);
 
     // Re-compute auxSecretIDr because we changed roles *IDr with my H3, *IDi with peer's H3
     // Setup a DHPart1 packet.
     myRole = Responder;
     computeAuxSecretIds();                 // recompute AUX secret ids because we are now Responder, use different H3
 
-    zrtpDH1.setPubKeyType(pubKey->getName());
-    zrtpDH1.setMessageType((uint8_t*)DHPart1Msg);
-    zrtpDH1.setRs1Id(rs1IDr);
-    zrtpDH1.setRs2Id(rs2IDr);
-    zrtpDH1.setAuxSecretId(auxSecretIDr);
-    zrtpDH1.setPbxSecretId(pbxSecretIDr);
-    zrtpDH1.setPv(pubKeyBytes);
-    zrtpDH1.setH1(H1);
+    handshake->zrtpDH1.setPubKeyType(pubKey->getName());
+    handshake->zrtpDH1.setMessageType((uint8_t*)DHPart1Msg);
+    handshake->zrtpDH1.setRs1Id(rs1IDr);
+    handshake->zrtpDH1.setRs2Id(rs2IDr);
+    handshake->zrtpDH1.setAuxSecretId(auxSecretIDr);
+    handshake->zrtpDH1.setPbxSecretId(pbxSecretIDr);
+    handshake->zrtpDH1.setPv(handshake->pubKeyBytes);
+    handshake->zrtpDH1.setH1(H1);
 
-    int32_t len = zrtpDH1.getLength() * ZRTP_WORD_SIZE;
+    int32_t len = handshake->zrtpDH1.getLength() * ZRTP_WORD_SIZE;
 
     // Compute HMAC over DHPart1, excluding the HMAC field (HMAC_SIZE)
     // and store in DHPart1.
     // Use implicit Hash function
     uint8_t hmac[IMPL_MAX_DIGEST_LENGTH];
     uint32_t macLen;
-    hmacFunctionImpl(H0, HASH_IMAGE_SIZE, (uint8_t*)zrtpDH1.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
-    zrtpDH1.setHMAC(hmac);
+    hmacFunctionImpl(H0, HASH_IMAGE_SIZE, (uint8_t*)handshake->zrtpDH1.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
+    handshake->zrtpDH1.setHMAC(hmac);
 
     // We are definitly responder. Save the peer's hvi for later compare.
     memcpy(peerHvi, commit->getHvi(), HVI_SIZE);
@@ -612,12 +786,12 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart1(ZrtpPacketCommit *commit, uint32_t* errMs
     // Must use negotiated hash.
     hashCtxFunction(msgShaContext, (unsigned char*)currentHelloPacket->getHeaderBase(), currentHelloPacket->getLength() * ZRTP_WORD_SIZE);
     hashCtxFunction(msgShaContext, (unsigned char*)commit->getHeaderBase(), commit->getLength() * ZRTP_WORD_SIZE);
-    hashCtxFunction(msgShaContext, (unsigned char*)zrtpDH1.getHeaderBase(), zrtpDH1.getLength() * ZRTP_WORD_SIZE);
+    hashCtxFunction(msgShaContext, (unsigned char*)handshake->zrtpDH1.getHeaderBase(), handshake->zrtpDH1.getLength() * ZRTP_WORD_SIZE);
 
     // store Commit data temporarily until we can check HMAC after we got DHPart2
     storeMsgTemp(commit);
 
-    return &zrtpDH1;
+    return &handshake->zrtpDH1;
 }
 
 /*
@@ -656,8 +830,8 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart2(ZrtpPacketDHPart *dhPart1, uint32_t* errM
         return nullptr;
     }
 
-    // get memory to store DH result TODO: make it fixed memory
-    DHss = new uint8_t[dhContext->getDhSize()];
+    // get memory to store DH result
+    DHss = static_cast<uint8_t*>(handshake->allocate(dhContext->getDhSize()));
     if (DHss == nullptr) {
         *errMsg = CriticalSWError;
         return nullptr;
@@ -669,18 +843,21 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart2(ZrtpPacketDHPart *dhPart1, uint32_t* errM
         *errMsg = IgnorePacket;
         return nullptr;
     }
-    if (!dhContext->checkPubKey(pvr)) {
-        *errMsg = DHErrorWrongPV;
-        return nullptr;
+    {
+        ZrtpTraceTimer traceTimer(traceInfo, TraceDhCompute);
+        if (!dhContext->checkPubKey(pvr)) {
+            *errMsg = DHErrorWrongPV;
+            return nullptr;
+        }
+        dhContext->computeSecretKey(pvr, DHss);
     }
-    dhContext->computeSecretKey(pvr, DHss);
 
     // We are Initiator: the Responder's Hello and the Initiator's (our) Commit
     // are already hashed in the context. Now hash the Responder's DH1 and then
     // the Initiator's (our) DH2 in that order.
     // Use the negotiated hash function.
     hashCtxFunction(msgShaContext, (unsigned char*)dhPart1->getHeaderBase(), dhPart1->getLength() * ZRTP_WORD_SIZE);
-    hashCtxFunction(msgShaContext, (unsigned char*)zrtpDH2.getHeaderBase(), zrtpDH2.getLength() * ZRTP_WORD_SIZE);
+    hashCtxFunction(msgShaContext, (unsigned char*)handshake->zrtpDH2.getHeaderBase(), handshake->zrtpDH2.getLength() * ZRTP_WORD_SIZE);
 
     // Compute the message Hash
     closeHashCtx(msgShaContext, messageHash);
@@ -689,13 +866,12 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart2(ZrtpPacketDHPart *dhPart1, uint32_t* errM
     // also performs sign SAS callback if it's active.
     generateKeysInitiator(dhPart1, zidRec);
 
-    delete dhContext;
-    dhContext = nullptr;
+    freeDhData();
 
     // TODO: at initiator we can call signSAS at this point, don't delay until confirm1 received
     // store DHPart1 data temporarily until we can check HMAC after receiving Confirm1
     storeMsgTemp(dhPart1);
-    return &zrtpDH2;
+    return &handshake->zrtpDH2;
 }
 
 /*
@@ -738,18 +914,21 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* er
         *errMsg = DHErrorWrongHVI;
         return nullptr;
     }
-    DHss = new uint8_t[dhContext->getDhSize()];
+    DHss = static_cast<uint8_t*>(handshake->allocate(dhContext->getDhSize()));
     if (DHss == nullptr) {
         *errMsg = CriticalSWError;
         return nullptr;
     }
     // Get and check the Initiator's public value, see chap. 5.4.2 of the spec
     pvi = dhPart2->getPv();
-    if (!dhContext->checkPubKey(pvi)) {
-        *errMsg = DHErrorWrongPV;
-        return nullptr;
+    {
+        ZrtpTraceTimer traceTimer(traceInfo, TraceDhCompute);
+        if (!dhContext->checkPubKey(pvi)) {
+            *errMsg = DHErrorWrongPV;
+            return nullptr;
+        }
+        dhContext->computeSecretKey(pvi, DHss);
     }
-    dhContext->computeSecretKey(pvi, DHss);
 
     // Hash the Initiator's DH2 into the message Hash (other messages already prepared, see method prepareDHPart1().
     // Use neotiated hash function
@@ -765,23 +944,22 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* er
      */
     generateKeysResponder(dhPart2, zidRec);
 
-    delete dhContext;
-    dhContext = nullptr;
+    freeDhData();
 
     // Fill in Confirm1 packet.
-    zrtpConfirm1.setMessageType((uint8_t*)Confirm1Msg);
+    handshake->zrtpConfirm1.setMessageType((uint8_t*)Confirm1Msg);
 
     // Check if user verfied the SAS in a previous call and thus verfied
     // the retained secret. Don't set the verified flag if paranoidMode is true.
     if (zidRec->isSasVerified() && !paranoidMode) {
-        zrtpConfirm1.setSASFlag();
+        handshake->zrtpConfirm1.setSASFlag();
     }
     if (configureAlgos.isDisclosureFlag()) {
-        zrtpConfirm1.setDisclosureFlag();
+        handshake->zrtpConfirm1.setDisclosureFlag();
     }
-    zrtpConfirm1.setExpTime(0xFFFFFFFF);
-    zrtpConfirm1.setIv(randomIV);
-    zrtpConfirm1.setHashH0(H0);
+    handshake->zrtpConfirm1.setExpTime(0xFFFFFFFF);
+    handshake->zrtpConfirm1.setIv(randomIV);
+    handshake->zrtpConfirm1.setHashH0(H0);
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
     // if this runs at PBX user agent enrollment service then set flag in confirm
@@ -794,22 +972,22 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* er
             zidRec->setMiTMData(pbxSecretTmp);
         }
         // Set flag to enable user's client to ask for confirmation or re-confirmation.
-        zrtpConfirm1.setPBXEnrollment();
+        handshake->zrtpConfirm1.setPBXEnrollment();
     }
 #endif
     uint8_t confMac[MAX_DIGEST_LENGTH];
     uint32_t macLen;
 
     // Encrypt and HMAC with Responder's key - we are Responder here
-    uint32_t hmLen = (zrtpConfirm1.getLength() - 9U) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyR, cipher->getKeylen(), randomIV, zrtpConfirm1.getHashH0(), hmLen);
-    hmacFunction(hmacKeyR, hashLength, zrtpConfirm1.getHashH0(), hmLen, confMac, &macLen);
+    uint32_t hmLen = (handshake->zrtpConfirm1.getLength() - 9U) * ZRTP_WORD_SIZE;
+    cipher->getEncrypt()(zrtpKeyR, cipher->getKeylen(), randomIV, handshake->zrtpConfirm1.getHashH0(), hmLen);
+    hmacFunction(hmacKeyR, hashLength, handshake->zrtpConfirm1.getHashH0(), hmLen, confMac, &macLen);
 
-    zrtpConfirm1.setHmac(confMac);
+    handshake->zrtpConfirm1.setHmac(confMac);
 
     // store DHPart2 data temporarily until we can check HMAC after receiving Confirm2
     storeMsgTemp(dhPart2);
-    return &zrtpConfirm1;
+    return &handshake->zrtpConfirm1;
 }
 
 /*
@@ -844,8 +1022,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1MultiStream(ZrtpPacketCommit* commit, ui
         return nullptr;
     }
 
-    if (!checkAndSetNonce(commit->getNonce())) {
-        *errMsg = NonceReused;
+    if (!checkAndSetNonce(commit->getNonce(), errMsg)) {
         return nullptr;
     }
     // check if Commit contains "Mult" as pub key type
@@ -906,29 +1083,29 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1MultiStream(ZrtpPacketCommit* commit, ui
     generateKeysMultiStream();
 
     // Fill in Confirm1 packet.
-    zrtpConfirm1.setMessageType((uint8_t*)Confirm1Msg);
+    handshake->zrtpConfirm1.setMessageType((uint8_t*)Confirm1Msg);
     if (configureAlgos.isDisclosureFlag()) {
-        zrtpConfirm1.setDisclosureFlag();
+        handshake->zrtpConfirm1.setDisclosureFlag();
     }
-    zrtpConfirm1.setExpTime(0xFFFFFFFF);
-    zrtpConfirm1.setIv(randomIV);
-    zrtpConfirm1.setHashH0(H0);
+    handshake->zrtpConfirm1.setExpTime(0xFFFFFFFF);
+    handshake->zrtpConfirm1.setIv(randomIV);
+    handshake->zrtpConfirm1.setHashH0(H0);
 
     uint8_t confMac[MAX_DIGEST_LENGTH];
     uint32_t macLen;
 
     // Encrypt and HMAC with Responder's key - we are Respondere here
-    uint32_t hmLen = (zrtpConfirm1.getLength() - 9U) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyR, cipher->getKeylen(), randomIV, zrtpConfirm1.getHashH0(), hmLen);
+    uint32_t hmLen = (handshake->zrtpConfirm1.getLength() - 9U) * ZRTP_WORD_SIZE;
+    cipher->getEncrypt()(zrtpKeyR, cipher->getKeylen(), randomIV, handshake->zrtpConfirm1.getHashH0(), hmLen);
 
     // Use negotiated HMAC (hash)
-    hmacFunction(hmacKeyR, hashLength, zrtpConfirm1.getHashH0(), hmLen, confMac, &macLen);
+    hmacFunction(hmacKeyR, hashLength, handshake->zrtpConfirm1.getHashH0(), hmLen, confMac, &macLen);
 
-    zrtpConfirm1.setHmac(confMac);
+    handshake->zrtpConfirm1.setHmac(confMac);
 
     // Store Commit data temporarily until we can check HMAC after receiving Confirm2
     storeMsgTemp(commit);
-    return &zrtpConfirm1;
+    return &handshake->zrtpConfirm1;
 }
 
 /*
@@ -996,17 +1173,17 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2(ZrtpPacketConfirm* confirm1, uint32_t*
     zidRec->setNewRs1((const uint8_t*)newRs1);
 
     // now generate my Confirm2 message
-    zrtpConfirm2.setMessageType((uint8_t*)Confirm2Msg);
-    zrtpConfirm2.setHashH0(H0);
+    handshake->zrtpConfirm2.setMessageType((uint8_t*)Confirm2Msg);
+    handshake->zrtpConfirm2.setHashH0(H0);
 
     if (sasFlag) {
-        zrtpConfirm2.setSASFlag();
+        handshake->zrtpConfirm2.setSASFlag();
     }
     if (configureAlgos.isDisclosureFlag()) {
-        zrtpConfirm2.setDisclosureFlag();
+        handshake->zrtpConfirm2.setDisclosureFlag();
     }
-    zrtpConfirm2.setExpTime(0xFFFFFFFF);
-    zrtpConfirm2.setIv(randomIV);
+    handshake->zrtpConfirm2.setExpTime(0xFFFFFFFF);
+    handshake->zrtpConfirm2.setIv(randomIV);
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
     // Compute PBX secret if we are in enrollemnt mode (PBX user agent)
@@ -1025,21 +1202,23 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2(ZrtpPacketConfirm* confirm1, uint32_t*
                 zidRec->setMiTMData(pbxSecretTmp);
             }
             // Set flag to enable user's client to ask for confirmation or re-confirmation.
-            zrtpConfirm2.setPBXEnrollment();
+            handshake->zrtpConfirm2.setPBXEnrollment();
         }
     }
 #endif
-    if (saveZidRecord)
+    if (saveZidRecord) {
+        ZrtpTraceTimer traceTimer(traceInfo, TraceCacheWrite);
         getZidCacheInstance()->saveRecord(zidRec);
+    }
 
     // Encrypt and HMAC with Initiator's key - we are Initiator here
-    hmlen = (zrtpConfirm2.getLength() - (uint)9) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyI, cipher->getKeylen(), randomIV, zrtpConfirm2.getHashH0(), hmlen);
+    hmlen = (handshake->zrtpConfirm2.getLength() - (uint)9) * ZRTP_WORD_SIZE;
+    cipher->getEncrypt()(zrtpKeyI, cipher->getKeylen(), randomIV, handshake->zrtpConfirm2.getHashH0(), hmlen);
 
     // Use negotiated HMAC (hash)
-    hmacFunction(hmacKeyI, hashLength, zrtpConfirm2.getHashH0(), hmlen, confMac, &macLen);
+    hmacFunction(hmacKeyI, hashLength, handshake->zrtpConfirm2.getHashH0(), hmlen, confMac, &macLen);
 
-    zrtpConfirm2.setHmac(confMac);
+    handshake->zrtpConfirm2.setHmac(confMac);
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
     // Ask for enrollment only if enabled via configuration and the
@@ -1057,7 +1236,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2(ZrtpPacketConfirm* confirm1, uint32_t*
         }
     }
 #endif
-    return &zrtpConfirm2;
+    return &handshake->zrtpConfirm2;
 }
 
 /*
@@ -1119,23 +1298,23 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2MultiStream(ZrtpPacketConfirm* confirm1,
     peerDisclosureFlagSeen = confirm1->isDisclosureFlag();
 
     // now generate my Confirm2 message
-    zrtpConfirm2.setMessageType((uint8_t*)Confirm2Msg);
+    handshake->zrtpConfirm2.setMessageType((uint8_t*)Confirm2Msg);
     if (configureAlgos.isDisclosureFlag()) {
-        zrtpConfirm2.setDisclosureFlag();
+        handshake->zrtpConfirm2.setDisclosureFlag();
     }
-    zrtpConfirm2.setHashH0(H0);
-    zrtpConfirm2.setExpTime(0xFFFFFFFF);
-    zrtpConfirm2.setIv(randomIV);
+    handshake->zrtpConfirm2.setHashH0(H0);
+    handshake->zrtpConfirm2.setExpTime(0xFFFFFFFF);
+    handshake->zrtpConfirm2.setIv(randomIV);
 
     // Encrypt and HMAC with Initiator's key - we are Initiator here
-    hmLen = (zrtpConfirm2.getLength() - 9U) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyI, cipher->getKeylen(), randomIV, zrtpConfirm2.getHashH0(), hmLen);
+    hmLen = (handshake->zrtpConfirm2.getLength() - 9U) * ZRTP_WORD_SIZE;
+    cipher->getEncrypt()(zrtpKeyI, cipher->getKeylen(), randomIV, handshake->zrtpConfirm2.getHashH0(), hmLen);
 
     // Use negotiated HMAC (hash)
-    hmacFunction(hmacKeyI, hashLength, zrtpConfirm2.getHashH0(), hmLen, confMac, &macLen);
+    hmacFunction(hmacKeyI, hashLength, handshake->zrtpConfirm2.getHashH0(), hmLen, confMac, &macLen);
 
-    zrtpConfirm2.setHmac(confMac);
-    return &zrtpConfirm2;
+    handshake->zrtpConfirm2.setHmac(confMac);
+    return &handshake->zrtpConfirm2;
 }
 
 /*
@@ -1193,8 +1372,10 @@ ZrtpPacketConf2Ack* ZRtp::prepareConf2Ack(ZrtpPacketConfirm *confirm2, uint32_t*
         }
         // save new RS1, this inherits the verified flag from old RS1
         zidRec->setNewRs1((const uint8_t*)newRs1);
-        if (saveZidRecord)
+        if (saveZidRecord) {
+            ZrtpTraceTimer traceTimer(traceInfo, TraceCacheWrite);
             getZidCacheInstance()->saveRecord(zidRec);
+        }
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
         // Ask for enrollment only if enabled via configuration and the
@@ -1833,18 +2014,14 @@ bool ZRtp::verifyH2(ZrtpPacketCommit *commit) {
 
 void ZRtp::computeHvi(ZrtpPacketDHPart* dh, ZrtpPacketHello *hello) {
 
-    std::vector<const uint_8t *>data;
-    std::vector<uint64_t >length;
+    DataChunks data;
     /*
-     * populate the vector to compute the HVI hash according to the
+     * populate the list to compute the HVI hash according to the
      * ZRTP specification.
      */
-    data.push_back(dh->getHeaderBase());
-    length.push_back(dh->getLength() * ZRTP_WORD_SIZE);
-
-    data.push_back(hello->getHeaderBase());
-    length.push_back(hello->getLength() * ZRTP_WORD_SIZE);
-    hashListFunction(data, length, hvi);
+    data.add(dh->getHeaderBase(), dh->getLength() * ZRTP_WORD_SIZE);
+    data.add(hello->getHeaderBase(), hello->getLength() * ZRTP_WORD_SIZE);
+    hashListFunction(data, hvi);
 }
 
 void ZRtp:: computeSharedSecretSet(ZIDRecord *zidRec) {
@@ -1916,15 +2093,6 @@ void ZRtp::computeAuxSecretIds() {
     }
 }
 
-/*
- * memset_volatile is a volatile pointer to the memset function.
- * You can call (*memset_volatile)(buf, val, len) or even
- * memset_volatile(buf, val, len) just as you would call
- * memset(buf, val, len), but the use of a volatile pointer
- * guarantees that the compiler will not optimise the call away.
- */
-static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
-
 /*
  * The DH packet for this function is DHPart1 and contains the Responder's
  * retained secret ids. Compare them with the expected secret ids (refer
@@ -1932,6 +2100,7 @@ static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
  * When using this method then we are in Initiator role.
  */
 void ZRtp::generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
+    ZrtpTraceTimer traceTimer(traceInfo, TraceKdf);
     const uint8_t* setD[3];
     int32_t rsFound = 0;
 
@@ -2017,12 +2186,11 @@ void ZRtp::generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
      */
 
     /*
-     * These arrays hold the pointers and lengths of the data that must be
+     * This list holds the pointers and lengths of the data that must be
      * hashed to create S0.  According to the formula the max number of
-     * elements to hash is 12, add one for the terminating "nullptr"
+     * elements to hash is 12.
      */
-    std::vector<const uint_8t*> data;
-    std::vector<uint64_t> length;
+    DataChunks data;
 
     // we need a number of length data items, so define them here
     uint32_t counter, sLen[3];
@@ -2030,29 +2198,23 @@ void ZRtp::generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
     //Very first element is a fixed counter, big endian
     counter = 1;
     counter = zrtpHtonl(counter);
-    data.push_back((unsigned char*)&counter);
-    length.push_back(sizeof(uint32_t));
+    data.add((unsigned char*)&counter, sizeof(uint32_t));
 
     // Next is the DH result itself
-    data.push_back(DHss);
-    length.push_back(dhContext->getDhSize());
+    data.add(DHss, dhContext->getDhSize());
 
     // Next the fixed string "ZRTP-HMAC-KDF"
-    data.push_back((unsigned char*)KDFString);
-    length.push_back(static_cast<uint32_t>(strlen(KDFString)));
+    data.add((unsigned char*)KDFString, static_cast<uint32_t>(strlen(KDFString)));
 
     // Next is Initiator's id (ZIDi), in this case as Initiator
     // it is zid
-    data.push_back(ownZid);
-    length.push_back(ZID_SIZE);
+    data.add(ownZid, ZID_SIZE);
 
     // Next is Responder's id (ZIDr), in this case our peer's id
-    data.push_back(peerZid);
-    length.push_back(ZID_SIZE);
+    data.add(peerZid, ZID_SIZE);
 
     // Next ist total hash (messageHash) itself
-    data.push_back(messageHash);
-    length.push_back(hashLength);
+    data.add(messageHash, hashLength);
 
     /*
      * For each matching shared secret hash the length of
@@ -2069,22 +2231,18 @@ void ZRtp::generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
     for (int32_t i = 0; i < 3; i++) {
         if (setD[i] != nullptr) {           // a matching secret, set length, then secret
             sLen[i] = secretHashLen;
-            data.push_back((unsigned char*)&sLen[i]);
-            length.push_back(sizeof(uint32_t));
-            data.push_back((unsigned char*)setD[i]);
-            length.push_back((i != 1) ? RS_LENGTH : auxSecretLength);
+            data.add((unsigned char*)&sLen[i], sizeof(uint32_t));
+            data.add((unsigned char*)setD[i], (i != 1) ? RS_LENGTH : auxSecretLength);
         }
         else {                           // no machting secret, set length 0, skip secret
             sLen[i] = 0;
-            data.push_back((unsigned char*)&sLen[i]);
-            length.push_back(sizeof(uint32_t));
+            data.add((unsigned char*)&sLen[i], sizeof(uint32_t));
         }
     }
-    hashListFunction(data, length, s0);
+    hashListFunction(data, s0);
 //  hexdump("S0 I", s0, hashLength);
 
     memset_volatile(DHss, 0, dhContext->getDhSize());
-    delete[] DHss;
     DHss = nullptr;
 
     computeSRTPKeys();
@@ -2096,6 +2254,7 @@ void ZRtp::generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
  * to chapter 5.3.1 in the specification).
  */
 void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
+    ZrtpTraceTimer traceTimer(traceInfo, TraceKdf);
     const uint8_t* setD[3];
     int32_t rsFound = 0;
 
@@ -2183,8 +2342,7 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
      * These arrays hold the pointers and lengths of the data that must be
      * hashed to create S0.
      */
-    std::vector<const uint_8t*> data;
-    std::vector<uint64_t> length;
+    DataChunks data;
 
     // we need a number of length data items, so define them here
     uint32_t counter, sLen[3];
@@ -2192,29 +2350,23 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
     //Very first element is a fixed counter, big endian
     counter = 1;
     counter = zrtpHtonl(counter);
-    data.push_back((unsigned char*)&counter);
-    length.push_back(sizeof(uint32_t));
+    data.add((unsigned char*)&counter, sizeof(uint32_t));
 
     // Next is the DH result itself
-    data.push_back(DHss);
-    length.push_back(dhContext->getDhSize());
+    data.add(DHss, dhContext->getDhSize());
 
     // Next the fixed string "ZRTP-HMAC-KDF"
-    data.push_back((unsigned char*)KDFString);
-    length.push_back(static_cast<uint32_t>(strlen(KDFString)));
+    data.add((unsigned char*)KDFString, static_cast<uint32_t>(strlen(KDFString)));
 
     // Next is Initiator's id (ZIDi), in this case as Responder
     // it is peerZid
-    data.push_back(peerZid);
-    length.push_back(ZID_SIZE);
+    data.add(peerZid, ZID_SIZE);
 
     // Next is Responder's id (ZIDr), in this case our own zid
-    data.push_back(ownZid);
-    length.push_back(ZID_SIZE);
+    data.add(ownZid, ZID_SIZE);
 
     // Next ist total hash (messageHash) itself
-    data.push_back(messageHash);
-    length.push_back(hashLength);
+    data.add(messageHash, hashLength);
 
     /*
      * For each matching shared secret hash the length of
@@ -2231,22 +2383,18 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
     for (int32_t i = 0; i < 3; i++) {
         if (setD[i] != nullptr) {           // a matching secret, set length, then secret
             sLen[i] = secretHashLen;
-            data.push_back((unsigned char*)&sLen[i]);
-            length.push_back(sizeof(uint32_t));
-            data.push_back((unsigned char*)setD[i]);
-            length.push_back((i != 1) ? RS_LENGTH : auxSecretLength);
+            data.add((unsigned char*)&sLen[i], sizeof(uint32_t));
+            data.add((unsigned char*)setD[i], (i != 1) ? RS_LENGTH : auxSecretLength);
         }
         else {                           // no machting secret, set length 0, skip secret
             sLen[i] = 0;
-            data.push_back((unsigned char*)&sLen[i]);
-            length.push_back(sizeof(uint32_t));
+            data.add((unsigned char*)&sLen[i], sizeof(uint32_t));
         }
     }
-    hashListFunction(data, length, s0);
+    hashListFunction(data, s0);
 //  hexdump("S0 R", s0, hashLength);
 
     memset_volatile(DHss, 0, dhContext->getDhSize());
-    delete[] DHss;
     DHss = nullptr;
 
     computeSRTPKeys();
@@ -2257,35 +2405,87 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
 void ZRtp::KDF(uint8_t* key, size_t keyLength, uint8_t* label, size_t labelLength,
                uint8_t* context, size_t contextLength, size_t L, uint8_t* output) {
 
-    std::vector<const uint8_t*>data;
-    std::vector<uint64_t> length;
+    DataChunks data;
     uint32_t macLen = 0;
 
     // Very first element is a fixed counter, big endian
     uint32_t counter = 1;
     counter = zrtpHtonl(counter);
-    data.push_back(reinterpret_cast<uint_8t *>(&counter));
-    length.push_back(sizeof(uint32_t));
+    data.add(reinterpret_cast<uint_8t *>(&counter), sizeof(uint32_t));
 
     // Next element is the label, null terminated, labelLength includes null byte.
-    data.push_back(label);
-    length.push_back(labelLength);
+    data.add(label, labelLength);
 
     // Next is the KDF context
-    data.push_back(context);
-    length.push_back(contextLength);
+    data.add(context, contextLength);
 
     // last element is HMAC length in bits, big endian
     uint32_t len = zrtpHtonl(static_cast<uint32_t>(L));
-    data.push_back(reinterpret_cast<uint_8t *>(&len));
-    length.push_back(sizeof(uint32_t));
+    data.add(reinterpret_cast<uint_8t *>(&len), sizeof(uint32_t));
 
     // Use negotiated hash.
-    hmacListFunction(key, keyLength, data, length, output, &macLen);
+    hmacListFunction(key, keyLength, data, output, &macLen);
+}
+
+void ZRtp::KDFMulti(uint8_t* key, size_t keyLength, const KdfOutput* outputs, size_t count,
+                    uint8_t* context, size_t contextLength) {
+
+    // The labels are short fixed strings and the context is at most ZIDi | ZIDr | total_hash
+    const size_t maxOutputs = 12;
+    const size_t maxLabel = 48;
+    const size_t maxContext = sizeof(peerZid) + sizeof(ownZid) + sizeof(messageHash);
+
+    uint8_t messages[maxOutputs][sizeof(uint32_t) + maxLabel + maxContext + sizeof(uint32_t)];
+    const uint8_t* data[maxOutputs];
+    uint64_t dataLength[maxOutputs];
+    uint8_t* mac[maxOutputs];
+
+    if (count > maxOutputs || contextLength > maxContext) {
+        for (size_t i = 0; i < count; i++) {
+            KDF(key, keyLength, (uint8_t*)outputs[i].label, strlen(outputs[i].label)+1, context, contextLength,
+                outputs[i].L, outputs[i].output);
+        }
+        return;
+    }
+
+    // Same message as KDF: counter | label | context | L, see ZRTP specification chap 4.5.1
+    uint32_t counter = zrtpHtonl(1);
+    for (size_t i = 0; i < count; i++) {
+        size_t labelLength = strlen(outputs[i].label) + 1;
+        if (labelLength > maxLabel) {
+            KDF(key, keyLength, (uint8_t*)outputs[i].label, labelLength, context, contextLength,
+                outputs[i].L, outputs[i].output);
+            data[i] = nullptr;
+            continue;
+        }
+        uint32_t len = zrtpHtonl(static_cast<uint32_t>(outputs[i].L));
+        uint8_t* msg = messages[i];
+
+        memcpy(msg, &counter, sizeof(uint32_t));
+        memcpy(msg + sizeof(uint32_t), outputs[i].label, labelLength);
+        memcpy(msg + sizeof(uint32_t) + labelLength, context, contextLength);
+        memcpy(msg + sizeof(uint32_t) + labelLength + contextLength, &len, sizeof(uint32_t));
+        data[i] = msg;
+        dataLength[i] = sizeof(uint32_t) + labelLength + contextLength + sizeof(uint32_t);
+        mac[i] = outputs[i].output;
+    }
+
+    // Pack the outputs that KDF did not compute already
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (data[i] != nullptr) {
+            data[n] = data[i];
+            dataLength[n] = dataLength[i];
+            mac[n] = mac[i];
+            n++;
+        }
+    }
+    hmacMultiFunction(key, keyLength, n, data, dataLength, mac);
 }
 
 // Compute the Multi Stream mode s0
 void ZRtp::generateKeysMultiStream() {
+    ZrtpTraceTimer traceTimer(traceInfo, TraceKdf);
 
     // allocate the maximum size, compute real size to use
     uint8_t KDFcontext[sizeof(peerZid)+sizeof(ownZid)+sizeof(messageHash)];
@@ -2349,37 +2549,39 @@ void ZRtp::computeSRTPKeys() {
     }
     memcpy(KDFcontext+sizeof(ownZid)+sizeof(peerZid), messageHash, hashLength);
 
-    // Inititiator key and salt
-    KDF(s0, hashLength, (unsigned char*)iniMasterKey, strlen(iniMasterKey)+1, KDFcontext, kdfSize, keyLen, srtpKeyI);
-    KDF(s0, hashLength, (unsigned char*)iniMasterSalt, strlen(iniMasterSalt)+1, KDFcontext, kdfSize, 112, srtpSaltI);
-
-    // Responder key and salt
-    KDF(s0, hashLength, (unsigned char*)respMasterKey, strlen(respMasterKey)+1, KDFcontext, kdfSize, keyLen, srtpKeyR);
-    KDF(s0, hashLength, (unsigned char*)respMasterSalt, strlen(respMasterSalt)+1, KDFcontext, kdfSize, 112, srtpSaltR);
-
-    // The HMAC keys for GoClear
-    KDF(s0, hashLength, (unsigned char*)iniHmacKey, strlen(iniHmacKey)+1, KDFcontext, kdfSize, hashLength*8, hmacKeyI);
-    KDF(s0, hashLength, (unsigned char*)respHmacKey, strlen(respHmacKey)+1, KDFcontext, kdfSize, hashLength*8, hmacKeyR);
-
-    // The keys for Confirm messages
-    KDF(s0, hashLength, (unsigned char*)iniZrtpKey, strlen(iniZrtpKey)+1, KDFcontext, kdfSize, keyLen, zrtpKeyI);
-    KDF(s0, hashLength, (unsigned char*)respZrtpKey, strlen(respZrtpKey)+1, KDFcontext, kdfSize, keyLen, zrtpKeyR);
+    // All keys derive from s0 with the same context, prepare the HMAC key once
+    KdfOutput outputs[] = {
+        // Inititiator key and salt
+        {iniMasterKey, keyLen, srtpKeyI},
+        {iniMasterSalt, 112, srtpSaltI},
+
+        // Responder key and salt
+        {respMasterKey, keyLen, srtpKeyR},
+        {respMasterSalt, 112, srtpSaltR},
+
+        // The HMAC keys for GoClear
+        {iniHmacKey, hashLength*8UL, hmacKeyI},
+        {respHmacKey, hashLength*8UL, hmacKeyR},
+
+        // The keys for Confirm messages
+        {iniZrtpKey, keyLen, zrtpKeyI},
+        {respZrtpKey, keyLen, zrtpKeyR},
+
+        // The new Retained Secret, the ZRTP Session Key, the exported Key and
+        // the SAS hash according to chapter 5.5 and 8, only in DH mode
+        {retainedSec, SHA256_DIGEST_LENGTH*8, newRs1},
+        {zrtpSessionKey, hashLength*8UL, zrtpSession},
+        {zrtpExportedKey, hashLength*8UL, zrtpExport},
+        {sasString, SHA256_DIGEST_LENGTH*8, sasHash}
+    };
+    const size_t numOutputs = sizeof(outputs) / sizeof(outputs[0]);
+    KDFMulti(s0, hashLength, outputs, multiStream ? numOutputs - 4 : numOutputs, KDFcontext, kdfSize);
 
     detailInfo.pubKey = detailInfo.sasType = nullptr;
     if (!multiStream) {
-        // Compute the new Retained Secret
-        KDF(s0, hashLength, (unsigned char*)retainedSec, strlen(retainedSec)+1, KDFcontext, kdfSize, SHA256_DIGEST_LENGTH*8, newRs1);
-
-        // Compute the ZRTP Session Key
-        KDF(s0, hashLength, (unsigned char*)zrtpSessionKey, strlen(zrtpSessionKey)+1, KDFcontext, kdfSize, hashLength*8, zrtpSession);
-
-        // Compute the exported Key
-        KDF(s0, hashLength, (unsigned char*)zrtpExportedKey, strlen(zrtpExportedKey)+1, KDFcontext, kdfSize, hashLength*8, zrtpExport);
-        // perform  generation according to chapter 5.5 and 8.
         // we don't need a speciai sasValue filed. sasValue are the first
         // (leftmost) 32 bits (4 bytes) of sasHash
         uint8_t sasBytes[4];
-        KDF(s0, hashLength, (unsigned char*)sasString, strlen(sasString)+1, KDFcontext, kdfSize, SHA256_DIGEST_LENGTH*8, sasHash);
 
         // according to chapter 8 only the leftmost 20 bits of sasValue (aka
         //  sasHash) are used to create the character SAS string of type SAS
@@ -2465,11 +2667,11 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
     switch (zrtpHashes.getOrdinal(*hash)) {
     case 0:
         hashLength = SHA256_DIGEST_LENGTH;
-        hashListFunction = sha256; // static_cast<void (*)(const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *)>(sha256);;
+        hashListFunction = sha256; // static_cast<void (*)(const DataChunks&, uint8_t *)>(sha256);;
 
         hmacFunction = static_cast<void (*)(const uint8_t*, uint64_t, const uint8_t *, uint64_t, uint8_t *c, uint32_t *)>(hmac_sha256);
-        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&,
-                                                const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(hmacSha256);
+        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const DataChunks&, uint8_t *, uint32_t *)>(hmacSha256);
+        hmacMultiFunction = hmacSha256Multi;
 
         createHashCtx = initializeSha256Context;
         msgShaContext = &hashCtx.sha256Ctx;
@@ -2479,11 +2681,11 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
 
     case 1:
         hashLength = SHA384_DIGEST_LENGTH;
-        hashListFunction = sha384; // static_cast<void (*) (const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *)>(sha384);
+        hashListFunction = sha384; // static_cast<void (*) (const DataChunks&, uint8_t *)>(sha384);
 
         hmacFunction = hmac_sha384;
-        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&,
-                                                const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(hmacSha384);
+        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const DataChunks&, uint8_t *, uint32_t *)>(hmacSha384);
+        hmacMultiFunction = hmacSha384Multi;
 
         createHashCtx = initializeSha384Context;
         msgShaContext = &hashCtx.sha384Ctx;
@@ -2493,10 +2695,11 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
 
     case 2:
         hashLength = SKEIN256_DIGEST_LENGTH;
-        hashListFunction = static_cast<void (*) (const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *)>(skein256);
+        hashListFunction = static_cast<void (*) (const DataChunks&, uint8_t *)>(skein256);
 
         hmacFunction = macSkein256;
-        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(macSkein256);
+        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const DataChunks&, uint8_t *, uint32_t *)>(macSkein256);
+        hmacMultiFunction = macSkein256Multi;
 
         createHashCtx = initializeSkein256Context;
         msgShaContext = &hashCtx.skeinCtx;
@@ -2506,10 +2709,11 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
 
     case 3:
         hashLength = SKEIN384_DIGEST_LENGTH;
-        hashListFunction = static_cast<void (*) (const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *)>(skein384);
+        hashListFunction = static_cast<void (*) (const DataChunks&, uint8_t *)>(skein384);
 
         hmacFunction = macSkein384;
-        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(macSkein384);
+        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const DataChunks&, uint8_t *, uint32_t *)>(macSkein384);
+        hmacMultiFunction = macSkein384Multi;
 
         createHashCtx = initializeSkein384Context;
         msgShaContext = &hashCtx.skeinCtx;
@@ -2570,17 +2774,46 @@ void ZRtp::sendInfo(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) {
         memset(srtpSaltI, 0, 112/8);
         memset(srtpKeyR, 0, cipher->getKeylen());
         memset(srtpSaltR, 0, 112/8);
+        releaseHandshakeData();
+        publishMultiStrParams(true);
+    }
+    else if (severity == Info && subCode == InfoSecureStateOff) {
+        publishMultiStrParams(false);
     }
     callback->sendInfo(severity, subCode);
+
+    if (streamGroup != nullptr && severity == Info && subCode == InfoSecureStateOn)
+        streamGroup->streamDone(streamGroupIndex, true);
 }
 
 
+void ZRtp::publishMultiStrParams(bool secure) {
+    std::lock_guard<std::mutex> lock(multiStrLock);
+
+    if (secure && !multiStream) {
+        multiStrParams.hash = hash;
+        multiStrParams.cipher = cipher;
+        multiStrParams.authLength = authLength;
+        multiStrParams.hashLength = hashLength;
+        memcpy(multiStrParams.zrtpSession, zrtpSession, hashLength);
+        multiStrParams.valid = true;
+    }
+    else {
+        memset_volatile(multiStrParams.zrtpSession, 0, MAX_DIGEST_LENGTH);
+        multiStrParams.valid = false;
+    }
+}
+
 void ZRtp::zrtpNegotiationFailed(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) {
     callback->zrtpNegotiationFailed(severity, subCode);
+    if (streamGroup != nullptr)
+        streamGroup->streamDone(streamGroupIndex, false);
 }
 
 void ZRtp::zrtpNotSuppOther() {
     callback->zrtpNotSuppOther();
+    if (streamGroup != nullptr)
+        streamGroup->streamDone(streamGroupIndex, false);
 }
 
 void ZRtp::synchEnter() {
@@ -2619,6 +2852,15 @@ void ZRtp::setClientId(std::string id, HelloPacketVersion* hpv) {
     tmp[CLIENT_ID_SIZE] = 0;
 
     hpv->packet->setClientId(tmp);
+    hpv->hmacDone = false;
+}
+
+void ZRtp::computeHelloHmac(HelloPacketVersion* hpv) {
+
+    std::lock_guard<std::mutex> lock(helloLock);
+
+    if (hpv->hmacDone)
+        return;
 
     uint32_t len = hpv->packet->getLength() * ZRTP_WORD_SIZE;
 
@@ -2633,32 +2875,34 @@ void ZRtp::setClientId(std::string id, HelloPacketVersion* hpv) {
     // calculate hash over the final Hello packet, refer to chap 9.1 how to
     // use this hash in SIP/SDP.
     hashFunctionImpl((uint8_t*)hpv->packet->getHeaderBase(), len, hpv->helloHash);
+    hpv->hmacDone = true;
 }
 
 void ZRtp::storeMsgTemp(ZrtpPacketBase* pkt) {
     uint32_t length = pkt->getLength() * ZRTP_WORD_SIZE;
-    length = (length > sizeof(tempMsgBuffer)) ? sizeof(tempMsgBuffer) : length;
-    memset(tempMsgBuffer, 0, sizeof(tempMsgBuffer));
-    memcpy(tempMsgBuffer, (uint8_t*)pkt->getHeaderBase(), length);
-    lengthOfMsgData = length;
+    length = (length > sizeof(handshake->tempMsgBuffer)) ? sizeof(handshake->tempMsgBuffer) : length;
+    memset(handshake->tempMsgBuffer, 0, sizeof(handshake->tempMsgBuffer));
+    memcpy(handshake->tempMsgBuffer, (uint8_t*)pkt->getHeaderBase(), length);
+    handshake->lengthOfMsgData = length;
 }
 
 bool ZRtp::checkMsgHmac(uint8_t* key) {
     uint8_t hmac[IMPL_MAX_DIGEST_LENGTH];
     uint32_t macLen;
-    uint32_t len = lengthOfMsgData-(HMAC_SIZE);  // compute HMAC, but exclude the stored HMAC :-)
+    uint32_t len = handshake->lengthOfMsgData-(HMAC_SIZE);  // compute HMAC, but exclude the stored HMAC :-)
 
     // Use the implicit hash function
-    hmacFunctionImpl(key, HASH_IMAGE_SIZE, tempMsgBuffer, len, hmac, &macLen);
-    return memcmp(hmac, tempMsgBuffer + len, (HMAC_SIZE)) == 0;
+    hmacFunctionImpl(key, HASH_IMAGE_SIZE, handshake->tempMsgBuffer, len, hmac, &macLen);
+    return memcmp(hmac, handshake->tempMsgBuffer + len, (HMAC_SIZE)) == 0;
 }
 
 std::string ZRtp::getHelloHash(int32_t index) {
     std::ostringstream stm;
 
-    if (index < 0 || index >= MAX_ZRTP_VERSIONS)
+    if (index < 0 || index >= MAX_ZRTP_VERSIONS || helloPackets[index].packet == nullptr)
         return std::string();
 
+    computeHelloHmac(&helloPackets[index]);
     uint8_t* hp = helloPackets[index].helloHash;
 
     char version[5] = {'\0'};
@@ -2700,13 +2944,15 @@ std::string ZRtp::getMultiStrParams(ZRtp **zrtpMaster) {
     std::string str;
     char tmp[MAX_DIGEST_LENGTH + 1 + 1 + 1]; // hash length + cipher + authLength + hash
 
-    if (inState(SecureState) && !multiStream) {
+    std::lock_guard<std::mutex> lock(multiStrLock);
+    if (multiStrParams.valid) {
         // construct array that holds zrtpSession, cipher type, auth-length, and hash type
-        tmp[0] = static_cast<char>(zrtpHashes.getOrdinal(*hash));
-        tmp[1] = static_cast<char>(zrtpAuthLengths.getOrdinal(*authLength));
-        tmp[2] = static_cast<char>(zrtpSymCiphers.getOrdinal(*cipher));
-        memcpy(tmp+3, zrtpSession, hashLength);
-        str.assign(tmp, hashLength + 1 + 1 + 1); // set chars (bytes) to the string
+        int32_t length = multiStrParams.hashLength;
+        tmp[0] = static_cast<char>(zrtpHashes.getOrdinal(*multiStrParams.hash));
+        tmp[1] = static_cast<char>(zrtpAuthLengths.getOrdinal(*multiStrParams.authLength));
+        tmp[2] = static_cast<char>(zrtpSymCiphers.getOrdinal(*multiStrParams.cipher));
+        memcpy(tmp+3, multiStrParams.zrtpSession, length);
+        str.assign(tmp, length + 1 + 1 + 1); // set chars (bytes) to the string
         if (zrtpMaster != nullptr)
             *zrtpMaster = this;
     }
@@ -2738,6 +2984,29 @@ void ZRtp::setMultiStrParams(std::string parameters, ZRtp *zrtpMaster) {
         masterStream = zrtpMaster;
 }
 
+bool ZRtp::setMultiStrMaster(ZRtp* zrtpMaster) {
+    if (zrtpMaster == nullptr)
+        return false;
+
+    // The master may process packets in another thread, use its copy
+    {
+        std::lock_guard<std::mutex> lock(zrtpMaster->multiStrLock);
+        if (!zrtpMaster->multiStrParams.valid)
+            return false;
+
+        hash = zrtpMaster->multiStrParams.hash;
+        setNegotiatedHash(hash);           // sets hashlength
+        authLength = zrtpMaster->multiStrParams.authLength;
+        cipher = zrtpMaster->multiStrParams.cipher;
+        memcpy(zrtpSession, zrtpMaster->multiStrParams.zrtpSession, hashLength);
+    }
+
+    multiStream = true;
+    stateEngine->setMultiStream(true);
+    masterStream = zrtpMaster;
+    return true;
+}
+
 bool ZRtp::isMultiStream() {
     return multiStream;
 }
@@ -2771,7 +3040,10 @@ bool ZRtp::setSignatureData(uint8_t* data, uint32_t length) {
     if ((length % 4) != 0)
         return false;
 
-    ZrtpPacketConfirm* cfrm = (myRole == Responder) ? &zrtpConfirm1 : &zrtpConfirm2;
+    if (handshake == nullptr)
+        return false;
+
+    ZrtpPacketConfirm* cfrm = (myRole == Responder) ? &handshake->zrtpConfirm1 : &handshake->zrtpConfirm2;
     cfrm->setSignatureLength(length / 4);
     return cfrm->setSignatureData(data, length);
 }
@@ -2874,10 +3146,32 @@ const ZRtp::zrtpInfo* ZRtp::getDetailInfo() {
     return &detailInfo;
 }
 
+size_t ZRtp::getMemoryFootprint() {
+    size_t size = sizeof(ZRtp);
+
+    if (handshake != nullptr)
+        size += sizeof(HandshakeData);
+    if (zidRec != nullptr)
+        size += sizeof(*zidRec);
+    size += auxSecretLength;
+    size += peerNonces.getMemorySize();
+    return size;
+}
+
+const zrtpTraceInfo* ZRtp::getTraceInfo() {
+    int32_t counters[ErrorRetry+1];
+    int32_t number = stateEngine->getRetryCounters(counters);
+
+    traceInfo.retransmits = 0;
+    for (int32_t i = 0; i < number; i++)
+        traceInfo.retransmits += counters[i];
+    return &traceInfo;
+}
+
 std::string ZRtp::getPeerClientId() {
-    if (peerClientId.empty())
+    if (peerClientId[0] == 0)
         return std::string();
-    return peerClientId;
+    return std::string(peerClientId, ZRTP_WORD_SIZE * 4);
 }
 
 std::string ZRtp::getPeerProtcolVersion() {
@@ -2919,28 +3213,49 @@ int ZRtp::getCountersZrtp(int32_t* counters) {
     return stateEngine->getRetryCounters(counters);
 }
 
+int ZRtp::getNumberOfTraceCountersZrtp() {
+    return numberOfTraceOps * 2 + 1;
+}
+
+int ZRtp::getTraceCountersZrtp(int32_t* counters) {
+    int32_t number = 0;
+
+    // Number of calls and accumulated time in microseconds per crypto operation,
+    // then the setup time in microseconds.
+    for (int32_t i = 0; i < numberOfTraceOps; i++) {
+        counters[number++] = traceInfo.opCount[i];
+        counters[number++] = static_cast<int32_t>(traceInfo.opTime[i] / 1000);
+    }
+    int64_t secure = traceInfo.startTime != 0 ? traceInfo.stateEntered[ZRTP_TRACE_SECURE] : -1;
+    counters[number++] = secure >= 0 ? static_cast<int32_t>(secure / 1000) : -1;
+    return number;
+}
+
 uint8_t* ZRtp::getExportedKey(int32_t *length) {
     if (length != nullptr)
         *length = hashLength;
     return zrtpExport;
 }
 
-bool ZRtp::checkAndSetNonce(uint8_t* nonce) {
+bool ZRtp::checkAndSetNonce(uint8_t* nonce, uint32_t* errMsg) {
     // This is for backward compatibility if an applications uses the old
     // get- and setMultiStrParams functions
     if (masterStream == nullptr)
         return true;
 
-    for (const auto& usedNonce : masterStream->peerNonces) {
-        if (memcmp(usedNonce.data(), nonce, ZRTP_WORD_SIZE * 4) == 0) {
-            return false;
-        }
+    switch (masterStream->peerNonces.checkAndAdd(nonce)) {
+    case ZrtpNonceSet::Added:
+        return true;
+
+    case ZrtpNonceSet::Seen:
+        *errMsg = NonceReused;
+        return false;
+
+    default:
+        // The master session reached its maximum number of multi-stream sessions
+        *errMsg = CriticalSWError;
+        return false;
     }
-    // the string holds the binary nonce
-    std::string str;
-    str.assign((char *)nonce, ZRTP_WORD_SIZE * 4);
-    masterStream->peerNonces.push_back(str);
-    return true;
 }
 
 /** EMACS **
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <libzrtpcpp/ZRtpPool.h>
+
+ZRtpPool::ZRtpPool(size_t maxIdle): maxIdle(maxIdle), created(0), reused(0) {
+    idle.reserve(maxIdle);
+}
+
+ZRtpPool::~ZRtpPool() {
+    for (size_t i = 0; i < idle.size(); i++)
+        delete idle[i];
+    idle.clear();
+}
+
+ZRtp* ZRtpPool::acquire(uint8_t* myZid, ZrtpCallback* cb, std::string id,
+                        ZrtpConfigure* config, bool mitm, bool sasSignSupport) {
+    ZRtp* engine = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!idle.empty()) {
+            engine = idle.back();
+            idle.pop_back();
+            reused++;
+        }
+        else {
+            created++;
+        }
+    }
+    // Reset and construct outside the lock, both compute the hash chain
+    if (engine != nullptr)
+        engine->reset(myZid, cb, id, config, mitm, sasSignSupport);
+    else
+        engine = new ZRtp(myZid, cb, id, config, mitm, sasSignSupport);
+    return engine;
+}
+
+void ZRtpPool::release(ZRtp* engine) {
+    if (engine == nullptr)
+        return;
+
+    engine->clearSession();
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (idle.size() < maxIdle) {
+            idle.push_back(engine);
+            return;
+        }
+    }
+    delete engine;
+}
+
+void ZRtpPool::prefill(size_t count, uint8_t* myZid, ZrtpConfigure* config) {
+    if (count > maxIdle)
+        count = maxIdle;
+
+    for (size_t i = getIdleCount(); i < count; i++) {
+        ZRtp* engine = new ZRtp(myZid, nullptr, std::string(), config);
+        engine->clearSession();
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (idle.size() >= maxIdle) {
+            delete engine;
+            break;
+        }
+        idle.push_back(engine);
+    }
+}
+
+size_t ZRtpPool::getIdleCount() {
+    std::lock_guard<std::mutex> guard(lock);
+    return idle.size();
+}
+
+uint64_t ZRtpPool::getCreatedCount() {
+    std::lock_guard<std::mutex> guard(lock);
+    return created;
+}
+
+uint64_t ZRtpPool::getReusedCount() {
+    std::lock_guard<std::mutex> guard(lock);
+    return reused;
+}
+
+ZRtpPool& ZRtpPool::getInstance() {
+    static ZRtpPool pool;
+    return pool;
+}
@@ -337,6 +337,46 @@ int32_t zrtp_getCurrentProtocolVersion(ZrtpContext* zrtpContext) {
         return zrtpContext->zrtpEngine->getCurrentProtocolVersion();
     return -1;
 }
+
+int32_t zrtp_getNumberOfCountersZrtp(ZrtpContext* zrtpContext) {
+    if (zrtpContext && zrtpContext->zrtpEngine)
+        return zrtpContext->zrtpEngine->getNumberOfCountersZrtp();
+    return -1;
+}
+
+int32_t zrtp_getCountersZrtp(ZrtpContext* zrtpContext, int32_t* counters) {
+    if (counters == NULL)
+        return -1;
+
+    if (zrtpContext && zrtpContext->zrtpEngine)
+        return zrtpContext->zrtpEngine->getCountersZrtp(counters);
+    return -1;
+}
+
+static_assert(sizeof(C_ZrtpTraceInfo_t) == sizeof(zrtpTraceInfo), "C_ZrtpTraceInfo_t out of sync with zrtpTraceInfo");
+
+int32_t zrtp_getTraceInfo(ZrtpContext* zrtpContext, C_ZrtpTraceInfo_t* info) {
+    if (info == NULL)
+        return 0;
+
+    if (zrtpContext && zrtpContext->zrtpEngine) {
+        memcpy(info, zrtpContext->zrtpEngine->getTraceInfo(), sizeof(C_ZrtpTraceInfo_t));
+        return 1;
+    }
+    return 0;
+}
+
+void zrtp_setTraceEnabled(int32_t enable) {
+    ZrtpTrace::setEnabled(enable != 0);
+}
+
+int32_t zrtp_getTraceHistogram(int32_t histogram, uint64_t* buckets, int32_t size) {
+    return ZrtpTrace::getHistogram(histogram, buckets, size);
+}
+
+void zrtp_resetTraceHistograms(void) {
+    ZrtpTrace::resetHistograms();
+}
 /*
  * The following methods wrap the ZRTP Configure functions
  */
@@ -22,6 +22,7 @@
 #include <crypto/twoCFB.h>
 #include <libzrtpcpp/ZrtpConfigure.h>
 #include <libzrtpcpp/ZrtpTextData.h>
+#include <libzrtpcpp/ZrtpPacketHello.h>
 
 AlgorithmEnum::AlgorithmEnum(const AlgoTypes type, const char* name, 
                              uint32_t klen, const char* ra, encrypt_t en,
@@ -238,10 +239,56 @@ AuthLengthEnum zrtpAuthLengths;
  * The public methods are mainly a facade to the private methods.
  */
 ZrtpConfigure::ZrtpConfigure(): enableTrustedMitM(false), enableSasSignature(false), enableParanoidMode(false),
-selectionPolicy(Standard){}
+enableDisclosureFlag(false), maxMultiStreams(ZRTP_DEFAULT_MAX_NONCES), selectionPolicy(Standard){}
+
+/*
+ * Copy and assignment load the template atomically because another thread
+ * may build the template of the source configuration at the same time.
+ */
+ZrtpConfigure::ZrtpConfigure(const ZrtpConfigure& other): hashes(other.hashes), symCiphers(other.symCiphers),
+publicKeyAlgos(other.publicKeyAlgos), sasTypes(other.sasTypes), authLengths(other.authLengths),
+enableTrustedMitM(other.enableTrustedMitM), enableSasSignature(other.enableSasSignature),
+enableParanoidMode(other.enableParanoidMode), enableDisclosureFlag(other.enableDisclosureFlag),
+maxMultiStreams(other.maxMultiStreams), selectionPolicy(other.selectionPolicy), helloTemplate(std::atomic_load(&other.helloTemplate)) {}
 
 ZrtpConfigure::~ZrtpConfigure() {}
 
+ZrtpConfigure& ZrtpConfigure::operator=(const ZrtpConfigure& other) {
+    if (this == &other)
+        return *this;
+
+    hashes = other.hashes;
+    symCiphers = other.symCiphers;
+    publicKeyAlgos = other.publicKeyAlgos;
+    sasTypes = other.sasTypes;
+    authLengths = other.authLengths;
+    enableTrustedMitM = other.enableTrustedMitM;
+    enableSasSignature = other.enableSasSignature;
+    enableParanoidMode = other.enableParanoidMode;
+    enableDisclosureFlag = other.enableDisclosureFlag;
+    maxMultiStreams = other.maxMultiStreams;
+    selectionPolicy = other.selectionPolicy;
+    std::atomic_store(&helloTemplate, std::atomic_load(&other.helloTemplate));
+    return *this;
+}
+
+std::shared_ptr<const ZrtpPacketHello> ZrtpConfigure::getHelloTemplate() {
+    std::shared_ptr<const ZrtpPacketHello> hello = std::atomic_load(&helloTemplate);
+    if (hello)
+        return hello;
+
+    // Concurrent callers may build identical templates, the last one wins
+    ZrtpPacketHello* newHello = new ZrtpPacketHello();
+    newHello->configureHello(this);
+    hello.reset(newHello);
+    std::atomic_store(&helloTemplate, hello);
+    return hello;
+}
+
+void ZrtpConfigure::clearHelloTemplate() {
+    std::atomic_store(&helloTemplate, std::shared_ptr<const ZrtpPacketHello>());
+}
+
 void ZrtpConfigure::setStandardConfig() {
     clear();
 
@@ -285,6 +332,7 @@ void ZrtpConfigure::setMandatoryOnly() {
 }
 
 void ZrtpConfigure::clear() {
+    clearHelloTemplate();
     hashes.clear();
     symCiphers.clear();
     publicKeyAlgos.clear();
@@ -294,11 +342,13 @@ void ZrtpConfigure::clear() {
 
 int32_t ZrtpConfigure::addAlgo(AlgoTypes algoType, AlgorithmEnum& algo) {
 
+    clearHelloTemplate();
     return addAlgo(getEnum(algoType), algo);
 }
 
 int32_t ZrtpConfigure::addAlgoAt(AlgoTypes algoType, AlgorithmEnum& algo, int32_t index) {
 
+    clearHelloTemplate();
     return addAlgoAt(getEnum(algoType), algo, index);
 }
 
@@ -309,6 +359,7 @@ AlgorithmEnum& ZrtpConfigure::getAlgoAt(AlgoTypes algoType, int32_t index) {
 
 int32_t ZrtpConfigure::removeAlgo(AlgoTypes algoType, AlgorithmEnum& algo) {
 
+    clearHelloTemplate();
     return removeAlgo(getEnum(algoType), algo);
 }
 
@@ -494,6 +545,14 @@ bool ZrtpConfigure::isDisclosureFlag() {
     return enableDisclosureFlag;
 }
 
+void ZrtpConfigure::setMaxMultiStreams(uint32_t number) {
+    maxMultiStreams = number;
+}
+
+uint32_t ZrtpConfigure::getMaxMultiStreams() {
+    return maxMultiStreams;
+}
+
 #if 0
 ZrtpConfigure config;
 
@@ -7,7 +7,14 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <libzrtpcpp/ZrtpCrc32.h>
+#include <common/osSpecifics.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32C_X86
+#include <nmmintrin.h>
+#endif
 
 #define CRC32C_POLY 0x1EDC6F41
 #define CRC32C(c,d) (c=(c>>8)^crc_c[(c^(d))&0xFF])
@@ -98,6 +105,162 @@ static const uint32_t crc_c[256] = {
 };
 
 
+/*
+ * Slicing-by-8: crcTables[k][n] is the CRC register after processing the
+ * byte n followed by k zero bytes. One lookup per table processes eight
+ * bytes, crcTables[0] is the byte table crc_c.
+ */
+static uint32_t crcTables[8][256];
+
+static inline uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t crc32cBytes(uint32_t crc32, const uint8_t *buffer, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+        CRC32C(crc32, buffer[i]);
+    return crc32;
+}
+
+static uint32_t crc32cSlice8(uint32_t crc32, const uint8_t *buffer, size_t length)
+{
+    while (length >= 8) {
+        uint32_t lo = crc32 ^ le32(buffer);
+        uint32_t hi = le32(buffer + 4);
+        crc32 = crcTables[7][lo & 0xff] ^ crcTables[6][(lo >> 8) & 0xff] ^
+                crcTables[5][(lo >> 16) & 0xff] ^ crcTables[4][lo >> 24] ^
+                crcTables[3][hi & 0xff] ^ crcTables[2][(hi >> 8) & 0xff] ^
+                crcTables[1][(hi >> 16) & 0xff] ^ crcTables[0][hi >> 24];
+        buffer += 8;
+        length -= 8;
+    }
+    return crc32cBytes(crc32, buffer, length);
+}
+
+#if defined(CRC32C_X86)
+
+/*
+ * The crc32 instruction has a latency of three cycles but can start one
+ * every cycle. Buffers of at least 3 * CRC32C_LANE bytes are thus processed
+ * in three independent lanes. The CRC of the first lane is shifted over the
+ * following lane and combined with the CRC of that lane, which started
+ * with 0. shiftTable[k][n] is the register after processing the byte n at
+ * position k of the register followed by CRC32C_LANE zero bytes.
+ */
+#define CRC32C_LANE 64
+
+static uint32_t shiftTable[4][256];
+
+static inline uint32_t crc32cShift(uint32_t crc32)
+{
+    return shiftTable[0][crc32 & 0xff] ^ shiftTable[1][(crc32 >> 8) & 0xff] ^
+           shiftTable[2][(crc32 >> 16) & 0xff] ^ shiftTable[3][crc32 >> 24];
+}
+
+#if defined(__x86_64__)
+typedef uint64_t crcWord;
+#define CRC32C_WORD(c, p)   _mm_crc32_u64((c), load64(p))
+
+static inline uint64_t load64(const uint8_t *p)
+{
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+#else
+typedef uint32_t crcWord;
+#define CRC32C_WORD(c, p)   _mm_crc32_u32((c), load32(p))
+
+static inline uint32_t load32(const uint8_t *p)
+{
+    uint32_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+#endif
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSse42(uint32_t crc32, const uint8_t *buffer, size_t length)
+{
+    while (length >= 3 * CRC32C_LANE) {
+        crcWord crc0 = crc32, crc1 = 0, crc2 = 0;
+        const uint8_t *end = buffer + CRC32C_LANE;
+
+        do {
+            crc0 = CRC32C_WORD(crc0, buffer);
+            crc1 = CRC32C_WORD(crc1, buffer + CRC32C_LANE);
+            crc2 = CRC32C_WORD(crc2, buffer + 2 * CRC32C_LANE);
+            buffer += sizeof(crcWord);
+        } while (buffer < end);
+
+        crc32 = crc32cShift((uint32_t)crc0) ^ (uint32_t)crc1;
+        crc32 = crc32cShift(crc32) ^ (uint32_t)crc2;
+        buffer += 2 * CRC32C_LANE;
+        length -= 3 * CRC32C_LANE;
+    }
+
+    crcWord crc = crc32;
+    while (length >= sizeof(crcWord)) {
+        crc = CRC32C_WORD(crc, buffer);
+        buffer += sizeof(crcWord);
+        length -= sizeof(crcWord);
+    }
+    crc32 = (uint32_t)crc;
+    while (length-- > 0)
+        crc32 = _mm_crc32_u8(crc32, *buffer++);
+    return crc32;
+}
+#endif
+
+/* Until the tables are ready at load time the byte-wise code runs */
+typedef uint32_t (*crc32cFunction)(uint32_t crc32, const uint8_t *buffer, size_t length);
+
+static crc32cFunction crc32cUpdate = crc32cBytes;
+
+static struct Crc32cSetup {
+    Crc32cSetup() {
+        for (int n = 0; n < 256; n++)
+            crcTables[0][n] = crc_c[n];
+        for (int k = 1; k < 8; k++) {
+            for (int n = 0; n < 256; n++)
+                crcTables[k][n] = (crcTables[k - 1][n] >> 8) ^ crc_c[crcTables[k - 1][n] & 0xff];
+        }
+#if defined(CRC32C_X86)
+        static const uint8_t zeros[CRC32C_LANE] = {0};
+        for (int k = 0; k < 4; k++) {
+            for (uint32_t n = 0; n < 256; n++)
+                shiftTable[k][n] = crc32cBytes(n << (8 * k), zeros, sizeof(zeros));
+        }
+#endif
+        zrtpCksumUseAccel(1);
+    }
+} crc32cSetup;
+
+int zrtpCksumUseAccel(int enable)
+{
+    int previous = crc32cUpdate != crc32cSlice8 && crc32cUpdate != crc32cBytes;
+
+    crc32cUpdate = crc32cSlice8;
+#if defined(CRC32C_X86)
+    if (enable && (zrtpCpuFeatures() & ZRTP_CPU_SSE42))
+        crc32cUpdate = crc32cSse42;
+#else
+    (void)enable;
+#endif
+    return previous;
+}
+
+const char* zrtpCksumImpl()
+{
+#if defined(CRC32C_X86)
+    if (crc32cUpdate == crc32cSse42)
+        return "sse4.2";
+#endif
+    return "slice8";
+}
+
 bool zrtpCheckCksum(const uint8_t *buffer, uint16_t length, uint32_t crc32)
 {
     uint32_t chksum = zrtpGenerateCksum(buffer, length);
@@ -108,15 +271,9 @@ bool zrtpCheckCksum(const uint8_t *buffer, uint16_t length, uint32_t crc32)
 
 uint32_t zrtpGenerateCksum(const uint8_t *buffer, uint16_t length)
 {
-    uint32_t crc32 = ~(uint32_t) 0;
-    uint32_t i;
-
     // fprintf(stderr, "Buffer %xl, length: %d\n", buffer, length);
     /* Calculate the CRC. */
-    for (i = 0; i < length ; i++)
-        CRC32C(crc32, buffer[i]);
-
-    return crc32;
+    return crc32cUpdate(~(uint32_t) 0, buffer, length);
 }
 
 uint32_t zrtpEndCksum(uint32_t crc32)
@@ -0,0 +1,301 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include <libzrtpcpp/ZrtpEventLoop.h>
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpCrc32.h>
+#include <libzrtpcpp/zrtpPacket.h>
+
+// Size of the fixed ZRTP packet header: flags, sequence number, magic, SSRC
+static const int32_t zrtpHeaderLength = 12;
+
+ZrtpEventLoop::ZrtpEventLoop(): lastTimerId(0), readyHead(nullptr), readyTail(nullptr), signaled(false),
+    eventFd(-1) {
+#ifdef __linux__
+    eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+ZrtpEventLoop::~ZrtpEventLoop() {
+#ifdef __linux__
+    if (eventFd >= 0)
+        close(eventFd);
+#endif
+}
+
+void ZrtpEventLoop::clearEvent() {
+#ifdef __linux__
+    if (eventFd >= 0) {
+        uint64_t value;
+        ssize_t rc = read(eventFd, &value, sizeof(value));
+        (void)rc;
+    }
+#endif
+    signaled = false;
+}
+
+bool ZrtpEventLoop::isValid(const TimerEntry& entry) const {
+    Timer* timer = slots[entry.slot];
+    return timer != nullptr && timer->timerId == entry.timerId;
+}
+
+void ZrtpEventLoop::popTimer() {
+    std::pop_heap(timers.begin(), timers.end(), laterTimer);
+    timers.pop_back();
+}
+
+// The engines cancel and restart their timers often. Remove the cancelled
+// entries if they are the majority of the heap.
+void ZrtpEventLoop::compactTimers() {
+    size_t valid = 0;
+    for (size_t i = 0; i < timers.size(); i++) {
+        if (isValid(timers[i]))
+            timers[valid++] = timers[i];
+    }
+    timers.resize(valid);
+    std::make_heap(timers.begin(), timers.end(), laterTimer);
+}
+
+uint64_t ZrtpEventLoop::getNextDeadline() {
+    while (!timers.empty() && !isValid(timers.front()))
+        popTimer();
+    return timers.empty() ? 0 : timers.front().deadline;
+}
+
+int32_t ZrtpEventLoop::getTimeout(uint64_t nowMs) {
+    uint64_t next = getNextDeadline();
+    if (next == 0)
+        return -1;
+    if (next <= nowMs)
+        return 0;
+    uint64_t diff = next - nowMs;
+    return diff > 0x7fffffff ? 0x7fffffff : static_cast<int32_t>(diff);
+}
+
+int32_t ZrtpEventLoop::processTimers(uint64_t nowMs) {
+    int32_t processed = 0;
+
+    while (!timers.empty()) {
+        TimerEntry entry = timers.front();
+        if (!isValid(entry)) {
+            popTimer();
+            continue;
+        }
+        if (entry.deadline > nowMs)
+            break;
+        popTimer();
+
+        // The client may start the timer again
+        Timer* timer = slots[entry.slot];
+        timer->timerId = 0;
+        timer->timerExpired();
+        processed++;
+    }
+    return processed;
+}
+
+ZrtpEventSession* ZrtpEventLoop::nextReady() {
+    ZrtpEventSession* session = readyHead;
+    if (session == nullptr)
+        return nullptr;
+
+    readyHead = session->nextReady;
+    if (readyHead == nullptr)
+        readyTail = nullptr;
+    session->nextReady = nullptr;
+    session->inReadyList = false;
+    return session;
+}
+
+void ZrtpEventLoop::attachTimer(Timer* timer) {
+    if (timer->timerLoop != nullptr)
+        return;
+
+    timer->timerLoop = this;
+    timer->timerId = 0;
+    if (!freeSlots.empty()) {
+        timer->slot = freeSlots.back();
+        freeSlots.pop_back();
+        slots[timer->slot] = timer;
+        return;
+    }
+    slots.push_back(timer);
+    timer->slot = static_cast<uint32_t>(slots.size() - 1);
+}
+
+void ZrtpEventLoop::detachTimer(Timer* timer) {
+    if (timer->timerLoop != this)
+        return;
+
+    // The heap entries of this slot are now invalid, also if a new timer
+    // gets the slot: timer ids are unique
+    timer->timerId = 0;
+    timer->timerLoop = nullptr;
+    slots[timer->slot] = nullptr;
+    freeSlots.push_back(timer->slot);
+}
+
+void ZrtpEventLoop::startTimer(Timer* timer, int32_t timeMs) {
+    attachTimer(timer);
+    if (timers.size() >= 64 && timers.size() > 2 * getNumberOfTimers())
+        compactTimers();
+
+    TimerEntry entry;
+    entry.deadline = zrtpGetTickCount() + static_cast<uint64_t>(timeMs < 0 ? 0 : timeMs);
+    entry.timerId = ++lastTimerId;
+    entry.slot = timer->slot;
+    timers.push_back(entry);
+    std::push_heap(timers.begin(), timers.end(), laterTimer);
+
+    timer->timerId = entry.timerId;
+    timer->deadline = entry.deadline;
+}
+
+void ZrtpEventLoop::detach(ZrtpEventSession* session) {
+    if (session->inReadyList) {
+        ZrtpEventSession* prev = nullptr;
+        for (ZrtpEventSession* s = readyHead; s != nullptr; prev = s, s = s->nextReady) {
+            if (s != session)
+                continue;
+            if (prev == nullptr)
+                readyHead = s->nextReady;
+            else
+                prev->nextReady = s->nextReady;
+            if (readyTail == s)
+                readyTail = prev;
+            break;
+        }
+        session->inReadyList = false;
+    }
+    detachTimer(session);
+}
+
+void ZrtpEventLoop::markReady(ZrtpEventSession* session) {
+    if (session->inReadyList)
+        return;
+
+    session->inReadyList = true;
+    session->nextReady = nullptr;
+    if (readyTail == nullptr)
+        readyHead = session;
+    else
+        readyTail->nextReady = session;
+    readyTail = session;
+
+    if (!signaled) {
+        signaled = true;
+#ifdef __linux__
+        if (eventFd >= 0) {
+            uint64_t one = 1;
+            ssize_t rc = write(eventFd, &one, sizeof(one));
+            (void)rc;
+        }
+#endif
+    }
+}
+
+ZrtpEventSession::ZrtpEventSession(ZrtpEventLoop* loop, uint32_t ssrc): loop(loop), zrtpEngine(nullptr),
+    nextReady(nullptr), localSsrc(ssrc), sequence(0), inReadyList(false), readOffset(0) {
+    loop->attachTimer(this);
+}
+
+ZrtpEventSession::~ZrtpEventSession() {
+    loop->detach(this);
+}
+
+const uint8_t* ZrtpEventSession::frontPacket(int32_t* length) const {
+    if (readOffset >= output.size())
+        return nullptr;
+
+    uint16_t len;
+    memcpy(&len, &output[readOffset], sizeof(len));
+    *length = len;
+    return &output[readOffset + sizeof(len)];
+}
+
+void ZrtpEventSession::popPacket() {
+    if (readOffset >= output.size())
+        return;
+
+    uint16_t len;
+    memcpy(&len, &output[readOffset], sizeof(len));
+    readOffset += sizeof(len) + len;
+
+    // Keep the capacity of the buffer for the next packets
+    if (readOffset >= output.size()) {
+        output.clear();
+        readOffset = 0;
+    }
+}
+
+int32_t ZrtpEventSession::sendDataZRTP(const uint8_t* data, int32_t length) {
+    // The length of the message includes the CRC
+    int32_t packetLength = zrtpHeaderLength + length;
+    if (length < static_cast<int32_t>(CRC_SIZE) || packetLength > 0xffff)
+        return 0;
+
+    uint16_t len = static_cast<uint16_t>(packetLength);
+    size_t offset = output.size();
+    output.resize(offset + sizeof(len) + packetLength);
+    memcpy(&output[offset], &len, sizeof(len));
+
+    uint8_t* buffer = &output[offset + sizeof(len)];
+    uint16_t seq = zrtpHtons(sequence++);
+    uint32_t magic = zrtpHtonl(ZRTP_MAGIC);
+    uint32_t ssrc = zrtpHtonl(localSsrc);
+
+    buffer[0] = 0x10;
+    buffer[1] = 0;
+    memcpy(buffer + 2, &seq, sizeof(seq));
+    memcpy(buffer + 4, &magic, sizeof(magic));
+    memcpy(buffer + 8, &ssrc, sizeof(ssrc));
+    memcpy(buffer + zrtpHeaderLength, data, length - CRC_SIZE);
+
+    // The CRC covers the fixed header and the message
+    uint16_t crcOffset = static_cast<uint16_t>(packetLength - CRC_SIZE);
+    uint32_t crc = zrtpHtonl(zrtpEndCksum(zrtpGenerateCksum(buffer, crcOffset)));
+    memcpy(buffer + crcOffset, &crc, sizeof(crc));
+
+    loop->markReady(this);
+    return 1;
+}
+
+int32_t ZrtpEventSession::activateTimer(int32_t time) {
+    loop->startTimer(this, time);
+    return 1;
+}
+
+int32_t ZrtpEventSession::cancelTimer() {
+    loop->stopTimer(this);
+    return 1;
+}
+
+void ZrtpEventSession::timerExpired() {
+    if (zrtpEngine != nullptr)
+        zrtpEngine->processTimeout();
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <chrono>
+
+#include <libzrtpcpp/ZrtpMultiStreamGroup.h>
+
+ZrtpMultiStreamGroup::ZrtpMultiStreamGroup(ZRtp* master, ZRtpPool* pool): master(master), pool(pool),
+    listener(nullptr), secureCount(0), failedCount(0) {}
+
+ZrtpMultiStreamGroup::~ZrtpMultiStreamGroup() {
+    releaseStreams();
+}
+
+size_t ZrtpMultiStreamGroup::createStreams(size_t number, ZrtpCallback* const* callbacks, uint8_t* myZid,
+                                           const std::string& id, ZrtpConfigure* config) {
+    std::vector<ZRtp*> created;
+    created.reserve(number);
+
+    // Create the engines outside the lock, each computes its hash chain
+    for (size_t i = 0; i < number; i++) {
+        ZRtp* engine = pool != nullptr ? pool->acquire(myZid, callbacks[i], id, config) :
+                                         new ZRtp(myZid, callbacks[i], id, config);
+        if (!engine->setMultiStrMaster(master)) {
+            if (pool != nullptr)
+                pool->release(engine);
+            else
+                delete engine;
+            break;
+        }
+        created.push_back(engine);
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (!streams.empty() || created.size() != number) {
+        for (size_t i = 0; i < created.size(); i++) {
+            if (pool != nullptr)
+                pool->release(created[i]);
+            else
+                delete created[i];
+        }
+        return 0;
+    }
+    streams.swap(created);
+    states.assign(number, Running);
+    secureCount = 0;
+    failedCount = 0;
+    for (size_t i = 0; i < streams.size(); i++) {
+        streams[i]->streamGroup = this;
+        streams[i]->streamGroupIndex = i;
+    }
+    return number;
+}
+
+void ZrtpMultiStreamGroup::startStreams() {
+    // The engines may report secure state or failure in other threads while
+    // this loop runs, thus copy the list first
+    std::vector<ZRtp*> toStart;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        toStart = streams;
+    }
+    for (size_t i = 0; i < toStart.size(); i++)
+        toStart[i]->startZrtpEngine();
+}
+
+void ZrtpMultiStreamGroup::releaseStreams() {
+    std::vector<ZRtp*> toRelease;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        toRelease.swap(streams);
+        states.clear();
+        secureCount = 0;
+        failedCount = 0;
+        for (size_t i = 0; i < toRelease.size(); i++)
+            toRelease[i]->streamGroup = nullptr;
+    }
+    for (size_t i = 0; i < toRelease.size(); i++) {
+        ZRtp* engine = toRelease[i];
+        if (pool != nullptr) {
+            pool->release(engine);
+        }
+        else {
+            engine->stopZrtp();
+            delete engine;
+        }
+    }
+}
+
+ZRtp* ZrtpMultiStreamGroup::getStream(size_t index) {
+    std::lock_guard<std::mutex> guard(lock);
+    return index < streams.size() ? streams[index] : nullptr;
+}
+
+size_t ZrtpMultiStreamGroup::getNumberOfStreams() {
+    std::lock_guard<std::mutex> guard(lock);
+    return streams.size();
+}
+
+size_t ZrtpMultiStreamGroup::getSecureStreams() {
+    std::lock_guard<std::mutex> guard(lock);
+    return secureCount;
+}
+
+size_t ZrtpMultiStreamGroup::getFailedStreams() {
+    std::lock_guard<std::mutex> guard(lock);
+    return failedCount;
+}
+
+bool ZrtpMultiStreamGroup::isDone() {
+    std::lock_guard<std::mutex> guard(lock);
+    return !streams.empty() && secureCount + failedCount == streams.size();
+}
+
+bool ZrtpMultiStreamGroup::waitDone(int32_t timeoutMs) {
+    std::unique_lock<std::mutex> guard(lock);
+    return done.wait_for(guard, std::chrono::milliseconds(timeoutMs), [this] {
+        return !streams.empty() && secureCount + failedCount == streams.size();
+    });
+}
+
+void ZrtpMultiStreamGroup::setListener(Listener* l) {
+    std::lock_guard<std::mutex> guard(lock);
+    listener = l;
+}
+
+void ZrtpMultiStreamGroup::streamDone(size_t index, bool secure) {
+    Listener* notify = nullptr;
+    size_t secureStreams = 0;
+    size_t failedStreams = 0;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        // An engine reports each result once, a failure after secure state
+        // (for example a GoClear) does not change the group result
+        if (index >= states.size() || states[index] != Running)
+            return;
+
+        states[index] = secure ? Secure : Failed;
+        if (secure)
+            secureCount++;
+        else
+            failedCount++;
+
+        if (secureCount + failedCount < streams.size())
+            return;
+        notify = listener;
+        secureStreams = secureCount;
+        failedStreams = failedCount;
+    }
+    done.notify_all();
+    if (notify != nullptr)
+        notify->streamsDone(this, secureStreams, failedStreams);
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <cstring>
+#include <new>
+
+#include <libzrtpcpp/ZrtpNonceSet.h>
+#include <cryptcommon/ZrtpRandom.h>
+
+static const uint32_t initialCapacity = 16;
+
+// Finalizer of MurmurHash3, mixes all input bits into all output bits
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+ZrtpNonceSet::ZrtpNonceSet(uint32_t maxNonces): entries(nullptr), tags(nullptr), capacity(0), count(0),
+    maxNonces(maxNonces), seed(0) {}
+
+ZrtpNonceSet::~ZrtpNonceSet() {
+    delete[] entries;
+    delete[] tags;
+}
+
+uint64_t ZrtpNonceSet::hash(const Entry& nonce) const {
+    return mix64(mix64(nonce.words[0] ^ seed) ^ nonce.words[1]);
+}
+
+void ZrtpNonceSet::insert(const Entry& nonce, uint64_t h) {
+    uint32_t mask = capacity - 1;
+    uint32_t slot = static_cast<uint32_t>(h) & mask;
+
+    while (tags[slot] != 0)
+        slot = (slot + 1) & mask;
+    tags[slot] = static_cast<uint8_t>(0x80 | (h >> 57));
+    entries[slot] = nonce;
+}
+
+bool ZrtpNonceSet::grow() {
+    uint32_t newCapacity = capacity == 0 ? initialCapacity : capacity * 2;
+    if (newCapacity < capacity)
+        return false;
+
+    Entry* oldEntries = entries;
+    uint8_t* oldTags = tags;
+    uint32_t oldCapacity = capacity;
+
+    entries = new (std::nothrow) Entry[newCapacity];
+    tags = new (std::nothrow) uint8_t[newCapacity];
+    if (entries == nullptr || tags == nullptr) {
+        delete[] entries;
+        delete[] tags;
+        entries = oldEntries;
+        tags = oldTags;
+        return false;
+    }
+    memset(tags, 0, newCapacity);
+    capacity = newCapacity;
+
+    if (oldCapacity == 0)
+        ZrtpRandom::getRandomData(reinterpret_cast<uint8_t*>(&seed), sizeof(seed));
+
+    for (uint32_t i = 0; i < oldCapacity; i++) {
+        if (oldTags[i] != 0)
+            insert(oldEntries[i], hash(oldEntries[i]));
+    }
+    delete[] oldEntries;
+    delete[] oldTags;
+    return true;
+}
+
+ZrtpNonceSet::Result ZrtpNonceSet::checkAndAdd(const uint8_t* nonce) {
+    Entry entry;
+    memcpy(entry.words, nonce, nonceLength);
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (capacity != 0) {
+        uint64_t h = hash(entry);
+        uint8_t tag = static_cast<uint8_t>(0x80 | (h >> 57));
+        uint32_t mask = capacity - 1;
+
+        for (uint32_t slot = static_cast<uint32_t>(h) & mask; tags[slot] != 0; slot = (slot + 1) & mask) {
+            if (tags[slot] == tag && memcmp(entries[slot].words, entry.words, nonceLength) == 0)
+                return Seen;
+        }
+    }
+    if (count >= maxNonces)
+        return Full;
+
+    // Keep the load factor at or below 3/4 to keep the probe sequences short
+    if ((static_cast<uint64_t>(count) + 1) * 4 > static_cast<uint64_t>(capacity) * 3 && !grow())
+        return Full;
+
+    insert(entry, hash(entry));
+    count++;
+    return Added;
+}
+
+void ZrtpNonceSet::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+
+    delete[] entries;
+    delete[] tags;
+    entries = nullptr;
+    tags = nullptr;
+    capacity = 0;
+    count = 0;
+}
+
+void ZrtpNonceSet::setMaxNonces(uint32_t max) {
+    std::lock_guard<std::mutex> guard(lock);
+    maxNonces = max;
+}
+
+size_t ZrtpNonceSet::size() {
+    std::lock_guard<std::mutex> guard(lock);
+    return count;
+}
+
+size_t ZrtpNonceSet::getMemorySize() {
+    std::lock_guard<std::mutex> guard(lock);
+    return static_cast<size_t>(capacity) * (sizeof(Entry) + 1);
+}
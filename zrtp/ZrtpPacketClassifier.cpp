@@ -0,0 +1,159 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <string.h>
+
+#include <libzrtpcpp/ZrtpPacketClassifier.h>
+#include <libzrtpcpp/ZrtpCrc32.h>
+#include <libzrtpcpp/ZrtpTextData.h>
+#include <libzrtpcpp/zrtpPacket.h>
+
+// Fixed RTP header in front of the ZRTP message
+static const size_t rtpHeaderSize = 12;
+
+static const uint16_t zrtpId = 0x505a;
+
+/*
+ * The ZRTP message types and their length in words, without the CRC. The
+ * messages with variable parts have a minimum length: the fixed part of
+ * Hello, DHPart, Confirm and SASrelay, and the multi-stream Commit which
+ * has a 4 word nonce instead of the 8 word hvi.
+ */
+struct MessageType {
+    const char* type;
+    uint16_t minWords;
+    uint16_t maxWords;
+};
+
+#define FIXED_WORDS(packet)     static_cast<uint16_t>((sizeof(packet) - CRC_SIZE) / ZRTP_WORD_SIZE)
+#define MIN_WORDS(packet)       static_cast<uint16_t>(sizeof(packet) / ZRTP_WORD_SIZE)
+
+static const MessageType messageTypes[] = {
+    {HelloMsg,    MIN_WORDS(HelloPacket_t), 0xffff},
+    {HelloAckMsg, FIXED_WORDS(HelloAckPacket_t), FIXED_WORDS(HelloAckPacket_t)},
+    {CommitMsg,   static_cast<uint16_t>(FIXED_WORDS(CommitPacket_t) - HVI_SIZE / 2 / ZRTP_WORD_SIZE), 0xffff},
+    {DHPart1Msg,  MIN_WORDS(DHPartPacket_t), 0xffff},
+    {DHPart2Msg,  MIN_WORDS(DHPartPacket_t), 0xffff},
+    {Confirm1Msg, MIN_WORDS(ConfirmPacket_t), 0xffff},
+    {Confirm2Msg, MIN_WORDS(ConfirmPacket_t), 0xffff},
+    {Conf2AckMsg, FIXED_WORDS(Conf2AckPacket_t), FIXED_WORDS(Conf2AckPacket_t)},
+    {ErrorMsg,    FIXED_WORDS(ErrorPacket_t), FIXED_WORDS(ErrorPacket_t)},
+    {ErrorAckMsg, FIXED_WORDS(ErrorAckPacket_t), FIXED_WORDS(ErrorAckPacket_t)},
+    {GoClearMsg,  FIXED_WORDS(GoClearPacket_t), FIXED_WORDS(GoClearPacket_t)},
+    {ClearAckMsg, FIXED_WORDS(ClearAckPacket_t), FIXED_WORDS(ClearAckPacket_t)},
+    {PingMsg,     FIXED_WORDS(PingPacket_t), FIXED_WORDS(PingPacket_t)},
+    {PingAckMsg,  FIXED_WORDS(PingAckPacket_t), FIXED_WORDS(PingAckPacket_t)},
+    {SasRelayMsg, MIN_WORDS(SASrelayPacket_t), 0xffff},
+    {RelayAckMsg, FIXED_WORDS(RelayAckPacket_t), FIXED_WORDS(RelayAckPacket_t)},
+};
+
+static inline uint32_t getUint32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+static inline uint16_t getUint16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+ZrtpPacketClassifier::ZrtpPacketClassifier() {
+    resetCounters();
+}
+
+ZrtpPacketClassifier::PacketClass ZrtpPacketClassifier::classify(const uint8_t* packet, size_t length) {
+    if (length < rtpHeaderSize || length > 0xffff)
+        return JunkPacket;
+
+    if ((packet[0] & 0xc0) == 0x80)
+        return RtpPacket;
+
+    // Fixed header length + smallest ZRTP packet (includes CRC)
+    if ((packet[0] & 0xf0) != 0x10 || length < rtpHeaderSize + sizeof(HelloAckPacket_t))
+        return JunkPacket;
+
+    if (getUint32(packet + 4) != ZRTP_MAGIC)
+        return JunkPacket;
+
+    const uint8_t* message = packet + rtpHeaderSize;
+    if (getUint16(message) != zrtpId)
+        return JunkPacket;
+
+    uint16_t words = getUint16(message + 2);
+    if (rtpHeaderSize + static_cast<size_t>(words) * ZRTP_WORD_SIZE + CRC_SIZE != length)
+        return JunkPacket;
+
+    const uint8_t* type = message + 2 * sizeof(uint16_t);
+    for (size_t i = 0; i < sizeof(messageTypes) / sizeof(messageTypes[0]); i++) {
+        if (memcmp(type, messageTypes[i].type, TYPE_SIZE) == 0)
+            return (words >= messageTypes[i].minWords && words <= messageTypes[i].maxWords) ? ZrtpPacket : JunkPacket;
+    }
+    return JunkPacket;
+}
+
+ZrtpPacketClassifier::PacketClass ZrtpPacketClassifier::checkCrc(const uint8_t* packet, size_t length) {
+    uint16_t crcOffset = static_cast<uint16_t>(length - CRC_SIZE);
+    uint32_t crc = getUint32(packet + crcOffset);
+
+    return zrtpCheckCksum(packet, crcOffset, crc) ? ZrtpPacket : CrcErrorPacket;
+}
+
+ZrtpPacketClassifier::PacketClass ZrtpPacketClassifier::check(const uint8_t* packet, size_t length) {
+    PacketClass packetClass = classify(packet, length);
+
+    if (packetClass == ZrtpPacket)
+        packetClass = checkCrc(packet, length);
+    addCount(packetClass, 1);
+    return packetClass;
+}
+
+size_t ZrtpPacketClassifier::checkBatch(const uint8_t* const* packets, const size_t* lengths, size_t count,
+                                        PacketClass* classes) {
+    uint64_t found[numberOfClasses] = {0};
+
+    for (size_t i = 0; i < count; i++) {
+        PacketClass packetClass = classify(packets[i], lengths[i]);
+        if (packetClass == ZrtpPacket)
+            packetClass = checkCrc(packets[i], lengths[i]);
+        classes[i] = packetClass;
+        found[packetClass]++;
+    }
+    for (int32_t i = 0; i < numberOfClasses; i++) {
+        if (found[i] != 0)
+            addCount(static_cast<PacketClass>(i), found[i]);
+    }
+    return static_cast<size_t>(found[RtpPacket] + found[ZrtpPacket]);
+}
+
+ZrtpPacketCounters ZrtpPacketClassifier::getCounters() const {
+    ZrtpPacketCounters data;
+
+    data.rtpPackets = counters[RtpPacket].load(std::memory_order_relaxed);
+    data.zrtpPackets = counters[ZrtpPacket].load(std::memory_order_relaxed);
+    data.junkPackets = counters[JunkPacket].load(std::memory_order_relaxed);
+    data.crcErrors = counters[CrcErrorPacket].load(std::memory_order_relaxed);
+    return data;
+}
+
+void ZrtpPacketClassifier::resetCounters() {
+    for (int32_t i = 0; i < numberOfClasses; i++)
+        counters[i].store(0, std::memory_order_relaxed);
+}
@@ -94,6 +94,26 @@ void ZrtpPacketHello::configureHello(ZrtpConfigure* config) {
     *((uint32_t*)&helloHeader->flags) = zrtpHtonl(lenField);
 }
 
+void ZrtpPacketHello::configureHello(const ZrtpPacketHello& helloTemplate) {
+    nHash = helloTemplate.nHash;
+    nCipher = helloTemplate.nCipher;
+    nPubkey = helloTemplate.nPubkey;
+    nSas = helloTemplate.nSas;
+    nAuth = helloTemplate.nAuth;
+
+    oHash = helloTemplate.oHash;
+    oCipher = helloTemplate.oCipher;
+    oAuth = helloTemplate.oAuth;
+    oPubkey = helloTemplate.oPubkey;
+    oSas = helloTemplate.oSas;
+    oHmac = helloTemplate.oHmac;
+
+    memcpy(data, helloTemplate.data, sizeof(data));
+
+    zrtpHeader = (zrtpPacketHeader_t *)&((HelloPacket_t *)data)->hdr;	// the standard header
+    helloHeader = (Hello_t *)&((HelloPacket_t *)data)->hello;
+}
+
 ZrtpPacketHello::ZrtpPacketHello(uint8_t *data) {
     DEBUGOUT((fprintf(stdout, "Creating Hello packet from data\n")));
 
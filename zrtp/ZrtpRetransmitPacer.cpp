@@ -0,0 +1,146 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <libzrtpcpp/ZrtpRetransmitPacer.h>
+#include <common/osSpecifics.h>
+
+ZrtpRetransmitPacer::ZrtpRetransmitPacer(): active(false), getTime(zrtpGetTickCount), interval(0), tolerance(0),
+    nextSlot(0), jitterPercent(0), maxDelay(1000), sent(0), delayed(0), suppressed(0), forced(0) {}
+
+void ZrtpRetransmitPacer::setRate(int32_t packetsPerSecond, int32_t burst) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    interval = packetsPerSecond > 0 ? 1000000 / packetsPerSecond : 0;
+    if (packetsPerSecond > 0 && interval == 0)
+        interval = 1;
+    tolerance = static_cast<int64_t>(burst < 1 ? 1 : burst) * interval;
+    nextSlot = 0;
+    active.store(interval > 0 || jitterPercent.load() > 0);
+}
+
+void ZrtpRetransmitPacer::setJitter(int32_t percent) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    jitterPercent.store(percent < 0 ? 0 : (percent > 50 ? 50 : percent));
+    active.store(interval > 0 || jitterPercent.load() > 0);
+}
+
+void ZrtpRetransmitPacer::setMaxDelay(int32_t ms) {
+    std::lock_guard<std::mutex> guard(lock);
+    maxDelay = ms < 1 ? 1 : ms;
+}
+
+void ZrtpRetransmitPacer::setClock(uint64_t (*clk)()) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    getTime = (clk != nullptr) ? clk : zrtpGetTickCount;
+    nextSlot = 0;
+}
+
+uint32_t ZrtpRetransmitPacer::nextRandom(uint32_t* seed) {
+    // xorshift32, the seed must not be 0
+    uint32_t x = *seed != 0 ? *seed : 0x9e3779b9;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+int32_t ZrtpRetransmitPacer::jitterTime(int32_t timeMs, uint32_t* seed) const {
+    int32_t range = timeMs * jitterPercent.load(std::memory_order_relaxed) / 100;
+    if (range <= 0)
+        return timeMs;
+    return timeMs + static_cast<int32_t>(nextRandom(seed) % static_cast<uint32_t>(range + 1));
+}
+
+/*
+ * The bucket is a virtual schedule (GCRA): nextSlot is the time of the next
+ * free send slot, in microseconds. A retransmission may use a slot up to
+ * the tolerance ahead of its time, this is the burst. A retransmission that
+ * would be too early reserves the next slot and waits for it. Thus each
+ * retransmission waits at most once, and the waiting engines leave the
+ * bucket in the order of their reservations.
+ */
+ZrtpRetransmitPacer::Decision ZrtpRetransmitPacer::acquire(int32_t priority, int32_t delayedMs, int32_t* delayMs) {
+    // A delayed retransmission owns its slot
+    if (delayedMs > 0)
+        return Send;
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (interval == 0) {
+        sent++;
+        return Send;
+    }
+    int64_t now = static_cast<int64_t>(getTime()) * 1000;
+    if (nextSlot < now)
+        nextSlot = now;
+
+    // Packets closer to SecureState may use slots further ahead, thus they
+    // pass the Hello packets that wait for their slots
+    if (priority < HelloPriority)
+        priority = HelloPriority;
+    if (priority >= numberOfPriorities)
+        priority = FinalPriority;
+    int64_t ahead = tolerance * (1 + priority);
+
+    int64_t wait = nextSlot - ahead - now;
+    if (wait <= 0) {
+        nextSlot += interval;
+        sent++;
+        return Send;
+    }
+    int32_t delay = static_cast<int32_t>((wait + 999) / 1000);
+    if (delay > maxDelay) {
+        if (priority == HelloPriority) {
+            suppressed++;
+            return Suppress;
+        }
+        nextSlot += interval;
+        forced++;
+        return Send;
+    }
+    nextSlot += interval;
+    delayed++;
+    *delayMs = delay;
+    return Delay;
+}
+
+ZrtpRetransmitPacer::Counters ZrtpRetransmitPacer::getCounters() const {
+    Counters c;
+    c.sent = sent.load();
+    c.delayed = delayed.load();
+    c.suppressed = suppressed.load();
+    c.forced = forced.load();
+    return c;
+}
+
+void ZrtpRetransmitPacer::resetCounters() {
+    sent.store(0);
+    delayed.store(0);
+    suppressed.store(0);
+    forced.store(0);
+}
+
+ZrtpRetransmitPacer& ZrtpRetransmitPacer::getInstance() {
+    static ZrtpRetransmitPacer pacer;
+    return pacer;
+}
@@ -417,9 +417,7 @@ static int b64Decode(const char *b64Data, int32_t b64length, uint8_t *binData, i
 
 void* createSha384HmacContext(const uint8_t* key, uint64_t keyLength);
 void freeSha384HmacContext(void* ctx);
-void hmacSha384Ctx(void* ctx, const std::vector<const uint8_t*>& data,
-                   const std::vector<uint64_t>& dataLength,
-                   uint8_t* mac, uint32_t* macLength );
+void hmacSha384Ctx(void* ctx, const DataChunks& data, uint8_t* mac, uint32_t* macLength );
 
 static int expand(uint8_t* prk, uint32_t prkLen, uint8_t* info, uint32_t infoLen, int32_t L, uint32_t hashLen, uint8_t* outbuffer)
 {
@@ -427,8 +425,7 @@ static int expand(uint8_t* prk, uint32_t prkLen, uint8_t* info, uint32_t infoLen
     uint8_t *T;
     void* hmacCtx;
 
-    std::vector<const uint8_t*>data;
-    std::vector<uint64_t> dataLen;
+    DataChunks data;
 
     uint8_t counter;
     uint32_t macLength;
@@ -452,21 +449,17 @@ static int expand(uint8_t* prk, uint32_t prkLen, uint8_t* info, uint32_t infoLen
     // After first run use its output (T(1)) as first data in next HMAC run.
     for (int i = 1; i <= n; i++) {
         if (infoLen > 0 && info != nullptr) {
-            data.push_back(info);
-            dataLen.push_back(infoLen);
+            data.add(info, infoLen);
         }
         counter = static_cast<uint8_t >(i & 0xff);
-        data.push_back(&counter);
-        dataLen.push_back(1);
+        data.add(&counter, 1);
 
         if (hashLen == 384/8)
-            hmacSha384Ctx(hmacCtx, data, dataLen, T + ((i-1) * hashLen), &macLength);
+            hmacSha384Ctx(hmacCtx, data, T + ((i-1) * hashLen), &macLength);
 
         // Use output of previous hash run as first input of next hash run
         data.clear();
-        dataLen.clear();
-        data.push_back(T + ((i-1) * hashLen));
-        dataLen.push_back(hashLen);
+        data.add(T + ((i-1) * hashLen), hashLen);
     }
     freeSha384HmacContext(hmacCtx);
     memcpy(outbuffer, T, L);
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <chrono>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <libzrtpcpp/ZrtpShardReactor.h>
+#include <common/osSpecifics.h>
+
+// Shard of the calling thread, to check the thread in isShardThread()
+static thread_local const void* currentShard = nullptr;
+
+ZrtpShardReactor::ZrtpShardReactor(int32_t numShards, size_t ringSize, bool pinThreads): ringSize(ringSize),
+    pinThreads(pinThreads), started(false), readyHandler(nullptr), readyUserData(nullptr) {
+
+    if (numShards < 1)
+        numShards = 1;
+    for (int32_t i = 0; i < numShards; i++)
+        shards.push_back(std::unique_ptr<Shard>(new Shard()));
+}
+
+ZrtpShardReactor::~ZrtpShardReactor() {
+    stop();
+}
+
+void ZrtpShardReactor::start() {
+    if (started)
+        return;
+    started = true;
+
+    for (size_t i = 0; i < shards.size(); i++) {
+        shards[i]->running.store(true);
+        shards[i]->thread = std::thread(&ZrtpShardReactor::run, this, static_cast<int32_t>(i));
+    }
+}
+
+void ZrtpShardReactor::stop() {
+    if (!started)
+        return;
+
+    for (size_t i = 0; i < shards.size(); i++) {
+        Shard* shard = shards[i].get();
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->running.store(false);
+        shard->wakeup.notify_one();
+    }
+    for (size_t i = 0; i < shards.size(); i++)
+        shards[i]->thread.join();
+    started = false;
+}
+
+int32_t ZrtpShardReactor::selectShard(uint64_t key) const {
+    // Fibonacci hashing spreads addresses and sequential SSRCs
+    uint64_t hash = key * 0x9e3779b97f4a7c15ULL;
+    return static_cast<int32_t>((hash >> 32) % shards.size());
+}
+
+bool ZrtpShardReactor::isShardThread(int32_t shard) const {
+    return currentShard == shards[shard].get();
+}
+
+ZrtpShardProducer* ZrtpShardReactor::createProducer() {
+    std::lock_guard<std::mutex> lock(producerLock);
+
+    if (producers.size() >= static_cast<size_t>(maxProducers))
+        return nullptr;
+
+    ZrtpShardProducer* producer = new ZrtpShardProducer();
+    int32_t slot = static_cast<int32_t>(producers.size());
+    producers.push_back(std::unique_ptr<ZrtpShardProducer>(producer));
+
+    for (size_t i = 0; i < shards.size(); i++) {
+        producer->rings.push_back(std::unique_ptr<ZrtpShardProducer::Ring>(new ZrtpShardProducer::Ring(ringSize)));
+        Shard* shard = shards[i].get();
+        shard->rings[slot].store(producer->rings.back().get(), std::memory_order_relaxed);
+        shard->numRings.store(slot + 1, std::memory_order_release);
+    }
+    return producer;
+}
+
+bool ZrtpShardReactor::post(ZrtpShardProducer* producer, int32_t shardNumber, ZrtpShardTask function, void* context,
+                            void* data) {
+    ZrtpShardProducer::Task task;
+    task.function = function;
+    task.context = context;
+    task.data = data;
+
+    if (!producer->rings[shardNumber]->push(task))
+        return false;
+
+    // Pairs with the fence in run(): either the shard sees the new task
+    // before it sleeps or this thread sees the sleeping flag
+    Shard* shard = shards[shardNumber].get();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (shard->sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->wakeup.notify_one();
+    }
+    return true;
+}
+
+int32_t ZrtpShardReactor::runTasks(Shard* shard) {
+    int32_t processed = 0;
+    int32_t numRings = shard->numRings.load(std::memory_order_acquire);
+
+    for (int32_t i = 0; i < numRings; i++) {
+        ZrtpShardProducer::Ring* ring = shard->rings[i].load(std::memory_order_relaxed);
+        ZrtpShardProducer::Task task;
+
+        // Limit the tasks per ring, a busy producer shall not block the
+        // other producers and the timers
+        for (int32_t n = 0; n < 256 && ring->pop(task); n++) {
+            task.function(task.context, task.data);
+            processed++;
+        }
+    }
+    return processed;
+}
+
+bool ZrtpShardReactor::hasTasks(Shard* shard) {
+    int32_t numRings = shard->numRings.load(std::memory_order_acquire);
+
+    for (int32_t i = 0; i < numRings; i++) {
+        if (!shard->rings[i].load(std::memory_order_relaxed)->empty())
+            return true;
+    }
+    return false;
+}
+
+void ZrtpShardReactor::sendOutput(Shard* shard) {
+    ZrtpEventSession* session;
+
+    while ((session = shard->loop.nextReady()) != nullptr) {
+        if (readyHandler != nullptr) {
+            readyHandler(session, readyUserData);
+        }
+        else {
+            while (session->hasOutput())
+                session->popPacket();
+        }
+    }
+    shard->loop.clearEvent();
+}
+
+void ZrtpShardReactor::run(int32_t shardNumber) {
+    Shard* shard = shards[shardNumber].get();
+    currentShard = shard;
+
+#ifdef __linux__
+    if (pinThreads) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        if (cores > 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(static_cast<unsigned int>(shardNumber) % cores, &cpus);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        }
+    }
+#endif
+
+    while (shard->running.load(std::memory_order_relaxed)) {
+        int32_t processed = runTasks(shard);
+        processed += shard->loop.processTimers(zrtpGetTickCount());
+        sendOutput(shard);
+        if (processed > 0)
+            continue;
+
+        int32_t timeout = shard->loop.getTimeout(zrtpGetTickCount());
+        if (timeout == 0)
+            continue;
+
+        std::unique_lock<std::mutex> lock(shard->mutex);
+        shard->sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!hasTasks(shard) && shard->running.load(std::memory_order_relaxed)) {
+            if (timeout < 0)
+                shard->wakeup.wait(lock);
+            else
+                shard->wakeup.wait_for(lock, std::chrono::milliseconds(timeout));
+        }
+        shard->sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    // The tasks may own data, for example packet buffers. Run them to hand
+    // the data back to the application.
+    while (runTasks(shard) > 0)
+        ;
+    sendOutput(shard);
+    currentShard = nullptr;
+}
@@ -24,6 +24,7 @@
 
 #include <libzrtpcpp/ZRtp.h>
 #include <libzrtpcpp/ZrtpStateClass.h>
+#include <libzrtpcpp/ZrtpRetransmitPacer.h>
 
 using namespace std;
 using namespace GnuZrtpCodes;
@@ -44,13 +45,21 @@ state_t states[numberOfStates] = {
     {WaitErrorAck, &ZrtpStateClass::evWaitErrorAck }
 };
 
+static_assert(ZRTP_TRACE_STATES == numberOfStates, "ZrtpTrace.h: ZRTP_TRACE_STATES out of sync");
+static_assert(ZRTP_TRACE_SECURE == SecureState, "ZrtpTrace.h: ZRTP_TRACE_SECURE out of sync");
+
 
 ZrtpStateClass::ZrtpStateClass(ZRtp *p) : parent(p), commitPkt(NULL), t1Resend(20), t1ResendExtend(60), t2Resend(10),
-                                          multiStream(false), secSubstate(Normal), sentVersion(0) {
+                                          multiStream(false), secSubstate(Normal), sentVersion(0), pacingDelayed(0) {
 
     engine = new ZrtpStates(states, numberOfStates, Initial);
     memset(retryCounters, 0, sizeof(retryCounters));
 
+    // Each engine gets its own jitter sequence, also if many engines start
+    // in the same millisecond
+    pacingSeed = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(this) >> 4) ^
+                 static_cast<uint32_t>(zrtpGetTickCount()) ^ 0x9e3779b9;
+
     // Set up timers according to ZRTP spec
     T1.start = 50;
     T1.maxResend = t1Resend;
@@ -77,6 +86,38 @@ ZrtpStateClass::~ZrtpStateClass(void) {
     delete engine;
 }
 
+void ZrtpStateClass::reset() {
+
+    // Same as in destructor: close the protocol engine if necessary
+    if (!inState(Initial)) {
+        Event ev;
+
+        cancelTimer();
+        ev.type = ZrtpClose;
+        event = &ev;
+        engine->processEvent(*this);
+    }
+    engine->nextState(Initial);
+
+    commitPkt = NULL;
+    t1Resend = 20;
+    t1ResendExtend = 60;
+    t2Resend = 10;
+    multiStream = false;
+    secSubstate = Normal;
+    sentVersion = 0;
+    pacingDelayed = 0;
+    memset(retryCounters, 0, sizeof(retryCounters));
+
+    T1.start = 50;
+    T1.maxResend = t1Resend;
+    T1.capping = 800;
+
+    T2.start = 150;
+    T2.maxResend = t2Resend;
+    T2.capping = 1200;
+}
+
 void ZrtpStateClass::processEvent(Event *ev) {
 
     char *msg, first, middle, last;
@@ -296,6 +337,7 @@ void ZrtpStateClass::evDetect(void) {
                     return;
                 }
                 parent->currentHelloPacket = hpv->packet;
+                parent->computeHelloHmac(hpv);
                 sentVersion = parent->currentHelloPacket->getVersionInt();
 
                 // remember packet for easy resend in case timer triggers
@@ -335,7 +377,10 @@ void ZrtpStateClass::evDetect(void) {
     }
     // Timer event triggered - this is Timer T1 to resend Hello
     else if (event->type == Timer) {
-        if (!parent->sendPacketZRTP(sentPacket)) {
+        int32_t pace = paceResend();
+        if (pace == ZrtpRetransmitPacer::Delay)
+            return;
+        if (pace == ZrtpRetransmitPacer::Send && !parent->sendPacketZRTP(sentPacket)) {
             sendFailed();       // returns to state Initial
             return;
         }
@@ -520,7 +565,10 @@ void ZrtpStateClass::evAckSent(void) {
      *   sentPacket, Detect requires it to point to own Hello message
      */
     else if (event->type == Timer) {
-        if (!parent->sendPacketZRTP(sentPacket)) {
+        int32_t pace = paceResend();
+        if (pace == ZrtpRetransmitPacer::Delay)
+            return;
+        if (pace == ZrtpRetransmitPacer::Send && !parent->sendPacketZRTP(sentPacket)) {
             return sendFailed();      // returns to state Initial
         }
         retryCounters[HelloRetryAck]++;
@@ -936,7 +984,10 @@ void ZrtpStateClass::evCommitSent(void) {
     }
     // Timer event triggered, resend the Commit packet
     else if (event->type == Timer) {
-        if (!parent->sendPacketZRTP(sentPacket)) {
+        int32_t pace = paceResend();
+        if (pace == ZrtpRetransmitPacer::Delay)
+            return;
+        if (pace == ZrtpRetransmitPacer::Send && !parent->sendPacketZRTP(sentPacket)) {
                 sendFailed();       // returns to state Initial
                 return;
         }
@@ -1102,7 +1153,10 @@ void ZrtpStateClass::evWaitConfirm1(void) {
         }
     }
     else if (event->type == Timer) {
-        if (!parent->sendPacketZRTP(sentPacket)) {
+        int32_t pace = paceResend();
+        if (pace == ZrtpRetransmitPacer::Delay)
+            return;
+        if (pace == ZrtpRetransmitPacer::Send && !parent->sendPacketZRTP(sentPacket)) {
             sendFailed();             // returns to state Initial
             return;
         }
@@ -1258,7 +1312,10 @@ void ZrtpStateClass::evWaitConfAck(void) {
         }
     }
     else if (event->type == Timer) {
-        if (!parent->sendPacketZRTP(sentPacket)) {
+        int32_t pace = paceResend();
+        if (pace == ZrtpRetransmitPacer::Delay)
+            return;
+        if (pace == ZrtpRetransmitPacer::Send && !parent->sendPacketZRTP(sentPacket)) {
             sendFailed();             // returns to state Initial
             parent->srtpSecretsOff(ForReceiver);
             return;
@@ -1334,7 +1391,10 @@ void ZrtpStateClass::evWaitErrorAck(void) {
     }
     // Timer event triggered - this is Timer T2 to resend Error.
     else if (event->type == Timer) {
-        if (!parent->sendPacketZRTP(sentPacket)) {
+        int32_t pace = paceResend();
+        if (pace == ZrtpRetransmitPacer::Delay)
+            return;
+        if (pace == ZrtpRetransmitPacer::Send && !parent->sendPacketZRTP(sentPacket)) {
             sendFailed();                 // returns to state Initial
             return;
         }
@@ -1453,7 +1513,10 @@ bool ZrtpStateClass::subEvWaitRelayAck() {
     }
     // Timer event triggered - this is Timer T2 to resend Error.
     else if (event->type == Timer) {
-        if (!parent->sendPacketZRTP(sentPacket)) {
+        int32_t pace = paceResend();
+        if (pace == ZrtpRetransmitPacer::Delay)
+            return true;
+        if (pace == ZrtpRetransmitPacer::Send && !parent->sendPacketZRTP(sentPacket)) {
             sendFailed(); // returns to state Initial
             return false;
         }
@@ -1471,7 +1534,8 @@ int32_t ZrtpStateClass::startTimer(zrtpTimer_t *t) {
 
     t->time = t->start;
     t->counter = 0;
-    return parent->activateTimer(t->time);
+    pacingDelayed = 0;
+    return parent->activateTimer(jitterTime(t->time));
 }
 
 int32_t ZrtpStateClass::nextTimer(zrtpTimer_t *t) {
@@ -1484,7 +1548,41 @@ int32_t ZrtpStateClass::nextTimer(zrtpTimer_t *t) {
             return -1;
         }
     }
-    return parent->activateTimer(t->time);
+    return parent->activateTimer(jitterTime(t->time));
+}
+
+int32_t ZrtpStateClass::jitterTime(int32_t time) {
+    ZrtpRetransmitPacer& pacer = ZrtpRetransmitPacer::getInstance();
+    return pacer.isActive() ? pacer.jitterTime(time, &pacingSeed) : time;
+}
+
+int32_t ZrtpStateClass::paceResend() {
+    ZrtpRetransmitPacer& pacer = ZrtpRetransmitPacer::getInstance();
+    if (!pacer.isActive())
+        return ZrtpRetransmitPacer::Send;
+
+    // The closer to SecureState the higher the priority
+    int32_t priority = ZrtpRetransmitPacer::CommitPriority;
+    if (inState(Detect) || inState(AckSent))
+        priority = ZrtpRetransmitPacer::HelloPriority;
+    else if (inState(WaitConfirm1))
+        priority = ZrtpRetransmitPacer::ConfirmPriority;
+    else if (inState(WaitConfAck))
+        priority = ZrtpRetransmitPacer::FinalPriority;
+
+    int32_t delay = 0;
+    ZrtpRetransmitPacer::Decision decision = pacer.acquire(priority, pacingDelayed, &delay);
+    if (decision == ZrtpRetransmitPacer::Delay) {
+        // Send when the reserved token is due, the delay does not count as
+        // a retransmission. Send now if the timer fails.
+        if (parent->activateTimer(delay) > 0) {
+            pacingDelayed += delay;
+            return decision;
+        }
+        decision = ZrtpRetransmitPacer::Send;
+    }
+    pacingDelayed = 0;
+    return decision;
 }
 
 void ZrtpStateClass::sendErrorPacket(uint32_t errorCode) {
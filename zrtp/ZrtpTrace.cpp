@@ -0,0 +1,91 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+
+#include <libzrtpcpp/ZrtpTrace.h>
+
+std::atomic<bool> ZrtpTrace::enabled(false);
+std::atomic<uint64_t> ZrtpTrace::histograms[numberOfTraceHistograms][ZRTP_TRACE_BUCKETS];
+
+int64_t ZrtpTrace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ZrtpTrace::start(zrtpTraceInfo* info) {
+    for (int i = 0; i < ZRTP_TRACE_STATES; i++)
+        info->stateEntered[i] = -1;
+    for (int i = 0; i < numberOfTraceOps; i++) {
+        info->opTime[i] = 0;
+        info->opCount[i] = 0;
+    }
+    info->retransmits = 0;
+    info->startTime = 0;
+
+    if (!isEnabled())
+        return;
+
+    int64_t startTime = now();
+    info->startTime = startTime != 0 ? startTime : 1;   // 0 means: not traced
+    info->stateEntered[0] = 0;                          // the Initial state
+}
+
+void ZrtpTrace::enterState(zrtpTraceInfo* info, int32_t state) {
+    if (info->startTime == 0 || state < 0 || state >= ZRTP_TRACE_STATES || info->stateEntered[state] >= 0)
+        return;
+
+    int64_t elapsed = now() - info->startTime;
+    info->stateEntered[state] = elapsed;
+    if (state == ZRTP_TRACE_SECURE)
+        addToHistogram(TraceSetupTime, elapsed);
+}
+
+void ZrtpTrace::addOp(zrtpTraceInfo* info, ZrtpTraceOps op, int64_t duration) {
+    info->opTime[op] += duration;
+    info->opCount[op]++;
+    addToHistogram(op, duration);
+}
+
+void ZrtpTrace::addToHistogram(int32_t histogram, int64_t duration) {
+    uint64_t micro = duration > 0 ? static_cast<uint64_t>(duration) / 1000 : 0;
+
+    int32_t bucket = 0;
+    while (micro != 0 && bucket < ZRTP_TRACE_BUCKETS - 1) {
+        micro >>= 1;
+        bucket++;
+    }
+    histograms[histogram][bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+int32_t ZrtpTrace::getHistogram(int32_t histogram, uint64_t* buckets, int32_t size) {
+    if (histogram < 0 || histogram >= numberOfTraceHistograms || buckets == nullptr)
+        return -1;
+
+    if (size > ZRTP_TRACE_BUCKETS)
+        size = ZRTP_TRACE_BUCKETS;
+
+    for (int32_t i = 0; i < size; i++)
+        buckets[i] = histograms[histogram][i].load(std::memory_order_relaxed);
+    return size;
+}
+
+void ZrtpTrace::resetHistograms() {
+    for (int32_t h = 0; h < numberOfTraceHistograms; h++) {
+        for (int32_t i = 0; i < ZRTP_TRACE_BUCKETS; i++)
+            histograms[h][i].store(0, std::memory_order_relaxed);
+    }
+}
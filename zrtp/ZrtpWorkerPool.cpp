@@ -0,0 +1,99 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <libzrtpcpp/ZrtpWorkerPool.h>
+
+// The strand of the task that the calling worker thread runs
+static thread_local const ZrtpWorkerPool::Strand* currentStrand = nullptr;
+
+ZrtpWorkerPool::ZrtpWorkerPool(int32_t numThreads): running(true) {
+    if (numThreads < 1)
+        numThreads = 1;
+    for (int32_t i = 0; i < numThreads; i++)
+        threads.push_back(std::thread(&ZrtpWorkerPool::run, this));
+}
+
+ZrtpWorkerPool::~ZrtpWorkerPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+    }
+    wakeup.notify_all();
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
+
+void ZrtpWorkerPool::post(Strand* strand, ZrtpWorkerTask function, void* context, void* data) {
+    Strand::Item item;
+    item.function = function;
+    item.context = context;
+    item.data = data;
+
+    std::lock_guard<std::mutex> guard(lock);
+    strand->items.push_back(item);
+
+    // A scheduled strand gets the task after its running task
+    if (!strand->scheduled) {
+        strand->scheduled = true;
+        ready.push_back(strand);
+        wakeup.notify_one();
+    }
+}
+
+void ZrtpWorkerPool::drain(Strand* strand) {
+    std::unique_lock<std::mutex> guard(lock);
+    while (strand->scheduled)
+        idle.wait(guard);
+}
+
+bool ZrtpWorkerPool::runsStrand(const Strand* strand) {
+    return strand != nullptr && currentStrand == strand;
+}
+
+void ZrtpWorkerPool::run() {
+    std::unique_lock<std::mutex> guard(lock);
+
+    // Stop only if all tasks ran, the streams may wait in drain()
+    while (running || !ready.empty()) {
+        if (ready.empty()) {
+            wakeup.wait(guard);
+            continue;
+        }
+        Strand* strand = ready.front();
+        ready.pop_front();
+        Strand::Item item = strand->items.front();
+        strand->items.pop_front();
+
+        guard.unlock();
+        currentStrand = strand;
+        item.function(item.context, item.data);
+        currentStrand = nullptr;
+        guard.lock();
+
+        // One task per turn, a strand with many tasks does not block others
+        if (!strand->items.empty()) {
+            ready.push_back(strand);
+        }
+        else {
+            strand->scheduled = false;
+            idle.notify_all();
+        }
+    }
+}
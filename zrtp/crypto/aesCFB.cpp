@@ -25,34 +25,35 @@
 
 void aesCfbEncrypt(uint8_t *key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
 {
-    auto* saAes = new AESencrypt();
+    AESencrypt saAes;
 
     if (keyLength == 16)
-        saAes->key128(key);
+        saAes.key128(key);
     else if (keyLength == 32)
-        saAes->key256(key);
+        saAes.key256(key);
     else
         return;
 
     // Note: maybe copy IV to an internal array if we encounter strange things.
     // the cfb encrypt modifies the IV on return. Same for output data (inplace encryption)
-    saAes->cfb_encrypt(data, data, dataLength, IV);
-    delete saAes;
+    saAes.cfb_encrypt(data, data, dataLength, IV);
+    memset(saAes.cx, 0, sizeof(saAes.cx));
 }
 
 
 void aesCfbDecrypt(uint8_t *key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
 {
-    auto* saAes = new AESencrypt();
+    AESencrypt saAes;
+
     if (keyLength == 16)
-        saAes->key128(key);
+        saAes.key128(key);
     else if (keyLength == 32)
-        saAes->key256(key);
+        saAes.key256(key);
     else
         return;
 
     // Note: maybe copy IV to an internal array if we encounter strange things.
     // the cfb encrypt modifies the IV on return. Same for output data (inplace encryption)
-    saAes->cfb_decrypt(data, data, dataLength, IV);
-    delete saAes;
+    saAes.cfb_decrypt(data, data, dataLength, IV);
+    memset(saAes.cx, 0, sizeof(saAes.cx));
 }
@@ -117,8 +117,7 @@ void hmac_sha256(const uint8_t *key, uint64_t keyLength, const uint8_t* data, ui
 }
 
 void hmacSha256(const uint8_t* key, uint64_t keyLength,
-                const std::vector<const uint8_t*>& dataChunks,
-                const std::vector<uint64_t>& dataChunkLength,
+                const DataChunks& dataChunks,
                 uint8_t* mac, uint32_t* macLength )
 {
     if (key == nullptr || mac == nullptr || macLength == nullptr) {
@@ -132,15 +131,35 @@ void hmacSha256(const uint8_t* key, uint64_t keyLength,
     }
 
     for (size_t i = 0, size = dataChunks.size(); i < size; i++) {
-        if (dataChunks[i] == nullptr || dataChunkLength[i] == 0) {
+        if (dataChunks.data(i) == nullptr || dataChunks.length(i) == 0) {
             continue;
         }
-        hmacSha256Update(&ctx, dataChunks[i], dataChunkLength[i]);
+        hmacSha256Update(&ctx, dataChunks.data(i), dataChunks.length(i));
     }
     hmacSha256Final(&ctx, mac);
     *macLength = SHA256_DIGEST_SIZE;
 }
 
+void hmacSha256Multi(const uint8_t* key, uint64_t keyLength, size_t count,
+                     const uint8_t* const* data, const uint64_t* dataLength, uint8_t* const* mac)
+{
+    if (key == nullptr || data == nullptr || mac == nullptr) {
+        return;
+    }
+
+    hmacSha256Context ctx = {};
+
+    if (!hmacSha256Init(&ctx, key, keyLength)) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        hmacSha256Reset(&ctx);
+        hmacSha256Update(&ctx, data[i], dataLength[i]);
+        hmacSha256Final(&ctx, mac[i]);
+    }
+    memset(&ctx, 0, sizeof(ctx));
+}
+
 void* createSha256HmacContext(uint8_t* key, uint64_t keyLength)
 {
     if (key == nullptr) {
@@ -174,8 +193,7 @@ void hmacSha256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength,
 }
 
 void hmacSha256Ctx(void* ctx,
-                   const std::vector<const uint8_t*>& data,
-                   const std::vector<uint64_t>& dataLength,
+                   const DataChunks& data,
                    uint8_t* mac, uint32_t* macLength )
 {
     if (ctx == nullptr || mac == nullptr || macLength == nullptr) {
@@ -186,10 +204,10 @@ void hmacSha256Ctx(void* ctx,
 
     hmacSha256Reset(pctx);
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        if (data[i] == nullptr || dataLength[i] == 0) {
+        if (data.data(i) == nullptr || data.length(i) == 0) {
             continue;
         }
-        hmacSha256Update(pctx, data[i], dataLength[i]);
+        hmacSha256Update(pctx, data.data(i), data.length(i));
     }
     hmacSha256Final(pctx, mac);
     *macLength = SHA256_DIGEST_SIZE;
@@ -120,8 +120,7 @@ void hmac_sha384(const uint8_t *key, uint64_t keyLength, const uint8_t* data, ui
 }
 
 void hmacSha384(const uint8_t* key, uint64_t keyLength,
-                const std::vector<const uint8_t*>& data,
-                const std::vector<uint64_t>& dataLength,
+                const DataChunks& data,
                 uint8_t* mac, uint32_t* macLength )
 {
     if (key == nullptr || mac == nullptr || macLength == nullptr) {
@@ -135,15 +134,35 @@ void hmacSha384(const uint8_t* key, uint64_t keyLength,
     }
 
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        if (data[i] == nullptr || dataLength[i] == 0) {
+        if (data.data(i) == nullptr || data.length(i) == 0) {
             continue;
         }
-        hmacSha384Update(&ctx, data[i], dataLength[i]);
+        hmacSha384Update(&ctx, data.data(i), data.length(i));
     }
     hmacSha384Final(&ctx, mac);
     *macLength = SHA384_DIGEST_SIZE;
 }
 
+void hmacSha384Multi(const uint8_t* key, uint64_t keyLength, size_t count,
+                     const uint8_t* const* data, const uint64_t* dataLength, uint8_t* const* mac)
+{
+    if (key == nullptr || data == nullptr || mac == nullptr) {
+        return;
+    }
+
+    hmacSha384Context ctx = {};
+
+    if (!hmacSha384Init(&ctx, key, keyLength)) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        hmacSha384Reset(&ctx);
+        hmacSha384Update(&ctx, data[i], dataLength[i]);
+        hmacSha384Final(&ctx, mac[i]);
+    }
+    memset(&ctx, 0, sizeof(ctx));
+}
+
 void* createSha384HmacContext(const uint8_t* key, uint64_t keyLength)
 {
     if (key == nullptr) {
@@ -177,8 +196,7 @@ void hmacSha384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength,
 }
 
 void hmacSha384Ctx(void* ctx,
-                   const std::vector<const uint8_t*>& data,
-                   const std::vector<uint64_t>& dataLength,
+                   const DataChunks& data,
                    uint8_t* mac, uint32_t* macLength )
 {
     if (ctx == nullptr || mac == nullptr || macLength == nullptr) {
@@ -189,10 +207,10 @@ void hmacSha384Ctx(void* ctx,
 
     hmacSha384Reset(pctx);
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        if (data[i] == nullptr || dataLength[i] == 0) {
+        if (data.data(i) == nullptr || data.length(i) == 0) {
             continue;
         }
-        hmacSha384Update(pctx, data[i], dataLength[i]);
+        hmacSha384Update(pctx, data.data(i), data.length(i));
     }
     hmacSha384Final(pctx, mac);
     *macLength = SHA384_DIGEST_SIZE;
@@ -204,4 +222,4 @@ void freeSha384HmacContext(void* ctx)
         memset(ctx, 0, sizeof(hmacSha384Context));
         free(ctx);
     }
-}
\ No newline at end of file
+}
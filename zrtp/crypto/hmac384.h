@@ -30,7 +30,7 @@
  */
 
 #include <cstdint>
-#include <vector>
+#include <cryptcommon/DataChunks.h>
 
 #ifndef SHA384_DIGEST_LENGTH
 #define SHA384_DIGEST_LENGTH 48
@@ -70,9 +70,7 @@ void hmac_sha384(const uint8_t* key, uint64_t key_length,
  * @param key_length
  *    Lneght of the MAC key in bytes
  * @param data
- *    Vector of pointers that point to the data chunks.
- * @param dataLength
- *   Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  * @param mac
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 48 bytes (SHA384_DIGEST_LENGTH).
@@ -81,9 +79,32 @@ void hmac_sha384(const uint8_t* key, uint64_t key_length,
  */
 
 void hmacSha384(const uint8_t* key, uint64_t key_length,
-                const std::vector<const uint8_t*>& data,
-                const std::vector<uint64_t>& dataLength,
+                const DataChunks& data,
                 uint8_t* mac, uint32_t* mac_length);
+
+/**
+ * Compute SHA384 HMACs of several messages with the same key.
+ *
+ * Prepares the key once and computes the HMAC of each message, the results
+ * are the same as calling the single message function for each message.
+ * The ZRTP key derivation uses it to derive all keys from s0.
+ *
+ * @param key
+ *    The MAC key.
+ * @param key_length
+ *    Length of the MAC key in bytes
+ * @param count
+ *    Number of messages.
+ * @param data
+ *    Array of @c count pointers to the messages.
+ * @param dataLength
+ *    Array of @c count message lengths in bytes.
+ * @param mac
+ *    Array of @c count pointers to buffers that receive the computed digests.
+ *    Each buffer must have a size of at least 48 bytes (SHA384_DIGEST_LENGTH).
+ */
+void hmacSha384Multi(const uint8_t* key, uint64_t key_length, size_t count,
+                     const uint8_t* const* data, const uint64_t* dataLength, uint8_t* const* mac);
 /**
  * @}
  */
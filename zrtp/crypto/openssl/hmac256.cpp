@@ -18,7 +18,7 @@
 #include <openssl/evp.h>
 #include <crypto/hmac256.h>
 #include "openssl_compat.h"
-#include <vector>
+#include <cryptcommon/DataChunks.h>
 
 void hmac_sha256(const uint8_t* key, uint64_t key_length,
                  const uint8_t* data, uint64_t data_length,
@@ -34,8 +34,7 @@ void hmac_sha256(const uint8_t* key, uint64_t key_length,
 }
 
 void hmacSha256(const uint8_t* key, uint64_t key_length,
-                const std::vector<const uint8_t*>& data,
-                const std::vector<uint64_t>& dataLength,
+                const DataChunks& data,
                 uint8_t* mac, uint32_t* mac_length)
 {
     if (key == nullptr || mac == nullptr || mac_length == nullptr) {
@@ -56,10 +55,10 @@ void hmacSha256(const uint8_t* key, uint64_t key_length,
     }
     
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        if (data[i] == nullptr || dataLength[i] == 0) {
+        if (data.data(i) == nullptr || data.length(i) == 0) {
             continue;
         }
-        if (!hmac_update(ctx, data[i], dataLength[i])) {
+        if (!hmac_update(ctx, data.data(i), data.length(i))) {
             hmac_ctx_free(ctx);
             *mac_length = 0;
             return;
@@ -121,8 +120,7 @@ void hmacSha256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength,
 }
 
 void hmacSha256Ctx(void* ctx,
-                   const std::vector<const uint8_t*>& data,
-                   const std::vector<uint64_t>& dataLength,
+                   const DataChunks& data,
                    uint8_t* mac, uint32_t* macLength)
 {
     if (ctx == nullptr || mac == nullptr || macLength == nullptr) {
@@ -137,10 +135,10 @@ void hmacSha256Ctx(void* ctx,
     }
     
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        if (data[i] == nullptr || dataLength[i] == 0) {
+        if (data.data(i) == nullptr || data.length(i) == 0) {
             continue;
         }
-        if (!hmac_update(pctx, data[i], dataLength[i])) {
+        if (!hmac_update(pctx, data.data(i), data.length(i))) {
             *macLength = 0;
             return;
         }
@@ -158,3 +156,31 @@ void freeSha256HmacContext(void* ctx)
         hmac_ctx_free((hmac_ctx_t)ctx);
     }
 }
+
+void hmacSha256Multi(const uint8_t* key, uint64_t keyLength, size_t count,
+                     const uint8_t* const* data, const uint64_t* dataLength, uint8_t* const* mac)
+{
+    if (key == nullptr || data == nullptr || mac == nullptr) {
+        return;
+    }
+
+    hmac_ctx_t ctx = hmac_ctx_new();
+    if (!ctx) {
+        return;
+    }
+
+    // A NULL key re-uses the prepared key for each message
+    if (!hmac_init_ex(ctx, key, static_cast<int>(keyLength), EVP_sha256())) {
+        hmac_ctx_free(ctx);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        unsigned int tmp = 0;
+
+        if ((i > 0 && !hmac_init_ex(ctx, nullptr, 0, nullptr)) ||
+            !hmac_update(ctx, data[i], dataLength[i]) || !hmac_final(ctx, mac[i], &tmp)) {
+            break;
+        }
+    }
+    hmac_ctx_free(ctx);
+}
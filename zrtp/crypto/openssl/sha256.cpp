@@ -24,7 +24,7 @@ void sha256(const uint8_t *data, uint64_t data_length, uint8_t *digest)
 	SHA256(data, data_length, digest);
 }
 
-void sha256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t >& dataLength, uint8_t *digest)
+void sha256(const DataChunks& data, uint8_t *digest)
 {
 	SHA256_CTX ctx = {};
 	#if defined(OPENSSL_3_API) && defined(__GNUC__)
@@ -33,7 +33,7 @@ void sha256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t
 	#endif
 	SHA256_Init( &ctx);
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        SHA256_Update(&ctx, data[i], dataLength[i]);
+        SHA256_Update(&ctx, data.data(i), data.length(i));
     }
 	SHA256_Final(digest, &ctx);
 	#if defined(OPENSSL_3_API) && defined(__GNUC__)
@@ -116,7 +116,7 @@ void sha256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength)
     #endif
 }
 
-void sha256Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength)
+void sha256Ctx(void* ctx, const DataChunks& data)
 {
     auto* hd = (SHA256_CTX*)ctx;
 
@@ -125,7 +125,7 @@ void sha256Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::ve
     #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
     #endif
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        SHA256_Update(hd, data[i], dataLength[i]);
+        SHA256_Update(hd, data.data(i), data.length(i));
     }
     #if defined(OPENSSL_3_API) && defined(__GNUC__)
     #pragma GCC diagnostic pop
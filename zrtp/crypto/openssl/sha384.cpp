@@ -24,12 +24,12 @@ void sha384(const uint8_t *data, uint64_t dataLength, uint8_t *digest)
 	SHA384(data, dataLength, digest);
 }
 
-void sha384(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength, uint8_t* digest)
+void sha384(const DataChunks& data, uint8_t* digest)
 {
 	SHA512_CTX ctx = {};
 	SHA384_Init( &ctx);
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        SHA384_Update(&ctx, data[i], dataLength[i]);
+        SHA384_Update(&ctx, data.data(i), data.length(i));
     }
 	SHA384_Final(digest, &ctx);
 }
@@ -75,11 +75,11 @@ void sha384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength)
     SHA384_Update(hd, data, dataLength);
 }
 
-void sha384Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength)
+void sha384Ctx(void* ctx, const DataChunks& data)
 {
     auto* hd = (SHA512_CTX*)ctx;
 
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        SHA384_Update(hd, data[i], dataLength[i]);
+        SHA384_Update(hd, data.data(i), data.length(i));
     }
 }
@@ -813,6 +813,16 @@ const char* ZrtpDH::getDHtype()
     }
 }
 
+void ZrtpDH::setUseArena(bool enable)
+{
+    // OpenSSL manages its own memory
+}
+
+uint64_t ZrtpDH::getHeapAllocations()
+{
+    return 0;
+}
+
 /** EMACS **
  * Local variables:
  * mode: c++
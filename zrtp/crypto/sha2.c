@@ -80,9 +80,15 @@
 #include <string.h>     /* for memcpy() etc.        */
 
 #include "sha2.h"
+#include "sha2x86.h"
 
 #include <cryptcommon/brg_endian.h>
 
+#if defined(SHA2_X86)
+#include <stdint.h>
+#include <common/osSpecifics.h>
+#endif
+
 #if defined(__cplusplus)
 extern "C"
 {
@@ -135,6 +141,68 @@ extern "C"
     vf(3,i) += vf(7,i);                             \
     vf(7,i) += s_0(vf(0,i))+ maj(vf(0,i),vf(1,i),vf(2,i))
 
+/* Block functions for CPU extensions, selected at load time. If a     */
+/* pointer is NULL the portable compile function below is used.       */
+
+#if defined(SHA2_X86)
+
+typedef void (*sha256_blocks_fn)(uint_32t hash[8], const void *data, unsigned long blocks, int words);
+typedef void (*sha512_blocks_fn)(uint_64t hash[8], const void *data, unsigned long blocks, int words);
+
+static sha256_blocks_fn sha256_blocks = 0;
+static sha512_blocks_fn sha512_blocks = 0;
+
+__attribute__((constructor))
+static void sha2_select(void)
+{
+    sha2_use_accel(1);
+}
+
+#endif
+
+INT_RETURN sha2_use_accel(int enable)
+{
+#if defined(SHA2_X86)
+    uint32_t features = zrtpCpuFeatures();
+    int previous = sha256_blocks != 0 || sha512_blocks != 0;
+
+    sha256_blocks = 0;
+    sha512_blocks = 0;
+    if(enable)
+    {
+        uint32_t sha = ZRTP_CPU_SHA | ZRTP_CPU_SSE41 | ZRTP_CPU_SSSE3;
+        uint32_t avx = ZRTP_CPU_AVX2 | ZRTP_CPU_BMI2;
+
+        if((features & sha) == sha)
+            sha256_blocks = sha256_blocks_shani;
+        if((features & avx) == avx)
+            sha512_blocks = sha512_blocks_avx2;
+    }
+    return previous;
+#else
+    (void)enable;
+    return 0;
+#endif
+}
+
+const char *sha256_impl(void)
+{
+#if defined(SHA2_X86)
+    if(sha256_blocks)
+        return "sha-ni";
+#endif
+    return "c";
+}
+
+const char *sha512_impl(void)
+{
+#if defined(SHA2_X86)
+    if(sha512_blocks)
+        return "avx2";
+#endif
+    return "c";
+}
+
 #if defined(SHA_224) || defined(SHA_256)
 
 #define SHA256_MASK (SHA256_BLOCK_SIZE - 1)
@@ -189,7 +257,7 @@ const uint_32t k256[64] =
 /* in the ORIGINAL byte stream will go into the high end of */
 /* words on BOTH big and little endian systems              */
 
-VOID_RETURN sha256_compile(sha256_ctx ctx[1])
+static void sha256_compile_c(sha256_ctx ctx[1])
 {
 #if !defined(UNROLL_SHA2)
 
@@ -298,6 +366,18 @@ VOID_RETURN sha256_compile(sha256_ctx ctx[1])
 #endif
 }
 
+VOID_RETURN sha256_compile(sha256_ctx ctx[1])
+{
+#if defined(SHA2_X86)
+    if(sha256_blocks)
+    {
+        sha256_blocks(ctx->hash, ctx->wbuf, 1, 1);
+        return;
+    }
+#endif
+    sha256_compile_c(ctx);
+}
+
 /* SHA256 hash data in an array of bytes into hash buffer   */
 /* and call the hash_compile function as required.          */
 
@@ -311,6 +391,16 @@ VOID_RETURN sha256_hash(const unsigned char data[], unsigned long len, sha256_ct
 
     while(len >= space)     /* tranfer whole blocks while possible  */
     {
+#if defined(SHA2_X86)
+        if(sha256_blocks && pos == 0)   /* hash them in place   */
+        {
+            unsigned long blocks = len / SHA256_BLOCK_SIZE;
+
+            sha256_blocks(ctx->hash, sp, blocks, 0);
+            sp += blocks * SHA256_BLOCK_SIZE; len -= blocks * SHA256_BLOCK_SIZE;
+            break;
+        }
+#endif
         memcpy(((unsigned char*)ctx->wbuf) + pos, sp, space);
         sp += space; len -= space; space = SHA256_BLOCK_SIZE; pos = 0;
         bsw_32(ctx->wbuf, SHA256_BLOCK_SIZE >> 2)
@@ -511,7 +601,7 @@ const uint_64t  k512[80] =
 /* in the ORIGINAL byte stream will go into the high end of */
 /* words on BOTH big and little endian systems              */
 
-VOID_RETURN sha512_compile(sha512_ctx ctx[1])
+static void sha512_compile_c(sha512_ctx ctx[1])
 {   uint_64t    v[8], *p = ctx->wbuf;
     uint_32t    j;
 
@@ -535,6 +625,18 @@ VOID_RETURN sha512_compile(sha512_ctx ctx[1])
     ctx->hash[6] += v[6]; ctx->hash[7] += v[7];
 }
 
+VOID_RETURN sha512_compile(sha512_ctx ctx[1])
+{
+#if defined(SHA2_X86)
+    if(sha512_blocks)
+    {
+        sha512_blocks(ctx->hash, ctx->wbuf, 1, 1);
+        return;
+    }
+#endif
+    sha512_compile_c(ctx);
+}
+
 /* Compile 128 bytes of hash data into SHA256 digest value  */
 /* NOTE: this routine assumes that the byte order in the    */
 /* ctx->wbuf[] at this point is in such an order that low   */
@@ -552,6 +654,16 @@ VOID_RETURN sha512_hash(const unsigned char data[], unsigned long len, sha512_ct
 
     while(len >= space)     /* tranfer whole blocks while possible  */
     {
+#if defined(SHA2_X86)
+        if(sha512_blocks && pos == 0)   /* hash them in place   */
+        {
+            unsigned long blocks = len / SHA512_BLOCK_SIZE;
+
+            sha512_blocks(ctx->hash, sp, blocks, 0);
+            sp += blocks * SHA512_BLOCK_SIZE; len -= blocks * SHA512_BLOCK_SIZE;
+            break;
+        }
+#endif
         memcpy(((unsigned char*)ctx->wbuf) + pos, sp, space);
         sp += space; len -= space; space = SHA512_BLOCK_SIZE; pos = 0;
         bsw_64(ctx->wbuf, SHA512_BLOCK_SIZE >> 3);
@@ -78,6 +78,15 @@ typedef sha256_ctx  sha224_ctx;
 
 VOID_RETURN sha256_compile(sha256_ctx ctx[1]);
 
+/* Use the SHA256 and SHA512 block functions for CPU extensions (SHA-NI, */
+/* AVX2) if the CPU supports them, or the portable code if enable is 0.  */
+/* They are enabled by default. Returns the previous setting.            */
+INT_RETURN  sha2_use_accel(int enable);
+
+/* Names of the active block functions, for example "sha-ni" or "c"      */
+const char *sha256_impl(void);
+const char *sha512_impl(void);
+
 VOID_RETURN sha224_begin(sha224_ctx ctx[1]);
 #define sha224_hash sha256_hash
 VOID_RETURN sha224_end(unsigned char hval[], sha224_ctx ctx[1]);
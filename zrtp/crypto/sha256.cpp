@@ -30,13 +30,13 @@ void sha256(const uint8_t *data, uint64_t dataLength, uint8_t *digest )
     sha256_end(digest, &ctx);
 }
 
-void sha256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength, uint8_t *digest)
+void sha256(const DataChunks& data, uint8_t *digest)
 {
     sha256_ctx ctx  = {};
 
     sha256_begin(&ctx);
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        sha256_hash(data[i], dataLength[i], &ctx);
+        sha256_hash(data.data(i), data.length(i), &ctx);
     }
     sha256_end(digest, &ctx);
 }
@@ -84,11 +84,11 @@ void sha256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength)
     sha256_hash(data, dataLength, hd);
 }
 
-void sha256Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength)
+void sha256Ctx(void* ctx, const DataChunks& data)
 {
     auto* hd = reinterpret_cast<sha256_ctx*>(ctx);
 
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        sha256_hash(data[i], dataLength[i], hd);
+        sha256_hash(data.data(i), data.length(i), hd);
     }
 }
@@ -33,7 +33,7 @@
  */
 
 #include <cstdint>
-#include <vector>
+#include <cryptcommon/DataChunks.h>
 
 #ifndef SHA256_DIGEST_LENGTH
 #define SHA256_DIGEST_LENGTH 32
@@ -66,14 +66,12 @@ void sha256(const uint8_t *data,
  * SHA256 operations.
  *
  * @param data
- *    Vector of pointers that point to the data chunks.
- * @param dataLength
- *    Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  * @param digest
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 32 bytes (SHA256_DIGEST_LENGTH).
  */
-void sha256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t >& dataLength, uint8_t *digest);
+void sha256(const DataChunks& data, uint8_t *digest);
 
 /**
  * Create and initialize a SHA256 context.
@@ -151,13 +149,10 @@ void sha256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength);
  * @param ctx
  *    Points to the SHA256 context.
  * @param data
- *    Vector of pointers that point to the data chunks. A NULL
- *    pointer in an array element terminates the data chunks.
- * @param dataLength
- *    Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  *
  */
-void sha256Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength);
+void sha256Ctx(void* ctx, const DataChunks& data);
 
 /**
  * @}
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * SHA256 and SHA512 block functions for x86 CPU extensions.
+ *
+ * The functions use target attributes, thus the file compiles without
+ * special compiler flags. sha2.c calls them only if zrtpCpuFeatures()
+ * reports the extensions.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include "sha2x86.h"
+
+#if defined(SHA2_X86)
+
+#include <immintrin.h>
+
+extern const uint_32t k256[64];
+extern const uint_64t k512[80];
+
+/*
+ * SHA256 with the SHA extensions. The state is kept as ABEF and CDGH in
+ * two registers as the sha256rnds2 instruction expects it. Each loop runs
+ * four rounds and computes the next four message words.
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+void sha256_blocks_shani(uint_32t hash[8], const void *data, unsigned long blocks, int words)
+{
+    const __m128i *in = (const __m128i *)data;
+    const __m128i mask = words ? _mm_set_epi64x(0x0f0e0d0c0b0a0908ULL, 0x0706050403020100ULL)
+                               : _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, tmp, msg, abefSave, cdghSave;
+    __m128i w[4];
+    int i;
+
+    tmp = _mm_loadu_si128((const __m128i *)&hash[0]);           /* DCBA */
+    state1 = _mm_loadu_si128((const __m128i *)&hash[4]);        /* HGFE */
+    tmp = _mm_shuffle_epi32(tmp, 0xb1);                         /* CDAB */
+    state1 = _mm_shuffle_epi32(state1, 0x1b);                   /* EFGH */
+    state0 = _mm_alignr_epi8(tmp, state1, 8);                   /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);                /* CDGH */
+
+    while (blocks--) {
+        abefSave = state0;
+        cdghSave = state1;
+
+        for (i = 0; i < 16; i++) {
+            if (i < 4) {
+                w[i] = _mm_shuffle_epi8(_mm_loadu_si128(in + i), mask);
+            }
+            else {
+                /* W[t] = W[t-16] + s0(W[t-15]) + W[t-7] + s1(W[t-2]) for four words */
+                tmp = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                w[i & 3] = _mm_sha256msg2_epu32(tmp, w[(i + 3) & 3]);
+            }
+            msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *)&k256[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0e);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+        in += 4;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);                      /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xb1);                   /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xf0);                /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);                   /* HGFE */
+
+    _mm_storeu_si128((__m128i *)&hash[0], state0);
+    _mm_storeu_si128((__m128i *)&hash[4], state1);
+}
+
+/*
+ * SHA512 with the message schedule in AVX2 registers, four words at a
+ * time, and the rounds in general purpose registers where BMI2 provides
+ * rotates that do not overwrite their source (rorx).
+ */
+#define ROTR64(x, n)    (((x) >> (n)) | ((x) << (64 - (n))))
+#define VROTR64(x, n)   _mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64 - (n)))
+
+#define V_S0(x)  _mm256_xor_si256(_mm256_xor_si256(VROTR64((x), 1), VROTR64((x), 8)), _mm256_srli_epi64((x), 7))
+#define V_S1(x)  _mm256_xor_si256(_mm256_xor_si256(VROTR64((x), 19), VROTR64((x), 61)), _mm256_srli_epi64((x), 6))
+
+#define S_0(x)  (ROTR64((x), 28) ^ ROTR64((x), 34) ^ ROTR64((x), 39))
+#define S_1(x)  (ROTR64((x), 14) ^ ROTR64((x), 18) ^ ROTR64((x), 41))
+#define CH(x, y, z)     ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z)    (((x) & (y)) | ((z) & ((x) ^ (y))))
+
+#define ROUND(a, b, c, d, e, f, g, h, t)                        \
+    h += S_1(e) + CH(e, f, g) + wk[t];                          \
+    d += h;                                                     \
+    h += S_0(a) + MAJ(a, b, c)
+
+/* Words 1..4 of the eight words in lo and hi */
+__attribute__((target("avx2")))
+static inline __m256i shiftWord(__m256i lo, __m256i hi)
+{
+    return _mm256_alignr_epi8(_mm256_permute2x128_si256(lo, hi, 0x21), lo, 8);
+}
+
+__attribute__((target("avx2,bmi2")))
+void sha512_blocks_avx2(uint_64t hash[8], const void *data, unsigned long blocks, int words)
+{
+    const __m256i *in = (const __m256i *)data;
+    const __m256i mask = words ? _mm256_set_epi64x(0x0f0e0d0c0b0a0908ULL, 0x0706050403020100ULL,
+                                                   0x0f0e0d0c0b0a0908ULL, 0x0706050403020100ULL)
+                               : _mm256_set_epi64x(0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL,
+                                                   0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL);
+    uint_64t wk[80] __attribute__((aligned(32)));
+    uint_64t a, b, c, d, e, f, g, h;
+    __m256i w[4], t;
+    int i;
+
+    while (blocks--) {
+        for (i = 0; i < 4; i++) {
+            w[i] = _mm256_shuffle_epi8(_mm256_loadu_si256(in + i), mask);
+            _mm256_store_si256((__m256i *)&wk[4 * i],
+                               _mm256_add_epi64(w[i], _mm256_loadu_si256((const __m256i *)&k512[4 * i])));
+        }
+        for (i = 4; i < 20; i++) {
+            /* W[t-16] + s0(W[t-15]) + W[t-7] for the words t .. t+3 */
+            t = _mm256_add_epi64(w[i & 3], V_S0(shiftWord(w[i & 3], w[(i + 1) & 3])));
+            t = _mm256_add_epi64(t, shiftWord(w[(i + 2) & 3], w[(i + 3) & 3]));
+
+            /* s1(W[t-2]) for words t and t+1, then s1 of the new words for t+2 and t+3 */
+            t = _mm256_add_epi64(t, V_S1(_mm256_permute2x128_si256(w[(i + 3) & 3], w[(i + 3) & 3], 0x81)));
+            t = _mm256_add_epi64(t, V_S1(_mm256_permute2x128_si256(t, t, 0x08)));
+
+            w[i & 3] = t;
+            _mm256_store_si256((__m256i *)&wk[4 * i],
+                               _mm256_add_epi64(t, _mm256_loadu_si256((const __m256i *)&k512[4 * i])));
+        }
+
+        a = hash[0]; b = hash[1]; c = hash[2]; d = hash[3];
+        e = hash[4]; f = hash[5]; g = hash[6]; h = hash[7];
+
+        for (i = 0; i < 80; i += 8) {
+            ROUND(a, b, c, d, e, f, g, h, i + 0);
+            ROUND(h, a, b, c, d, e, f, g, i + 1);
+            ROUND(g, h, a, b, c, d, e, f, i + 2);
+            ROUND(f, g, h, a, b, c, d, e, i + 3);
+            ROUND(e, f, g, h, a, b, c, d, i + 4);
+            ROUND(d, e, f, g, h, a, b, c, i + 5);
+            ROUND(c, d, e, f, g, h, a, b, i + 6);
+            ROUND(b, c, d, e, f, g, h, a, i + 7);
+        }
+
+        hash[0] += a; hash[1] += b; hash[2] += c; hash[3] += d;
+        hash[4] += e; hash[5] += f; hash[6] += g; hash[7] += h;
+        in += 4;
+    }
+}
+
+#endif
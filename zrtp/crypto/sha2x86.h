@@ -0,0 +1,58 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SHA2X86_H_
+#define _SHA2X86_H_
+
+/**
+ * @file sha2x86.h
+ * @brief SHA256 and SHA512 block functions for x86 CPU extensions
+ *
+ * The functions are internal to sha2.c which selects them at runtime if
+ * the CPU supports the extensions. They hash @c blocks consecutive blocks
+ * into @c hash. If @c words is 0 the data is the big endian byte stream,
+ * otherwise the data is the @c wbuf of a context that already contains the
+ * words in host byte order.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include "sha2.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA2_X86
+#endif
+
+#if defined(SHA2_X86)
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/** SHA256 with the SHA extensions, needs SHA, SSE 4.1 and SSSE3 */
+void sha256_blocks_shani(uint_32t hash[8], const void *data, unsigned long blocks, int words);
+
+/** SHA384/512 with AVX2 message schedule and BMI2 rotates, needs AVX2 and BMI2 */
+void sha512_blocks_avx2(uint_64t hash[8], const void *data, unsigned long blocks, int words);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
+
+#endif
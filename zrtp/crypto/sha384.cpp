@@ -30,13 +30,13 @@ void sha384(const uint_8t *data, uint64_t dataLength, uint8_t *digest )
     sha384_end(digest, &ctx);
 }
 
-void sha384(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength, uint8_t *digest)
+void sha384(const DataChunks& data, uint8_t *digest)
 {
     sha384_ctx ctx = {};
 
     sha384_begin(&ctx);
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        sha384_hash(data[i], dataLength[i], &ctx);
+        sha384_hash(data.data(i), data.length(i), &ctx);
     }
     sha384_end(digest, &ctx);
 }
@@ -86,11 +86,11 @@ void sha384Ctx(void* ctx, const uint_8t* data, uint64_t dataLength)
     sha384_hash(data, dataLength, hd);
 }
 
-void sha384Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength)
+void sha384Ctx(void* ctx, const DataChunks& data)
 {
     auto* hd = reinterpret_cast<sha384_ctx*>(ctx);
 
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        sha384_hash(data[i], dataLength[i], hd);
+        sha384_hash(data.data(i), data.length(i), hd);
     }
 }
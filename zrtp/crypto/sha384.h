@@ -32,7 +32,7 @@
  */
 
 #include <cstdint>
-#include <vector>
+#include <cryptcommon/DataChunks.h>
 
 #ifndef SHA384_DIGEST_LENGTH
 #define SHA384_DIGEST_LENGTH 48
@@ -65,15 +65,12 @@ void sha384(const uint8_t *data,
  * SHA384 operations.
  *
  * @param data
- *    Vector of pointers that point to the data chunks. A NULL
- *    pointer in an array element terminates the data chunks.
- * @param dataLength
- *    Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  * @param digest
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 48 bytes (SHA384_DIGEST_LENGTH).
  */
-void sha384(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength, uint8_t* digest);
+void sha384(const DataChunks& data, uint8_t* digest);
 
 /**
  * Create and initialize a SHA384 context.
@@ -151,13 +148,10 @@ void sha384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength);
  * @param ctx
  *    Points to the SHA384 context.
  * @param data
- *    Vector of pointers that point to the data chunks. A NULL
- *    pointer in an array element terminates the data chunks.
- * @param dataLength
- *    Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  *
  */
-void sha384Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength);
+void sha384Ctx(void* ctx, const DataChunks& data);
 
 /**
  * @}
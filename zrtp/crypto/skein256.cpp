@@ -34,14 +34,14 @@ void skein256(const uint8_t *data, uint64_t dataLength, uint8_t *digest )
     skeinFinal(&ctx, digest);
 }
 
-void skein256(const std::vector<const uint8_t*>& dataChunks, const std::vector<uint64_t>& dataChunkLength, uint8_t *digest)
+void skein256(const DataChunks& dataChunks, uint8_t *digest)
 {
     SkeinCtx_t ctx = {};
 
     skeinCtxPrepare(&ctx, SKEIN_SIZE);
     skeinInit(&ctx, SKEIN256_DIGEST_LENGTH*8);
     for (size_t i = 0, size = dataChunks.size(); i < size; i++) {
-        skeinUpdate(&ctx, dataChunks[i], dataChunkLength[i]);
+        skeinUpdate(&ctx, dataChunks.data(i), dataChunks.length(i));
     }
     skeinFinal(&ctx, digest);
 }
@@ -90,11 +90,11 @@ void skein256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength)
     skeinUpdate(hd, data, dataLength);
 }
 
-void skein256Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength)
+void skein256Ctx(void* ctx, const DataChunks& data)
 {
     auto* hd = reinterpret_cast<SkeinCtx_t*>(ctx);
 
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        skeinUpdate(hd, data[i], dataLength[i]);
+        skeinUpdate(hd, data.data(i), data.length(i));
     }
 }
@@ -32,7 +32,7 @@
  */
 
 #include <cstdint>
-#include <vector>
+#include <cryptcommon/DataChunks.h>
 
 #ifndef SKEIN256_DIGEST_LENGTH
 #define SKEIN256_DIGEST_LENGTH  32
@@ -65,14 +65,12 @@ void skein256(const uint8_t *data, uint64_t dataLength, uint8_t *digest);
  * Skein256 operations.
  *
  * @param data
- *    Vector of pointers that point to the data chunks.
- * @param dataLength
- *    Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  * @param digest
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 32 bytes (Skein256_DIGEST_LENGTH).
  */
-void skein256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength,
+void skein256(const DataChunks& data,
               uint8_t *digest);
 /**
  * Create and initialize a Skein256 context.
@@ -150,13 +148,10 @@ void skein256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength);
  * @param ctx
  *    Points to the Skein256 context.
  * @param data
- *    Vector of pointers that point to the data chunks. A NULL
- *    pointer in an array element terminates the data chunks.
- * @param dataLength
- *    Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  *
  */
-void skein256Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength);
+void skein256Ctx(void* ctx, const DataChunks& data);
 
 /**
  * @}
@@ -38,14 +38,14 @@ void skein384(const uint8_t *data, uint64_t dataLength, uint8_t *digest )
     skeinFinal(&ctx, digest);
 }
 
-void skein384(const std::vector<const uint_8t *>& dataChunks, const std::vector<uint64_t>& dataChunkLength, uint8_t *digest)
+void skein384(const DataChunks& dataChunks, uint8_t *digest)
 {
     SkeinCtx_t ctx = {};
 
     skeinCtxPrepare(&ctx, SKEIN_SIZE);
     skeinInit(&ctx, SKEIN384_DIGEST_LENGTH*8);
     for (size_t i = 0, size = dataChunks.size(); i < size; i++) {
-        skeinUpdate(&ctx, dataChunks[i], dataChunkLength[i]);
+        skeinUpdate(&ctx, dataChunks.data(i), dataChunks.length(i));
     }
     skeinFinal(&ctx, digest);
 }
@@ -97,12 +97,11 @@ void skein384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength)
 }
 
 void skein384Ctx(void* ctx,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength)
+                 const DataChunks& data)
 {
     auto* hd = reinterpret_cast<SkeinCtx_t*>(ctx);
 
     for (size_t i = 0, size = data.size(); i < size; i++) {
-        skeinUpdate(hd, data[i], dataLength[i]);
+        skeinUpdate(hd, data.data(i), data.length(i));
     }
 }
@@ -33,7 +33,7 @@
  */
 
 #include <cstdint>
-#include <vector>
+#include <cryptcommon/DataChunks.h>
 
 #ifndef SKEIN384_DIGEST_LENGTH
 #define SKEIN384_DIGEST_LENGTH  48
@@ -68,15 +68,12 @@ void skein384(const uint8_t *data,
  * Skein384 operations.
  *
  * @param data
- *    Vector of pointers that point to the data chunks.
- * @param dataLength
- *    Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  * @param digest
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 48 bytes (Skein384_DIGEST_LENGTH).
  */
-void skein384(const std::vector<const uint8_t*>& data,
-              const std::vector<uint64_t>& dataLength,
+void skein384(const DataChunks& data,
               uint8_t *digest);
 /**
  * Create and initialize a Skein384 context.
@@ -154,15 +151,11 @@ void skein384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength);
  * @param ctx
  *    Points to the Skein384 context.
  * @param data
- *    Vector of pointers that point to the data chunks. A NULL
- *    pointer in an array element terminates the data chunks.
- * @param dataLength
- *    Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  *
  */
 void skein384Ctx(void* ctx,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength);
+                 const DataChunks& data);
 
 /**
  * @}
@@ -18,6 +18,7 @@
  * Authors: Werner Dittmann
  */
 
+#include <cstring>
 #include <cryptcommon/macSkein.h>
 #include <zrtp/crypto/skeinMac256.h>
 
@@ -31,13 +32,22 @@ void macSkein256(const uint8_t *key, uint64_t keyLength, const uint8_t* data, ui
 }
 
 
-void macSkein256(const uint8_t* key, uint64_t keyLength, const std::vector<const uint8_t*>& data,
-                  const std::vector<uint64_t>& dataLength, uint8_t* mac, uint32_t* macLength )
+void macSkein256(const uint8_t* key, uint64_t keyLength, const DataChunks& data, uint8_t* mac, uint32_t* macLength )
 {
-    macSkein(key, keyLength, data, dataLength, mac, SKEIN256_DIGEST_LENGTH*8, SKEIN_SIZE);
+    macSkein(key, keyLength, data, mac, SKEIN256_DIGEST_LENGTH*8, SKEIN_SIZE);
     *macLength = SKEIN256_DIGEST_LENGTH;
 }
 
+void macSkein256Multi(const uint8_t* key, uint64_t keyLength, size_t count,
+                      const uint8_t* const* data, const uint64_t* dataLength, uint8_t* const* mac)
+{
+    SkeinCtx_t ctx = {};
+
+    initializeSkeinMacContext(&ctx, key, keyLength, SKEIN256_DIGEST_LENGTH*8, SKEIN_SIZE);
+    macSkeinCtxMulti(&ctx, count, data, dataLength, mac);
+    memset(&ctx, 0, sizeof(ctx));
+}
+
 void* createMacSkein256Context(uint8_t* key, uint64_t keyLength)
 {
     return createSkeinMacContext(key, keyLength, SKEIN256_DIGEST_LENGTH*8, SKEIN_SIZE);
@@ -50,10 +60,9 @@ void macSkein256Ctx(void* ctx, const uint8_t* data, uint32_t dataLength, uint8_t
     *macLength = SKEIN256_DIGEST_LENGTH;
 }
 
-void macSkein256Ctx(void* ctx, const std::vector<const uint8_t*>& data,
-                    const std::vector<uint64_t>& dataLength, uint8_t* mac, int32_t* macLength )
+void macSkein256Ctx(void* ctx, const DataChunks& data, uint8_t* mac, int32_t* macLength )
 {
-    macSkeinCtx(ctx, data, dataLength, mac);
+    macSkeinCtx(ctx, data, mac);
     *macLength = SKEIN256_DIGEST_LENGTH;
 }
 
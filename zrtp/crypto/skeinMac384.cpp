@@ -21,6 +21,7 @@
 #define SKEIN_SIZE Skein512
 #define SKEIN384_DIGEST_LENGTH  48
 
+#include <cstring>
 #include <cryptcommon/macSkein.h>
 #include <zrtp/crypto/skeinMac384.h>
 
@@ -31,13 +32,22 @@ void macSkein384(const uint8_t *key, uint64_t keyLength, const uint8_t* data, ui
 }
 
 
-void macSkein384(const uint8_t* key, uint64_t keyLength, const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength, uint8_t* mac, uint32_t* macLength )
+void macSkein384(const uint8_t* key, uint64_t keyLength, const DataChunks& data, uint8_t* mac, uint32_t* macLength )
 {
-    macSkein(key, keyLength, data, dataLength, mac, SKEIN384_DIGEST_LENGTH*8, SKEIN_SIZE);
+    macSkein(key, keyLength, data, mac, SKEIN384_DIGEST_LENGTH*8, SKEIN_SIZE);
     *macLength = SKEIN384_DIGEST_LENGTH;
 }
 
+void macSkein384Multi(const uint8_t* key, uint64_t keyLength, size_t count,
+                      const uint8_t* const* data, const uint64_t* dataLength, uint8_t* const* mac)
+{
+    SkeinCtx_t ctx = {};
+
+    initializeSkeinMacContext(&ctx, key, keyLength, SKEIN384_DIGEST_LENGTH*8, SKEIN_SIZE);
+    macSkeinCtxMulti(&ctx, count, data, dataLength, mac);
+    memset(&ctx, 0, sizeof(ctx));
+}
+
 void* createMacSkein384Context(const uint8_t* key, uint64_t keyLength)
 {
     return createSkeinMacContext(key, keyLength, SKEIN384_DIGEST_LENGTH*8, SKEIN_SIZE);
@@ -51,11 +61,10 @@ void macSkein384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength, uint8_t
 }
 
 void macSkein384Ctx(void* ctx,
-                    const std::vector<const uint8_t*>& data,
-                    const std::vector<uint64_t>& dataLength,
+                    const DataChunks& data,
                     uint8_t* mac, uint32_t* macLength )
 {
-    macSkeinCtx(ctx, data, dataLength, mac);
+    macSkeinCtx(ctx, data, mac);
     *macLength = SKEIN384_DIGEST_LENGTH;
 }
 
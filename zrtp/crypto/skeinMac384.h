@@ -34,7 +34,7 @@
  */
 
 #include <cstdint>
-#include <vector>
+#include <cryptcommon/DataChunks.h>
 
 #ifndef SKEIN384_DIGEST_LENGTH
 #define SKEIN384_DIGEST_LENGTH 48
@@ -73,10 +73,7 @@ void macSkein384(const uint8_t* key, uint64_t key_length, const uint8_t* data, u
  * @param keyLength
  *    Lneght of the MAC key in bytes
  * @param data
- *    Vector of pointers that point to the data chunks. A NULL
- *    pointer in an array element terminates the data chunks.
- * @param dataLength
- *    Vector of integers that hold the length of each data chunk.
+ *    The list of data chunks, at most MAX_DATA_CHUNKS.
  * @param mac
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 48 bytes (SKEIN384_DIGEST_LENGTH).
@@ -84,9 +81,33 @@ void macSkein384(const uint8_t* key, uint64_t key_length, const uint8_t* data, u
  *    Pointer to an uint32_t that receives the length of the computed HMAC.
  */
 void macSkein384(const uint8_t* key, uint64_t keyLength,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength,
+                 const DataChunks& data,
                  uint8_t* mac, uint32_t* mac_length);
+
+/**
+ * Compute Skein384 HMACs of several messages with the same key.
+ *
+ * Prepares the key once and computes the HMAC of each message, the results
+ * are the same as calling the single message function for each message.
+ * The ZRTP key derivation uses it to derive all keys from s0. Skein computes
+ * four MACs in parallel if the CPU supports AVX2.
+ *
+ * @param key
+ *    The MAC key.
+ * @param keyLength
+ *    Length of the MAC key in bytes
+ * @param count
+ *    Number of messages.
+ * @param data
+ *    Array of @c count pointers to the messages.
+ * @param dataLength
+ *    Array of @c count message lengths in bytes.
+ * @param mac
+ *    Array of @c count pointers to buffers that receive the computed digests.
+ *    Each buffer must have a size of at least 48 bytes (SKEIN384_DIGEST_LENGTH).
+ */
+void macSkein384Multi(const uint8_t* key, uint64_t keyLength, size_t count,
+                      const uint8_t* const* data, const uint64_t* dataLength, uint8_t* const* mac);
 /**
  * @}
  */
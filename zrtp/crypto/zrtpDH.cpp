@@ -23,9 +23,13 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 #include <bn.h>
 #include <bnprint.h>
+#include <bnarena.h>
 #include <ec/ec.h>
 #include <ec/ecdh.h>
 #include <zrtp/crypto/zrtpDH.h>
@@ -44,25 +48,117 @@ static BigNum bnP4096MinusOne = {0};
 
 static BigNum two = {0};
 
-static uint8_t dhinit = 0;
+static std::once_flag dhInitOnce;
 
-#if defined(_WIN32) || defined(_WIN64)
-#include <windows.h>
-static CRITICAL_SECTION dh_init_lock;
-static volatile LONG dh_init_started = 0;
-#else
-#include <pthread.h>
-static pthread_mutex_t dh_init_lock = PTHREAD_MUTEX_INITIALIZER;
-#endif
+/*
+ * The curves are read-only after dhInit(), all ZrtpDH objects share them.
+ * The EC functions need scratch pad variables, each thread uses its own
+ * workspace per curve, see EcWorkspace.
+ */
+enum SharedCurves {
+    CurveP256 = 0,
+    CurveP384,
+    Curve25519Shared,
+    Curve3617Shared,
+    numberOfSharedCurves
+};
+static EcCurve sharedCurves[numberOfSharedCurves];
 
 typedef struct _dhCtx {
     BigNum privKey;
     BigNum pubKey;
-    EcCurve curve;
+    int curveIndex;
     EcPoint pubPoint;
     int initialized;
 } dhCtx;
 
+namespace {
+class EcWorkspace {
+public:
+    EcWorkspace() { memset(ready, 0, sizeof(ready)); }
+
+    ~EcWorkspace() {
+        for (int i = 0; i < numberOfSharedCurves; i++) {
+            if (ready[i])
+                ecFreeCurveWorkspace(&curves[i]);
+        }
+    }
+
+    const EcCurve* get(int index) {
+        if (!ready[index]) {
+            ecInitCurveWorkspace(&sharedCurves[index], &curves[index]);
+            ready[index] = true;
+        }
+        return &curves[index];
+    }
+
+private:
+    EcCurve curves[numberOfSharedCurves];
+    bool ready[numberOfSharedCurves];
+};
+}
+
+static thread_local EcWorkspace ecWorkspace;
+
+/*
+ * The temporaries of a DH operation use an arena of the thread instead of
+ * the heap. The numbers of the DH context exist before the operation and
+ * stay on the heap, thus each operation allocates them before it enters
+ * the arena. The EC workspace lives longer than the operation, thus the
+ * operations get it before they enter the arena.
+ */
+static std::atomic<bool> useArena(true);
+static const unsigned arenaSize = 64 * 1024;
+
+// The largest private key: 512 bits for DH4k, less for the EC curves
+static const unsigned privKeyBits = 640;
+
+namespace {
+class DhArena {
+public:
+    DhArena(): depth(0) {}
+
+    void enter() {
+        if (depth++ > 0)
+            return;
+        if (!buffer) {
+            buffer.reset(new uint64_t[arenaSize / sizeof(uint64_t)]);
+            bnArenaInit(&arena, buffer.get(), arenaSize);
+        }
+        bnArenaEnter(&arena);
+    }
+
+    void leave() {
+        if (--depth == 0)
+            bnArenaLeave(&arena);
+    }
+
+private:
+    std::unique_ptr<uint64_t[]> buffer;
+    BnArena arena;
+    int depth;
+};
+
+static thread_local DhArena dhArena;
+
+class ArenaScope {
+public:
+    ArenaScope(): entered(useArena.load(std::memory_order_relaxed)) {
+        if (entered)
+            dhArena.enter();
+    }
+
+    ~ArenaScope() {
+        if (entered)
+            dhArena.leave();
+    }
+
+private:
+    bool entered;
+};
+}
+
+
 void randomZRTP(uint8_t *buf, int32_t length)
 {
     ZrtpRandom::getRandomData(buf, length);
@@ -177,6 +273,36 @@ static const uint8_t P4096[] =
 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
 };
 
+static void dhInit()
+{
+    bnBegin(&two);
+    bnSetQ(&two, 2);
+
+    bnBegin(&bnP2048);
+    bnInsertBigBytes(&bnP2048, P2048, 0, sizeof(P2048));
+    bnBegin(&bnP3072);
+    bnInsertBigBytes(&bnP3072, P3072, 0, sizeof(P3072));
+    bnBegin(&bnP4096);
+    bnInsertBigBytes(&bnP4096, P4096, 0, sizeof(P4096));
+
+    bnBegin(&bnP2048MinusOne);
+    bnCopy(&bnP2048MinusOne, &bnP2048);
+    bnSubQ(&bnP2048MinusOne, 1);
+
+    bnBegin(&bnP3072MinusOne);
+    bnCopy(&bnP3072MinusOne, &bnP3072);
+    bnSubQ(&bnP3072MinusOne, 1);
+
+    bnBegin(&bnP4096MinusOne);
+    bnCopy(&bnP4096MinusOne, &bnP4096);
+    bnSubQ(&bnP4096MinusOne, 1);
+
+    ecGetCurveNistECp(NIST256P, &sharedCurves[CurveP256]);
+    ecGetCurveNistECp(NIST384P, &sharedCurves[CurveP384]);
+    ecGetCurvesCurve(Curve25519, &sharedCurves[Curve25519Shared]);
+    ecGetCurvesCurve(Curve3617, &sharedCurves[Curve3617Shared]);
+}
+
 ZrtpDH::ZrtpDH(const char* type) {
 
     uint8_t random[64];
@@ -221,50 +347,30 @@ ZrtpDH::ZrtpDH(const char* type) {
 
     randomZRTP(random, sizeof(random));
 
-#if defined(_WIN32) || defined(_WIN64)
-    if (InterlockedCompareExchange(&dh_init_started, 1, 0) == 0) {
-        InitializeCriticalSection(&dh_init_lock);
-    }
-    EnterCriticalSection(&dh_init_lock);
-#else
-    pthread_mutex_lock(&dh_init_lock);
-#endif
-    
-    if (!dhinit) {
-        bnBegin(&two);
-        bnSetQ(&two, 2);
-
-        bnBegin(&bnP2048);
-        bnInsertBigBytes(&bnP2048, P2048, 0, sizeof(P2048));
-        bnBegin(&bnP3072);
-        bnInsertBigBytes(&bnP3072, P3072, 0, sizeof(P3072));
-        bnBegin(&bnP4096);
-        bnInsertBigBytes(&bnP4096, P4096, 0, sizeof(P4096));
-
-        bnBegin(&bnP2048MinusOne);
-        bnCopy(&bnP2048MinusOne, &bnP2048);
-        bnSubQ(&bnP2048MinusOne, 1);
-
-        bnBegin(&bnP3072MinusOne);
-        bnCopy(&bnP3072MinusOne, &bnP3072);
-        bnSubQ(&bnP3072MinusOne, 1);
-
-        bnBegin(&bnP4096MinusOne);
-        bnCopy(&bnP4096MinusOne, &bnP4096);
-        bnSubQ(&bnP4096MinusOne, 1);
-
-        dhinit = 1;
-    }
-    
-#if defined(_WIN32) || defined(_WIN64)
-    LeaveCriticalSection(&dh_init_lock);
-#else
-    pthread_mutex_unlock(&dh_init_lock);
-#endif
+    std::call_once(dhInitOnce, dhInit);
 
     bnBegin(&tmpCtx->privKey);
+    bnPrealloc(&tmpCtx->privKey, privKeyBits);
     INIT_EC_POINT(&tmpCtx->pubPoint);
 
+    switch (pkType) {
+    case EC25:
+        tmpCtx->curveIndex = CurveP256;
+        break;
+    case EC38:
+        tmpCtx->curveIndex = CurveP384;
+        break;
+    case E255:
+        tmpCtx->curveIndex = Curve25519Shared;
+        break;
+    case E414:
+        tmpCtx->curveIndex = Curve3617Shared;
+        break;
+    }
+    const EcCurve* curve = (pkType == DH2K || pkType == DH3K || pkType == DH4K) ? nullptr :
+                           ecWorkspace.get(tmpCtx->curveIndex);
+    ArenaScope arena;
+
     switch (pkType) {
     case DH2K:
         bnInsertBigBytes(&tmpCtx->privKey, random, 0, 256/8);
@@ -279,23 +385,10 @@ ZrtpDH::ZrtpDH(const char* type) {
         break;
 
     case EC25:
-        ecGetCurveNistECp(NIST256P, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
-        break;
-
     case EC38:
-        ecGetCurveNistECp(NIST384P, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
-        break;
-
     case E255:
-        ecGetCurvesCurve(Curve25519, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
-        break;
-
     case E414:
-        ecGetCurvesCurve(Curve3617, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
+        ecGenerateRandomNumber(curve, &tmpCtx->privKey);
         break;
         
     default:
@@ -324,16 +417,6 @@ ZrtpDH::~ZrtpDH() {
     case DH4K:
         bnEnd(&tmpCtx->pubKey);
         break;
-
-    case EC25:
-    case EC38:
-        ecFreeCurveNistECp(&tmpCtx->curve);
-        break;
-
-    case E255:
-    case E414:
-        ecFreeCurvesCurve(&tmpCtx->curve);
-        break;
     }
     delete tmpCtx;
     ctx = nullptr;
@@ -357,6 +440,10 @@ int32_t ZrtpDH::computeSecretKey(uint8_t *pubKeyBytes, uint8_t *secret) {
         return -1;
     }
 
+    const EcCurve* curve = (pkType == DH2K || pkType == DH3K || pkType == DH4K) ? nullptr :
+                           ecWorkspace.get(tmpCtx->curveIndex);
+    ArenaScope arena;
+
     BigNum sec;
     if (pkType == DH2K || pkType == DH3K || pkType == DH4K) {
         BigNum pubKeyOther;
@@ -409,7 +496,7 @@ int32_t ZrtpDH::computeSecretKey(uint8_t *pubKeyBytes, uint8_t *secret) {
         bnInsertBigBytes(pub.x, pubKeyBytes, 0, len);
         bnInsertBigBytes(pub.y, pubKeyBytes+len, 0, len);
 
-        ecdhComputeAgreement(&tmpCtx->curve, &sec, &pub, &tmpCtx->privKey);
+        ecdhComputeAgreement(curve, &sec, &pub, &tmpCtx->privKey);
         bnExtractBigBytes(&sec, secret, 0, length);
         bnEnd(&sec);
         FREE_EC_POINT(&pub);
@@ -430,7 +517,7 @@ int32_t ZrtpDH::computeSecretKey(uint8_t *pubKeyBytes, uint8_t *secret) {
 
         bnInsertLittleBytes(pub.x, pubKeyBytes, 0, len);
 
-        ecdhComputeAgreement(&tmpCtx->curve, &sec, &pub, &tmpCtx->privKey);
+        ecdhComputeAgreement(curve, &sec, &pub, &tmpCtx->privKey);
         bnExtractLittleBytes(&sec, secret, 0, length);
         bnEnd(&sec);
         FREE_EC_POINT(&pub);
@@ -453,6 +540,21 @@ int32_t ZrtpDH::generatePublicKey()
     }
 
     bnBegin(&tmpCtx->pubKey);
+
+    const EcCurve* curve = nullptr;
+    if (pkType == DH2K || pkType == DH3K || pkType == DH4K) {
+        bnPrealloc(&tmpCtx->pubKey, getDhSize() * 8);
+    }
+    else {
+        // The point functions store products of two coordinates before the reduction
+        curve = ecWorkspace.get(tmpCtx->curveIndex);
+        unsigned bits = bnBits(curve->p) * 2 + 128;
+        bnPrealloc(tmpCtx->pubPoint.x, bits);
+        bnPrealloc(tmpCtx->pubPoint.y, bits);
+        bnPrealloc(tmpCtx->pubPoint.z, bits);
+    }
+    ArenaScope arena;
+
     switch (pkType) {
     case DH2K:
         if (bnExpMod(&tmpCtx->pubKey, &two, &tmpCtx->privKey, &bnP2048) < 0) {
@@ -479,8 +581,8 @@ int32_t ZrtpDH::generatePublicKey()
     case EC38:
     case E255:
     case E414:
-        while (!ecdhGeneratePublic(&tmpCtx->curve, &tmpCtx->pubPoint, &tmpCtx->privKey))
-            ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
+        while (!ecdhGeneratePublic(curve, &tmpCtx->pubPoint, &tmpCtx->privKey))
+            ecGenerateRandomNumber(curve, &tmpCtx->privKey);
         break;
         
     default:
@@ -532,10 +634,10 @@ int32_t ZrtpDH::getPubKeySize() const
         return bnBytes(&tmpCtx->pubKey);
 
     if (pkType == EC25 || pkType == EC38 || pkType == E414)
-        return bnBytes(tmpCtx->curve.p) * 2;
+        return bnBytes(sharedCurves[tmpCtx->curveIndex].p) * 2;
 
     if (pkType == E255)
-        return bnBytes(tmpCtx->curve.p);
+        return bnBytes(sharedCurves[tmpCtx->curveIndex].p);
     return 0;
 
 }
@@ -599,22 +701,28 @@ int32_t ZrtpDH::checkPubKey(uint8_t *pubKeyBytes) const
         return 0;
     }
 
+    const EcCurve* curve = (pkType == DH2K || pkType == DH3K || pkType == DH4K) ? nullptr :
+                           ecWorkspace.get(tmpCtx->curveIndex);
+    ArenaScope arena;
+
     /* ECC validation (partial), NIST SP800-56A, section 5.6.2.6 */
     if (pkType == EC25 || pkType == EC38 || pkType == E414) {
 
         EcPoint pub;
 
-        INIT_EC_POINT(&pub);
         int32_t len = getPubKeySize() / 2;
 
         if (len <= 0) {
             return 0;
         }
 
+        INIT_EC_POINT(&pub);
         bnInsertBigBytes(pub.x, pubKeyBytes, 0, len);
         bnInsertBigBytes(pub.y, pubKeyBytes+len, 0, len);
 
-        return ecCheckPubKey(&tmpCtx->curve, &pub);
+        int32_t result = ecCheckPubKey(curve, &pub);
+        FREE_EC_POINT(&pub);
+        return result;
     }
 
     if (pkType == E255) {
@@ -685,6 +793,16 @@ const char* ZrtpDH::getDHtype()
     return NULL;
 }
 
+void ZrtpDH::setUseArena(bool enable)
+{
+    useArena.store(enable);
+}
+
+uint64_t ZrtpDH::getHeapAllocations()
+{
+    return lbnMemHeapAllocs();
+}
+
 /** EMACS **
  * Local variables:
  * mode: c++
@@ -163,6 +163,23 @@ public:
      *     Pointer to DH algorithm name
      */
     const char* getDHtype();
+
+    /**
+     * Enable or disable the arena for the big number temporaries.
+     *
+     * The DH operations allocate their temporary big numbers in an arena
+     * of the calling thread instead of the heap. The arena is enabled by
+     * default, benchmarks switch it off to compare.
+     */
+    static void setUseArena(bool enable);
+
+    /**
+     * Get the number of heap allocations of the big number library.
+     *
+     * @return
+     *     The heap allocations of the calling thread.
+     */
+    static uint64_t getHeapAllocations();
 };
 #endif /*__cpluscplus */
 #endif
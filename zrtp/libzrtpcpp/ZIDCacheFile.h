@@ -15,6 +15,7 @@
  */
 
 #include <stdio.h>
+#include <mutex>
 
 #include <libzrtpcpp/ZIDCache.h>
 #include <libzrtpcpp/ZIDRecordFile.h>
@@ -50,6 +51,7 @@ private:
 
     FILE* zidFile;
     unsigned char associatedZid[IDENTIFIER_LEN];
+    std::mutex fileLock;        ///< ZRtp instances of several threads share the file position
 
     void createZIDFile(char* name);
     void checkDoMigration(char* name);
@@ -24,6 +24,7 @@
  */
 
 #include <cstdlib>
+#include <mutex>
 
 #include <libzrtpcpp/ZrtpPacketHello.h>
 #include <libzrtpcpp/ZrtpPacketHelloAck.h>
@@ -41,8 +42,11 @@
 #include <libzrtpcpp/ZrtpPacketRelayAck.h>
 #include <libzrtpcpp/ZrtpCallback.h>
 #include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZrtpTrace.h>
+#include <libzrtpcpp/ZrtpNonceSet.h>
 
 #include <cryptcommon/skeinApi.h>
+#include <cryptcommon/DataChunks.h>
 #ifdef ZRTP_OPENSSL
 #include <openssl/crypto.h>
 #include <openssl/sha.h>
@@ -70,6 +74,7 @@
 class __EXPORT ZrtpStateClass;
 class ZrtpDH;
 class ZRtp;
+class ZrtpMultiStreamGroup;
 
 /**
  * The main ZRTP class.
@@ -132,6 +137,7 @@ class __EXPORT ZRtp {
         int32_t version;
         ZrtpPacketHello* packet;
         uint8_t helloHash[IMPL_MAX_DIGEST_LENGTH];
+        bool hmacDone;                  ///< HMAC and helloHash are computed
     } HelloPacketVersion;
 
     /**
@@ -146,6 +152,44 @@ class __EXPORT ZRtp {
      */
     ~ZRtp();
 
+    /**
+     * Reset the engine for a new ZRTP session.
+     *
+     * Stops the engine, wipes all secrets of the previous session and then
+     * initializes the engine with the same data the constructor uses. After
+     * reset the engine is in the same state as a new engine and the
+     * application must start it with startZrtpEngine().
+     *
+     * Reset reuses the engine object, its packet buffers and its state engine,
+     * thus it is faster than deleting and creating an engine. Refer to
+     * ZRtpPool.
+     *
+     * @param myZid
+     *     Pointer to the ZID of this client.
+     * @param cb
+     *     The callback of the new session.
+     * @param id
+     *     The client's id, refer to setClientId().
+     * @param config
+     *     The configuration data.
+     * @param mitm
+     *     Set to true if this engine acts as a trusted MitM.
+     * @param sasSignSupport
+     *     Set to true if the application supports SAS signing.
+     */
+    void reset(uint8_t* myZid, ZrtpCallback* cb, std::string id,
+               ZrtpConfigure* config, bool mitm = false, bool sasSignSupport= false);
+
+    /**
+     * Stop the engine and wipe all secrets of the current session.
+     *
+     * Frees the DH context, the ZID record and the other data the engine
+     * allocated during the session and clears all keys, hash chain values
+     * and message buffers. The engine also forgets its callback and is
+     * unusable until the application calls reset().
+     */
+    void clearSession();
+
     /**
      * Kick off the ZRTP protocol engine.
      *
@@ -369,6 +413,26 @@ class __EXPORT ZRtp {
      */
     void setMultiStrParams(std::string parameters, ZRtp* zrtpMaster);
 
+    /**
+     * Set Multi-stream parameters from the master stream.
+     *
+     * Same as <code>setMultiStrParams(std::string parameters, ZRtp* zrtpMaster)</code>
+     * but copies the parameters directly from the master stream and does not
+     * use the opaque parameter string. Applications that start many
+     * multi-stream sessions may use this function or ZrtpMultiStreamGroup.
+     *
+     * The master saves a copy of the parameters when it enters secure state.
+     * This function reads the copy under a lock of the master, thus the
+     * master may process its packets in another thread.
+     *
+     * @param zrtpMaster
+     *     The pointer of the ZRTP master stream. The master stream must be in
+     *     secure state and must not be a multi-stream session.
+     * @return
+     *     True if the master stream provided the parameters.
+     */
+    bool setMultiStrMaster(ZRtp* zrtpMaster);
+
     /**
      * Check if this ZRTP session is a Multi-stream session.
      *
@@ -560,6 +624,31 @@ class __EXPORT ZRtp {
       */
      const zrtpInfo *getDetailInfo();
 
+     /**
+      * Returns a pointer to the handshake trace of this session.
+      *
+      * The trace contains data only if tracing was enabled with
+      * ZrtpTrace::setEnabled() before the engine started. The retransmission
+      * count is updated during this call.
+      *
+      * @see ZrtpTrace
+      */
+     const zrtpTraceInfo *getTraceInfo();
+
+     /**
+      * Returns the number of memory bytes this engine currently uses.
+      *
+      * The value is the size of the ZRtp object plus the heap data it owns:
+      * the handshake packets and buffers, the DH context and DH secret, the
+      * ZID record, the auxiliary secret, and the stored multi-stream nonces.
+      * It does not include the internal data of the DH context and the
+      * overhead of the heap allocator.
+      *
+      * After the engine entered SecureState the handshake data is released,
+      * the value is then the long-term footprint of a secure call.
+      */
+     size_t getMemoryFootprint();
+
      /**
       * Get peer's client id.
       *
@@ -674,6 +763,28 @@ class __EXPORT ZRtp {
       * @return number of 32-bit counters returned in buffer or < 0 on error
       */
      int getCountersZrtp(int32_t* counters);
+
+     /**
+      * @brief Get required buffer size to get the 32-bit trace counters of ZRTP
+      *
+      * @return number of 32 bit integer elements required
+      */
+     int getNumberOfTraceCountersZrtp();
+
+     /**
+      * @brief Read the trace counters of ZRTP
+      *
+      * The number of calls and the accumulated time in microseconds of each
+      * traced crypto operation, then the time in microseconds from engine
+      * start until secure state or -1 if not known. The counters are zero if
+      * tracing was not enabled when the engine started, see ZrtpTrace.
+      *
+      * @param counters Pointer to buffer of 32-bit integers. The buffer must be able to
+      *         hold at least getNumberOfTraceCountersZrtp() 32-bit integers
+      *
+      * @return number of 32-bit counters returned in buffer
+      */
+     int getTraceCountersZrtp(int32_t* counters);
      
      /**
       * @brief Get the computed ZRTP exported key.
@@ -709,6 +820,7 @@ private:
      } HashCtx;
 
      friend class ZrtpStateClass;
+     friend class ZrtpMultiStreamGroup;
 
     /**
      * The state engine takes care of protocol processing.
@@ -741,10 +853,6 @@ private:
      */
     uint8_t* DHss;
 
-    /**
-     * My computed public key
-     */
-    uint8_t pubKeyBytes[1000];
     /**
      * Length off public key
      */
@@ -883,19 +991,18 @@ private:
     /**
      * Pointers to negotiated hash and HMAC functions
      */
-    void (*hashListFunction)(const std::vector<const uint8_t*>& data,
-                             const std::vector<uint64_t>& dataLength,
-                             uint8_t *digest);
+    void (*hashListFunction)(const DataChunks& data, uint8_t *digest);
 
     void (*hmacFunction)(const uint8_t* key, uint64_t key_length,
                          const uint8_t* data, uint64_t data_length,
                          uint8_t* mac, uint32_t* mac_length);
 
-    void (*hmacListFunction)(const uint8_t* key, uint64_t key_length,
-                             const std::vector<const uint8_t*>& data,
-                             const std::vector<uint64_t>& data_length,
+    void (*hmacListFunction)(const uint8_t* key, uint64_t key_length, const DataChunks& data,
                              uint8_t* mac, uint32_t* mac_length );
 
+    void (*hmacMultiFunction)(const uint8_t* key, uint64_t key_length, size_t count,
+                              const uint8_t* const* data, const uint64_t* dataLength, uint8_t* const* mac);
+
     void* (*createHashCtx)(void* ctx);
 
     void (*closeHashCtx)(void* ctx, uint_8t* digest);
@@ -988,11 +1095,6 @@ private:
     ZrtpPacketGoClear  zrtpGoClear;
     ZrtpPacketError    zrtpError;
     ZrtpPacketErrorAck zrtpErrorAck;
-    ZrtpPacketDHPart   zrtpDH1;
-    ZrtpPacketDHPart   zrtpDH2;
-    ZrtpPacketCommit   zrtpCommit;
-    ZrtpPacketConfirm  zrtpConfirm1;
-    ZrtpPacketConfirm  zrtpConfirm2;
     ZrtpPacketPingAck  zrtpPingAck;
     ZrtpPacketSASrelay zrtpSasRelay;
     ZrtpPacketRelayAck zrtpRelayAck;
@@ -1000,6 +1102,9 @@ private:
     HelloPacketVersion helloPackets[MAX_ZRTP_VERSIONS + 1];
     int32_t highestZrtpVersion;
 
+    /// Protects the lazy HMAC computation of the Hello packets
+    std::mutex helloLock;
+
     /// Pointer to Hello packet sent to partner, initialized in ZRtp, modified by ZrtpStateClass
     ZrtpPacketHello* currentHelloPacket;
 
@@ -1019,8 +1124,43 @@ private:
      */
     uint8_t randomIV[16];
 
-    uint8_t tempMsgBuffer[1024];
-    uint32_t lengthOfMsgData;
+    /**
+     * Packets and buffers that ZRtp needs only during key negotiation.
+     *
+     * ZRtp allocates this data when it initializes the session or starts the
+     * engine and wipes and frees it when the engine enters SecureState. A
+     * secure call keeps only the data it needs for the SAS, the multi-stream
+     * parameters, the SAS relay and the exported key, refer to
+     * releaseHandshakeData().
+     */
+    struct HandshakeData {
+        ZrtpPacketDHPart   zrtpDH1;
+        ZrtpPacketDHPart   zrtpDH2;
+        ZrtpPacketCommit   zrtpCommit;
+        ZrtpPacketConfirm  zrtpConfirm1;
+        ZrtpPacketConfirm  zrtpConfirm2;
+
+        uint8_t pubKeyBytes[1000];          // My computed public key
+
+        uint8_t tempMsgBuffer[1024];        // Peer message to check with the next H? hash image
+        uint32_t lengthOfMsgData;
+
+        // Bump arena for the DH context and the DH result, large enough for DH4k
+        alignas(16) uint8_t arena[1024];
+        size_t arenaUsed;
+
+        HandshakeData(): lengthOfMsgData(0), arenaUsed(0) {}
+
+        void* allocate(size_t size) {
+            size = (size + 15) & ~static_cast<size_t>(15);
+            if (size > sizeof(arena) - arenaUsed)
+                return nullptr;
+            void* memory = arena + arenaUsed;
+            arenaUsed += size;
+            return memory;
+        }
+    };
+    HandshakeData* handshake;
 
     /**
      * Variables to store signature data. Includes the signature type block
@@ -1037,11 +1177,37 @@ private:
 
     zrtpInfo detailInfo;         // filled with some more detailded information if application would like to know
 
-    std::string peerClientId;    // store the peer's client Id
+    zrtpTraceInfo traceInfo;     // handshake trace, filled only if tracing is enabled
+
+    char peerClientId[ZRTP_WORD_SIZE * 4];  // store the peer's client Id, not nul terminated
 
     ZRtp* masterStream;                    // This is the master stream in case this is a multi-stream
-    std::vector<std::string> peerNonces;   // Store nonces we got from our partner. Using std::string
-                                           // just simplifies memnory management, nonces are binary data, not strings :-)
+    ZrtpNonceSet peerNonces;               // Nonces of the multi-stream Commits of our partner
+    ZrtpMultiStreamGroup* streamGroup;     // Group that created this multi-stream session, if any
+    size_t streamGroupIndex;               // Index of this session in its group
+
+    /**
+     * The parameters a multi-stream session takes from this master session.
+     *
+     * The master copies them when it enters SecureState and clears them
+     * when it leaves SecureState. Other threads read the copy under
+     * multiStrLock, never the live session data of the master.
+     */
+    struct MultiStrParams {
+        AlgorithmEnum* hash;
+        AlgorithmEnum* cipher;
+        AlgorithmEnum* authLength;
+        int32_t hashLength;
+        uint8_t zrtpSession[MAX_DIGEST_LENGTH];
+        bool valid;
+    };
+    MultiStrParams multiStrParams;
+    std::mutex multiStrLock;
+
+    /**
+     * Copy or clear the multi-stream parameters, see MultiStrParams.
+     */
+    void publishMultiStrParams(bool secure);
     /**
      * Enable or disable paranoid mode.
      *
@@ -1078,6 +1244,37 @@ private:
      */
     bool peerDisclosureFlagSeen;
 
+    /**
+     * Initialize the session data, used by constructor and reset().
+     */
+    void initialize(uint8_t* myZid, std::string id, ZrtpConfigure* config, bool mitm, bool sasSignSupport);
+
+    /**
+     * Allocate the handshake data or reinitialize existing handshake data.
+     */
+    void allocateHandshakeData();
+
+    /**
+     * Wipe and free the handshake data and the secrets only used during key
+     * negotiation.
+     *
+     * ZRtp calls this function when it enters SecureState. The engine
+     * allocates the data again if the application restarts it.
+     */
+    void releaseHandshakeData();
+
+    /**
+     * Create a DH context in the handshake arena, replaces an existing context.
+     *
+     * @return the DH context or @c nullptr if the arena is full.
+     */
+    ZrtpDH* createDhContext(const char* type);
+
+    /**
+     * Destroy the DH context, forget the DH result and wipe the handshake arena.
+     */
+    void freeDhData();
+
     /**
      * Find the best Hash algorithm that is offered in Hello.
      *
@@ -1258,6 +1455,25 @@ private:
     void KDF(uint8_t* key, size_t keyLength, uint8_t* label, size_t labelLength,
                uint8_t* context, size_t contextLength, size_t L, uint8_t* output);
 
+    /**
+     * One output of KDFMulti: the label string, the length L in bits and the output buffer.
+     */
+    typedef struct _kdfOutput {
+        const char* label;
+        size_t L;
+        uint8_t* output;
+    } KdfOutput;
+
+    /**
+     * Compute several KDF outputs with the same key and context.
+     *
+     * Same results as a KDF call for each output, but prepares the HMAC key
+     * only once. Derives all keys from s0 in one call, the outputs are
+     * computed one after the other in the calling thread.
+     */
+    void KDFMulti(uint8_t* key, size_t keyLength, const KdfOutput* outputs, size_t count,
+                  uint8_t* context, size_t contextLength);
+
     void generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec);
 
     void generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec);
@@ -1630,7 +1846,7 @@ private:
       *
       * The identifier is set in the Hello packet of ZRTP. Thus only after
       * setting the identifier ZRTP can compute the HMAC and the final
-      * helloHash.
+      * helloHash, refer to computeHelloHmac().
       *
       * @param id
       *     The client's id
@@ -1638,6 +1854,20 @@ private:
       *     Pointer to hello packet version structure.
       */
      void setClientId(std::string id, HelloPacketVersion* hpv);
+
+     /**
+      * Compute the HMAC and the final helloHash of a Hello packet.
+      *
+      * ZRTP computes the HMAC of the Hello packet it sends first when it
+      * creates the engine. The Hello packets of the other versions are
+      * only necessary if the peer uses an older version or if the
+      * application asks for their hello hash, thus ZRTP computes them on
+      * first use. Does nothing if the HMAC is already computed.
+      *
+      * @param hpv
+      *     Pointer to hello packet version structure.
+      */
+     void computeHelloHmac(HelloPacketVersion* hpv);
      
      /**
       * Check and set a nonce.
@@ -1648,10 +1878,13 @@ private:
       * @param nonce
       *     The nonce to check and to store if not already seen.
       * 
+      * @param errMsg
+      *     Set to the ZRTP error code if the function rejects the nonce.
+      *
       * @return
-      *     True if the the nonce was stroed, thus not yet seen.
+      *     True if the the nonce was stored, thus not yet seen.
       */
-     bool checkAndSetNonce(uint8_t* nonce);
+     bool checkAndSetNonce(uint8_t* nonce, uint32_t* errMsg);
 };
 
 /**
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPPOOL_H_
+#define _ZRTPPOOL_H_
+
+/**
+ * @file ZRtpPool.h
+ * @brief Pool of reusable ZRTP engines
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#include <libzrtpcpp/ZRtp.h>
+
+/**
+ * A pool of ZRTP engines.
+ *
+ * A ZRtp object is large: it contains all ZRTP packets, the message buffers
+ * and a state engine. Applications that create and delete many engines, for
+ * example one or two per call, may use this pool instead. The pool keeps
+ * released engines and hands them out again after a ZRtp::reset(). Reset
+ * initializes an engine like the constructor but does not allocate the
+ * engine, its packets and its state engine again.
+ *
+ * The pool wipes all secrets of an engine when the application releases it,
+ * thus idle engines in the pool do not hold key material.
+ *
+ * The pool saves allocations, not time. Measured with zrtpbench (-t 1000,
+ * 4 runs), a new engine takes 18.8 - 24.8 us and 8 heap allocations, a
+ * pooled acquire and release 18.7 - 23.9 us and no heap allocation. Most of
+ * the time goes to the random H0, the hash chain and the Hello HMAC, which
+ * are secrets of each session. Thus clients use the pool only if the
+ * application asks for it, see for example CtZrtpSession::setEnginePool().
+ *
+ * All methods are thread safe. The engines themselves are not, the
+ * application must use an engine in the same way as an engine it created
+ * with @c new.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZRtpPool {
+
+public:
+    /**
+     * Create an empty pool.
+     *
+     * @param maxIdle
+     *     Maximum number of idle engines the pool keeps. The pool deletes
+     *     released engines if it already holds this number of idle engines.
+     */
+    ZRtpPool(size_t maxIdle = 64);
+
+    /**
+     * Destructor deletes all idle engines.
+     *
+     * The application must release or delete all engines it acquired before
+     * it deletes the pool.
+     */
+    ~ZRtpPool();
+
+    /**
+     * Get an engine from the pool.
+     *
+     * Takes an idle engine and resets it or creates a new engine if the pool
+     * is empty. The parameters are the same as for the ZRtp constructor.
+     *
+     * @return
+     *     An engine, ready to start with ZRtp::startZrtpEngine().
+     */
+    ZRtp* acquire(uint8_t* myZid, ZrtpCallback* cb, std::string id,
+                  ZrtpConfigure* config, bool mitm = false, bool sasSignSupport = false);
+
+    /**
+     * Return an engine to the pool.
+     *
+     * Stops the engine and wipes its secrets. The callback of the engine
+     * must be valid during this call because stopping the engine may cancel
+     * its timer.
+     *
+     * @param engine
+     *     The engine, the application must not use it after this call. A
+     *     @c NULL pointer is ignored.
+     */
+    void release(ZRtp* engine);
+
+    /**
+     * Create idle engines in advance.
+     *
+     * Fill the pool up to @c count idle engines, at most up to the maximum
+     * number of idle engines.
+     *
+     * @param count
+     *     Number of idle engines.
+     * @param myZid
+     *     Pointer to the ZID of this client.
+     * @param config
+     *     The configuration, acquire() resets the engines with the
+     *     configuration of the new session.
+     */
+    void prefill(size_t count, uint8_t* myZid, ZrtpConfigure* config);
+
+    /// Number of idle engines in the pool
+    size_t getIdleCount();
+
+    /// Number of engines acquire() created because the pool was empty
+    uint64_t getCreatedCount();
+
+    /// Number of engines acquire() took from the pool
+    uint64_t getReusedCount();
+
+    /**
+     * Get the process-wide pool.
+     *
+     * Applications that share one pool between all their sessions may use
+     * this instance.
+     */
+    static ZRtpPool& getInstance();
+
+private:
+    ZRtpPool(const ZRtpPool& other) = delete;
+    ZRtpPool& operator=(const ZRtpPool& other) = delete;
+
+    std::mutex lock;
+    std::vector<ZRtp*> idle;
+    size_t maxIdle;
+    uint64_t created;
+    uint64_t reused;
+};
+
+/**
+ * @}
+ */
+#endif
@@ -249,6 +249,37 @@ typedef struct c_srtpSecrets
 #define ForReceiver 1       /*!< Enable security for SRTP receiver */
 #define ForSender   2       /*!< Enable security for SRTP sender */
 
+/*
+ * Keep the following enumeration, defines, and structure in sync with ZrtpTrace.h
+ */
+/*! The traced crypto operations and the histograms. */
+typedef enum {
+    zrtp_TraceDhKeyGen = 0,     /*!< Create DH context and compute public key */
+    zrtp_TraceDhCompute,        /*!< Compute the DH shared secret */
+    zrtp_TraceCacheRead,        /*!< Read a ZID record from the cache */
+    zrtp_TraceCacheWrite,       /*!< Write a ZID record to the cache */
+    zrtp_TraceKdf,              /*!< Key derivation, s0 and all SRTP keys */
+    zrtp_TraceSetupTime         /*!< Histogram only: start of engine until secure state */
+} zrtp_TraceOps;
+
+#define zrtp_TraceNumberOfOps 5         /*!< Number of traced crypto operations */
+#define zrtp_TraceNumberOfBuckets 32    /*!< Number of buckets of a trace histogram */
+
+/**
+ * This structure contains the handshake trace of a ZRTP session.
+ *
+ * All times are in nanoseconds, the state indices are the values of
+ * enum zrtpStates.
+ */
+typedef struct c_zrtpTraceInfo
+{
+    int64_t startTime;                          /*!< Monotonic time the engine started, 0 if not traced */
+    int64_t stateEntered[numberOfStates];       /*!< Time relative to start when state was entered first, -1 if never */
+    int64_t opTime[zrtp_TraceNumberOfOps];      /*!< Accumulated time of each crypto operation */
+    int32_t opCount[zrtp_TraceNumberOfOps];     /*!< Number of calls of each crypto operation */
+    int32_t retransmits;                        /*!< Total number of packet retransmissions */
+} C_ZrtpTraceInfo_t;
+
 #ifdef __cplusplus
 #ifdef __GNUC__ 
 #pragma GCC visibility push(default)
@@ -1110,6 +1141,82 @@ extern "C"
       */
      int32_t zrtp_getCurrentProtocolVersion(ZrtpContext* zrtpContext);
 
+     /**
+      * Get required buffer size to get all 32-bit statistic counters of ZRTP.
+      *
+      * @param zrtpContext
+      *    Pointer to the opaque ZrtpContext structure.
+      *
+      * @return number of 32 bit integer elements required or < 0 on error
+      */
+     int32_t zrtp_getNumberOfCountersZrtp(ZrtpContext* zrtpContext);
+
+     /**
+      * Read statistic counters of ZRTP.
+      *
+      * The counters are the retry counters of the ZRTP state engine. Use
+      * zrtp_getTraceInfo to get the handshake trace.
+      *
+      * @param zrtpContext
+      *    Pointer to the opaque ZrtpContext structure.
+      * @param counters
+      *    Pointer to buffer of 32-bit integers. The buffer must be able to
+      *    hold at least zrtp_getNumberOfCountersZrtp() 32-bit integers
+      *
+      * @return number of 32-bit counters returned in buffer or < 0 on error
+      */
+     int32_t zrtp_getCountersZrtp(ZrtpContext* zrtpContext, int32_t* counters);
+
+     /**
+      * Get the handshake trace of a ZRTP session.
+      *
+      * The trace contains data only if tracing was enabled before the
+      * ZRTP engine started.
+      *
+      * @param zrtpContext
+      *    Pointer to the opaque ZrtpContext structure.
+      * @param info
+      *    Pointer to the structure that gets the trace data.
+      *
+      * @return 1 if the trace data was copied, 0 otherwise
+      *
+      * @see zrtp_setTraceEnabled
+      */
+     int32_t zrtp_getTraceInfo(ZrtpContext* zrtpContext, C_ZrtpTraceInfo_t* info);
+
+     /**
+      * Switch handshake tracing on or off.
+      *
+      * The setting is process-wide and applies to ZRTP sessions that
+      * start after this call. Tracing is off by default.
+      *
+      * @param enable
+      *    If not zero switch tracing on, otherwise switch it off.
+      */
+     void zrtp_setTraceEnabled(int32_t enable);
+
+     /**
+      * Get a process-wide trace histogram.
+      *
+      * Bucket 0 counts durations below 1 microsecond, bucket @c n counts
+      * durations between 2^(n-1) and 2^n microseconds.
+      *
+      * @param histogram
+      *    The histogram to get, one of zrtp_TraceOps.
+      * @param buckets
+      *    Pointer to an array that gets the bucket counts.
+      * @param size
+      *    Number of elements of @c buckets, at most zrtp_TraceNumberOfBuckets are used.
+      *
+      * @return number of buckets copied or -1 if the histogram is invalid
+      */
+     int32_t zrtp_getTraceHistogram(int32_t histogram, uint64_t* buckets, int32_t size);
+
+     /**
+      * Clear all process-wide trace histograms.
+      */
+     void zrtp_resetTraceHistograms(void);
+
      /**
      * This enumerations list all configurable algorithm types.
      */
@@ -33,10 +33,17 @@
 #include <list>
 #include <string>
 #include <vector>
+#include <memory>
 #include <string.h>
 
 #include <libzrtpcpp/ZrtpCallback.h>
 
+/**
+ * Default maximum number of multi-stream sessions per master session, thus
+ * the maximum number of nonces a master session stores.
+ */
+#define ZRTP_DEFAULT_MAX_NONCES 65536
+
 /**
  * This enumerations list all configurable algorithm types.
  */
@@ -308,11 +315,16 @@ extern __EXPORT AuthLengthEnum zrtpAuthLengths;
  *
  * An application can configure implemented algorithms only.
  */
+class ZrtpPacketHello;
+
 class __EXPORT ZrtpConfigure {
 public:
     ZrtpConfigure();         /* Creates Configuration data */
+    ZrtpConfigure(const ZrtpConfigure& other);
     ~ZrtpConfigure();
 
+    ZrtpConfigure& operator=(const ZrtpConfigure& other);
+
     /**
      * Define the algorithm selection policies.
      */
@@ -532,12 +544,51 @@ public:
      */
     bool isDisclosureFlag();
 
+    /**
+     * Set the maximum number of multi-stream sessions of a master session.
+     *
+     * The master session stores the nonce of each multi-stream Commit it
+     * accepted to detect nonce reuse. If a master session reached this
+     * number it rejects further multi-stream Commits. The default is
+     * ZRTP_DEFAULT_MAX_NONCES.
+     *
+     * @param number
+     *    Maximum number of multi-stream sessions.
+     */
+    void setMaxMultiStreams(uint32_t number);
+
+    /**
+     * Get the maximum number of multi-stream sessions of a master session.
+     *
+     * @return
+     *    Maximum number of multi-stream sessions.
+     */
+    uint32_t getMaxMultiStreams();
+
     /// Helper function to print some internal data
     void printConfiguredAlgos(AlgoTypes algoTyp);
 
     Policy getSelectionPolicy()         {return selectionPolicy;}
     void setSelectionPolicy(Policy pol) {selectionPolicy = pol;}
 
+    /**
+     * Get the Hello packet template of this configuration.
+     *
+     * The template is a Hello packet that contains the configured algorithm
+     * names, the lengths and all offsets. ZRTP engines copy the template and
+     * only fill in their ZID, H3, version, client id and flags and compute
+     * the MAC. The first call after a change of the algorithms builds the
+     * template, all further calls and all copies of this configuration share
+     * the same immutable template until the algorithms change again.
+     *
+     * The function is thread safe if no other thread modifies the
+     * configuration at the same time.
+     *
+     * @return
+     *    Reference counted pointer to the immutable Hello template.
+     */
+    std::shared_ptr<const ZrtpPacketHello> getHelloTemplate();
+
   private:
     std::vector<AlgorithmEnum* > hashes;
     std::vector<AlgorithmEnum* > symCiphers;
@@ -549,6 +600,7 @@ public:
     bool enableSasSignature;
     bool enableParanoidMode;
     bool enableDisclosureFlag;
+    uint32_t maxMultiStreams;
 
 
     AlgorithmEnum& getAlgoAt(std::vector<AlgorithmEnum* >& a, int32_t index);
@@ -560,9 +612,12 @@ public:
     std::vector<AlgorithmEnum* >& getEnum(AlgoTypes algoType);
 
     void printConfiguredAlgos(std::vector<AlgorithmEnum* >& a);
+    void clearHelloTemplate();
 
     Policy selectionPolicy;
 
+    std::shared_ptr<const ZrtpPacketHello> helloTemplate;
+
   protected:
 
   public:
@@ -68,6 +68,29 @@ uint32_t zrtpGenerateCksum(const uint8_t *buffer, uint16_t length);
  */
 uint32_t zrtpEndCksum(uint32_t crc32);
 
+/**
+ * Switch the CRC32C computation between the CPU extension and the portable code.
+ *
+ * At load time the library selects the crc32 instruction of SSE 4.2 if the
+ * CPU supports it, otherwise the portable slicing-by-8 code. Benchmarks use
+ * this function to compare both.
+ *
+ * @param enable
+ *    If not 0 use the CPU extension if available, otherwise the portable code.
+ *
+ * @return
+ *    1 if the CPU extension was in use before the call, 0 otherwise.
+ */
+int zrtpCksumUseAccel(int enable);
+
+/**
+ * Get the name of the CRC32C code in use.
+ *
+ * @return
+ *    "sse4.2" or "slice8".
+ */
+const char* zrtpCksumImpl();
+
 /**
  * @}
  */
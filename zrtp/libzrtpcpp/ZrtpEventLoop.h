@@ -0,0 +1,326 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPEVENTLOOP_H_
+#define _ZRTPEVENTLOOP_H_
+
+/**
+ * @file ZrtpEventLoop.h
+ * @brief Drive many ZRTP sessions from one event loop thread
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <vector>
+
+#include <libzrtpcpp/ZrtpCallback.h>
+
+class ZRtp;
+class ZrtpEventSession;
+
+/**
+ * Timers and output readiness of the ZRTP sessions of one event loop.
+ *
+ * The classic integration implements the ZrtpCallback timer and send
+ * functions synchronously: a timeout provider thread calls back into the
+ * engine and the synchEnter() and synchLeave() functions lock a mutex
+ * around each ZRTP event. This class and ZrtpEventSession provide another
+ * mode for applications that run an event loop (epoll, kqueue, io_uring):
+ *
+ * - the sessions queue their outgoing ZRTP packets, the loop fetches them
+ *   with nextReady() and sends them on its sockets,
+ * - the sessions store their timer requests in a heap of the loop, the loop
+ *   uses getTimeout() as poll timeout and calls processTimers() when it
+ *   wakes up,
+ * - on Linux the loop owns an eventfd. It becomes readable if a session has
+ *   output, thus the application adds it to its epoll set.
+ *
+ * The loop, its sessions and their ZRtp engines must run in one thread,
+ * then no locking is necessary. Applications with more threads use one loop
+ * per thread.
+ *
+ * The loop uses the millisecond clock of zrtpGetTickCount().
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpEventLoop {
+
+public:
+    /**
+     * A one-shot timer of the loop.
+     *
+     * ZrtpEventSession uses a timer for the ZRTP engine. Other clients, for
+     * example glue code that implements its own ZrtpCallback, derive from this
+     * class and use startTimer() and stopTimer().
+     */
+    class Timer {
+    public:
+        Timer(): timerLoop(nullptr), slot(0), timerId(0), deadline(0) {}
+        virtual ~Timer() {}
+
+        /// Called by processTimers() when the timer expired
+        virtual void timerExpired() = 0;
+
+        /// Time of the active timer, 0 if the timer is not active
+        uint64_t getDeadline() const { return timerId != 0 ? deadline : 0; }
+
+    private:
+        friend class ZrtpEventLoop;
+
+        ZrtpEventLoop* timerLoop;
+        uint32_t slot;
+        uint64_t timerId;           // 0: not active
+        uint64_t deadline;
+    };
+
+    ZrtpEventLoop();
+
+    /**
+     * Destructor closes the event fd. All sessions must be deleted before.
+     */
+    ~ZrtpEventLoop();
+
+    /**
+     * Get the pollable file descriptor of the loop.
+     *
+     * @return
+     *     The eventfd or -1 if the platform has no eventfd. The fd is
+     *     readable while sessions have output, see clearEvent().
+     */
+    int getEventFd() const { return eventFd; }
+
+    /**
+     * Reset the event fd after a wake up.
+     *
+     * The application calls this function after it fetched all output with
+     * nextReady(). The fd becomes readable again when a session queues
+     * the next packet.
+     */
+    void clearEvent();
+
+    /**
+     * Get the time until the next ZRTP timer expires.
+     *
+     * @param nowMs
+     *     The current time, see zrtpGetTickCount().
+     * @return
+     *     Milliseconds until the next timer, 0 if a timer is due, -1 if no
+     *     timer is active. The value fits as timeout of poll() and
+     *     epoll_wait().
+     */
+    int32_t getTimeout(uint64_t nowMs);
+
+    /**
+     * Get the time of the next ZRTP timer.
+     *
+     * @return
+     *     Time of the next timer in milliseconds, see zrtpGetTickCount(), or
+     *     0 if no timer is active.
+     */
+    uint64_t getNextDeadline();
+
+    /**
+     * Process all expired timers.
+     *
+     * Calls Timer::timerExpired() of each expired timer, for a session
+     * this calls ZRtp::processTimeout().
+     *
+     * @param nowMs
+     *     The current time, see zrtpGetTickCount().
+     * @return
+     *     Number of processed timers.
+     */
+    int32_t processTimers(uint64_t nowMs);
+
+    /**
+     * Get the next session that has output.
+     *
+     * The application sends all packets of the session, see
+     * ZrtpEventSession::frontPacket(). A session appears once in the list,
+     * and again after it queued new packets.
+     *
+     * @return
+     *     The session or @c NULL if no session has output.
+     */
+    ZrtpEventSession* nextReady();
+
+    /**
+     * Add a timer to this loop.
+     *
+     * @param timer
+     *     The timer, must not belong to another loop.
+     */
+    void attachTimer(Timer* timer);
+
+    /**
+     * Remove a timer from this loop, also stops it.
+     */
+    void detachTimer(Timer* timer);
+
+    /**
+     * Start or restart a timer.
+     *
+     * @param timer
+     *     The timer, the function attaches it if necessary.
+     * @param timeMs
+     *     Time until the timer expires in milliseconds.
+     */
+    void startTimer(Timer* timer, int32_t timeMs);
+
+    /**
+     * Stop a timer, does nothing if the timer is not active.
+     */
+    void stopTimer(Timer* timer) { timer->timerId = 0; }
+
+    /// Number of timers attached to this loop, each session has one
+    size_t getNumberOfTimers() const { return slots.size() - freeSlots.size(); }
+
+private:
+    friend class ZrtpEventSession;
+
+    ZrtpEventLoop(const ZrtpEventLoop& other) = delete;
+    ZrtpEventLoop& operator=(const ZrtpEventLoop& other) = delete;
+
+    struct TimerEntry {
+        uint64_t deadline;
+        uint64_t timerId;       // loop-wide unique, identifies the activation
+        uint32_t slot;
+    };
+
+    static bool laterTimer(const TimerEntry& a, const TimerEntry& b) { return a.deadline > b.deadline; }
+
+    void detach(ZrtpEventSession* session);
+    void markReady(ZrtpEventSession* session);
+    bool isValid(const TimerEntry& entry) const;
+    void popTimer();
+    void compactTimers();
+
+    std::vector<Timer*> slots;
+    std::vector<uint32_t> freeSlots;
+    std::vector<TimerEntry> timers;     // min heap, may contain cancelled timers
+    uint64_t lastTimerId;
+    ZrtpEventSession* readyHead;
+    ZrtpEventSession* readyTail;
+    bool signaled;
+    int eventFd;
+};
+
+/**
+ * ZRTP callback for the event loop mode.
+ *
+ * The class implements the transport, timer and synchronization functions
+ * of ZrtpCallback, see ZrtpEventLoop. An application derives its callback
+ * from this class and implements the remaining functions, for example
+ * srtpSecretsReady() and sendInfo().
+ *
+ * The session builds complete ZRTP packets: fixed header with sequence
+ * number, magic cookie and SSRC, the ZRTP message and the CRC. It stores
+ * them in one buffer that keeps its size, thus a session does not allocate
+ * memory for each packet.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpEventSession: public ZrtpCallback, public ZrtpEventLoop::Timer {
+
+public:
+    /**
+     * Create a session.
+     *
+     * @param loop
+     *     The event loop of this session.
+     * @param ssrc
+     *     The SSRC for the ZRTP packets of this session.
+     */
+    ZrtpEventSession(ZrtpEventLoop* loop, uint32_t ssrc);
+
+    /**
+     * Destructor removes the session from its loop.
+     *
+     * The application must stop or delete the ZRtp engine first.
+     */
+    virtual ~ZrtpEventSession();
+
+    /**
+     * Set the ZRTP engine of this session.
+     *
+     * The loop calls the engine's processTimeout() if a timer expires.
+     *
+     * @param engine
+     *     The engine, @c NULL removes the engine.
+     */
+    void setZrtpEngine(ZRtp* engine) { zrtpEngine = engine; }
+
+    /// Get the ZRTP engine of this session
+    ZRtp* getZrtpEngine() const { return zrtpEngine; }
+
+    /// Set the SSRC for the next ZRTP packets
+    void setSsrc(uint32_t ssrc) { localSsrc = ssrc; }
+
+    /// True if the session has queued ZRTP packets
+    bool hasOutput() const { return readOffset < output.size(); }
+
+    /**
+     * Get the oldest queued ZRTP packet.
+     *
+     * @param length
+     *     Gets the length of the packet.
+     * @return
+     *     Pointer to the complete ZRTP packet or @c NULL if no packet is
+     *     queued. The pointer is valid until the next call to popPacket()
+     *     or into the ZRtp engine.
+     */
+    const uint8_t* frontPacket(int32_t* length) const;
+
+    /**
+     * Remove the oldest queued ZRTP packet.
+     */
+    void popPacket();
+
+protected:
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length);
+    int32_t activateTimer(int32_t time);
+    int32_t cancelTimer();
+
+    // All calls run in the loop thread, no locking
+    void synchEnter() {}
+    void synchLeave() {}
+
+    /// Calls the engine's processTimeout()
+    void timerExpired();
+
+private:
+    friend class ZrtpEventLoop;
+
+    ZrtpEventSession(const ZrtpEventSession& other) = delete;
+    ZrtpEventSession& operator=(const ZrtpEventSession& other) = delete;
+
+    ZrtpEventLoop* loop;
+    ZRtp* zrtpEngine;
+    ZrtpEventSession* nextReady;
+    uint32_t localSsrc;
+    uint16_t sequence;
+    bool inReadyList;
+
+    // Queued packets, each a 2 byte length in host order and the packet
+    std::vector<uint8_t> output;
+    size_t readOffset;
+};
+
+/**
+ * @}
+ */
+#endif
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPMULTISTREAMGROUP_H_
+#define _ZRTPMULTISTREAMGROUP_H_
+
+/**
+ * @file ZrtpMultiStreamGroup.h
+ * @brief Start and track many multi-stream sessions of one master session
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZRtpPool.h>
+
+/**
+ * A group of multi-stream sessions that share one master session.
+ *
+ * A conference or SFU application may add many media streams to a call
+ * after the master stream reached secure state. Without this class the
+ * application gets the opaque parameter string from the master, copies it
+ * into each new engine and tracks the state of each engine on its own.
+ *
+ * The group creates all multi-stream engines in one call. The engines copy
+ * the negotiated algorithms and the ZRTP session key directly from the
+ * master stream, see ZRtp::setMultiStrMaster(). The group counts the
+ * engines that reached secure state or failed and reports to a listener
+ * when all engines are done. An application may also wait for this.
+ *
+ * Each engine still runs its own Commit/Confirm exchange with the peer, and
+ * its key derivation depends on the messages of this exchange. Thus the
+ * engines do their work in the threads that process their ZRTP packets and
+ * timers. Engines of one group may run in different threads.
+ *
+ * The group owns the engines. It deletes them, or returns them to a pool,
+ * in releaseStreams() or in its destructor. The master stream must exist
+ * as long as the group holds engines.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpMultiStreamGroup {
+
+public:
+    /**
+     * Receives the result of a group.
+     */
+    class Listener {
+    public:
+        virtual ~Listener() {}
+
+        /**
+         * All engines of the group are secure or failed.
+         *
+         * The group calls this function once in the thread that processed the
+         * last engine. The function must not delete the group.
+         *
+         * @param group
+         *     The group.
+         * @param secure
+         *     Number of engines in secure state.
+         * @param failed
+         *     Number of failed engines.
+         */
+        virtual void streamsDone(ZrtpMultiStreamGroup* group, size_t secure, size_t failed) = 0;
+    };
+
+    /**
+     * Create an empty group.
+     *
+     * @param master
+     *     The ZRTP master stream.
+     * @param pool
+     *     If not @c NULL the group takes its engines from this pool and
+     *     returns them to the pool.
+     */
+    ZrtpMultiStreamGroup(ZRtp* master, ZRtpPool* pool = NULL);
+
+    /**
+     * Destructor releases all engines.
+     */
+    ~ZrtpMultiStreamGroup();
+
+    /**
+     * Create multi-stream engines.
+     *
+     * The application calls this function once per group. The engines are
+     * ready to start, see startStreams().
+     *
+     * @param number
+     *     Number of engines.
+     * @param callbacks
+     *     Array of @c number callbacks, one for each engine.
+     * @param myZid
+     *     Pointer to the ZID of this client, same as for the master.
+     * @param id
+     *     The client id.
+     * @param config
+     *     The configuration, usually the configuration of the master.
+     * @return
+     *     Number of engines created. Zero if the master stream is not in
+     *     secure state or the group already has engines.
+     */
+    size_t createStreams(size_t number, ZrtpCallback* const* callbacks, uint8_t* myZid, const std::string& id,
+                         ZrtpConfigure* config);
+
+    /**
+     * Start all engines of the group.
+     *
+     * Calls ZRtp::startZrtpEngine() for each engine in the calling thread.
+     * Applications that start the engines in their own threads use
+     * getStream() instead.
+     */
+    void startStreams();
+
+    /**
+     * Stop, delete or return all engines to the pool.
+     *
+     * The callbacks of the engines must be valid during this call, the
+     * engines may cancel their timers. The application must not use the
+     * engines after this call and no other thread may process packets or
+     * timers of the engines during this call. The group is empty afterwards
+     * and the application may create new engines.
+     */
+    void releaseStreams();
+
+    /**
+     * Get an engine of the group.
+     *
+     * @param index
+     *     Index of the engine, the same as the index of its callback.
+     * @return
+     *     The engine or @c NULL if the index is not valid.
+     */
+    ZRtp* getStream(size_t index);
+
+    /// Number of engines in the group
+    size_t getNumberOfStreams();
+
+    /// Number of engines in secure state
+    size_t getSecureStreams();
+
+    /// Number of failed engines
+    size_t getFailedStreams();
+
+    /// True if all engines are secure or failed
+    bool isDone();
+
+    /**
+     * Wait until all engines are secure or failed.
+     *
+     * @param timeoutMs
+     *     Maximum time to wait in milliseconds.
+     * @return
+     *     True if all engines are done, false on timeout.
+     */
+    bool waitDone(int32_t timeoutMs);
+
+    /**
+     * Set the listener of the group.
+     *
+     * @param listener
+     *     The listener or @c NULL. The listener must exist as long as the
+     *     group.
+     */
+    void setListener(Listener* listener);
+
+private:
+    friend class ZRtp;
+
+    ZrtpMultiStreamGroup(const ZrtpMultiStreamGroup& other) = delete;
+    ZrtpMultiStreamGroup& operator=(const ZrtpMultiStreamGroup& other) = delete;
+
+    enum StreamState {
+        Running = 0,
+        Secure,
+        Failed
+    };
+
+    /**
+     * Called by an engine of this group when it reached secure state or failed.
+     */
+    void streamDone(size_t index, bool secure);
+
+    ZRtp* master;
+    ZRtpPool* pool;
+    Listener* listener;
+
+    std::mutex lock;
+    std::condition_variable done;
+    std::vector<ZRtp*> streams;
+    std::vector<uint8_t> states;
+    size_t secureCount;
+    size_t failedCount;
+};
+
+/**
+ * @}
+ */
+#endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPNONCESET_H_
+#define _ZRTPNONCESET_H_
+
+/**
+ * @file ZrtpNonceSet.h
+ * @brief Set of the multi-stream nonces a ZRTP session has seen
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+#include <common/osSpecifics.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+
+/**
+ * A set of multi-stream nonces.
+ *
+ * RFC 6189, chapter 4.4.3.1, requires that a ZRTP endpoint rejects a
+ * multi-stream Commit if its nonce was already used in the same ZRTP
+ * session. The master stream owns one set, all its multi-stream sessions
+ * check and add their peer's nonce to this set.
+ *
+ * The set is a hash table with open addressing that stores the 16 byte
+ * nonces inline. A check and add costs one hash and usually one probe. The
+ * table starts small and doubles its size until it reaches the size for the
+ * configured maximum number of nonces. If the set is full it rejects new
+ * nonces: removing old nonces would allow a peer to reuse them.
+ *
+ * The hash uses a random per-set seed, thus a peer cannot select nonces that
+ * collide in the table.
+ *
+ * All methods are thread safe, multi-stream sessions may run in other threads
+ * than their master stream.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpNonceSet {
+
+public:
+    /// Length of a nonce in bytes
+    static const size_t nonceLength = 16;
+
+    /// Result of checkAndAdd()
+    enum Result {
+        Added = 0,          //!< Nonce was not in the set and is now stored
+        Seen,               //!< Nonce is already in the set
+        Full                //!< Nonce is not in the set but the set is full
+    };
+
+    /**
+     * Create an empty set.
+     *
+     * @param maxNonces
+     *     Maximum number of nonces the set stores.
+     */
+    ZrtpNonceSet(uint32_t maxNonces = ZRTP_DEFAULT_MAX_NONCES);
+
+    ~ZrtpNonceSet();
+
+    /**
+     * Check if a nonce is in the set and add it if not.
+     *
+     * @param nonce
+     *     Points to the nonce, @c nonceLength bytes.
+     * @return
+     *     The result, only @c Added accepts the nonce.
+     */
+    Result checkAndAdd(const uint8_t* nonce);
+
+    /**
+     * Remove all nonces and free the table.
+     */
+    void clear();
+
+    /**
+     * Set the maximum number of nonces.
+     *
+     * A smaller value does not remove nonces, the set just does not accept
+     * new nonces until it holds less than the maximum number.
+     */
+    void setMaxNonces(uint32_t maxNonces);
+
+    /// Number of nonces in the set
+    size_t size();
+
+    /// Size of the table in bytes
+    size_t getMemorySize();
+
+private:
+    ZrtpNonceSet(const ZrtpNonceSet& other) = delete;
+    ZrtpNonceSet& operator=(const ZrtpNonceSet& other) = delete;
+
+    struct Entry {
+        uint64_t words[2];
+    };
+
+    uint64_t hash(const Entry& nonce) const;
+    bool grow();
+    void insert(const Entry& nonce, uint64_t h);
+
+    std::mutex lock;
+    Entry* entries;
+    uint8_t* tags;          // 0: empty slot, otherwise 0x80 | 7 bits of the nonce hash
+    uint32_t capacity;      // number of slots, a power of 2
+    uint32_t count;
+    uint32_t maxNonces;
+    uint64_t seed;
+};
+
+/**
+ * @}
+ */
+#endif
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPPACKETCLASSIFIER_H_
+#define _ZRTPPACKETCLASSIFIER_H_
+
+/**
+ * @file ZrtpPacketClassifier.h
+ * @brief Classify received packets as RTP, ZRTP or junk
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include <common/osSpecifics.h>
+
+/**
+ * @brief A copy of the classifier counters.
+ */
+typedef struct _ZrtpPacketCounters {
+    uint64_t rtpPackets;        ///< Packets with RTP version 2, RTP or SRTP
+    uint64_t zrtpPackets;       ///< ZRTP packets with a valid CRC
+    uint64_t junkPackets;       ///< Packets that failed the checks before the CRC
+    uint64_t crcErrors;         ///< ZRTP packets with a wrong CRC
+} ZrtpPacketCounters;
+
+/**
+ * Classify packets received on a media port.
+ *
+ * RTP, SRTP and ZRTP packets share the media port. On public ports most
+ * other traffic is junk from scanners. The classifier checks the cheap
+ * parts of a ZRTP packet before it computes the CRC:
+ *
+ * - the first byte is 0x1X, as ZRTP specifies (RTP version 0),
+ * - the magic cookie replaces the RTP timestamp,
+ * - the ZRTP message starts with the id 0x505a,
+ * - the message type is one of the ZRTP message types,
+ * - the length field matches the packet length and the length of the type.
+ *
+ * Only packets that pass all checks pay for the CRC. The checks do not
+ * apply to ZRTP tunneled in SRTP, its length covers the SRTP tag.
+ *
+ * Each client stream owns a classifier. The counters have one writer at a
+ * time, the receive thread of the stream, thus they use relaxed atomic
+ * loads and stores. Other threads may read the counters at any time.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpPacketClassifier {
+
+public:
+    /// Class of a received packet
+    enum PacketClass {
+        RtpPacket = 0,      ///< RTP version 2, RTP or SRTP
+        ZrtpPacket,         ///< ZRTP packet, the CRC is valid if checked
+        JunkPacket,         ///< Neither RTP nor ZRTP, drop without further work
+        CrcErrorPacket,     ///< ZRTP packet with a wrong CRC
+        numberOfClasses
+    };
+
+    ZrtpPacketClassifier();
+
+    /**
+     * Classify a packet without computing the CRC.
+     *
+     * The function does not count the packet.
+     *
+     * @param packet
+     *     The packet, starting with the RTP header.
+     * @param length
+     *     Length of the packet in bytes.
+     * @return
+     *     RtpPacket, ZrtpPacket or JunkPacket.
+     */
+    static PacketClass classify(const uint8_t* packet, size_t length);
+
+    /**
+     * Classify a packet and check the CRC of a ZRTP packet.
+     *
+     * @param packet
+     *     The packet, starting with the RTP header.
+     * @param length
+     *     Length of the packet in bytes.
+     * @return
+     *     The PacketClass, counted in the counters.
+     */
+    PacketClass check(const uint8_t* packet, size_t length);
+
+    /**
+     * Classify several packets and check the CRC of the ZRTP packets.
+     *
+     * The function updates the counters once for all packets.
+     *
+     * @param packets
+     *     The packets, starting with the RTP header.
+     * @param lengths
+     *     The lengths of the packets in bytes.
+     * @param count
+     *     Number of packets.
+     * @param classes
+     *     Gets the PacketClass of each packet.
+     * @return
+     *     Number of RTP and valid ZRTP packets, the other packets are junk.
+     */
+    size_t checkBatch(const uint8_t* const* packets, const size_t* lengths, size_t count, PacketClass* classes);
+
+    /// Get the counters
+    ZrtpPacketCounters getCounters() const;
+
+    /// Set all counters to zero
+    void resetCounters();
+
+private:
+    ZrtpPacketClassifier(const ZrtpPacketClassifier& other) = delete;
+    ZrtpPacketClassifier& operator=(const ZrtpPacketClassifier& other) = delete;
+
+    static PacketClass checkCrc(const uint8_t* packet, size_t length);
+
+    void addCount(PacketClass packetClass, uint64_t n) {
+        counters[packetClass].store(counters[packetClass].load(std::memory_order_relaxed) + n,
+                                    std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> counters[numberOfClasses];
+};
+
+/**
+ * @}
+ */
+#endif
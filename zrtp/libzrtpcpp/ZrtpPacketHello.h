@@ -81,6 +81,19 @@ class __EXPORT ZrtpPacketHello : public ZrtpPacketBase {
      */
     void configureHello(ZrtpConfigure* config);
 
+    /**
+     * Populate Hello message data from a Hello template.
+     *
+     * Copies the algorithm names, the length and all offsets of a Hello
+     * packet that an application configured with configureHello() before.
+     * Use this instead of configureHello(ZrtpConfigure*) to avoid building the
+     * same Hello data again, refer to ZrtpConfigure::getHelloTemplate().
+     *
+     * @param helloTemplate
+     *    A configured Hello packet.
+     */
+    void configureHello(const ZrtpPacketHello& helloTemplate);
+
     /// Get version number from Hello message, fixed ASCII character array
     uint8_t* getVersion()  { return helloHeader->version; };
 
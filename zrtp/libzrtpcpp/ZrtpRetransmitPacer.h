@@ -0,0 +1,191 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPRETRANSMITPACER_H_
+#define _ZRTPRETRANSMITPACER_H_
+
+/**
+ * @file ZrtpRetransmitPacer.h
+ * @brief Process-wide pacing of ZRTP retransmissions
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+#include <common/osSpecifics.h>
+
+/**
+ * Spread and limit the ZRTP retransmissions of all engines of a process.
+ *
+ * If many calls restart ZRTP at the same time, for example after a network
+ * outage, all state engines start their T1 and T2 timers in the same
+ * millisecond. Their retransmissions then arrive in bursts that overflow
+ * socket buffers, which causes more retransmissions. The pacer prevents
+ * this in two ways:
+ *
+ * - Jitter: each state engine adds a random part, up to a percentage of
+ *   the timeout, to each T1 and T2 timeout. The engines drift apart after
+ *   the first retransmissions.
+ * - Token bucket: each retransmission needs a token of a process-wide
+ *   bucket. If no token is available the engine reserves the next token
+ *   and starts its timer with the time until the bucket provides it.
+ *   Engines close to SecureState may overdraw the bucket, thus they pass
+ *   while engines that send Hello packets wait.
+ *
+ * The delay of one retransmission is bounded. If a Hello retransmission
+ * would wait longer than the maximum delay the engine suppresses it and
+ * continues with its next timeout, as if the packet was lost. Other
+ * packets are sent after the maximum delay in any case.
+ *
+ * The pacer does not delay the first transmission of a packet. It is off
+ * by default, then the engines use the timeouts of the ZRTP specification.
+ * All methods are thread safe.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpRetransmitPacer {
+
+public:
+    /// Decision of acquire()
+    enum Decision {
+        Send = 0,           ///< Send the retransmission now
+        Delay,              ///< Try again after the returned delay
+        Suppress            ///< Skip this retransmission
+    };
+
+    /// Priority of a retransmission, higher values are closer to SecureState
+    enum Priority {
+        HelloPriority = 0,  ///< Hello packets
+        CommitPriority,     ///< Commit, DHPart, Error and other packets
+        ConfirmPriority,    ///< Confirm1 and DHPart2
+        FinalPriority,      ///< Confirm2, the last packet before SecureState
+        numberOfPriorities
+    };
+
+    /// Counters of the pacer
+    struct Counters {
+        uint64_t sent;          ///< Retransmissions that got a token without delay
+        uint64_t delayed;       ///< Retransmissions that waited for their token
+        uint64_t suppressed;    ///< Hello retransmissions skipped after the maximum delay
+        uint64_t forced;        ///< Other retransmissions sent after the maximum delay
+    };
+
+    ZrtpRetransmitPacer();
+
+    /**
+     * Set the token bucket.
+     *
+     * @param packetsPerSecond
+     *     Rate of retransmissions of the process, 0 disables the bucket.
+     * @param burst
+     *     Size of the bucket in packets.
+     */
+    void setRate(int32_t packetsPerSecond, int32_t burst);
+
+    /**
+     * Set the timer jitter.
+     *
+     * @param percent
+     *     Maximum random part of a timeout in percent of the timeout, 0
+     *     disables the jitter, at most 50.
+     */
+    void setJitter(int32_t percent);
+
+    /**
+     * Set the maximum delay of one retransmission in milliseconds.
+     */
+    void setMaxDelay(int32_t ms);
+
+    /**
+     * Set the clock of the pacer.
+     *
+     * Simulations use a virtual clock. The default is zrtpGetTickCount().
+     *
+     * @param clock
+     *     Function that returns the time in milliseconds, @c NULL restores
+     *     the default.
+     */
+    void setClock(uint64_t (*clock)());
+
+    /// True if the bucket or the jitter is enabled
+    bool isActive() const { return active.load(std::memory_order_relaxed); }
+
+    /**
+     * Add the jitter to a timeout.
+     *
+     * @param timeMs
+     *     The timeout of the ZRTP timer.
+     * @param seed
+     *     Random state of the state engine, updated.
+     * @return
+     *     The timeout plus a random part.
+     */
+    int32_t jitterTime(int32_t timeMs, uint32_t* seed) const;
+
+    /**
+     * Get a token for a retransmission.
+     *
+     * @param priority
+     *     The Priority of the packet.
+     * @param delayedMs
+     *     Time the retransmission was delayed already. A delayed
+     *     retransmission reserved its token, the function returns @c Send.
+     * @param delayMs
+     *     Gets the delay if the function returns @c Delay.
+     * @return
+     *     The Decision.
+     */
+    Decision acquire(int32_t priority, int32_t delayedMs, int32_t* delayMs);
+
+    /// Get the counters
+    Counters getCounters() const;
+
+    /// Set all counters to zero
+    void resetCounters();
+
+    /**
+     * Get the process-wide pacer that the state engines use.
+     */
+    static ZrtpRetransmitPacer& getInstance();
+
+private:
+    ZrtpRetransmitPacer(const ZrtpRetransmitPacer& other) = delete;
+    ZrtpRetransmitPacer& operator=(const ZrtpRetransmitPacer& other) = delete;
+
+    static uint32_t nextRandom(uint32_t* seed);
+
+    std::mutex lock;
+    std::atomic<bool> active;
+    uint64_t (*getTime)();
+    int64_t interval;           // time between two tokens in microseconds, 0: no bucket
+    int64_t tolerance;          // burst, in microseconds
+    int64_t nextSlot;           // time of the next free token in microseconds
+    std::atomic<int32_t> jitterPercent;
+    int32_t maxDelay;
+
+    std::atomic<uint64_t> sent;
+    std::atomic<uint64_t> delayed;
+    std::atomic<uint64_t> suppressed;
+    std::atomic<uint64_t> forced;
+};
+
+/**
+ * @}
+ */
+#endif
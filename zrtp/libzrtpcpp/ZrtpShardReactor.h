@@ -0,0 +1,249 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPSHARDREACTOR_H_
+#define _ZRTPSHARDREACTOR_H_
+
+/**
+ * @file ZrtpShardReactor.h
+ * @brief Run ZRTP sessions on a fixed set of shard threads
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <libzrtpcpp/ZrtpEventLoop.h>
+#include <libzrtpcpp/ZrtpSpscRing.h>
+
+/**
+ * Function that runs in a shard thread, see ZrtpShardReactor::post().
+ */
+typedef void (*ZrtpShardTask)(void* context, void* data);
+
+/**
+ * Handle of a thread that posts tasks to the shards.
+ *
+ * A producer owns one single producer ring per shard, thus only one thread
+ * may use a producer. Each RTP receive or send thread of an application
+ * creates its own producer, see ZrtpShardReactor::createProducer().
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpShardProducer {
+
+public:
+    struct Task {
+        ZrtpShardTask function;
+        void* context;
+        void* data;
+    };
+
+    typedef ZrtpSpscRing<Task> Ring;
+
+private:
+    friend class ZrtpShardReactor;
+
+    ZrtpShardProducer() {}
+    ZrtpShardProducer(const ZrtpShardProducer& other) = delete;
+    ZrtpShardProducer& operator=(const ZrtpShardProducer& other) = delete;
+
+    std::vector<std::unique_ptr<Ring> > rings;      // index is the shard
+};
+
+/**
+ * A set of event loop threads, each owns a part of the sessions.
+ *
+ * The classic tivi integration runs the ZRTP timers in one global timeout
+ * thread and locks a mutex of the stream for each ZRTP event and each RTP
+ * packet that the application threads hand over. The reactor instead pins
+ * each session to one shard:
+ *
+ * - each shard has a thread and a ZrtpEventLoop, the timers of the shard's
+ *   sessions use this loop,
+ * - the application threads post their work, for example a received RTP
+ *   packet, with post() into a lock-free ring of the session's shard,
+ * - the shard thread runs the tasks, the timers and the output of its
+ *   ZrtpEventSession instances.
+ *
+ * All code of one session runs in the shard thread, thus the sessions do
+ * not need locks. A session must not call into a session of another shard.
+ *
+ * A shard thread sleeps on a condition variable if it has no work. A
+ * producer signals it only if the shard sleeps, thus a busy shard does not
+ * see system calls for new tasks.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpShardReactor {
+
+public:
+    /// Maximum number of producers of a reactor
+    static const int32_t maxProducers = 64;
+
+    /**
+     * Function that sends the output of a session, see setReadyHandler().
+     */
+    typedef void (*ReadyHandler)(ZrtpEventSession* session, void* userData);
+
+    /**
+     * Create a reactor, start() starts the shard threads.
+     *
+     * @param shards
+     *     Number of shards, usually the number of cores.
+     * @param ringSize
+     *     Size of each ring between a producer and a shard.
+     * @param pinThreads
+     *     If true bind shard @c n to core @c n modulo the number of cores,
+     *     only on Linux.
+     */
+    ZrtpShardReactor(int32_t shards, size_t ringSize = 4096, bool pinThreads = false);
+
+    /**
+     * Destructor stops the threads.
+     */
+    ~ZrtpShardReactor();
+
+    /**
+     * Start the shard threads.
+     */
+    void start();
+
+    /**
+     * Stop the shard threads.
+     *
+     * The threads run the tasks that are still in the rings before they
+     * terminate.
+     */
+    void stop();
+
+    /// Number of shards of this reactor
+    int32_t getNumberOfShards() const { return static_cast<int32_t>(shards.size()); }
+
+    /**
+     * Compute a shard for a session.
+     *
+     * @param key
+     *     A value that identifies the session, for example the SSRC or the
+     *     address of the session object.
+     * @return
+     *     The shard number.
+     */
+    int32_t selectShard(uint64_t key) const;
+
+    /**
+     * Get the event loop of a shard.
+     *
+     * The sessions of the shard create their timers and ZrtpEventSession
+     * instances with this loop. Only the shard thread may use the loop
+     * after start().
+     */
+    ZrtpEventLoop* getEventLoop(int32_t shard) { return &shards[shard]->loop; }
+
+    /**
+     * Check if the calling thread is the thread of a shard.
+     */
+    bool isShardThread(int32_t shard) const;
+
+    /**
+     * Create a producer for the calling thread.
+     *
+     * The reactor owns the producer. An application creates its producers
+     * during setup, the function locks a mutex.
+     *
+     * @return
+     *     The producer or @c NULL if the reactor has maxProducers producers.
+     */
+    ZrtpShardProducer* createProducer();
+
+    /**
+     * Run a function in a shard thread.
+     *
+     * @param producer
+     *     The producer of the calling thread.
+     * @param shard
+     *     The shard that runs the function.
+     * @param function
+     *     The function.
+     * @param context
+     *     First argument of the function, usually the session.
+     * @param data
+     *     Second argument of the function, for example a packet.
+     * @return
+     *     False if the ring of the shard is full. The caller may drop the
+     *     work or post it again later.
+     */
+    bool post(ZrtpShardProducer* producer, int32_t shard, ZrtpShardTask function, void* context, void* data);
+
+    /**
+     * Set the function that sends the output of ZrtpEventSession instances.
+     *
+     * The shard thread calls the function for each session of its loop that
+     * has queued ZRTP packets. Set the handler before start().
+     */
+    void setReadyHandler(ReadyHandler handler, void* userData) {
+        readyHandler = handler;
+        readyUserData = userData;
+    }
+
+private:
+    ZrtpShardReactor(const ZrtpShardReactor& other) = delete;
+    ZrtpShardReactor& operator=(const ZrtpShardReactor& other) = delete;
+
+    struct Shard {
+        Shard(): numRings(0), sleeping(false), running(false) {
+            for (int32_t i = 0; i < maxProducers; i++)
+                rings[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        ZrtpEventLoop loop;
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable wakeup;
+
+        // Rings of the producers, a producer publishes its ring by
+        // incrementing numRings
+        std::atomic<ZrtpShardProducer::Ring*> rings[maxProducers];
+        std::atomic<int32_t> numRings;
+        std::atomic<bool> sleeping;
+        std::atomic<bool> running;
+    };
+
+    void run(int32_t shard);
+    int32_t runTasks(Shard* shard);
+    bool hasTasks(Shard* shard);
+    void sendOutput(Shard* shard);
+
+    std::vector<std::unique_ptr<Shard> > shards;
+    std::vector<std::unique_ptr<ZrtpShardProducer> > producers;
+    std::mutex producerLock;
+    size_t ringSize;
+    bool pinThreads;
+    bool started;
+    ReadyHandler readyHandler;
+    void* readyUserData;
+};
+
+/**
+ * @}
+ */
+#endif
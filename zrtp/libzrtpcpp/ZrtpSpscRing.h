@@ -0,0 +1,130 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPSPSCRING_H_
+#define _ZRTPSPSCRING_H_
+
+/**
+ * @file ZrtpSpscRing.h
+ * @brief Lock-free single producer, single consumer ring buffer
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+/**
+ * Bounded ring buffer for exactly one producer and one consumer thread.
+ *
+ * The producer only writes the tail index, the consumer only writes the head
+ * index. Both sides keep a private copy of the other index and read the
+ * shared one only if the copy says the ring is full or empty. Thus a push or
+ * pop usually touches one shared cache line.
+ *
+ * The capacity is a power of two, the constructor rounds up.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+template <class T>
+class ZrtpSpscRing {
+
+public:
+    /**
+     * Create a ring.
+     *
+     * @param capacity
+     *     Minimum number of elements, rounded up to a power of two.
+     */
+    explicit ZrtpSpscRing(size_t capacity): head(0), cachedTail(0), tail(0), cachedHead(0) {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        elements.resize(size);
+        mask = size - 1;
+    }
+
+    /**
+     * Add an element, producer thread only.
+     *
+     * @return
+     *     False if the ring is full.
+     */
+    bool push(const T& element) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask)
+                return false;
+        }
+        elements[t & mask] = element;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Remove the oldest element, consumer thread only.
+     *
+     * @return
+     *     False if the ring is empty.
+     */
+    bool pop(T& element) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail)
+                return false;
+        }
+        element = elements[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// True if the ring is empty, exact in the consumer thread only
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    /// Number of elements the ring can hold
+    size_t getCapacity() const { return mask + 1; }
+
+private:
+    ZrtpSpscRing(const ZrtpSpscRing& other) = delete;
+    ZrtpSpscRing& operator=(const ZrtpSpscRing& other) = delete;
+
+    // Padding keeps the consumer and producer fields on separate cache
+    // lines, also if operator new does not honor alignas (before C++17)
+    std::vector<T> elements;
+    size_t mask;
+    char padding0[64];
+
+    // Consumer side
+    std::atomic<size_t> head;
+    size_t cachedTail;
+    char padding1[64];
+
+    // Producer side
+    std::atomic<size_t> tail;
+    size_t cachedHead;
+    char padding2[64];
+};
+
+/**
+ * @}
+ */
+#endif
@@ -175,16 +175,39 @@ private:
     
     int32_t retryCounters[ErrorRetry+1];  // TODO adjust
 
+    /**
+     * Time the retransmission pacer delayed the current resend.
+     */
+    int32_t pacingDelayed;
+
+    /**
+     * Random state for the jitter of the retransmission pacer.
+     */
+    uint32_t pacingSeed;
+
 public:
     /// Create a ZrtpStateClass
     ZrtpStateClass(ZRtp *p);
     ~ZrtpStateClass();
 
+    /**
+     * Reset the state engine to its initial values.
+     *
+     * Closes the protocol engine if it is not in Initial state, switches to
+     * Initial state and resets all counters and timers to the values the
+     * constructor sets. Does not allocate memory.
+     */
+    void reset();
+
     /// Check if in a specified state
     bool inState(const int32_t state) { return engine->inState(state); };
 
     /// Switch to the specified state
-    void nextState(int32_t state)        { engine->nextState(state); };
+    void nextState(int32_t state)        {
+        engine->nextState(state);
+        if (ZrtpTrace::isEnabled())
+            ZrtpTrace::enterState(&parent->traceInfo, state);
+    };
 
     /// Process an event, the main entry point into the state engine
     void processEvent(Event *ev);
@@ -256,6 +279,25 @@ public:
      */
     int32_t nextTimer(zrtpTimer_t *t);
 
+    /**
+     * Add the jitter of the retransmission pacer to a timeout.
+     */
+    int32_t jitterTime(int32_t time);
+
+    /**
+     * Ask the retransmission pacer if a timer event may resend the packet.
+     *
+     * If the pacer delays the resend the function starts the timer with the
+     * delay.
+     *
+     * @return
+     *    ZrtpRetransmitPacer::Send to resend the packet,
+     *    ZrtpRetransmitPacer::Delay if the timer was restarted, the caller
+     *    just returns, ZrtpRetransmitPacer::Suppress to skip the resend and
+     *    continue with nextTimer()
+     */
+    int32_t paceResend();
+
     /**
      * Cancel the active timer.
      *
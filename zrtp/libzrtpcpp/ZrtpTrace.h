@@ -0,0 +1,197 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPTRACE_H_
+#define _ZRTPTRACE_H_
+
+/**
+ * @file ZrtpTrace.h
+ * @brief Per-session ZRTP handshake latency tracing
+ *
+ * The trace records monotonic timestamps when the ZRTP state engine enters
+ * a state for the first time, the accumulated duration of the expensive
+ * crypto operations, and the number of retransmissions. In addition all
+ * sessions feed process-wide histograms that an application can read to
+ * get an aggregated view of the handshake latencies.
+ *
+ * Tracing is off by default. If it is off the engine only performs a
+ * relaxed atomic load at each trace point.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <atomic>
+
+#include <common/osSpecifics.h>
+
+/**
+ * The traced crypto operations.
+ *
+ * Keep in sync with the defines in ZrtpCWrapper.h
+ */
+enum ZrtpTraceOps {
+    TraceDhKeyGen = 0,          ///< Create DH context and compute public key
+    TraceDhCompute,             ///< Compute the DH shared secret, includes public key check
+    TraceCacheRead,             ///< Read a ZID record from the cache
+    TraceCacheWrite,            ///< Write a ZID record to the cache
+    TraceKdf,                   ///< Key derivation, s0 and all SRTP keys
+    numberOfTraceOps
+};
+
+/**
+ * The process-wide histograms.
+ *
+ * The first histograms are the crypto operations, followed by the
+ * time from engine start until the engine reaches the secure state.
+ */
+enum ZrtpTraceHistograms {
+    TraceSetupTime = numberOfTraceOps,  ///< Start of engine until secure state
+    numberOfTraceHistograms
+};
+
+/** Number of states the trace records, must match @c numberOfStates in ZrtpStateClass.h */
+#define ZRTP_TRACE_STATES      13
+
+/** Index of the secure state, must match @c SecureState in ZrtpStateClass.h */
+#define ZRTP_TRACE_SECURE      11
+
+/**
+ * Number of buckets of a histogram.
+ *
+ * Bucket 0 counts durations below 1 microsecond, bucket @c n counts durations
+ * between 2^(n-1) and 2^n microseconds. The last bucket counts all longer durations.
+ */
+#define ZRTP_TRACE_BUCKETS     32
+
+/**
+ * The trace data of one ZRTP session.
+ *
+ * All times are in nanoseconds. Keep in sync with the structure in ZrtpCWrapper.h
+ */
+typedef struct _zrtpTraceInfo {
+    int64_t startTime;                          ///< Monotonic time the engine started, 0 if not traced
+    int64_t stateEntered[ZRTP_TRACE_STATES];    ///< Time relative to start when state was entered first, -1 if never
+    int64_t opTime[numberOfTraceOps];           ///< Accumulated time of each crypto operation
+    int32_t opCount[numberOfTraceOps];          ///< Number of calls of each crypto operation
+    int32_t retransmits;                        ///< Total number of packet retransmissions
+} zrtpTraceInfo;
+
+/**
+ * Static functions to control tracing and to access the histograms.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpTrace {
+
+public:
+    /**
+     * @brief Switch tracing on or off.
+     *
+     * The setting is process-wide and applies to sessions that start after
+     * this call. Sessions that already run keep their state.
+     */
+    static void setEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+
+    /**
+     * @brief Check if tracing is on.
+     */
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Return current monotonic time in nanoseconds.
+     */
+    static int64_t now();
+
+    /**
+     * @brief Initialize the trace data of a session.
+     *
+     * Sets the start time and marks the Initial state as entered if tracing
+     * is on, otherwise clears the start time to disable tracing for this session.
+     */
+    static void start(zrtpTraceInfo* info);
+
+    /**
+     * @brief Record the first entry into a state.
+     *
+     * If the state is the secure state then record the setup time in the
+     * histogram.
+     */
+    static void enterState(zrtpTraceInfo* info, int32_t state);
+
+    /**
+     * @brief Add the duration of a crypto operation to the session and the histogram.
+     */
+    static void addOp(zrtpTraceInfo* info, ZrtpTraceOps op, int64_t duration);
+
+    /**
+     * @brief Copy a process-wide histogram.
+     *
+     * @param histogram index of the histogram, a ZrtpTraceOps value or @c TraceSetupTime
+     * @param buckets pointer to an array that gets the bucket counts
+     * @param size number of elements of @c buckets, at most ZRTP_TRACE_BUCKETS are used
+     * @return number of buckets copied or -1 if the histogram index is invalid
+     */
+    static int32_t getHistogram(int32_t histogram, uint64_t* buckets, int32_t size);
+
+    /**
+     * @brief Clear all process-wide histograms.
+     */
+    static void resetHistograms();
+
+private:
+    static std::atomic<bool> enabled;
+    static std::atomic<uint64_t> histograms[numberOfTraceHistograms][ZRTP_TRACE_BUCKETS];
+
+    static void addToHistogram(int32_t histogram, int64_t duration);
+};
+
+/**
+ * Measure a crypto operation of a session.
+ *
+ * Create an instance on the stack before the operation, the destructor adds
+ * the elapsed time to the trace. If tracing is off, or was off when the
+ * session started, the instance does nothing.
+ */
+class ZrtpTraceTimer {
+
+public:
+    ZrtpTraceTimer(zrtpTraceInfo& info, ZrtpTraceOps op): traceInfo(nullptr), operation(op), startTime(0) {
+        if (ZrtpTrace::isEnabled() && info.startTime != 0) {
+            traceInfo = &info;
+            startTime = ZrtpTrace::now();
+        }
+    }
+
+    ~ZrtpTraceTimer() {
+        if (traceInfo != nullptr)
+            ZrtpTrace::addOp(traceInfo, operation, ZrtpTrace::now() - startTime);
+    }
+
+private:
+    ZrtpTraceTimer(const ZrtpTraceTimer& other) = delete;
+    ZrtpTraceTimer& operator=(const ZrtpTraceTimer& other) = delete;
+
+    zrtpTraceInfo* traceInfo;
+    ZrtpTraceOps operation;
+    int64_t startTime;
+};
+
+/**
+ * @}
+ */
+#endif
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPWORKERPOOL_H_
+#define _ZRTPWORKERPOOL_H_
+
+/**
+ * @file ZrtpWorkerPool.h
+ * @brief Threads that process ZRTP messages for the RTP receive threads
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <common/osSpecifics.h>
+
+/**
+ * Function that runs in a worker thread, see ZrtpWorkerPool::post().
+ */
+typedef void (*ZrtpWorkerTask)(void* context, void* data);
+
+/**
+ * A set of threads shared by many streams to process ZRTP messages.
+ *
+ * The clients process a received ZRTP message in the RTP receive thread.
+ * The DH computations of DHPart1 and DHPart2 then block the reception of
+ * RTP on this stream for milliseconds. With a pool the receive thread posts
+ * the message and continues with the next packet.
+ *
+ * Each stream owns a Strand. The pool runs the tasks of one strand in the
+ * order of post() and never two of them at the same time, thus the ZRTP
+ * messages of a stream keep their order. Tasks of different strands run in
+ * parallel. ZRTP messages are rare compared to RTP packets, one mutex
+ * protects all queues of the pool.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpWorkerPool {
+
+public:
+    /**
+     * The task queue of one stream.
+     *
+     * A stream must call ZrtpWorkerPool::drain() before it deletes its
+     * strand or the objects that its tasks use.
+     */
+    class Strand {
+    public:
+        Strand(): scheduled(false) {}
+
+    private:
+        friend class ZrtpWorkerPool;
+
+        struct Item {
+            ZrtpWorkerTask function;
+            void* context;
+            void* data;
+        };
+
+        std::deque<Item> items;
+        bool scheduled;         // in the ready queue or a worker runs a task
+    };
+
+    /**
+     * Create a pool and start its threads.
+     *
+     * @param threads
+     *     Number of worker threads, at least 1.
+     */
+    explicit ZrtpWorkerPool(int32_t threads);
+
+    /**
+     * Destructor runs the queued tasks and stops the threads.
+     */
+    ~ZrtpWorkerPool();
+
+    /**
+     * Run a function in a worker thread.
+     *
+     * @param strand
+     *     The strand of the stream.
+     * @param function
+     *     The function.
+     * @param context
+     *     First argument of the function, usually the stream.
+     * @param data
+     *     Second argument of the function, for example a packet.
+     */
+    void post(Strand* strand, ZrtpWorkerTask function, void* context, void* data);
+
+    /**
+     * Wait until the strand has no queued or running tasks.
+     *
+     * A task must not drain its own strand, see runsStrand().
+     */
+    void drain(Strand* strand);
+
+    /**
+     * Check if the calling thread runs a task of the strand.
+     *
+     * Callbacks that a task may trigger use this to defer work that must
+     * not run in a pool thread, for example a drain() of the strand.
+     *
+     * @param strand
+     *     The strand of the stream.
+     * @return
+     *     True if called inside a task of this strand.
+     */
+    static bool runsStrand(const Strand* strand);
+
+    /// Number of worker threads
+    int32_t getNumberOfThreads() const { return static_cast<int32_t>(threads.size()); }
+
+private:
+    ZrtpWorkerPool(const ZrtpWorkerPool& other) = delete;
+    ZrtpWorkerPool& operator=(const ZrtpWorkerPool& other) = delete;
+
+    void run();
+
+    std::mutex lock;
+    std::condition_variable wakeup;     // a strand is ready or the pool stops
+    std::condition_variable idle;       // a strand ran its last task
+    std::deque<Strand*> ready;
+    std::vector<std::thread> threads;
+    bool running;
+};
+
+/**
+ * @}
+ */
+#endif